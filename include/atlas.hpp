@@ -0,0 +1,516 @@
+/*
+MIT License
+
+Copyright (c) 2022 IkarusDeveloper
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#pragma once
+#ifndef INCLUDE_IMPLUSPLUS_ATLAS_HPP
+#define INCLUDE_IMPLUSPLUS_ATLAS_HPP
+#include "image.hpp"
+
+#include <string.h>
+#include <stdint.h>
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <unordered_map>
+#include <vector>
+#include "pixel.hpp"
+#include "error.hpp"
+#include "hash.hpp"
+#include "parallel.hpp"
+#include "simd.hpp"
+
+namespace impp
+{
+	enum atlas_packing {
+		ATLAS_PACK_SKYLINE = 0,     // bottom-left skyline, fast with many sprites
+		ATLAS_PACK_MAXRECTS,        // maxrects bottom-left, fills the holes the skyline leaves
+	};
+
+	struct atlas_options
+	{
+		uint32_t max_width = 4096;
+		uint32_t max_height = 4096;
+		uint32_t padding = 1;               // empty pixels between sprites
+		bool trim = true;                   // drops fully transparent borders of 32bit sprites
+		bool deduplicate = true;            // identical sprites share their pixels
+		bool power_of_two = false;          // rounds the atlas sides up to powers of two, never past the maximum size
+		atlas_packing packing = ATLAS_PACK_SKYLINE;
+		unsigned threads = 0;               // 0 uses every hardware thread
+	};
+
+	// where a sprite ended up, coordinates are top-left based as image_region
+	struct atlas_entry
+	{
+		uint32_t x = 0;                     // trimmed rectangle in the atlas
+		uint32_t y = 0;
+		uint32_t width = 0;                 // 0 for fully transparent sprites
+		uint32_t height = 0;
+		uint32_t trim_x = 0;                // offset of the trimmed rectangle inside the sprite
+		uint32_t trim_y = 0;
+		uint32_t source_width = 0;
+		uint32_t source_height = 0;
+		float u0 = 0, v0 = 0, u1 = 0, v1 = 0;  // texture coordinates, v grows downward
+		size_t duplicate_of = 0;            // sprite whose pixels are used, the sprite itself unless deduplicated
+	};
+
+	template<pixel_type pixel>
+	struct texture_atlas
+	{
+		image<pixel> canvas = image<pixel>::null();
+		std::vector<atlas_entry> entries;   // one per sprite in input order
+	};
+
+	namespace detail
+	{
+		struct atlas_rect
+		{
+			uint32_t x = 0, y = 0, width = 0, height = 0;
+		};
+
+		// index of the first pixel in [begin, end) with a non zero alpha, end when there is none
+		template<pixel_type pixel>
+		inline uint32_t atlas_first_opaque(const pixel* row, uint32_t begin, uint32_t end)
+		{
+			uint32_t x = begin;
+#ifdef IMPP_SIMD_SSE2
+			const __m128i mask = _mm_set1_epi32(static_cast<int>(0xFF000000u));
+			for (; x + 4 <= end; x += 4)
+			{
+				const __m128i alpha = _mm_and_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(row + x)), mask);
+				if (_mm_movemask_epi8(_mm_cmpeq_epi32(alpha, _mm_setzero_si128())) != 0xFFFF)
+					break;
+			}
+#endif
+			for (; x < end && row[x].a == 0; x++);
+			return x;
+		}
+
+		// index past the last pixel in [begin, end) with a non zero alpha, begin when there is none
+		template<pixel_type pixel>
+		inline uint32_t atlas_last_opaque(const pixel* row, uint32_t begin, uint32_t end)
+		{
+			uint32_t x = end;
+#ifdef IMPP_SIMD_SSE2
+			const __m128i mask = _mm_set1_epi32(static_cast<int>(0xFF000000u));
+			for (; x >= begin + 4; x -= 4)
+			{
+				const __m128i alpha = _mm_and_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(row + x - 4)), mask);
+				if (_mm_movemask_epi8(_mm_cmpeq_epi32(alpha, _mm_setzero_si128())) != 0xFFFF)
+					break;
+			}
+#endif
+			for (; x > begin && row[x - 1].a == 0; x--);
+			return x;
+		}
+
+		// smallest rectangle holding every pixel with a non zero alpha, empty for transparent sprites;
+		// rows only scan the columns outside of the bounds found so far
+		template<pixel_type pixel>
+		inline atlas_rect atlas_alpha_bounds(const image<pixel>& img)
+		{
+			if constexpr (!pixel_is32bit<pixel>)
+				return { 0, 0, img.width, img.height };
+			else
+			{
+				uint32_t left = img.width, right = 0, top = img.height, bottom = 0;
+				for (uint32_t y = 0; y < img.height; y++)
+				{
+					const auto* row = image_top_row(img, y);
+					const uint32_t first = atlas_first_opaque(row, 0, left);
+					const bool opaque = first < left || atlas_first_opaque(row, left, img.width) < img.width;
+					if (!opaque)
+						continue;
+					left = first;
+					right = std::max(right, atlas_last_opaque(row, right, img.width));
+					top = std::min(top, y);
+					bottom = y + 1;
+				}
+				if (bottom == 0)
+					return {};
+				return { left, top, right - left, bottom - top };
+			}
+		}
+
+		// hash of the pixels of a rectangle as stored, equal rectangles are confirmed by atlas_same_pixels
+		template<pixel_type pixel>
+		inline uint64_t atlas_hash(const image<pixel>& img, const atlas_rect& rect)
+		{
+			hash_state state(static_cast<uint64_t>(rect.width) << 32 | rect.height);
+			for (uint32_t y = 0; y < rect.height; y++)
+				state.update(image_top_row(img, rect.y + y) + rect.x, static_cast<size_t>(rect.width) * sizeof(pixel));
+			return state.finish().low;
+		}
+
+		template<pixel_type pixel>
+		inline bool atlas_same_pixels(const image<pixel>& a, const atlas_rect& ra, const image<pixel>& b, const atlas_rect& rb)
+		{
+			if (ra.width != rb.width || ra.height != rb.height)
+				return false;
+			for (uint32_t y = 0; y < ra.height; y++)
+				if (memcmp(image_top_row(a, ra.y + y) + ra.x, image_top_row(b, rb.y + y) + rb.x, ra.width * sizeof(pixel)) != 0)
+					return false;
+			return true;
+		}
+
+		// skyline packer, each node is a segment of the top edge of the packed area
+		class atlas_skyline
+		{
+		public:
+			atlas_skyline(uint32_t width, uint32_t height) : _width(width), _height(height)
+			{
+				_nodes.push_back({ 0, 0, width });
+			}
+
+			bool insert(uint32_t width, uint32_t height, uint32_t* x, uint32_t* y)
+			{
+				size_t best = SIZE_MAX;
+				uint32_t best_bottom = UINT32_MAX, best_width = UINT32_MAX, best_y = 0;
+				for (size_t i = 0; i < _nodes.size(); i++)
+				{
+					uint32_t top;
+					if (!fit(i, width, height, &top))
+						continue;
+					if (top + height < best_bottom || (top + height == best_bottom && _nodes[i].width < best_width))
+					{
+						best = i;
+						best_bottom = top + height;
+						best_width = _nodes[i].width;
+						best_y = top;
+					}
+				}
+				if (best == SIZE_MAX)
+					return false;
+
+				*x = _nodes[best].x;
+				*y = best_y;
+				place(best, *x, best_y + height, width);
+				return true;
+			}
+
+		private:
+			struct node { uint32_t x, y, width; };
+
+			bool fit(size_t index, uint32_t width, uint32_t height, uint32_t* top) const
+			{
+				const uint32_t x = _nodes[index].x;
+				if (x + width > _width)
+					return false;
+				uint32_t y = 0;
+				for (size_t i = index; i < _nodes.size() && _nodes[i].x < x + width; i++)
+				{
+					y = std::max(y, _nodes[i].y);
+					if (y + height > _height)
+						return false;
+				}
+				*top = y;
+				return true;
+			}
+
+			void place(size_t index, uint32_t x, uint32_t y, uint32_t width)
+			{
+				_nodes.insert(_nodes.begin() + index, { x, y, width });
+				// the nodes now under the new one shrink or disappear
+				size_t i = index + 1;
+				while (i < _nodes.size() && _nodes[i].x < x + width)
+				{
+					const uint32_t end = _nodes[i].x + _nodes[i].width;
+					if (end <= x + width)
+						_nodes.erase(_nodes.begin() + i);
+					else
+					{
+						_nodes[i].width = end - (x + width);
+						_nodes[i].x = x + width;
+						break;
+					}
+				}
+				for (i = 0; i + 1 < _nodes.size(); )
+				{
+					if (_nodes[i].y == _nodes[i + 1].y)
+					{
+						_nodes[i].width += _nodes[i + 1].width;
+						_nodes.erase(_nodes.begin() + i + 1);
+					}
+					else
+						i++;
+				}
+			}
+
+			uint32_t _width;
+			uint32_t _height;
+			std::vector<node> _nodes;
+		};
+
+		// maxrects packer with the bottom-left rule, free rectangles may overlap each other
+		class atlas_maxrects
+		{
+		public:
+			atlas_maxrects(uint32_t width, uint32_t height)
+			{
+				_free.push_back({ 0, 0, width, height });
+			}
+
+			bool insert(uint32_t width, uint32_t height, uint32_t* x, uint32_t* y)
+			{
+				const atlas_rect* best = nullptr;
+				for (const auto& free : _free)
+				{
+					if (free.width < width || free.height < height)
+						continue;
+					if (!best || free.y < best->y || (free.y == best->y && free.x < best->x))
+						best = &free;
+				}
+				if (!best)
+					return false;
+
+				const atlas_rect used{ best->x, best->y, width, height };
+				*x = used.x;
+				*y = used.y;
+				split(used);
+				return true;
+			}
+
+		private:
+			static bool contains(const atlas_rect& outer, const atlas_rect& inner)
+			{
+				return inner.x >= outer.x && inner.y >= outer.y && inner.x + inner.width <= outer.x + outer.width
+					&& inner.y + inner.height <= outer.y + outer.height;
+			}
+
+			// every free rectangle hit by used is replaced by the up to 4 pieces left around it
+			void split(const atlas_rect& used)
+			{
+				std::vector<atlas_rect> pieces;
+				for (size_t i = 0; i < _free.size(); )
+				{
+					const auto free = _free[i];
+					if (used.x >= free.x + free.width || used.x + used.width <= free.x || used.y >= free.y + free.height || used.y + used.height <= free.y)
+					{
+						i++;
+						continue;
+					}
+					if (used.x > free.x)
+						pieces.push_back({ free.x, free.y, used.x - free.x, free.height });
+					if (used.x + used.width < free.x + free.width)
+						pieces.push_back({ used.x + used.width, free.y, free.x + free.width - used.x - used.width, free.height });
+					if (used.y > free.y)
+						pieces.push_back({ free.x, free.y, free.width, used.y - free.y });
+					if (used.y + used.height < free.y + free.height)
+						pieces.push_back({ free.x, used.y + used.height, free.width, free.y + free.height - used.y - used.height });
+					_free[i] = _free.back();
+					_free.pop_back();
+				}
+
+				// pieces inside another free rectangle are redundant, and so are the old ones inside a piece
+				for (size_t p = 0; p < pieces.size(); p++)
+				{
+					bool redundant = std::any_of(_free.begin(), _free.end(), [&](const atlas_rect& free) { return contains(free, pieces[p]); });
+					for (size_t q = 0; q < pieces.size() && !redundant; q++)
+						redundant = q != p && contains(pieces[q], pieces[p]) && (!contains(pieces[p], pieces[q]) || q < p);
+					if (redundant)
+						continue;
+					_free.erase(std::remove_if(_free.begin(), _free.end(), [&](const atlas_rect& free) { return contains(pieces[p], free); }), _free.end());
+					_free.push_back(pieces[p]);
+				}
+			}
+
+			std::vector<atlas_rect> _free;
+		};
+
+		// positions of the sprites in order, false when one does not fit
+		template<class packer>
+		inline bool atlas_pack(packer& bin, const std::vector<size_t>& order, const std::vector<atlas_rect>& sizes, uint32_t padding, std::vector<atlas_rect>* placed)
+		{
+			for (const auto index : order)
+			{
+				auto& rect = (*placed)[index];
+				rect.width = sizes[index].width;
+				rect.height = sizes[index].height;
+				if (!bin.insert(rect.width + padding, rect.height + padding, &rect.x, &rect.y))
+					return false;
+			}
+			return true;
+		}
+
+		inline uint32_t atlas_power_of_two(uint32_t side)
+		{
+			uint32_t pot = 1;
+			while (pot < side)
+				pot <<= 1;
+			return pot;
+		}
+	}
+
+	// packs the sprites in a single image, the canvas is as small as the packing allows; sprites which do not fit
+	// in max_width x max_height fail the whole atlas
+	template<pixel_type pixel>
+	inline result<texture_atlas<pixel>> try_build_atlas(const std::vector<image<pixel>>& sprites, const atlas_options& options = {})
+	{
+		using detail::atlas_rect;
+		if (options.max_width == 0 || options.max_height == 0)
+			return error::error_info{ error::ERROR_INVALID_ARGUMENT, 0, "atlas: maximum size must not be 0.", true };
+
+		// rounding the sides up to powers of two stays within the largest ones the limits hold
+		const uint32_t max_width = options.power_of_two ? std::bit_floor(options.max_width) : options.max_width;
+		const uint32_t max_height = options.power_of_two ? std::bit_floor(options.max_height) : options.max_height;
+		for (const auto& sprite : sprites)
+			if (sprite.pixels.size() != static_cast<size_t>(sprite.width) * sprite.height)
+				return error::error_info{ error::ERROR_INVALID_ARGUMENT, 0, "atlas: sprite is inconsistent.", true };
+
+		// trimming and hashing are independent per sprite
+		const size_t count = sprites.size();
+		std::vector<atlas_rect> bounds(count);
+		std::vector<uint64_t> hashes(count);
+		detail::parallel_for(count, 64, options.threads, [&](size_t begin, size_t end) {
+			for (size_t i = begin; i < end; i++)
+			{
+				bounds[i] = options.trim ? detail::atlas_alpha_bounds(sprites[i]) : atlas_rect{ 0, 0, sprites[i].width, sprites[i].height };
+				if (options.deduplicate)
+					hashes[i] = detail::atlas_hash(sprites[i], bounds[i]);
+			}
+		});
+
+		texture_atlas<pixel> atlas;
+		atlas.entries.resize(count);
+		std::vector<size_t> order;
+		std::unordered_map<uint64_t, std::vector<size_t>> seen;
+		uint64_t area = 0;
+		uint32_t widest = 0;
+		for (size_t i = 0; i < count; i++)
+		{
+			auto& entry = atlas.entries[i];
+			entry.trim_x = bounds[i].x;
+			entry.trim_y = bounds[i].y;
+			entry.source_width = sprites[i].width;
+			entry.source_height = sprites[i].height;
+			entry.duplicate_of = i;
+			if (bounds[i].width == 0 || bounds[i].height == 0)
+				continue;
+
+			if (options.deduplicate)
+			{
+				auto& candidates = seen[hashes[i]];
+				const auto same = std::find_if(candidates.begin(), candidates.end(), [&](size_t other) {
+					return detail::atlas_same_pixels(sprites[other], bounds[other], sprites[i], bounds[i]);
+				});
+				if (same != candidates.end())
+				{
+					entry.duplicate_of = *same;
+					continue;
+				}
+				candidates.push_back(i);
+			}
+
+			order.push_back(i);
+			area += static_cast<uint64_t>(bounds[i].width + options.padding) * (bounds[i].height + options.padding);
+			widest = std::max(widest, bounds[i].width);
+		}
+		if (widest > max_width)
+			return error::error_info{ error::ERROR_INVALID_ARGUMENT, 0, "atlas: a sprite is wider than the atlas.", true };
+
+		// tallest first, the packers fill rows of similar heights
+		std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+			return bounds[a].height != bounds[b].height ? bounds[a].height > bounds[b].height : bounds[a].width > bounds[b].width;
+		});
+
+		// starts from a square holding the total area and doubles the width until everything fits
+		std::vector<atlas_rect> placed(count);
+		uint32_t width = static_cast<uint32_t>(std::min<double>(std::ceil(std::sqrt(static_cast<double>(area))), max_width));
+		width = std::max(width, widest);
+		if (options.power_of_two)
+			width = std::min(detail::atlas_power_of_two(width), max_width);
+		for (;;)
+		{
+			// the padding right of the last column falls outside of the atlas
+			const uint32_t bin_width = width + options.padding, bin_height = max_height + options.padding;
+			bool packed;
+			if (options.packing == ATLAS_PACK_MAXRECTS)
+			{
+				detail::atlas_maxrects bin(bin_width, bin_height);
+				packed = detail::atlas_pack(bin, order, bounds, options.padding, &placed);
+			}
+			else
+			{
+				detail::atlas_skyline bin(bin_width, bin_height);
+				packed = detail::atlas_pack(bin, order, bounds, options.padding, &placed);
+			}
+			if (packed)
+				break;
+			if (width >= max_width)
+				return error::error_info{ error::ERROR_INVALID_ARGUMENT, 0, "atlas: sprites do not fit in the maximum size.", true };
+			width = static_cast<uint32_t>(std::min<uint64_t>(static_cast<uint64_t>(width) * 2, max_width));
+		}
+
+		uint32_t used_width = 0, used_height = 0;
+		for (const auto index : order)
+		{
+			used_width = std::max(used_width, placed[index].x + placed[index].width);
+			used_height = std::max(used_height, placed[index].y + placed[index].height);
+		}
+		if (options.power_of_two && !order.empty())
+		{
+			used_width = detail::atlas_power_of_two(used_width);
+			used_height = detail::atlas_power_of_two(used_height);
+		}
+
+		atlas.canvas = image<pixel>::create(used_width, used_height);
+		IMPP_INSTRUMENT_ALLOCATION(atlas.canvas.pixels.size() * sizeof(pixel));
+
+		// sprites never overlap so each worker copies its own rows
+		detail::parallel_for(order.size(), 16, options.threads, [&](size_t begin, size_t end) {
+			for (size_t i = begin; i < end; i++)
+			{
+				const auto index = order[i];
+				const auto& from = bounds[index];
+				const auto& to = placed[index];
+				for (uint32_t y = 0; y < to.height; y++)
+					memcpy(detail::image_top_row(atlas.canvas, to.y + y) + to.x, detail::image_top_row(sprites[index], from.y + y) + from.x, to.width * sizeof(pixel));
+			}
+		});
+
+		for (auto& entry : atlas.entries)
+		{
+			const auto& rect = placed[entry.duplicate_of];
+			if (rect.width == 0 || rect.height == 0)
+				continue;
+			entry.x = rect.x;
+			entry.y = rect.y;
+			entry.width = rect.width;
+			entry.height = rect.height;
+			entry.u0 = static_cast<float>(rect.x) / used_width;
+			entry.v0 = static_cast<float>(rect.y) / used_height;
+			entry.u1 = static_cast<float>(rect.x + rect.width) / used_width;
+			entry.v1 = static_cast<float>(rect.y + rect.height) / used_height;
+		}
+		return atlas;
+	}
+
+	// returns an atlas with a null canvas on failure, the error is forwarded to the error handler
+	template<pixel_type pixel>
+	inline texture_atlas<pixel> build_atlas(const std::vector<image<pixel>>& sprites, const atlas_options& options = {})
+	{
+		auto res = try_build_atlas(sprites, options);
+		return error::detail::report(res) ? std::move(res).value() : texture_atlas<pixel>{};
+	}
+}
+
+#endif //INCLUDE_IMPLUSPLUS_ATLAS_HPP
@@ -0,0 +1,966 @@
+/*
+MIT License
+
+Copyright (c) 2022 IkarusDeveloper
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#pragma once
+#ifndef INCLUDE_IMPLUSPLUS_BC_HPP
+#define INCLUDE_IMPLUSPLUS_BC_HPP
+#include "image.hpp"
+
+#include <string.h>
+#include <stdint.h>
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <vector>
+#include "pixel.hpp"
+#include "error.hpp"
+#include "parallel.hpp"
+#include "simd.hpp"
+
+// gpu block compression, every 4x4 pixel block becomes 8 (bc1) or 16 bytes
+namespace impp
+{
+	namespace bc
+	{
+		enum bc_format : uint8_t {
+			BC_FORMAT_BC1 = 1,  // rgb with 1 bit alpha, 4 bits per pixel
+			BC_FORMAT_BC2 = 2,  // bc1 colors with explicit 4 bit alpha
+			BC_FORMAT_BC3 = 3,  // bc1 colors with interpolated alpha
+			BC_FORMAT_BC7 = 7,  // rgba, encoded with mode 6 only
+		};
+
+		// bc1 pixels with alpha below it become transparent
+		constexpr uint8_t BC1_ALPHA_THRESHOLD = 128;
+
+		inline bool is_valid_format(bc_format format)
+		{
+			return format == BC_FORMAT_BC1 || format == BC_FORMAT_BC2 || format == BC_FORMAT_BC3 || format == BC_FORMAT_BC7;
+		}
+
+		constexpr size_t get_block_size(bc_format format)
+		{
+			return format == BC_FORMAT_BC1 ? 8 : 16;
+		}
+
+		// bytes taken by the blocks covering a width x height surface
+		inline size_t get_compressed_size(bc_format format, uint32_t width, uint32_t height)
+		{
+			return ((static_cast<size_t>(width) + 3) / 4) * ((static_cast<size_t>(height) + 3) / 4) * get_block_size(format);
+		}
+
+		namespace detail
+		{
+			enum bc_color_mode {
+				BC_COLOR_FOUR,      // bc1 opaque block, c0 > c1
+				BC_COLOR_THREE,     // bc1 block with transparent pixels, c0 <= c1
+				BC_COLOR_FORCED,    // bc2/bc3 color block, always 4 colors
+			};
+
+			constexpr uint8_t bc7_weights2[] = { 0, 21, 43, 64 };
+			constexpr uint8_t bc7_weights3[] = { 0, 9, 18, 27, 37, 46, 55, 64 };
+			constexpr uint8_t bc7_weights4[] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+			inline uint16_t bc_read16(const uint8_t* bytes)
+			{
+				return static_cast<uint16_t>(bytes[0] | bytes[1] << 8);
+			}
+
+			inline uint32_t bc_read32(const uint8_t* bytes)
+			{
+				return uint32_t(bytes[0]) | uint32_t(bytes[1]) << 8 | uint32_t(bytes[2]) << 16 | uint32_t(bytes[3]) << 24;
+			}
+
+			inline void bc_write16(uint8_t* bytes, uint16_t value)
+			{
+				bytes[0] = static_cast<uint8_t>(value);
+				bytes[1] = static_cast<uint8_t>(value >> 8);
+			}
+
+			inline void bc_write32(uint8_t* bytes, uint32_t value)
+			{
+				for (int i = 0; i < 4; i++)
+					bytes[i] = static_cast<uint8_t>(value >> (i * 8));
+			}
+
+			// 128 bit little endian stream as bc7 blocks are laid out
+			struct bc_bits
+			{
+				uint64_t lo = 0;
+				uint64_t hi = 0;
+				unsigned pos = 0;
+
+				void put(uint64_t value, unsigned bits)
+				{
+					if (pos < 64)
+					{
+						lo |= value << pos;
+						if (pos + bits > 64)
+							hi |= value >> (64 - pos);
+					}
+					else
+						hi |= value << (pos - 64);
+					pos += bits;
+				}
+
+				uint32_t get(unsigned bits)
+				{
+					uint64_t value = pos < 64 ? lo >> pos : hi >> (pos - 64);
+					if (pos < 64 && pos + bits > 64)
+						value |= hi << (64 - pos);
+					pos += bits;
+					return static_cast<uint32_t>(value & ((uint64_t(1) << bits) - 1));
+				}
+
+				void load(const uint8_t* bytes)
+				{
+					lo = uint64_t(bc_read32(bytes)) | uint64_t(bc_read32(bytes + 4)) << 32;
+					hi = uint64_t(bc_read32(bytes + 8)) | uint64_t(bc_read32(bytes + 12)) << 32;
+					pos = 0;
+				}
+
+				void store(uint8_t* bytes) const
+				{
+					bc_write32(bytes, static_cast<uint32_t>(lo));
+					bc_write32(bytes + 4, static_cast<uint32_t>(lo >> 32));
+					bc_write32(bytes + 8, static_cast<uint32_t>(hi));
+					bc_write32(bytes + 12, static_cast<uint32_t>(hi >> 32));
+				}
+			};
+
+			inline pixel32rgba bc_unpack565(uint16_t color)
+			{
+				const int r = color >> 11 & 31, g = color >> 5 & 63, b = color & 31;
+				return { uint8_t(r << 3 | r >> 2), uint8_t(g << 2 | g >> 4), uint8_t(b << 3 | b >> 2), UINT8_MAX };
+			}
+
+			inline uint16_t bc_pack565(float r, float g, float b)
+			{
+				auto quantize = [](float value, float max) {
+					return static_cast<int>(std::clamp(value, 0.0f, 255.0f) * max / 255.0f + 0.5f);
+				};
+				return static_cast<uint16_t>(quantize(r, 31) << 11 | quantize(g, 63) << 5 | quantize(b, 31));
+			}
+
+			// colors of a bc1 block, c0 <= c1 selects 3 colors and transparent black unless forced as in bc2/bc3
+			inline void bc1_palette(uint16_t c0, uint16_t c1, bool forced, pixel32rgba* palette)
+			{
+				const auto e0 = bc_unpack565(c0), e1 = bc_unpack565(c1);
+				palette[0] = e0;
+				palette[1] = e1;
+				if (forced || c0 > c1)
+				{
+					palette[2] = { uint8_t((2 * e0.r + e1.r) / 3), uint8_t((2 * e0.g + e1.g) / 3), uint8_t((2 * e0.b + e1.b) / 3), UINT8_MAX };
+					palette[3] = { uint8_t((e0.r + 2 * e1.r) / 3), uint8_t((e0.g + 2 * e1.g) / 3), uint8_t((e0.b + 2 * e1.b) / 3), UINT8_MAX };
+				}
+				else
+				{
+					palette[2] = { uint8_t((e0.r + e1.r) / 2), uint8_t((e0.g + e1.g) / 2), uint8_t((e0.b + e1.b) / 2), UINT8_MAX };
+					palette[3] = { 0, 0, 0, 0 };
+				}
+			}
+
+			// endpoint pairs whose 2/3 interpolation gets closest to every 8 bit value, the 5 and 6 bit channels
+			// of a solid block are matched exactly or within 1 this way
+			struct bc_single_color
+			{
+				std::array<std::array<uint8_t, 2>, 256> match5;
+				std::array<std::array<uint8_t, 2>, 256> match6;
+
+				bc_single_color()
+				{
+					fill(match5, 5);
+					fill(match6, 6);
+				}
+
+				static void fill(std::array<std::array<uint8_t, 2>, 256>& match, int bits)
+				{
+					const int count = 1 << bits;
+					auto expand = [bits](int v) { return bits == 5 ? (v << 3 | v >> 2) : (v << 2 | v >> 4); };
+					for (int value = 0; value < 256; value++)
+					{
+						int best = INT32_MAX;
+						for (int e0 = 0; e0 < count; e0++)
+							for (int e1 = 0; e1 < count; e1++)
+							{
+								const int error = std::abs((2 * expand(e0) + expand(e1)) / 3 - value) * 256 + std::abs(e0 - e1);
+								if (error < best)
+								{
+									best = error;
+									match[value] = { uint8_t(e0), uint8_t(e1) };
+								}
+							}
+					}
+				}
+
+				static const bc_single_color& get()
+				{
+					static const bc_single_color table;
+					return table;
+				}
+			};
+
+			// nearest of the first count palette entries for every pixel, 2 bits each, rgb squared errors are
+			// summed into *error; pixels set in skip take index 3 and add nothing
+			inline uint32_t bc_color_indices(const pixel32rgba* block, const pixel32rgba* palette, int count, uint16_t skip, uint32_t* error)
+			{
+				uint32_t indices = 0, total = 0;
+#ifdef IMPP_SIMD_SSE2
+				const __m128i zero = _mm_setzero_si128();
+				const __m128i rgb = _mm_set1_epi32(0x00FFFFFF);
+				__m128i entries[4];
+				for (int j = 0; j < count; j++)
+				{
+					uint32_t value;
+					memcpy(&value, palette + j, sizeof(value));
+					entries[j] = _mm_unpacklo_epi8(_mm_and_si128(_mm_set1_epi32(static_cast<int>(value)), rgb), zero);
+				}
+
+				for (int i = 0; i < 16; i += 4)
+				{
+					const __m128i px = _mm_and_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(block + i)), rgb);
+					const __m128i lo = _mm_unpacklo_epi8(px, zero);
+					const __m128i hi = _mm_unpackhi_epi8(px, zero);
+					__m128i best = _mm_set1_epi32(INT32_MAX);
+					__m128i best_index = zero;
+					for (int j = 0; j < count; j++)
+					{
+						// madd leaves r*r+g*g and b*b per pixel, the shuffles pair them up
+						const __m128i dlo = _mm_sub_epi16(lo, entries[j]);
+						const __m128i dhi = _mm_sub_epi16(hi, entries[j]);
+						const __m128 slo = _mm_castsi128_ps(_mm_madd_epi16(dlo, dlo));
+						const __m128 shi = _mm_castsi128_ps(_mm_madd_epi16(dhi, dhi));
+						const __m128i dist = _mm_add_epi32(_mm_castps_si128(_mm_shuffle_ps(slo, shi, _MM_SHUFFLE(2, 0, 2, 0))),
+							_mm_castps_si128(_mm_shuffle_ps(slo, shi, _MM_SHUFFLE(3, 1, 3, 1))));
+						const __m128i closer = _mm_cmplt_epi32(dist, best);
+						best = _mm_or_si128(_mm_and_si128(closer, dist), _mm_andnot_si128(closer, best));
+						best_index = _mm_or_si128(_mm_and_si128(closer, _mm_set1_epi32(j)), _mm_andnot_si128(closer, best_index));
+					}
+
+					alignas(16) uint32_t index[4], dist[4];
+					_mm_store_si128(reinterpret_cast<__m128i*>(index), best_index);
+					_mm_store_si128(reinterpret_cast<__m128i*>(dist), best);
+					for (int k = 0; k < 4; k++)
+					{
+						const bool skipped = skip >> (i + k) & 1;
+						indices |= (skipped ? 3 : index[k]) << (2 * (i + k));
+						total += skipped ? 0 : dist[k];
+					}
+				}
+#else
+				for (int i = 0; i < 16; i++)
+				{
+					if (skip >> i & 1)
+					{
+						indices |= 3u << (2 * i);
+						continue;
+					}
+
+					uint32_t best = UINT32_MAX, best_index = 0;
+					for (int j = 0; j < count; j++)
+					{
+						const int dr = block[i].r - palette[j].r, dg = block[i].g - palette[j].g, db = block[i].b - palette[j].b;
+						const auto dist = static_cast<uint32_t>(dr * dr + dg * dg + db * db);
+						if (dist < best)
+						{
+							best = dist;
+							best_index = j;
+						}
+					}
+					indices |= best_index << (2 * i);
+					total += best;
+				}
+#endif
+				*error = total;
+				return indices;
+			}
+
+			struct bc_color_fit
+			{
+				uint16_t c0 = 0;
+				uint16_t c1 = 0;
+				uint32_t indices = 0;
+				uint32_t error = UINT32_MAX;
+				bool four = true;   // the palette holds 4 colors
+			};
+
+			// orders the endpoints for the mode and keeps them in *best when they beat it
+			inline void bc_color_evaluate(const pixel32rgba* block, uint16_t c0, uint16_t c1, bc_color_mode mode, uint16_t transparent, bc_color_fit* best)
+			{
+				if (mode == BC_COLOR_THREE ? c0 > c1 : c0 < c1)
+					std::swap(c0, c1);
+
+				pixel32rgba palette[4];
+				bc1_palette(c0, c1, mode == BC_COLOR_FORCED, palette);
+				const bool four = mode == BC_COLOR_FORCED || c0 > c1;
+				uint32_t error = 0;
+				const uint32_t indices = bc_color_indices(block, palette, four ? 4 : 3, transparent, &error);
+				if (error < best->error)
+					*best = { c0, c1, indices, error, four };
+			}
+
+			// mean and main direction of the colors, false when they are all the same
+			template<int channels>
+			inline bool bc_principal_axis(const float (*colors)[4], int count, float* mean, float* axis)
+			{
+				for (int c = 0; c < channels; c++)
+				{
+					mean[c] = 0;
+					for (int i = 0; i < count; i++)
+						mean[c] += colors[i][c];
+					mean[c] /= static_cast<float>(count);
+				}
+
+				float cov[4][4] = {};
+				for (int i = 0; i < count; i++)
+				{
+					float d[4];
+					for (int c = 0; c < channels; c++)
+						d[c] = colors[i][c] - mean[c];
+					for (int j = 0; j < channels; j++)
+						for (int k = j; k < channels; k++)
+							cov[j][k] += d[j] * d[k];
+				}
+				for (int j = 0; j < channels; j++)
+					for (int k = 0; k < j; k++)
+						cov[j][k] = cov[k][j];
+
+				// power iteration from the row of the widest channel, 16 samples converge in a few steps
+				int widest = 0;
+				for (int c = 1; c < channels; c++)
+					if (cov[c][c] > cov[widest][widest])
+						widest = c;
+				if (cov[widest][widest] <= 0.0f)
+					return false;
+
+				for (int c = 0; c < channels; c++)
+					axis[c] = cov[widest][c];
+				for (int iteration = 0; iteration < 8; iteration++)
+				{
+					float next[4] = {}, norm = 0;
+					for (int j = 0; j < channels; j++)
+					{
+						for (int k = 0; k < channels; k++)
+							next[j] += cov[j][k] * axis[k];
+						norm = std::max(norm, std::fabs(next[j]));
+					}
+					if (norm <= 0.0f)
+						break;
+					for (int c = 0; c < channels; c++)
+						axis[c] = next[c] / norm;
+				}
+
+				float length = 0;
+				for (int c = 0; c < channels; c++)
+					length += axis[c] * axis[c];
+				length = std::sqrt(length);
+				for (int c = 0; c < channels; c++)
+					axis[c] /= length;
+				return true;
+			}
+
+			// ends of the colors projected on the axis
+			template<int channels>
+			inline void bc_axis_bounds(const float (*colors)[4], int count, const float* mean, const float* axis, float* lo, float* hi)
+			{
+				float tmin = 0, tmax = 0;
+				for (int i = 0; i < count; i++)
+				{
+					float t = 0;
+					for (int c = 0; c < channels; c++)
+						t += (colors[i][c] - mean[c]) * axis[c];
+					tmin = std::min(tmin, t);
+					tmax = std::max(tmax, t);
+				}
+				for (int c = 0; c < channels; c++)
+				{
+					lo[c] = std::clamp(mean[c] + tmin * axis[c], 0.0f, 255.0f);
+					hi[c] = std::clamp(mean[c] + tmax * axis[c], 0.0f, 255.0f);
+				}
+			}
+
+			// endpoints minimizing the squared error for fixed interpolation weights, weight[i] belongs to e0
+			template<int channels>
+			inline bool bc_least_squares(const float (*colors)[4], const float* weight, int count, float* e0, float* e1)
+			{
+				float aa = 0, ab = 0, bb = 0, xa[4] = {}, xb[4] = {};
+				for (int i = 0; i < count; i++)
+				{
+					const float a = weight[i], b = 1.0f - a;
+					aa += a * a;
+					ab += a * b;
+					bb += b * b;
+					for (int c = 0; c < channels; c++)
+					{
+						xa[c] += a * colors[i][c];
+						xb[c] += b * colors[i][c];
+					}
+				}
+
+				const float det = aa * bb - ab * ab;
+				if (std::fabs(det) < 1e-4f)
+					return false;
+				for (int c = 0; c < channels; c++)
+				{
+					e0[c] = std::clamp((bb * xa[c] - ab * xb[c]) / det, 0.0f, 255.0f);
+					e1[c] = std::clamp((aa * xb[c] - ab * xa[c]) / det, 0.0f, 255.0f);
+				}
+				return true;
+			}
+
+			// 8 byte bc1 color block
+			inline void bc_compress_color(const pixel32rgba* block, bc_color_mode mode, uint8_t* out)
+			{
+				uint16_t transparent = 0;
+				if (mode == BC_COLOR_THREE)
+					for (int i = 0; i < 16; i++)
+						if (block[i].a < BC1_ALPHA_THRESHOLD)
+							transparent |= static_cast<uint16_t>(1u << i);
+				if (transparent == 0 && mode == BC_COLOR_THREE)
+					mode = BC_COLOR_FOUR;
+
+				float colors[16][4];
+				int count = 0;
+				bool solid = true;
+				for (int i = 0; i < 16; i++)
+					if (!(transparent >> i & 1))
+					{
+						colors[count][0] = block[i].r;
+						colors[count][1] = block[i].g;
+						colors[count][2] = block[i].b;
+						solid = solid && colors[count][0] == colors[0][0] && colors[count][1] == colors[0][1] && colors[count][2] == colors[0][2];
+						count++;
+					}
+
+				bc_color_fit best;
+				if (count == 0)
+				{
+					best.indices = UINT32_MAX;
+				}
+				else
+				{
+					float mean[4] = { colors[0][0], colors[0][1], colors[0][2] }, axis[4], lo[4], hi[4];
+					if (solid || !bc_principal_axis<3>(colors, count, mean, axis))
+					{
+						// solid color, the tables interpolate it with index 2 in the 4 color modes
+						const auto& table = bc_single_color::get();
+						const auto r = static_cast<int>(mean[0]), g = static_cast<int>(mean[1]), b = static_cast<int>(mean[2]);
+						if (mode != BC_COLOR_THREE)
+						{
+							const auto c0 = static_cast<uint16_t>(table.match5[r][0] << 11 | table.match6[g][0] << 5 | table.match5[b][0]);
+							const auto c1 = static_cast<uint16_t>(table.match5[r][1] << 11 | table.match6[g][1] << 5 | table.match5[b][1]);
+							bc_color_evaluate(block, c0, c1, mode, transparent, &best);
+						}
+						else
+						{
+							const auto c = bc_pack565(mean[0], mean[1], mean[2]);
+							bc_color_evaluate(block, c, c, mode, transparent, &best);
+						}
+					}
+					else
+					{
+						bc_axis_bounds<3>(colors, count, mean, axis, lo, hi);
+						bc_color_evaluate(block, bc_pack565(hi[0], hi[1], hi[2]), bc_pack565(lo[0], lo[1], lo[2]), mode, transparent, &best);
+
+						// refit the endpoints to the chosen indices while that keeps helping
+						for (int iteration = 0; iteration < 2 && best.error != 0; iteration++)
+						{
+							constexpr float four[] = { 1.0f, 0.0f, 2.0f / 3.0f, 1.0f / 3.0f };
+							constexpr float three[] = { 1.0f, 0.0f, 0.5f, 0.0f };
+							float weight[16];
+							const float* weights = best.four ? four : three;
+							for (int i = 0, n = 0; i < 16; i++)
+								if (!(transparent >> i & 1))
+									weight[n++] = weights[best.indices >> (2 * i) & 3];
+
+							float e0[4], e1[4];
+							if (!bc_least_squares<3>(colors, weight, count, e0, e1))
+								break;
+							const auto previous = best.error;
+							bc_color_evaluate(block, bc_pack565(e0[0], e0[1], e0[2]), bc_pack565(e1[0], e1[1], e1[2]), mode, transparent, &best);
+							if (best.error == previous)
+								break;
+						}
+					}
+				}
+
+				bc_write16(out, best.c0);
+				bc_write16(out + 2, best.c1);
+				bc_write32(out + 4, best.indices);
+			}
+
+			// 8 byte bc3 alpha block, a0 > a1 selects 8 interpolated values
+			inline void bc_compress_alpha(const pixel32rgba* block, uint8_t* out)
+			{
+				uint8_t amin = UINT8_MAX, amax = 0;
+				for (int i = 0; i < 16; i++)
+				{
+					amin = std::min(amin, block[i].a);
+					amax = std::max(amax, block[i].a);
+				}
+
+				out[0] = amax;
+				out[1] = amin;
+				uint64_t indices = 0;
+				if (amax != amin)
+				{
+					// the palette runs from a0 to a1 in 7 steps, entries 0 and 1 are the ends
+					constexpr uint8_t order[] = { 0, 2, 3, 4, 5, 6, 7, 1 };
+					const int range = amax - amin;
+					for (int i = 0; i < 16; i++)
+					{
+						const int step = ((amax - block[i].a) * 7 + range / 2) / range;
+						indices |= uint64_t(order[step]) << (3 * i);
+					}
+				}
+				for (int i = 0; i < 6; i++)
+					out[2 + i] = static_cast<uint8_t>(indices >> (8 * i));
+			}
+
+			// 16 byte bc2 alpha block, 4 bits per pixel
+			inline void bc_compress_explicit_alpha(const pixel32rgba* block, uint8_t* out)
+			{
+				for (int i = 0; i < 8; i++)
+				{
+					const int a0 = (block[2 * i].a + 8) / 17, a1 = (block[2 * i + 1].a + 8) / 17;
+					out[i] = static_cast<uint8_t>(a0 | a1 << 4);
+				}
+			}
+
+			struct bc7_mode6_fit
+			{
+				int q[2][4] = {};       // 7 bit endpoints
+				int p[2] = {};          // their shared low bits
+				uint8_t indices[16] = {};
+				uint32_t error = UINT32_MAX;
+			};
+
+			// indexes the block against the endpoints of fit, kept in *best when it beats it
+			inline void bc7_mode6_index(const pixel32rgba* block, bc7_mode6_fit fit, bc7_mode6_fit* best)
+			{
+				int e[2][4], palette[16][4];
+				for (int k = 0; k < 2; k++)
+					for (int c = 0; c < 4; c++)
+						e[k][c] = fit.q[k][c] << 1 | fit.p[k];
+				for (int i = 0; i < 16; i++)
+					for (int c = 0; c < 4; c++)
+						palette[i][c] = ((64 - bc7_weights4[i]) * e[0][c] + bc7_weights4[i] * e[1][c] + 32) >> 6;
+
+				int d[4], dd = 0;
+				for (int c = 0; c < 4; c++)
+				{
+					d[c] = e[1][c] - e[0][c];
+					dd += d[c] * d[c];
+				}
+
+				// the palette lies on a line, the projection finds the neighborhood of the nearest entry
+				const float scale = dd != 0 ? 15.0f / static_cast<float>(dd) : 0.0f;
+				fit.error = 0;
+				for (int i = 0; i < 16 && fit.error < best->error; i++)
+				{
+					const int px[4] = { block[i].r, block[i].g, block[i].b, block[i].a };
+					int dot = 0;
+					for (int c = 0; c < 4; c++)
+						dot += (px[c] - e[0][c]) * d[c];
+					const int guess = static_cast<int>(std::clamp(static_cast<float>(dot) * scale + 0.5f, 0.0f, 15.0f));
+
+					uint32_t best_error = UINT32_MAX;
+					for (int j = std::max(guess - 1, 0); j <= std::min(guess + 1, 15); j++)
+					{
+						uint32_t error = 0;
+						for (int c = 0; c < 4; c++)
+							error += static_cast<uint32_t>((px[c] - palette[j][c]) * (px[c] - palette[j][c]));
+						if (error < best_error)
+						{
+							best_error = error;
+							fit.indices[i] = static_cast<uint8_t>(j);
+						}
+					}
+					fit.error += best_error;
+				}
+
+				if (fit.error < best->error)
+					*best = fit;
+			}
+
+			// quantizes both endpoints with the p-bit closest to them and indexes the block
+			inline void bc7_mode6_evaluate(const pixel32rgba* block, const float* lo, const float* hi, bc7_mode6_fit* best)
+			{
+				const float* ends[2] = { lo, hi };
+				bc7_mode6_fit fit;
+				for (int k = 0; k < 2; k++)
+				{
+					float best_error = 0;
+					for (int p = 0; p < 2; p++)
+					{
+						int q[4];
+						float error = 0;
+						for (int c = 0; c < 4; c++)
+						{
+							q[c] = std::clamp(static_cast<int>((ends[k][c] - p) * 0.5f + 0.5f), 0, 127);
+							const float delta = ends[k][c] - static_cast<float>(q[c] << 1 | p);
+							error += delta * delta;
+						}
+						if (p == 0 || error < best_error)
+						{
+							best_error = error;
+							fit.p[k] = p;
+							std::copy_n(q, 4, fit.q[k]);
+						}
+					}
+				}
+				bc7_mode6_index(block, fit, best);
+			}
+
+			// 16 byte bc7 block in mode 6: one subset, 7 bit rgba endpoints with a p-bit each, 4 bit indices
+			inline void bc7_compress_block(const pixel32rgba* block, uint8_t* out)
+			{
+				float colors[16][4];
+				for (int i = 0; i < 16; i++)
+				{
+					colors[i][0] = block[i].r;
+					colors[i][1] = block[i].g;
+					colors[i][2] = block[i].b;
+					colors[i][3] = block[i].a;
+				}
+
+				float mean[4], axis[4], lo[4], hi[4];
+				const bool solid = std::all_of(block + 1, block + 16, [&](const pixel32rgba& px) { return px == block[0]; });
+				if (!solid && bc_principal_axis<4>(colors, 16, mean, axis))
+					bc_axis_bounds<4>(colors, 16, mean, axis, lo, hi);
+				else
+					for (int c = 0; c < 4; c++)
+						lo[c] = hi[c] = colors[0][c];
+
+				bc7_mode6_fit best;
+				bc7_mode6_evaluate(block, lo, hi, &best);
+				for (int iteration = 0; iteration < 2 && best.error != 0; iteration++)
+				{
+					float weight[16];
+					for (int i = 0; i < 16; i++)
+						weight[i] = 1.0f - bc7_weights4[best.indices[i]] / 64.0f;
+					if (!bc_least_squares<4>(colors, weight, 16, lo, hi))
+						break;
+					const auto previous = best.error;
+					bc7_mode6_evaluate(block, lo, hi, &best);
+					if (best.error == previous)
+						break;
+				}
+
+				// the first index has an implicit 0 top bit, mirroring the endpoints keeps the colors
+				if (best.indices[0] & 8)
+				{
+					std::swap(best.q[0], best.q[1]);
+					std::swap(best.p[0], best.p[1]);
+					for (auto& index : best.indices)
+						index = static_cast<uint8_t>(15 - index);
+				}
+
+				bc_bits bits;
+				bits.put(1 << 6, 7);
+				for (int c = 0; c < 4; c++)
+				{
+					bits.put(static_cast<uint64_t>(best.q[0][c]), 7);
+					bits.put(static_cast<uint64_t>(best.q[1][c]), 7);
+				}
+				bits.put(static_cast<uint64_t>(best.p[0]), 1);
+				bits.put(static_cast<uint64_t>(best.p[1]), 1);
+				bits.put(best.indices[0], 3);
+				for (int i = 1; i < 16; i++)
+					bits.put(best.indices[i], 4);
+				bits.store(out);
+			}
+
+			inline void bc_compress_block(bc_format format, const pixel32rgba* block, uint8_t* out)
+			{
+				switch (format)
+				{
+				case BC_FORMAT_BC1:
+					bc_compress_color(block, BC_COLOR_THREE, out);
+					break;
+				case BC_FORMAT_BC2:
+					bc_compress_explicit_alpha(block, out);
+					bc_compress_color(block, BC_COLOR_FORCED, out + 8);
+					break;
+				case BC_FORMAT_BC3:
+					bc_compress_alpha(block, out);
+					bc_compress_color(block, BC_COLOR_FORCED, out + 8);
+					break;
+				case BC_FORMAT_BC7:
+					bc7_compress_block(block, out);
+					break;
+				}
+			}
+
+			inline void bc_decompress_color(const uint8_t* in, bool forced, pixel32rgba* block)
+			{
+				pixel32rgba palette[4];
+				bc1_palette(bc_read16(in), bc_read16(in + 2), forced, palette);
+				const uint32_t indices = bc_read32(in + 4);
+				for (int i = 0; i < 16; i++)
+					block[i] = palette[indices >> (2 * i) & 3];
+			}
+
+			inline void bc_decompress_alpha(const uint8_t* in, pixel32rgba* block)
+			{
+				const int a0 = in[0], a1 = in[1];
+				uint8_t palette[8] = { in[0], in[1] };
+				if (a0 > a1)
+				{
+					for (int i = 1; i < 7; i++)
+						palette[i + 1] = static_cast<uint8_t>(((7 - i) * a0 + i * a1) / 7);
+				}
+				else
+				{
+					for (int i = 1; i < 5; i++)
+						palette[i + 1] = static_cast<uint8_t>(((5 - i) * a0 + i * a1) / 5);
+					palette[6] = 0;
+					palette[7] = UINT8_MAX;
+				}
+
+				uint64_t indices = 0;
+				for (int i = 0; i < 6; i++)
+					indices |= uint64_t(in[2 + i]) << (8 * i);
+				for (int i = 0; i < 16; i++)
+					block[i].a = palette[indices >> (3 * i) & 7];
+			}
+
+			// modes 4, 5 and 6, the single subset ones; false for the partitioned modes
+			inline bool bc7_decompress_block(const uint8_t* in, pixel32rgba* block)
+			{
+				bc_bits bits;
+				bits.load(in);
+				int mode = 0;
+				while (mode < 8 && bits.get(1) == 0)
+					mode++;
+
+				if (mode == 8)
+				{
+					// reserved mode, decoders output transparent black
+					std::fill_n(block, 16, pixel32rgba{ 0, 0, 0, 0 });
+					return true;
+				}
+				if (mode < 4 || mode == 7)
+					return false;
+
+				int e[2][4];
+				int rotation = 0, index_mode = 0;
+				const uint8_t* color_weights = bc7_weights4;
+				const uint8_t* alpha_weights = bc7_weights4;
+				uint8_t color_index[16], alpha_index[16];
+
+				if (mode == 6)
+				{
+					for (int c = 0; c < 4; c++)
+					{
+						e[0][c] = static_cast<int>(bits.get(7));
+						e[1][c] = static_cast<int>(bits.get(7));
+					}
+					const int p0 = static_cast<int>(bits.get(1)), p1 = static_cast<int>(bits.get(1));
+					for (int c = 0; c < 4; c++)
+					{
+						e[0][c] = e[0][c] << 1 | p0;
+						e[1][c] = e[1][c] << 1 | p1;
+					}
+					for (int i = 0; i < 16; i++)
+						color_index[i] = alpha_index[i] = static_cast<uint8_t>(bits.get(i == 0 ? 3 : 4));
+				}
+				else
+				{
+					rotation = static_cast<int>(bits.get(2));
+					if (mode == 4)
+						index_mode = static_cast<int>(bits.get(1));
+
+					const unsigned color_bits = mode == 4 ? 5 : 7, alpha_bits = mode == 4 ? 6 : 8;
+					for (int c = 0; c < 3; c++)
+					{
+						e[0][c] = static_cast<int>(bits.get(color_bits));
+						e[1][c] = static_cast<int>(bits.get(color_bits));
+						e[0][c] = e[0][c] << (8 - color_bits) | e[0][c] >> (2 * color_bits - 8);
+						e[1][c] = e[1][c] << (8 - color_bits) | e[1][c] >> (2 * color_bits - 8);
+					}
+					e[0][3] = static_cast<int>(bits.get(alpha_bits));
+					e[1][3] = static_cast<int>(bits.get(alpha_bits));
+					if (alpha_bits < 8)
+					{
+						e[0][3] = e[0][3] << (8 - alpha_bits) | e[0][3] >> (2 * alpha_bits - 8);
+						e[1][3] = e[1][3] << (8 - alpha_bits) | e[1][3] >> (2 * alpha_bits - 8);
+					}
+
+					// mode 4 stores a 2 bit and a 3 bit index set, the index mode tells which one colors use
+					uint8_t first[16], second[16];
+					for (int i = 0; i < 16; i++)
+						first[i] = static_cast<uint8_t>(bits.get(i == 0 ? 1 : 2));
+					const unsigned second_bits = mode == 4 ? 3 : 2;
+					for (int i = 0; i < 16; i++)
+						second[i] = static_cast<uint8_t>(bits.get(i == 0 ? second_bits - 1 : second_bits));
+
+					const uint8_t* second_weights = mode == 4 ? bc7_weights3 : bc7_weights2;
+					if (index_mode == 0)
+					{
+						memcpy(color_index, first, sizeof(first));
+						memcpy(alpha_index, second, sizeof(second));
+						color_weights = bc7_weights2;
+						alpha_weights = second_weights;
+					}
+					else
+					{
+						memcpy(color_index, second, sizeof(second));
+						memcpy(alpha_index, first, sizeof(first));
+						color_weights = second_weights;
+						alpha_weights = bc7_weights2;
+					}
+				}
+
+				for (int i = 0; i < 16; i++)
+				{
+					int px[4];
+					const int wc = color_weights[color_index[i]], wa = alpha_weights[alpha_index[i]];
+					for (int c = 0; c < 3; c++)
+						px[c] = ((64 - wc) * e[0][c] + wc * e[1][c] + 32) >> 6;
+					px[3] = ((64 - wa) * e[0][3] + wa * e[1][3] + 32) >> 6;
+					if (rotation != 0)
+						std::swap(px[3], px[rotation - 1]);
+					block[i] = { uint8_t(px[0]), uint8_t(px[1]), uint8_t(px[2]), uint8_t(px[3]) };
+				}
+				return true;
+			}
+
+			inline bool bc_decompress_block(bc_format format, const uint8_t* in, pixel32rgba* block)
+			{
+				switch (format)
+				{
+				case BC_FORMAT_BC1:
+					bc_decompress_color(in, false, block);
+					return true;
+				case BC_FORMAT_BC2:
+					bc_decompress_color(in + 8, true, block);
+					for (int i = 0; i < 16; i++)
+						block[i].a = static_cast<uint8_t>((in[i / 2] >> (4 * (i & 1)) & 15) * 17);
+					return true;
+				case BC_FORMAT_BC3:
+					bc_decompress_color(in + 8, true, block);
+					bc_decompress_alpha(in, block);
+					return true;
+				case BC_FORMAT_BC7:
+					return bc7_decompress_block(in, block);
+				}
+				return false;
+			}
+
+			// gathers the block at block column bx and row by counting from the top, pixels past the right
+			// and bottom edges repeat the last column and row
+			inline void bc_load_block(const image<pixel32rgba>& source, uint32_t bx, uint32_t by, pixel32rgba* block)
+			{
+				for (uint32_t y = 0; y < 4; y++)
+				{
+					const uint32_t top = std::min(by * 4 + y, source.height - 1);
+					const auto* row = source.pixels.data() + static_cast<size_t>(source.height - 1 - top) * source.width;
+					if (bx * 4 + 4 <= source.width)
+						memcpy(block + y * 4, row + bx * 4, 4 * sizeof(pixel32rgba));
+					else
+						for (uint32_t x = 0; x < 4; x++)
+							block[y * 4 + x] = row[std::min(bx * 4 + x, source.width - 1)];
+				}
+			}
+
+			// decodes the blocks into bottom-up rows, false with the failing block offset in *offset
+			template<pixel_type pixel>
+			inline bool bc_decompress_pixels(const uint8_t* blocks, bc_format format, uint32_t width, uint32_t height, pixel* pixels, size_t* offset)
+			{
+				const uint32_t blocks_x = (width + 3) / 4, blocks_y = (height + 3) / 4;
+				const size_t block_size = get_block_size(format);
+				pixel32rgba block[16];
+				for (uint32_t by = 0; by < blocks_y; by++)
+					for (uint32_t bx = 0; bx < blocks_x; bx++)
+					{
+						const size_t at = (static_cast<size_t>(by) * blocks_x + bx) * block_size;
+						if (!bc_decompress_block(format, blocks + at, block))
+						{
+							*offset = at;
+							return false;
+						}
+
+						const uint32_t w = std::min(4u, width - bx * 4), h = std::min(4u, height - by * 4);
+						for (uint32_t y = 0; y < h; y++)
+						{
+							auto* dst = pixels + static_cast<size_t>(height - 1 - (by * 4 + y)) * width + bx * 4;
+							for (uint32_t x = 0; x < w; x++)
+								dst[x] = pixel_cast<pixel>(block[y * 4 + x]);
+						}
+					}
+				return true;
+			}
+		}
+
+		// compresses into get_compressed_size bytes at out, blocks go left to right and top to bottom as gpus
+		// expect them; rows of blocks are spread over threads workers, 0 uses every hardware thread
+		inline void compress(const image<pixel32rgba>& source, bc_format format, uint8_t* out, unsigned threads = 0)
+		{
+			if (!is_valid_format(format) || source.width == 0 || source.height == 0 || source.pixels.size() != static_cast<size_t>(source.width) * source.height)
+				return;
+
+			const uint32_t blocks_x = (source.width + 3) / 4, blocks_y = (source.height + 3) / 4;
+			const size_t block_size = get_block_size(format);
+			const size_t grain = std::max<size_t>(1, 1024 / blocks_x);
+			impp::detail::parallel_for(blocks_y, grain, threads, [&](size_t begin, size_t end) {
+				pixel32rgba block[16];
+				for (size_t by = begin; by < end; by++)
+				{
+					auto* dst = out + by * blocks_x * block_size;
+					for (uint32_t bx = 0; bx < blocks_x; bx++, dst += block_size)
+					{
+						detail::bc_load_block(source, bx, static_cast<uint32_t>(by), block);
+						detail::bc_compress_block(format, block, dst);
+					}
+				}
+			});
+		}
+
+		// empty when the format is unknown or the image is empty or inconsistent
+		inline std::vector<uint8_t> compress(const image<pixel32rgba>& source, bc_format format, unsigned threads = 0)
+		{
+			if (!is_valid_format(format) || source.width == 0 || source.height == 0 || source.pixels.size() != static_cast<size_t>(source.width) * source.height)
+				return {};
+			std::vector<uint8_t> blocks(get_compressed_size(format, source.width, source.height));
+			compress(source, format, blocks.data(), threads);
+			return blocks;
+		}
+
+		// bc7 blocks are decoded in the single subset modes 4 to 6 only, others fail as unsupported
+		inline result<image<pixel32rgba>> try_decompress(const void* blocks, size_t size, bc_format format, uint32_t width, uint32_t height)
+		{
+			if (!is_valid_format(format) || width == 0 || height == 0)
+				return error::error_info{ error::ERROR_INVALID_ARGUMENT, 0, "bc: unknown format or empty size." };
+			if (size < get_compressed_size(format, width, height))
+				return error::error_info{ error::ERROR_TRUNCATED, size, "bc: blocks do not cover the size." };
+
+			auto img = image<pixel32rgba>::create(width, height);
+			size_t offset = 0;
+			if (!detail::bc_decompress_pixels(reinterpret_cast<const uint8_t*>(blocks), format, width, height, img.pixels.data(), &offset))
+				return error::error_info{ error::ERROR_UNSUPPORTED, offset, "bc: bc7 block mode is not supported." };
+			return img;
+		}
+	}
+}
+
+#endif //INCLUDE_IMPLUSPLUS_BC_HPP
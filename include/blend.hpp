@@ -0,0 +1,280 @@
+/*
+MIT License
+
+Copyright (c) 2022 IkarusDeveloper
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#pragma once
+#ifndef INCLUDE_IMPLUSPLUS_BLEND_HPP
+#define INCLUDE_IMPLUSPLUS_BLEND_HPP
+#include <string.h>
+#include <stdint.h>
+#include <algorithm>
+#include <array>
+#include "pixel.hpp"
+#include "simd.hpp"
+
+namespace impp
+{
+	// compositing modes used when drawing a source over a destination
+	// 24bit pixels have no alpha so they are treated as opaque
+	enum blend_mode
+	{
+		BLEND_NONE = 0,                    // source replaces destination
+		BLEND_SRC_OVER = 1,                // straight alpha source over destination
+		BLEND_SRC_OVER_PREMULTIPLIED = 2,  // premultiplied alpha source over premultiplied destination
+		BLEND_ADDITIVE = 3,                // destination plus source weighted by its alpha
+		BLEND_MULTIPLY = 4,                // destination modulated by source weighted by its alpha
+	};
+
+	namespace detail
+	{
+		// 255 / alpha in 8.24 fixed point used to unpremultiply without divisions
+		inline constexpr auto unpremultiply_table = []() {
+			std::array<uint64_t, 256> table{};
+			for (uint64_t a = 1; a < 256; a++)
+				table[a] = ((uint64_t(UINT8_MAX) << 24) + a - 1) / a;
+			return table;
+		}();
+
+		// every 32bit pixel keeps alpha in its fourth byte, colors are blended whatever their order is
+		inline void blend_pixel32(const uint8_t* src, uint8_t* dst, blend_mode mode)
+		{
+			const uint32_t a = src[3];
+			const uint32_t inv = UINT8_MAX - a;
+
+			switch (mode)
+			{
+			case BLEND_NONE:
+				memcpy(dst, src, 4);
+				return;
+
+			case BLEND_SRC_OVER:
+				for (size_t c = 0; c < 3; c++)
+					dst[c] = div255(src[c] * a + dst[c] * inv);
+				break;
+
+			case BLEND_SRC_OVER_PREMULTIPLIED:
+				for (size_t c = 0; c < 3; c++)
+					dst[c] = static_cast<uint8_t>(std::min<uint32_t>(UINT8_MAX, src[c] + div255(dst[c] * inv)));
+				break;
+
+			case BLEND_ADDITIVE:
+				for (size_t c = 0; c < 3; c++)
+					dst[c] = static_cast<uint8_t>(std::min<uint32_t>(UINT8_MAX, dst[c] + div255(src[c] * a)));
+				break;
+
+			case BLEND_MULTIPLY:
+				for (size_t c = 0; c < 3; c++)
+					dst[c] = div255(dst[c] * (div255(src[c] * a) + inv));
+				break;
+			}
+
+			// coverage always accumulates as in source over
+			dst[3] = static_cast<uint8_t>(a + div255(dst[3] * inv));
+		}
+
+		inline void blend_pixel24(const uint8_t* src, uint8_t* dst, blend_mode mode)
+		{
+			switch (mode)
+			{
+			case BLEND_ADDITIVE:
+				for (size_t c = 0; c < 3; c++)
+					dst[c] = static_cast<uint8_t>(std::min<uint32_t>(UINT8_MAX, dst[c] + src[c]));
+				break;
+
+			case BLEND_MULTIPLY:
+				for (size_t c = 0; c < 3; c++)
+					dst[c] = div255(dst[c] * src[c]);
+				break;
+
+			default:
+				memcpy(dst, src, 3);
+				break;
+			}
+		}
+
+#ifdef IMPP_SIMD_SSE2
+		// blends two 32bit pixels unpacked into 16bit lanes
+		inline __m128i simd_blend_pixel32_epu16(__m128i src, __m128i dst, blend_mode mode)
+		{
+			const auto alphamask = _mm_set_epi16(-1, 0, 0, 0, -1, 0, 0, 0);
+			const auto full = _mm_set1_epi16(UINT8_MAX);
+			const auto a = simd_alpha_epu16(src);
+			const auto inv = _mm_sub_epi16(full, a);
+
+			// source over with alpha lanes weighted by 255 gives a + d * (1 - a) as output coverage
+			const auto weight = _mm_or_si128(_mm_andnot_si128(alphamask, a), _mm_and_si128(alphamask, full));
+			const auto over = simd_div255_epu16(_mm_add_epi16(_mm_mullo_epi16(src, weight), _mm_mullo_epi16(dst, inv)));
+
+			__m128i colors;
+			switch (mode)
+			{
+			case BLEND_SRC_OVER:
+				return over;
+
+			case BLEND_SRC_OVER_PREMULTIPLIED:
+				return _mm_add_epi16(src, simd_div255_epu16(_mm_mullo_epi16(dst, inv)));
+
+			case BLEND_ADDITIVE:
+				colors = _mm_add_epi16(dst, simd_div255_epu16(_mm_mullo_epi16(src, a)));
+				break;
+
+			case BLEND_MULTIPLY:
+			{
+				const auto factor = _mm_add_epi16(simd_div255_epu16(_mm_mullo_epi16(src, a)), inv);
+				colors = simd_div255_epu16(_mm_mullo_epi16(dst, factor));
+				break;
+			}
+
+			default:
+				return src;
+			}
+
+			return _mm_or_si128(_mm_andnot_si128(alphamask, colors), _mm_and_si128(alphamask, over));
+		}
+#endif
+
+		template<pixel_type pixel>
+		void blend_row32(const pixel* src, pixel* dst, size_t count, blend_mode mode)
+		{
+			size_t i = 0;
+			const auto* from = reinterpret_cast<const uint8_t*>(src);
+			auto* to = reinterpret_cast<uint8_t*>(dst);
+
+#ifdef IMPP_SIMD_SSE2
+			const auto zero = _mm_setzero_si128();
+			for (; i + 4 <= count; i += 4, from += 16, to += 16)
+			{
+				const auto s = _mm_loadu_si128(reinterpret_cast<const __m128i*>(from));
+				const auto d = _mm_loadu_si128(reinterpret_cast<const __m128i*>(to));
+				const auto lo = simd_blend_pixel32_epu16(_mm_unpacklo_epi8(s, zero), _mm_unpacklo_epi8(d, zero), mode);
+				const auto hi = simd_blend_pixel32_epu16(_mm_unpackhi_epi8(s, zero), _mm_unpackhi_epi8(d, zero), mode);
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(to), _mm_packus_epi16(lo, hi));
+			}
+#endif
+
+			for (; i < count; i++, from += 4, to += 4)
+				blend_pixel32(from, to, mode);
+		}
+
+		template<pixel_type pixel>
+		void blend_row24(const pixel* src, pixel* dst, size_t count, blend_mode mode)
+		{
+			if (mode != BLEND_ADDITIVE && mode != BLEND_MULTIPLY)
+			{
+				memcpy(dst, src, count * sizeof(pixel));
+				return;
+			}
+
+			// without alpha every byte is blended on its own
+			size_t i = 0;
+			const size_t bytes = count * sizeof(pixel);
+			const auto* from = reinterpret_cast<const uint8_t*>(src);
+			auto* to = reinterpret_cast<uint8_t*>(dst);
+
+#ifdef IMPP_SIMD_SSE2
+			const auto zero = _mm_setzero_si128();
+			for (; i + 16 <= bytes; i += 16)
+			{
+				const auto s = _mm_loadu_si128(reinterpret_cast<const __m128i*>(from + i));
+				const auto d = _mm_loadu_si128(reinterpret_cast<const __m128i*>(to + i));
+				__m128i result;
+				if (mode == BLEND_ADDITIVE)
+					result = _mm_adds_epu8(s, d);
+				else
+				{
+					const auto lo = simd_div255_epu16(_mm_mullo_epi16(_mm_unpacklo_epi8(s, zero), _mm_unpacklo_epi8(d, zero)));
+					const auto hi = simd_div255_epu16(_mm_mullo_epi16(_mm_unpackhi_epi8(s, zero), _mm_unpackhi_epi8(d, zero)));
+					result = _mm_packus_epi16(lo, hi);
+				}
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(to + i), result);
+			}
+#endif
+
+			for (; i < bytes; i++)
+				to[i] = mode == BLEND_ADDITIVE ?
+					static_cast<uint8_t>(std::min<uint32_t>(UINT8_MAX, to[i] + from[i])) :
+					div255(to[i] * from[i]);
+		}
+	}
+
+	// blends count source pixels over the destination ones
+	template<pixel_type pixel>
+	void blend_pixels(const pixel* src, pixel* dst, size_t count, blend_mode mode)
+	{
+		if (mode == BLEND_NONE)
+			memcpy(dst, src, count * sizeof(pixel));
+		else if constexpr (pixel_is32bit<pixel>)
+			detail::blend_row32(src, dst, count, mode);
+		else
+			detail::blend_row24(src, dst, count, mode);
+	}
+
+	// converts straight alpha pixels into premultiplied ones
+	template<pixel_type pixel, std::enable_if_t<pixel_is32bit<pixel>, int> = 0>
+	void premultiply_pixels(pixel* pixels, size_t count)
+	{
+		size_t i = 0;
+		auto* bytes = reinterpret_cast<uint8_t*>(pixels);
+
+#ifdef IMPP_SIMD_SSE2
+		const auto zero = _mm_setzero_si128();
+		const auto alphamask = _mm_set_epi16(-1, 0, 0, 0, -1, 0, 0, 0);
+		const auto full = _mm_set1_epi16(UINT8_MAX);
+		auto premultiply = [&](__m128i value) {
+			const auto a = detail::simd_alpha_epu16(value);
+			const auto weight = _mm_or_si128(_mm_andnot_si128(alphamask, a), _mm_and_si128(alphamask, full));
+			return detail::simd_div255_epu16(_mm_mullo_epi16(value, weight));
+		};
+
+		for (; i + 4 <= count; i += 4, bytes += 16)
+		{
+			const auto value = _mm_loadu_si128(reinterpret_cast<const __m128i*>(bytes));
+			const auto lo = premultiply(_mm_unpacklo_epi8(value, zero));
+			const auto hi = premultiply(_mm_unpackhi_epi8(value, zero));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(bytes), _mm_packus_epi16(lo, hi));
+		}
+#endif
+
+		for (; i < count; i++, bytes += 4)
+			for (size_t c = 0; c < 3; c++)
+				bytes[c] = detail::div255(bytes[c] * bytes[3]);
+	}
+
+	// converts premultiplied alpha pixels back into straight ones
+	template<pixel_type pixel, std::enable_if_t<pixel_is32bit<pixel>, int> = 0>
+	void unpremultiply_pixels(pixel* pixels, size_t count)
+	{
+		auto* bytes = reinterpret_cast<uint8_t*>(pixels);
+		for (size_t i = 0; i < count; i++, bytes += 4)
+		{
+			const auto a = bytes[3];
+			if (a == UINT8_MAX)
+				continue;
+
+			const auto reciprocal = detail::unpremultiply_table[a];
+			for (size_t c = 0; c < 3; c++)
+				bytes[c] = static_cast<uint8_t>(std::min<uint64_t>(UINT8_MAX, (bytes[c] * reciprocal + (1 << 23)) >> 24));
+		}
+	}
+}
+
+#endif //INCLUDE_IMPLUSPLUS_BLEND_HPP
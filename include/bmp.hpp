@@ -2,6 +2,13 @@
 #ifndef INCLUDE_IMPLUSPLUS_BMP_HPP
 #define INCLUDE_IMPLUSPLUS_BMP_HPP
 #include "image.hpp"
+
+#include <array>
+#include <bit>
+#include <memory>
+#include "decoder.hpp"
+#include "error.hpp"
+#include "instrument.hpp"
 namespace impp
 {
 	namespace bmp
@@ -57,7 +64,7 @@ namespace impp
         enum bmp_uncompression
         {
             BMP_UNCOMPRESSED_RGB = 0,
-            BMP_UNCOMPRESSED_BITFIELDS = 1,
+            BMP_UNCOMPRESSED_BITFIELDS = 3,
         };
 
         enum bmp_compression
@@ -67,105 +74,424 @@ namespace impp
             BMP_COMPRESSION_RLE4 = 2,
         };
 
+        // largest image decoded, rle bitmaps can declare any size with a few bytes
+        constexpr size_t BMP_PIXELS_MAX = 400000000;
+
         namespace detail
         {
+            // pixel layout of a bitmap extracted from its headers
+            struct bitmap_format
+            {
+                uint16_t bitcount = 0;
+                uint32_t compression = 0;
+                std::array<uint32_t, 4> masks{};          // R G B A
+                std::array<pixel32bgra, 256> palette{};
+            };
+
+            inline uint8_t bitmap_mask_channel(uint32_t value, uint32_t mask)
+            {
+                if(mask == 0)
+                    return UINT8_MAX;
+
+                const auto bits = std::popcount(mask);
+                value = (value & mask) >> std::countr_zero(mask);
+                if(bits >= 8)
+                    return static_cast<uint8_t>(value >> (bits - 8));
+                return static_cast<uint8_t>(value * UINT8_MAX / ((1u << bits) - 1));
+            }
+
+            // converts count pixels starting from pixel x, bytes points to the byte containing pixel x
             template<class pixel>
-            void load_bitmap_from_memory(const void* data, size_t len, typename image<pixel>::size* width, typename image<pixel>::size* height, std::vector<pixel>* pixels)
+            void bitmap_convert_row(const bitmap_format& format, const uint8_t* bytes, size_t x, size_t count, pixel* pxto)
+            {
+                switch(format.bitcount)
+                {
+                case BMP_MONOCHROME_PALETTED:
+                case BMP_4BIT_PALETTED:
+                case BMP_8BIT_PALETTED:
+                {
+                    const size_t bits = format.bitcount;
+                    const size_t mask = (size_t(1) << bits) - 1;
+                    size_t bitpos = (x * bits) & 7;
+                    for(size_t i = 0; i < count; i++, pxto++, bitpos += bits)
+                    {
+                        const auto index = (bytes[bitpos >> 3] >> (8 - bits - (bitpos & 7))) & mask;
+                        *pxto = pixel_cast<pixel>(format.palette[index]);
+                    }
+                    break;
+                }
+
+                case BMP_16BIT_RGB:
+                    for(size_t i = 0; i < count; i++, pxto++, bytes += 2)
+                    {
+                        const uint32_t value = bytes[0] | (bytes[1] << 8);
+                        pixel32bgra px{ bitmap_mask_channel(value, format.masks[2]), bitmap_mask_channel(value, format.masks[1]),
+                            bitmap_mask_channel(value, format.masks[0]), bitmap_mask_channel(value, format.masks[3]) };
+                        *pxto = pixel_cast<pixel>(px);
+                    }
+                    break;
+
+                case BMP_24BIT_BGR:
+                    pixel_convert(reinterpret_cast<const pixel24bgr*>(bytes), pxto, count);
+                    break;
+
+                case BMP_32BIT_BGRA:
+                    if(format.compression == BMP_UNCOMPRESSED_RGB)
+                    {
+                        // the fourth byte is reserved and usually 0, pixels are opaque like bitfields without an alpha mask
+                        pixel_convert(reinterpret_cast<const pixel32bgra*>(bytes), pxto, count);
+                        if constexpr (pixel_is32bit<pixel>)
+                            for(size_t i = 0; i < count; i++)
+                                pxto[i].a = UINT8_MAX;
+                        break;
+                    }
+
+                    for(size_t i = 0; i < count; i++, pxto++, bytes += 4)
+                    {
+                        const uint32_t value = bytes[0] | (bytes[1] << 8) | (bytes[2] << 16) | (static_cast<uint32_t>(bytes[3]) << 24);
+                        pixel32bgra px{ bitmap_mask_channel(value, format.masks[2]), bitmap_mask_channel(value, format.masks[1]),
+                            bitmap_mask_channel(value, format.masks[0]), bitmap_mask_channel(value, format.masks[3]) };
+                        *pxto = pixel_cast<pixel>(px);
+                    }
+                    break;
+                }
+            }
+
+            // decodes rle8/rle4 rows sequentially converting only the rows and columns covered by region
+            template<class pixel, decoder_type decoder_t>
+            void load_bitmap_rle(decoder_t& decoder, const bitmap_format& format, size_t bmpwidth, size_t bmpheight, const image_region& region, pixel* pixels)
+            {
+                const bool rle4 = format.compression == BMP_COMPRESSION_RLE4;
+                const size_t last = bmpheight - region.y;                 // rows are always bottom-up
+                const size_t first = last - region.height;
+
+                std::vector<uint8_t> indexes(bmpwidth);
+                IMPP_INSTRUMENT_ALLOCATION(bmpwidth);
+                size_t row = 0, column = 0;
+
+                auto put = [&](uint8_t index){
+                    if(column < bmpwidth)
+                        indexes[column] = index;
+                    column++;
+                };
+
+                auto flush = [&](){
+                    if(row >= first && row < last)
+                        for(size_t i = 0; i < region.width; i++)
+                            pixels[(row - first) * region.width + i] = pixel_cast<pixel>(format.palette[indexes[region.x + i]]);
+                    std::fill(indexes.begin(), indexes.end(), 0);
+                    column = 0;
+                    row++;
+                };
+
+                while(row < last && !decoder.failed())
+                {
+                    const auto count = decoder.template read<uint8_t>();
+                    const auto value = decoder.template read<uint8_t>();
+
+                    // encoded run
+                    if(count != 0)
+                    {
+                        IMPP_INSTRUMENT_COUNT(rle_run_packets, 1);
+                        IMPP_INSTRUMENT_COUNT(rle_run_pixels, count);
+                        for(size_t i = 0; i < count; i++)
+                            put(rle4 ? (i & 1 ? value & 0x0F : value >> 4) : value);
+                        continue;
+                    }
+
+                    switch(value)
+                    {
+                    case 0: // end of line
+                        flush();
+                        break;
+
+                    case 1: // end of bitmap
+                        while(row < last)
+                            flush();
+                        break;
+
+                    case 2: // delta
+                    {
+                        const auto dx = decoder.template read<uint8_t>();
+                        const auto dy = decoder.template read<uint8_t>();
+                        const auto dcolumn = column + dx;
+                        for(size_t i = 0; i < dy && row < last; i++)
+                            flush();
+                        column = dcolumn;
+                        break;
+                    }
+
+                    default: // absolute run padded to 16 bits
+                    {
+                        IMPP_INSTRUMENT_COUNT(rle_raw_packets, 1);
+                        IMPP_INSTRUMENT_COUNT(rle_raw_pixels, value);
+                        const size_t bytecount = rle4 ? (value + 1) / 2 : value;
+                        const auto* bytes = decoder.template peek<uint8_t>(bytecount);
+                        decoder.proceed_reading(bytecount);
+                        for(size_t i = 0; i < value; i++)
+                            put(rle4 ? (i & 1 ? bytes[i / 2] & 0x0F : bytes[i / 2] >> 4) : bytes[i]);
+                        decoder.proceed_reading(bytecount & 1);
+                        break;
+                    }
+                    }
+                }
+            }
+
+            // decodes the bitmap rows and columns covered by region
+            // uncompressed rows outside the region are seeked over
+            // false is returned with the error recorded in the decoder
+            template<class pixel, decoder_type decoder_t>
+            bool load_bitmap(decoder_t& decoder, image_region region, typename image<pixel>::size* width, typename image<pixel>::size* height, std::vector<pixel>* pixels)
             {
-                auto decoder = decoder::create(data, len);
-                const auto& fheader = decoder.read<bitmap_file_header>();
-                const auto& iheader = decoder.read<bitmap_info_header>();
+                IMPP_INSTRUMENT_STAGE(STAGE_HEADER);
+                const auto fheader = decoder.template read<bitmap_file_header>();
+                const auto iheader = decoder.template read<bitmap_info_header>();
+                if(decoder.failed())
+                    return false;
 
                 // checking file header
                 if(fheader.type != 19778) //BM LETTERS
-                    throw std::runtime_error("invalid bitmap file header.type: it must be BM");
+                    return decoder.fail(error::ERROR_INVALID_HEADER, "invalid bitmap file header.type: it must be BM");
                 if(fheader.reserved != 0) //MUST BE 0
-                    throw std::runtime_error("invalid bitmap file header.reserved: it must be 0 (0x00000000)");
+                    return decoder.fail(error::ERROR_INVALID_HEADER, "invalid bitmap file header.reserved: it must be 0 (0x00000000)");
                 if(fheader.offbits - sizeof(bitmap_file_header) - sizeof(bitmap_info_header) > decoder.get_readable())
-                    throw std::runtime_error("invalid bitmap file header.offbits: exceeded image space");
+                    return decoder.fail(error::ERROR_INVALID_HEADER, "invalid bitmap file header.offbits: exceeded image space");
                 if(fheader.size != decoder.get_readable() + decoder.get_read_offset())
-                    throw std::runtime_error("invalid bitmap file header.size: incorrect file size");
+                    return decoder.fail(error::ERROR_INVALID_HEADER, "invalid bitmap file header.size: incorrect file size");
 
                 // checking info header
                 /*if(iheader.ihsize != sizeof(iheader))
                     throw std::runtime_error(std::string("invalid bitmap info header.ihsize: it must be ") + std::to_string(sizeof(iheader)));*/
+                if(iheader.ihsize < sizeof(iheader))
+                    return decoder.fail(error::ERROR_INVALID_HEADER, "invalid bitmap info header.ihsize: it must be at least 40");
                 if(iheader.width <= 0)
-                    throw std::runtime_error("invalid bitmap info header.width: it must be > 0");
+                    return decoder.fail(error::ERROR_INVALID_HEADER, "invalid bitmap info header.width: it must be > 0");
+                if(iheader.height == 0 || iheader.height == INT32_MIN)
+                    return decoder.fail(error::ERROR_INVALID_HEADER, "invalid bitmap info header.height: it must not be 0");
                 if(iheader.height < 0 && iheader.compression != 0)
-                    throw std::runtime_error("invalid bitmap info header.height: it must be > 0 for compressed bitmaps");
+                    return decoder.fail(error::ERROR_INVALID_HEADER, "invalid bitmap info header.height: it must be > 0 for compressed bitmaps");
                 if(iheader.planes != 1)
-                    throw std::runtime_error("invalid bitmap info header.planes: it must be 1");
+                    return decoder.fail(error::ERROR_INVALID_HEADER, "invalid bitmap info header.planes: it must be 1");
                 if(iheader.bitcount != BMP_MONOCHROME_PALETTED && 
                    iheader.bitcount != BMP_4BIT_PALETTED && 
                    iheader.bitcount != BMP_8BIT_PALETTED && 
                    iheader.bitcount != BMP_16BIT_RGB && 
                    iheader.bitcount != BMP_24BIT_BGR &&
                    iheader.bitcount != BMP_32BIT_BGRA)
-                    throw std::runtime_error("invalid bitmap info header.bitcount: it must be one of the following values - 1, 4, 8, 16, 24");
+                    return decoder.fail(error::ERROR_INVALID_HEADER, "invalid bitmap info header.bitcount: it must be one of the following values - 1, 4, 8, 16, 24");
                 if(iheader.bitcount == BMP_16BIT_RGB || iheader.bitcount == BMP_32BIT_BGRA)
                     if(iheader.compression != BMP_UNCOMPRESSED_RGB && iheader.compression != BMP_UNCOMPRESSED_BITFIELDS)
-                        throw std::runtime_error("invalid bitmap info header.compression: it must be one of the following values - 0,1 for bitmap using 16/32 bpp");
+                        return decoder.fail(error::ERROR_INVALID_HEADER, "invalid bitmap info header.compression: it must be one of the following values - 0,3 for bitmap using 16/32 bpp");
                 if(iheader.bitcount == BMP_MONOCHROME_PALETTED || iheader.bitcount == BMP_4BIT_PALETTED || iheader.bitcount == BMP_8BIT_PALETTED)
                     if (iheader.compression != BMP_COMPRESSION_RGB && iheader.compression != BMP_COMPRESSION_RLE4 && iheader.compression != BMP_COMPRESSION_RLE8)
-                        throw std::runtime_error("invalid bitmap info header.compression: it must be one of the following values - 0,1,2 for bitmap using 1/4/8 bpp");
+                        return decoder.fail(error::ERROR_INVALID_HEADER, "invalid bitmap info header.compression: it must be one of the following values - 0,1,2 for bitmap using 1/4/8 bpp");
+                if(iheader.compression == BMP_COMPRESSION_RLE8 && iheader.bitcount != BMP_8BIT_PALETTED)
+                    return decoder.fail(error::ERROR_INVALID_HEADER, "invalid bitmap info header.compression: rle8 requires 8 bpp");
+                if(iheader.compression == BMP_COMPRESSION_RLE4 && iheader.bitcount != BMP_4BIT_PALETTED)
+                    return decoder.fail(error::ERROR_INVALID_HEADER, "invalid bitmap info header.compression: rle4 requires 4 bpp");
+                if(iheader.compression == BMP_UNCOMPRESSED_BITFIELDS && iheader.bitcount != BMP_16BIT_RGB && iheader.bitcount != BMP_32BIT_BGRA)
+                    return decoder.fail(error::ERROR_INVALID_HEADER, "invalid bitmap info header.compression: bitfields requires 16/32 bpp");
 
-               
-            }
-        }
+                bitmap_format format{};
+                format.bitcount = iheader.bitcount;
+                format.compression = iheader.compression;
 
-        template<class pixel>
-        image<pixel> load_memory(const void* data, size_t len)
-        {
-            using imagesize = typename image<pixel>::size;
-            using imagepix = typename image<pixel>::pixelvec;
+                // extracting channel masks (they follow the info header or are part of the extended ones)
+                if(iheader.compression == BMP_UNCOMPRESSED_BITFIELDS)
+                {
+                    const size_t maskcount = iheader.ihsize >= sizeof(iheader) + 4 * sizeof(uint32_t) ? 4 : 3;
+                    decoder.read(format.masks.data(), maskcount * sizeof(uint32_t));
+                }
+
+                else if(iheader.bitcount == BMP_16BIT_RGB)
+                    format.masks = { 0x7C00, 0x03E0, 0x001F, 0 };
+
+                // extracting palette
+                const size_t masksize = iheader.compression == BMP_UNCOMPRESSED_BITFIELDS && iheader.ihsize == sizeof(iheader) ? 3 * sizeof(uint32_t) : 0;
+                const size_t palette_offset = sizeof(bitmap_file_header) + iheader.ihsize + masksize;
+                if(palette_offset > fheader.offbits)
+                    return decoder.fail(error::ERROR_INVALID_HEADER, "invalid bitmap file header.offbits: overlapping headers");
+                decoder.proceed_reading(palette_offset - decoder.get_read_offset());
+
+                if(iheader.bitcount <= BMP_8BIT_PALETTED)
+                {
+                    const size_t maxcount = size_t(1) << iheader.bitcount;
+                    const size_t count = iheader.colorcount == 0 ? maxcount : std::min<size_t>(iheader.colorcount, maxcount);
+                    if(palette_offset + count * sizeof(pixel32bgra) > fheader.offbits)
+                        return decoder.fail(error::ERROR_INVALID_HEADER, "invalid bitmap info header.colorcount: palette exceeds raster offset");
+                    decoder.read(format.palette.data(), count * sizeof(pixel32bgra));
+                    IMPP_INSTRUMENT_MAX(palette_size, count);
+
+                    // palette entries reserve the alpha byte
+                    for(auto& color : format.palette)
+                        color.a = UINT8_MAX;
+                }
+
+                decoder.proceed_reading(fheader.offbits - decoder.get_read_offset());
+
+                // clipping the requested region
+                const size_t bmpwidth = static_cast<size_t>(iheader.width);
+                const size_t bmpheight = static_cast<size_t>(iheader.height < 0 ? -iheader.height : iheader.height);
+                if(bmpwidth > UINT32_MAX)
+                    return decoder.reject(error::ERROR_UNSUPPORTED, "bmp: images are limited to 2^32 - 1 pixels per row.");
+                if(bmpwidth * bmpheight > BMP_PIXELS_MAX)
+                    return decoder.reject(error::ERROR_UNSUPPORTED, "bmp: images are limited to 400 million pixels.");
+                if(!region.clip(static_cast<uint32_t>(bmpwidth), static_cast<uint32_t>(bmpheight)))
+                    return decoder.reject(error::ERROR_INVALID_ARGUMENT, "bmp: region outside of the image.");
+
+                // uncompressed rows must be in the input before the pixels are allocated, the last one may lack its padding
+                if(iheader.compression != BMP_COMPRESSION_RLE8 && iheader.compression != BMP_COMPRESSION_RLE4)
+                {
+                    const size_t stride = (bmpwidth * iheader.bitcount + 31) / 32 * 4;
+                    if(stride * (bmpheight - 1) + (bmpwidth * iheader.bitcount + 7) / 8 > decoder.get_readable())
+                    {
+                        // reported where the input ends like a read past it
+                        decoder.proceed_reading(decoder.get_readable());
+                        return decoder.fail(error::ERROR_TRUNCATED, "bmp: pixel data exceeds input.");
+                    }
+                }
+
+                IMPP_INSTRUMENT_STAGE(STAGE_DECODE);
+                std::vector<pixel> temp_pixel(static_cast<size_t>(region.width) * region.height);
+                IMPP_INSTRUMENT_ALLOCATION(temp_pixel.size() * sizeof(pixel));
+
+                if(iheader.compression == BMP_COMPRESSION_RLE8 || iheader.compression == BMP_COMPRESSION_RLE4)
+                {
+                    if(iheader.bitcount <= BMP_8BIT_PALETTED)
+                        load_bitmap_rle(decoder, format, bmpwidth, bmpheight, region, temp_pixel.data());
+                }
+
+                else
+                {
+                    // region is top-left based while bitmap rows are bottom-up unless height is negative
+                    const bool topdown = iheader.height < 0;
+                    const size_t first = topdown ? region.y : bmpheight - region.y - region.height;
+                    const size_t stride = (bmpwidth * iheader.bitcount + 31) / 32 * 4;
+                    const size_t rowbegin = region.x * iheader.bitcount / 8;
+                    const size_t rowend = ((region.x + region.width) * iheader.bitcount + 7) / 8;
 
-            imagepix pixels{};
-            imagesize width = 0, height = 0;
+                    decoder.proceed_reading(first * stride);
+                    for(size_t i = 0; i < region.height && !decoder.failed(); i++)
+                    {
+                        const auto dy = topdown ? region.height - i - 1 : i;
+                        decoder.proceed_reading(rowbegin);
+                        const auto* bytes = decoder.template peek<uint8_t>(rowend - rowbegin);
+                        decoder.proceed_reading(rowend - rowbegin);
+                        if(decoder.failed())
+                            break;
+                        bitmap_convert_row(format, bytes, region.x, region.width, temp_pixel.data() + dy * region.width);
 
-            try
+                        // the last row may come without its padding
+                        if(i + 1 != region.height)
+                            decoder.proceed_reading(stride - rowend);
+                    }
+                }
+
+                if(decoder.failed())
+                    return false;
+
+                IMPP_INSTRUMENT_COUNT(bytes_read, decoder.get_read_offset());
+                *width = region.width;
+                *height = region.height;
+                *pixels = std::move(temp_pixel);
+                return true;
+            }
+
+            template<class pixel>
+            result<image<pixel>> load_bitmap_from_memory(const void* data, size_t len, image_region region = {})
             {
-                detail::load_bitmap_from_memory(data, len, &width, &height, &pixels);
-                return image<pixel>::create(width, height, std::move(pixels));
+                typename image<pixel>::size width = 0, height = 0;
+                typename image<pixel>::pixelvec pixels{};
+
+                auto decoder = decoder::create(data, len, error::ERROR_POLICY_RECORD);
+                const bool decoded = load_bitmap(decoder, region, &width, &height, &pixels);
+                return impp::detail::decoded_image(decoder, decoded, width, height, std::move(pixels));
             }
 
-            catch(const std::runtime_error& error)
+            template<class pixel>
+            result<image<pixel>> load_bitmap_from_file(const std::string& filename, image_region region = {})
             {
-                error::detail::on_error(error);
-                return image<pixel>::null();
+                typename image<pixel>::size width = 0, height = 0;
+                typename image<pixel>::pixelvec pixels{};
+
+                auto decoder = file_decoder::create(filename, error::ERROR_POLICY_RECORD);
+                if(!decoder.is_open())
+                    return error::error_info{ error::ERROR_FILE_OPEN, 0, "bmp: unable to read file." };
+                const bool decoded = load_bitmap(decoder, region, &width, &height, &pixels);
+                return impp::detail::decoded_image(decoder, decoded, width, height, std::move(pixels));
             }
         }
 
+        // true when the data starts with the BM signature followed by an info header size
+        inline bool has_signature(const void* data, size_t len)
+        {
+            bitmap_file_header fheader;
+            uint32_t ihsize = 0;
+            if(len < sizeof(fheader) + sizeof(ihsize))
+                return false;
+            memcpy(&fheader, data, sizeof(fheader));
+            memcpy(&ihsize, reinterpret_cast<const uint8_t*>(data) + sizeof(fheader), sizeof(ihsize));
+            return fheader.type == 0x4D42 && ihsize >= 12;
+        }
+
+        // try_* functions never throw nor call the error handler, failures are returned with their cause
+
         template<class pixel>
-        image<pixel> load(const std::string& filename)
+        result<image<pixel>> try_load_memory(const void* data, size_t len)
+        {
+            IMPP_INSTRUMENT_CALL("bmp", "load_memory");
+            return detail::load_bitmap_from_memory<pixel>(data, len);
+        }
+
+        template<class pixel>
+        result<image<pixel>> try_load(const std::string& filename)
+        {
+            IMPP_INSTRUMENT_CALL("bmp", "load");
+            return detail::load_bitmap_from_file<pixel>(filename);
+        }
+
+        template<class pixel>
+        result<image<pixel>> try_load_memory_region(const void* data, size_t len, uint32_t x, uint32_t y, uint32_t width, uint32_t height)
         {
-            using imagesize = typename image<pixel>::size;
-            using imagepix = typename image<pixel>::pixelvec;
+            IMPP_INSTRUMENT_CALL("bmp", "load_memory_region");
+            return detail::load_bitmap_from_memory<pixel>(data, len, image_region{x, y, width, height});
+        }
 
-            std::ifstream f(filename, std::ios::binary | std::ios::ate);
-            if (!f.is_open())
-                return image<pixel>::null();
+        template<class pixel>
+        result<image<pixel>> try_load_region(const std::string& filename, uint32_t x, uint32_t y, uint32_t width, uint32_t height)
+        {
+            IMPP_INSTRUMENT_CALL("bmp", "load_region");
+            return detail::load_bitmap_from_file<pixel>(filename, image_region{x, y, width, height});
+        }
 
-            size_t size = f.tellg();
-            f.seekg(0);
+        // load functions return a null image on failure, errors found in the data are forwarded to the error handler
 
-            auto buffer = std::make_unique<uint8_t[]>(size);
-            f.read((char*)buffer.get(), size);
-            f.close();
+        template<class pixel>
+        image<pixel> load_memory(const void* data, size_t len)
+        {
+            auto res = try_load_memory<pixel>(data, len);
+            return error::detail::report(res) ? std::move(res).value() : image<pixel>::null();
+        }
 
-            imagepix pixels{};
-            imagesize width = 0, height = 0;
+        template<class pixel>
+        image<pixel> load(const std::string& filename)
+        {
+            auto res = try_load<pixel>(filename);
+            return error::detail::report(res) ? std::move(res).value() : image<pixel>::null();
+        }
 
-            try
-            {
-                detail::load_bitmap_from_memory(buffer.get(), size, &width, &height, &pixels);
-                return image<pixel>::create(width, height, std::move(pixels));
-            }
+        template<class pixel>
+        image<pixel> load_memory_region(const void* data, size_t len, uint32_t x, uint32_t y, uint32_t width, uint32_t height)
+        {
+            auto res = try_load_memory_region<pixel>(data, len, x, y, width, height);
+            return error::detail::report(res) ? std::move(res).value() : image<pixel>::null();
+        }
 
-            catch (const std::runtime_error& error)
-            {
-                error::detail::on_error(error);
-                return image<pixel>::null();
-            }
+        template<class pixel>
+        image<pixel> load_region(const std::string& filename, uint32_t x, uint32_t y, uint32_t width, uint32_t height)
+        {
+            auto res = try_load_region<pixel>(filename, x, y, width, height);
+            return error::detail::report(res) ? std::move(res).value() : image<pixel>::null();
         }
 	}
 }
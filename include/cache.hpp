@@ -0,0 +1,289 @@
+/*
+MIT License
+
+Copyright (c) 2022 IkarusDeveloper
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#pragma once
+#ifndef INCLUDE_IMPLUSPLUS_CACHE_HPP
+#define INCLUDE_IMPLUSPLUS_CACHE_HPP
+#include "image.hpp"
+
+#include <stdint.h>
+#include <atomic>
+#include <filesystem>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "codec.hpp"
+#include "error.hpp"
+#include "hash.hpp"
+
+namespace impp
+{
+	// decoded images shared between threads under a byte budget, the least recently used ones are evicted
+	// with the clock algorithm so hits only take a shared lock; handles keep their image alive after eviction
+	template<pixel_type pixel>
+	class image_cache
+	{
+	public:
+		using handle = std::shared_ptr<const image<pixel>>;
+		using loader = std::function<result<image<pixel>>()>;
+
+		struct counters
+		{
+			uint64_t hits = 0;
+			uint64_t misses = 0;        // loads started by this cache
+			uint64_t coalesced = 0;     // misses which waited for the load of another thread
+			uint64_t evictions = 0;
+			size_t bytes = 0;           // held by the cached images
+			size_t entries = 0;
+		};
+
+		explicit image_cache(size_t budget) : _budget(budget) {}
+		image_cache(const image_cache&) = delete;
+		image_cache& operator=(const image_cache&) = delete;
+
+		// keyed by the path, the size and the modification time, a changed file is loaded again
+		result<handle> try_get(const std::string& filename)
+		{
+			std::error_code ec;
+			const auto size = std::filesystem::file_size(filename, ec);
+			const auto time = ec ? std::filesystem::file_time_type{} : std::filesystem::last_write_time(filename, ec);
+			if (ec)
+				return error::error_info{ error::ERROR_FILE_OPEN, 0, "cache: unable to read file.", true };
+
+			std::string key = "f";
+			key.append(filename).push_back('\0');
+			key.append(std::to_string(size)).push_back(':');
+			key.append(std::to_string(time.time_since_epoch().count()));
+			return try_get_or_load(std::move(key), [&] { return impp::try_load<pixel>(filename); });
+		}
+
+		// keyed by the content hash of the encoded data
+		result<handle> try_get_memory(const void* memory, size_t size)
+		{
+			const auto hash = hash_bytes(memory, size);
+			std::string key = "m";
+			key.append(reinterpret_cast<const char*>(&hash), sizeof(hash));
+			return try_get_or_load(std::move(key), [&] { return impp::try_load_memory<pixel>(memory, size); });
+		}
+
+		// any other source, the key names it among the ones given to this function
+		result<handle> try_get(const std::string& key, const loader& load)
+		{
+			return try_get_or_load("k" + key, load);
+		}
+
+		// get functions return a null handle on failure, errors found in the data are forwarded to the error handler
+
+		handle get(const std::string& filename)
+		{
+			auto res = try_get(filename);
+			return error::detail::report(res) ? std::move(res).value() : handle{};
+		}
+
+		handle get_memory(const void* memory, size_t size)
+		{
+			auto res = try_get_memory(memory, size);
+			return error::detail::report(res) ? std::move(res).value() : handle{};
+		}
+
+		// a lower budget evicts right away
+		void set_budget(size_t budget)
+		{
+			std::unique_lock lock(_mutex);
+			_budget = budget;
+			evict(0);
+		}
+
+		size_t get_budget() const
+		{
+			std::shared_lock lock(_mutex);
+			return _budget;
+		}
+
+		void clear()
+		{
+			std::unique_lock lock(_mutex);
+			_index.clear();
+			_ring.clear();
+			_hand = 0;
+			_bytes = 0;
+		}
+
+		counters get_counters() const
+		{
+			std::shared_lock lock(_mutex);
+			counters ret;
+			ret.hits = _hits.load(std::memory_order_relaxed);
+			ret.misses = _misses;
+			ret.coalesced = _coalesced;
+			ret.evictions = _evictions;
+			ret.bytes = _bytes;
+			ret.entries = _ring.size();
+			return ret;
+		}
+
+	private:
+		struct entry
+		{
+			std::string key;
+			handle image;
+			size_t bytes = 0;
+			std::atomic<bool> referenced{ true };
+		};
+
+		static size_t get_cost(const image<pixel>& img)
+		{
+			return sizeof(img) + img.pixels.size() * sizeof(pixel);
+		}
+
+		template<class load_type>
+		result<handle> try_get_or_load(std::string key, const load_type& load)
+		{
+			{
+				std::shared_lock lock(_mutex);
+				const auto it = _index.find(key);
+				if (it != _index.end())
+				{
+					it->second->referenced.store(true, std::memory_order_relaxed);
+					_hits.fetch_add(1, std::memory_order_relaxed);
+					return it->second->image;
+				}
+			}
+
+			// the first thread missing a key loads it, the others wait for its result
+			std::promise<result<handle>> promise;
+			{
+				std::unique_lock lock(_mutex);
+				const auto it = _index.find(key);
+				if (it != _index.end())
+				{
+					it->second->referenced.store(true, std::memory_order_relaxed);
+					_hits.fetch_add(1, std::memory_order_relaxed);
+					return it->second->image;
+				}
+				const auto pending = _pending.find(key);
+				if (pending != _pending.end())
+				{
+					auto future = pending->second;
+					_coalesced++;
+					lock.unlock();
+					return future.get();
+				}
+				_pending.emplace(key, promise.get_future().share());
+				_misses++;
+			}
+
+			auto finish = [&]() {
+				auto loaded = load();
+				result<handle> res = loaded ? result<handle>(std::make_shared<const image<pixel>>(std::move(loaded).value())) : result<handle>(loaded.get_error());
+				std::unique_lock lock(_mutex);
+				if (res)
+					insert(std::move(key), *res);
+				else
+					_pending.erase(key);
+				return res;
+			};
+
+#if IMPP_EXCEPTIONS
+			// a throwing load leaves nothing pending, the waiting threads get its exception and the next miss loads again
+			try
+			{
+				auto res = finish();
+				promise.set_value(res);
+				return res;
+			}
+			catch (...)
+			{
+				{
+					std::unique_lock lock(_mutex);
+					_pending.erase(key);
+				}
+				promise.set_exception(std::current_exception());
+				throw;
+			}
+#else
+			auto res = finish();
+			promise.set_value(res);
+			return res;
+#endif
+		}
+
+		// called with the lock held, images larger than the budget are handed out without being kept
+		void insert(std::string&& key, const handle& img)
+		{
+			_pending.erase(key);
+			const size_t bytes = get_cost(*img);
+			if (bytes > _budget)
+				return;
+			evict(bytes);
+
+			auto added = std::make_unique<entry>();
+			added->key = std::move(key);
+			added->image = img;
+			added->bytes = bytes;
+			_index.emplace(added->key, added.get());
+			_ring.push_back(std::move(added));
+			_bytes += bytes;
+		}
+
+		// the hand clears the reference bits it passes and evicts the first entry found without one
+		void evict(size_t incoming)
+		{
+			while (!_ring.empty() && _bytes + incoming > _budget)
+			{
+				if (_hand >= _ring.size())
+					_hand = 0;
+				auto& current = _ring[_hand];
+				if (current->referenced.exchange(false, std::memory_order_relaxed))
+				{
+					_hand++;
+					continue;
+				}
+				_bytes -= current->bytes;
+				_index.erase(current->key);
+				std::swap(current, _ring.back());
+				_ring.pop_back();
+				_evictions++;
+			}
+		}
+
+		mutable std::shared_mutex _mutex;
+		std::unordered_map<std::string, entry*> _index;
+		std::unordered_map<std::string, std::shared_future<result<handle>>> _pending;
+		std::vector<std::unique_ptr<entry>> _ring;
+		size_t _hand = 0;
+		size_t _budget = 0;
+		size_t _bytes = 0;
+		std::atomic<uint64_t> _hits{ 0 };
+		uint64_t _misses = 0;
+		uint64_t _coalesced = 0;
+		uint64_t _evictions = 0;
+	};
+}
+
+#endif //INCLUDE_IMPLUSPLUS_CACHE_HPP
@@ -0,0 +1,465 @@
+/*
+MIT License
+
+Copyright (c) 2022 IkarusDeveloper
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#pragma once
+#ifndef INCLUDE_IMPLUSPLUS_CODEC_HPP
+#define INCLUDE_IMPLUSPLUS_CODEC_HPP
+#include <concepts>
+#include <cstring>
+#include <optional>
+#include <shared_mutex>
+#include <string>
+#include <tuple>
+#include <vector>
+#include "image.hpp"
+#include "decoder.hpp"
+#include "error.hpp"
+#include "instrument.hpp"
+#include "tga.hpp"
+#include "bmp.hpp"
+#include "qoi.hpp"
+#include "png.hpp"
+#include "dds.hpp"
+
+namespace impp
+{
+	// what the header of encoded data tells before any pixel is decoded
+	struct image_info
+	{
+		const char* format = nullptr;   // name of the codec
+		uint32_t width = 0;
+		uint32_t height = 0;
+		uint32_t bits = 0;              // per stored pixel, paletted data counts the bits of its indexes
+		bool alpha = false;             // the stored pixels carry an alpha channel
+	};
+
+	namespace codec
+	{
+		// how sure a codec is that some data is in its format
+		enum sniff_result : uint8_t {
+			SNIFF_NO = 0,
+			SNIFF_MAYBE,    // plausible header without a signature
+			SNIFF_YES       // signature found
+		};
+
+		template<pixel_type pixel>
+		using decode_function = result<image<pixel>>(*)(const void* memory, size_t size);
+		using sniff_function = sniff_result(*)(const void* memory, size_t size);
+		using probe_function = bool(*)(const void* memory, size_t size, image_info* info);
+
+		// bytes read from a file to probe its header, enough for the palettes commonly found before a tga image
+		constexpr size_t PROBE_SIZE = 4096;
+
+		// a codec is a type exposing its name, a sniff function and a decode function for every pixel type
+		// name must be a string literal, it is also the format name used by instrumentation
+		// a probe function reading the sides from the header alone is optional
+		template<class type>
+		concept codec_type = requires(const void* memory, size_t size) {
+			{ type::name } -> std::convertible_to<const char*>;
+			{ type::sniff(memory, size) } -> std::same_as<sniff_result>;
+			{ type::template decode<pixel24rgb>(memory, size) } -> std::same_as<result<image<pixel24rgb>>>;
+			{ type::template decode<pixel24bgr>(memory, size) } -> std::same_as<result<image<pixel24bgr>>>;
+			{ type::template decode<pixel32rgba>(memory, size) } -> std::same_as<result<image<pixel32rgba>>>;
+			{ type::template decode<pixel32bgra>(memory, size) } -> std::same_as<result<image<pixel32bgra>>>;
+		};
+
+		// type erased codec, decoding straight to the requested pixel
+		struct codec_entry
+		{
+			const char* name = nullptr;
+			sniff_function sniff = nullptr;
+			probe_function probe = nullptr;
+			std::tuple<decode_function<pixel24rgb>, decode_function<pixel24bgr>, decode_function<pixel32rgba>, decode_function<pixel32bgra>> decoders{};
+
+			template<pixel_type pixel>
+			decode_function<pixel> get_decoder() const
+			{
+				return std::get<decode_function<pixel>>(decoders);
+			}
+		};
+
+		template<codec_type codec>
+		inline codec_entry make_entry()
+		{
+			codec_entry entry;
+			entry.name = codec::name;
+			entry.sniff = &codec::sniff;
+			if constexpr (requires(const void* memory, size_t size, image_info* info) { { codec::probe(memory, size, info) } -> std::same_as<bool>; })
+				entry.probe = &codec::probe;
+			entry.decoders = { &codec::template decode<pixel24rgb>, &codec::template decode<pixel24bgr>,
+				&codec::template decode<pixel32rgba>, &codec::template decode<pixel32bgra> };
+			return entry;
+		}
+
+		struct tga_codec
+		{
+			static constexpr const char* name = "tga";
+
+			static sniff_result sniff(const void* memory, size_t size)
+			{
+				if (tga::has_footer(memory, size))
+					return SNIFF_YES;
+				return tga::is_plausible_header(memory, size) ? SNIFF_MAYBE : SNIFF_NO;
+			}
+
+			static bool probe(const void* memory, size_t size, image_info* info)
+			{
+				tga::tga_header header;
+				if (!tga::is_plausible_header(memory, size))
+					return false;
+				memcpy(&header, memory, sizeof(header));
+				info->width = header.width;
+				info->height = header.height;
+				info->bits = header.bits;
+				info->alpha = (header.colormap_type == 1 ? header.colormap_entrysize : header.bits) == 32;
+				return true;
+			}
+
+			template<pixel_type pixel>
+			static result<image<pixel>> decode(const void* memory, size_t size)
+			{
+				return tga::try_load_memory<pixel>(memory, size);
+			}
+		};
+
+		struct bmp_codec
+		{
+			static constexpr const char* name = "bmp";
+
+			static sniff_result sniff(const void* memory, size_t size)
+			{
+				return bmp::has_signature(memory, size) ? SNIFF_YES : SNIFF_NO;
+			}
+
+			static bool probe(const void* memory, size_t size, image_info* info)
+			{
+				bmp::bitmap_info_header header;
+				if (!bmp::has_signature(memory, size) || size < sizeof(bmp::bitmap_file_header) + sizeof(header))
+					return false;
+				memcpy(&header, reinterpret_cast<const uint8_t*>(memory) + sizeof(bmp::bitmap_file_header), sizeof(header));
+				if (header.ihsize < sizeof(header) || header.width <= 0 || header.height == 0 || header.height == INT32_MIN)
+					return false;
+				info->width = static_cast<uint32_t>(header.width);
+				info->height = static_cast<uint32_t>(header.height < 0 ? -header.height : header.height);
+				info->bits = header.bitcount;
+				info->alpha = header.bitcount == 32;
+				return true;
+			}
+
+			template<pixel_type pixel>
+			static result<image<pixel>> decode(const void* memory, size_t size)
+			{
+				return bmp::try_load_memory<pixel>(memory, size);
+			}
+		};
+
+		struct qoi_codec
+		{
+			static constexpr const char* name = "qoi";
+
+			static sniff_result sniff(const void* memory, size_t size)
+			{
+				return qoi::has_signature(memory, size) ? SNIFF_YES : SNIFF_NO;
+			}
+
+			static bool probe(const void* memory, size_t size, image_info* info)
+			{
+				const auto* bytes = reinterpret_cast<const uint8_t*>(memory);
+				if (!qoi::has_signature(memory, size))
+					return false;
+				info->width = qoi::detail::qoi_read32(bytes + 4);
+				info->height = qoi::detail::qoi_read32(bytes + 8);
+				info->bits = bytes[12] * 8u;
+				info->alpha = bytes[12] == 4;
+				return info->width != 0 && info->height != 0;
+			}
+
+			template<pixel_type pixel>
+			static result<image<pixel>> decode(const void* memory, size_t size)
+			{
+				return qoi::try_load_memory<pixel>(memory, size);
+			}
+		};
+
+		struct png_codec
+		{
+			static constexpr const char* name = "png";
+
+			static sniff_result sniff(const void* memory, size_t size)
+			{
+				return png::has_signature(memory, size) ? SNIFF_YES : SNIFF_NO;
+			}
+
+			// IHDR is always the first chunk
+			static bool probe(const void* memory, size_t size, image_info* info)
+			{
+				const auto* bytes = reinterpret_cast<const uint8_t*>(memory) + sizeof(png::PNG_SIGNATURE);
+				if (!png::has_signature(memory, size) || size < sizeof(png::PNG_SIGNATURE) + 8 + png::PNG_IHDR_SIZE || memcmp(bytes + 4, "IHDR", 4) != 0)
+					return false;
+				info->width = png::detail::png_read32(bytes + 8);
+				info->height = png::detail::png_read32(bytes + 12);
+				info->bits = bytes[16] * png::detail::png_channels(bytes[17]);
+				info->alpha = bytes[17] == png::PNG_GRAY_ALPHA || bytes[17] == png::PNG_RGBA;
+				return info->width != 0 && info->height != 0;
+			}
+
+			template<pixel_type pixel>
+			static result<image<pixel>> decode(const void* memory, size_t size)
+			{
+				return png::try_load_memory<pixel>(memory, size);
+			}
+		};
+
+		struct dds_codec
+		{
+			static constexpr const char* name = "dds";
+
+			static sniff_result sniff(const void* memory, size_t size)
+			{
+				return dds::has_signature(memory, size) ? SNIFF_YES : SNIFF_NO;
+			}
+
+			static bool probe(const void* memory, size_t size, image_info* info)
+			{
+				dds::dds_header header;
+				dds::detail::dds_layout layout;
+				auto decoder = decoder::create(memory, size, error::ERROR_POLICY_RECORD);
+				if (!dds::detail::dds_read_header(decoder, &header, &layout))
+					return false;
+				info->width = header.width;
+				info->height = header.height;
+				info->bits = layout.blocks ? (layout.blocks == bc::BC_FORMAT_BC1 ? 4 : 8) : layout.bytes * 8;
+				info->alpha = layout.blocks ? layout.blocks != bc::BC_FORMAT_BC1 : layout.shift[3] >= 0;
+				return true;
+			}
+
+			template<pixel_type pixel>
+			static result<image<pixel>> decode(const void* memory, size_t size)
+			{
+				return dds::try_load_memory<pixel>(memory, size);
+			}
+		};
+
+		// codecs used by impp::load, it is safe to use from multiple threads
+		class registry
+		{
+		public:
+			static registry& get_instance()
+			{
+				static registry instance;
+				return instance;
+			}
+
+			// a codec with the same name is replaced keeping its sniffing priority
+			void add(const codec_entry& entry)
+			{
+				std::unique_lock lock(_mutex);
+				for (auto& codec : _codecs)
+				{
+					if (strcmp(codec.name, entry.name) == 0)
+					{
+						codec = entry;
+						return;
+					}
+				}
+				_codecs.push_back(entry);
+			}
+
+			bool remove(const char* name)
+			{
+				std::unique_lock lock(_mutex);
+				const auto it = std::find_if(_codecs.begin(), _codecs.end(), [&](const codec_entry& codec) { return strcmp(codec.name, name) == 0; });
+				if (it == _codecs.end())
+					return false;
+				_codecs.erase(it);
+				return true;
+			}
+
+			std::optional<codec_entry> find(const char* name) const
+			{
+				std::shared_lock lock(_mutex);
+				for (const auto& codec : _codecs)
+					if (strcmp(codec.name, name) == 0)
+						return codec;
+				return std::nullopt;
+			}
+
+			// the most confident codec wins, ties go to the one registered first
+			std::optional<codec_entry> sniff(const void* memory, size_t size) const
+			{
+				std::shared_lock lock(_mutex);
+				std::optional<codec_entry> best;
+				auto best_result = SNIFF_NO;
+				for (const auto& codec : _codecs)
+				{
+					const auto res = codec.sniff(memory, size);
+					if (res > best_result)
+					{
+						best = codec;
+						best_result = res;
+						if (res == SNIFF_YES)
+							break;
+					}
+				}
+				return best;
+			}
+
+			std::vector<const char*> get_names() const
+			{
+				std::shared_lock lock(_mutex);
+				std::vector<const char*> names;
+				for (const auto& codec : _codecs)
+					names.push_back(codec.name);
+				return names;
+			}
+
+		private:
+			registry()
+			{
+				_codecs.push_back(make_entry<bmp_codec>());
+				_codecs.push_back(make_entry<dds_codec>());
+				_codecs.push_back(make_entry<png_codec>());
+				_codecs.push_back(make_entry<qoi_codec>());
+				_codecs.push_back(make_entry<tga_codec>());
+			}
+
+			mutable std::shared_mutex _mutex;
+			std::vector<codec_entry> _codecs;
+		};
+
+		template<codec_type codec>
+		inline void register_codec()
+		{
+			registry::get_instance().add(make_entry<codec>());
+		}
+
+		inline bool unregister_codec(const char* name)
+		{
+			return registry::get_instance().remove(name);
+		}
+	}
+
+	// name of the codec recognizing the data, nullptr when none does
+	inline const char* detect_format(const void* memory, size_t size)
+	{
+		const auto entry = codec::registry::get_instance().sniff(memory, size);
+		return entry ? entry->name : nullptr;
+	}
+
+	// try_* functions never throw nor call the error handler, failures are returned with their cause
+
+	template<pixel_type pixel>
+	inline result<image<pixel>> try_load_memory(const void* memory, size_t size)
+	{
+		IMPP_INSTRUMENT_CALL("unknown", "load_memory");
+		std::optional<codec::codec_entry> entry;
+		{
+			IMPP_INSTRUMENT_STAGE(STAGE_HEADER);
+			entry = codec::registry::get_instance().sniff(memory, size);
+		}
+		if (!entry)
+			return error::error_info{ error::ERROR_UNSUPPORTED, 0, "impp: unknown image format." };
+
+		IMPP_INSTRUMENT_FORMAT(entry->name);
+		return entry->get_decoder<pixel>()(memory, size);
+	}
+
+	// the file is read once and decoded from memory by the codec recognizing it
+	template<pixel_type pixel>
+	inline result<image<pixel>> try_load(const std::string& filename)
+	{
+		IMPP_INSTRUMENT_CALL("unknown", "load");
+		std::vector<uint8_t> bytes;
+		if (!detail::read_file(filename, &bytes))
+			return error::error_info{ error::ERROR_FILE_OPEN, 0, "impp: unable to read file." };
+		return try_load_memory<pixel>(bytes.data(), bytes.size());
+	}
+
+	// reads the header alone, the sides are known before paying for the decoding
+	inline result<image_info> try_probe_memory(const void* memory, size_t size)
+	{
+		const auto entry = codec::registry::get_instance().sniff(memory, size);
+		if (!entry)
+			return error::error_info{ error::ERROR_UNSUPPORTED, 0, "impp: unknown image format." };
+		if (!entry->probe)
+			return error::error_info{ error::ERROR_UNSUPPORTED, 0, "impp: the codec cannot read headers alone." };
+
+		image_info info;
+		info.format = entry->name;
+		if (!entry->probe(memory, size, &info))
+			return error::error_info{ error::ERROR_INVALID_HEADER, 0, "impp: invalid image header." };
+		return info;
+	}
+
+	// only the start of the file is read unless a header is larger
+	inline result<image_info> try_probe(const std::string& filename)
+	{
+		std::vector<uint8_t> bytes;
+		if (!detail::read_file(filename, &bytes, codec::PROBE_SIZE))
+			return error::error_info{ error::ERROR_FILE_OPEN, 0, "impp: unable to read file." };
+		auto res = try_probe_memory(bytes.data(), bytes.size());
+		if (res || bytes.size() < codec::PROBE_SIZE)
+			return res;
+
+		// only a tga id or colormap can outgrow the prefix, just the bytes they span are read again
+		tga::tga_header header;
+		memcpy(&header, bytes.data(), sizeof(header));
+		const size_t header_size = tga::detail::tga_header_size(header);
+		if (header_size <= bytes.size())
+			return res;
+		if (!detail::read_file(filename, &bytes, header_size))
+			return error::error_info{ error::ERROR_FILE_OPEN, 0, "impp: unable to read file." };
+		return try_probe_memory(bytes.data(), bytes.size());
+	}
+
+	// load functions return a null image on failure, errors found in the data are forwarded to the error handler
+
+	template<pixel_type pixel>
+	inline image<pixel> load_memory(const void* memory, size_t size)
+	{
+		auto res = try_load_memory<pixel>(memory, size);
+		return error::detail::report(res) ? std::move(res).value() : image<pixel>::null();
+	}
+
+	template<pixel_type pixel>
+	inline image<pixel> load(const std::string& filename)
+	{
+		auto res = try_load<pixel>(filename);
+		return error::detail::report(res) ? std::move(res).value() : image<pixel>::null();
+	}
+
+	// declared by image, defined here since it needs the codecs
+	template<class pixel>
+	inline image<pixel> image<pixel>::from_file(const std::string& filename)
+	{
+		return load<pixel>(filename);
+	}
+
+	template<class pixel>
+	inline image<pixel> image<pixel>::from_buffer(void* memory, size_t size)
+	{
+		return load_memory<pixel>(memory, size);
+	}
+}
+
+#endif //INCLUDE_IMPLUSPLUS_CODEC_HPP
@@ -0,0 +1,275 @@
+/*
+MIT License
+
+Copyright (c) 2022 IkarusDeveloper
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#pragma once
+#ifndef INCLUDE_IMPLUSPLUS_COLORSPACE_HPP
+#define INCLUDE_IMPLUSPLUS_COLORSPACE_HPP
+#include "image.hpp"
+
+#include <stdint.h>
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <vector>
+#include "parallel.hpp"
+#include "pixel.hpp"
+#include "simd.hpp"
+
+namespace impp
+{
+	// linear light working formats for resizing, blending and filtering, colors are linear and alpha keeps
+	// its straight value scaled to the range of the format
+
+	// 0 to 65535 per channel
+	struct pixel64linear
+	{
+		uint16_t r = 0;
+		uint16_t g = 0;
+		uint16_t b = 0;
+		uint16_t a = 0;
+
+		bool operator==(const pixel64linear&) const = default;
+	};
+
+	// 0 to 1 per channel, values out of range are clamped when encoded back
+	struct pixel128linear
+	{
+		float r = 0;
+		float g = 0;
+		float b = 0;
+		float a = 0;
+
+		bool operator==(const pixel128linear&) const = default;
+	};
+
+	namespace detail
+	{
+		// pixels given to each worker
+		constexpr size_t colorspace_grain = 64 * 1024;
+		// linear values are encoded through 4096 buckets, finer than the darkest srgb steps
+		constexpr size_t srgb_encode_bits = 12;
+		constexpr size_t srgb_encode_size = size_t(1) << srgb_encode_bits;
+
+		// the transfer functions are only evaluated to fill the tables
+		inline double srgb_to_linear_value(double value)
+		{
+			return value <= 0.04045 ? value / 12.92 : std::pow((value + 0.055) / 1.055, 2.4);
+		}
+
+		inline double linear_to_srgb_value(double value)
+		{
+			return value <= 0.0031308 ? value * 12.92 : 1.055 * std::pow(value, 1.0 / 2.4) - 0.055;
+		}
+
+		inline const auto srgb_decode_float = []() {
+			std::array<float, 256> table{};
+			for (size_t i = 0; i < table.size(); i++)
+				table[i] = static_cast<float>(srgb_to_linear_value(i / 255.0));
+			return table;
+		}();
+
+		inline const auto srgb_decode_u16 = []() {
+			std::array<uint16_t, 256> table{};
+			for (size_t i = 0; i < table.size(); i++)
+				table[i] = static_cast<uint16_t>(std::lround(srgb_to_linear_value(i / 255.0) * UINT16_MAX));
+			return table;
+		}();
+
+		// every bucket holds the srgb value of its center, which gives back the decoded srgb values exactly
+		inline const auto srgb_encode_table = []() {
+			std::array<uint8_t, srgb_encode_size> table{};
+			for (size_t i = 0; i < table.size(); i++)
+				table[i] = static_cast<uint8_t>(std::lround(linear_to_srgb_value((i + 0.5) / srgb_encode_size) * UINT8_MAX));
+			return table;
+		}();
+
+		// the bucket of a 16bit linear value, the same as the float one for value / 65535 up to rounding
+		inline size_t srgb_bucket(uint16_t value)
+		{
+			return value >> (16 - srgb_encode_bits);
+		}
+
+		// nan and negative values go to the first bucket
+		inline size_t srgb_bucket(float value)
+		{
+			if (!(value > 0.0f))
+				return 0;
+			return static_cast<size_t>(std::min(value * srgb_encode_size, srgb_encode_size - 1.0f));
+		}
+
+		// rounded division by 257 giving back the 8bit alpha of a widened one
+		inline uint8_t alpha_narrow(uint16_t value)
+		{
+			return static_cast<uint8_t>((value - (value >> 8) + 128) >> 8);
+		}
+
+		inline uint8_t alpha_narrow(float value)
+		{
+			if (!(value > 0.0f))
+				return 0;
+			return static_cast<uint8_t>(std::min(value, 1.0f) * UINT8_MAX + 0.5f);
+		}
+
+		template<pixel_type pixel>
+		inline uint8_t pixel_alpha(const pixel& px)
+		{
+			if constexpr (pixel_is32bit<pixel>)
+				return px.a;
+			else
+				return UINT8_MAX;
+		}
+
+		template<pixel_type pixel>
+		inline void srgb_decode_pixels(const pixel* from, pixel64linear* to, size_t count)
+		{
+			for (size_t i = 0; i < count; i++)
+			{
+				const auto& px = from[i];
+				to[i] = { srgb_decode_u16[px.r], srgb_decode_u16[px.g], srgb_decode_u16[px.b], static_cast<uint16_t>(pixel_alpha(px) * 257) };
+			}
+		}
+
+		template<pixel_type pixel>
+		inline void srgb_decode_pixels(const pixel* from, pixel128linear* to, size_t count)
+		{
+			for (size_t i = 0; i < count; i++)
+			{
+				const auto& px = from[i];
+				to[i] = { srgb_decode_float[px.r], srgb_decode_float[px.g], srgb_decode_float[px.b], pixel_alpha(px) / 255.0f };
+			}
+		}
+
+		template<pixel_type pixel>
+		inline void srgb_store(pixel& px, uint8_t r, uint8_t g, uint8_t b, uint8_t a)
+		{
+			px.r = r;
+			px.g = g;
+			px.b = b;
+			if constexpr (pixel_is32bit<pixel>)
+				px.a = a;
+		}
+
+		template<pixel_type pixel>
+		inline void srgb_encode_pixels(const pixel64linear* from, pixel* to, size_t count)
+		{
+			const auto& table = srgb_encode_table;
+			size_t i = 0;
+#ifdef IMPP_SIMD_SSE2
+			// buckets and narrowed alphas of two pixels at once, the table lookups stay scalar
+			const __m128i color_mask = _mm_setr_epi16(-1, -1, -1, 0, -1, -1, -1, 0);
+			for (; i + 2 <= count; i += 2)
+			{
+				const __m128i value = _mm_loadu_si128(reinterpret_cast<const __m128i*>(from + i));
+				const __m128i bucket = _mm_srli_epi16(value, 16 - srgb_encode_bits);
+				const __m128i alpha = _mm_srli_epi16(_mm_add_epi16(_mm_sub_epi16(value, _mm_srli_epi16(value, 8)), _mm_set1_epi16(128)), 8);
+				alignas(16) uint16_t lanes[8];
+				_mm_store_si128(reinterpret_cast<__m128i*>(lanes), _mm_or_si128(_mm_and_si128(color_mask, bucket), _mm_andnot_si128(color_mask, alpha)));
+				srgb_store(to[i], table[lanes[0]], table[lanes[1]], table[lanes[2]], static_cast<uint8_t>(lanes[3]));
+				srgb_store(to[i + 1], table[lanes[4]], table[lanes[5]], table[lanes[6]], static_cast<uint8_t>(lanes[7]));
+			}
+#endif
+			for (; i < count; i++)
+			{
+				const auto& px = from[i];
+				srgb_store(to[i], table[srgb_bucket(px.r)], table[srgb_bucket(px.g)], table[srgb_bucket(px.b)], alpha_narrow(px.a));
+			}
+		}
+
+		template<pixel_type pixel>
+		inline void srgb_encode_pixels(const pixel128linear* from, pixel* to, size_t count)
+		{
+			const auto& table = srgb_encode_table;
+			size_t i = 0;
+#ifdef IMPP_SIMD_SSE2
+			// colors are scaled to their bucket and alpha to 8bit in one register, clamping drops nans too
+			const __m128 scale = _mm_setr_ps(srgb_encode_size, srgb_encode_size, srgb_encode_size, UINT8_MAX);
+			const __m128 bias = _mm_setr_ps(0.0f, 0.0f, 0.0f, 0.5f);
+			const __m128 limit = _mm_setr_ps(srgb_encode_size - 1.0f, srgb_encode_size - 1.0f, srgb_encode_size - 1.0f, UINT8_MAX);
+			for (; i < count; i++)
+			{
+				const __m128 value = _mm_max_ps(_mm_loadu_ps(&from[i].r), _mm_setzero_ps());
+				const __m128 scaled = _mm_min_ps(_mm_add_ps(_mm_mul_ps(_mm_min_ps(value, _mm_set1_ps(1.0f)), scale), bias), limit);
+				alignas(16) int32_t lanes[4];
+				_mm_store_si128(reinterpret_cast<__m128i*>(lanes), _mm_cvttps_epi32(scaled));
+				srgb_store(to[i], table[lanes[0]], table[lanes[1]], table[lanes[2]], static_cast<uint8_t>(lanes[3]));
+			}
+#endif
+			for (; i < count; i++)
+			{
+				const auto& px = from[i];
+				srgb_store(to[i], table[srgb_bucket(px.r)], table[srgb_bucket(px.g)], table[srgb_bucket(px.b)], alpha_narrow(px.a));
+			}
+		}
+	}
+
+	// a single channel through the same tables as the pixel conversions
+	inline float srgb_decode(uint8_t value)
+	{
+		return detail::srgb_decode_float[value];
+	}
+
+	inline uint8_t srgb_encode(float value)
+	{
+		return detail::srgb_encode_table[detail::srgb_bucket(value)];
+	}
+
+	// srgb pixels to linear ones, 24bit pixels get an opaque alpha
+	// threads splits the pixels among workers, 0 asks for one per hardware thread
+	template<pixel_type pixel, class linear>
+	inline void srgb_to_linear(const pixel* from, linear* to, size_t count, unsigned threads = 1)
+	{
+		detail::parallel_for(count, detail::colorspace_grain, threads, [&](size_t begin, size_t end) {
+			detail::srgb_decode_pixels(from + begin, to + begin, end - begin);
+		});
+	}
+
+	// linear pixels back to srgb, every decoded srgb value is given back exactly
+	template<class linear, pixel_type pixel>
+	inline void linear_to_srgb(const linear* from, pixel* to, size_t count, unsigned threads = 1)
+	{
+		detail::parallel_for(count, detail::colorspace_grain, threads, [&](size_t begin, size_t end) {
+			detail::srgb_encode_pixels(from + begin, to + begin, end - begin);
+		});
+	}
+
+	// linear is pixel64linear or pixel128linear, the orientation is kept
+	template<class linear = pixel64linear, pixel_type pixel>
+	inline image<linear> srgb_to_linear(const image<pixel>& source, unsigned threads = 1)
+	{
+		auto ret = image<linear>::create(source.width, source.height);
+		ret.orientation = static_cast<typename image<linear>::orientation_value>(source.orientation);
+		srgb_to_linear(source.pixels.data(), ret.pixels.data(), source.pixels.size(), threads);
+		return ret;
+	}
+
+	template<pixel_type pixel = pixel32rgba, class linear>
+	inline image<pixel> linear_to_srgb(const image<linear>& source, unsigned threads = 1)
+	{
+		auto ret = image<pixel>::create(source.width, source.height);
+		ret.orientation = static_cast<typename image<pixel>::orientation_value>(source.orientation);
+		linear_to_srgb(source.pixels.data(), ret.pixels.data(), source.pixels.size(), threads);
+		return ret;
+	}
+}
+
+#endif //INCLUDE_IMPLUSPLUS_COLORSPACE_HPP
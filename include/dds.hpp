@@ -0,0 +1,649 @@
+/*
+MIT License
+
+Copyright (c) 2022 IkarusDeveloper
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#pragma once
+#ifndef INCLUDE_IMPLUSPLUS_DDS_HPP
+#define INCLUDE_IMPLUSPLUS_DDS_HPP
+#include "image.hpp"
+
+#include <string.h>
+#include <stdint.h>
+#include <algorithm>
+#include <type_traits>
+#include <vector>
+#include "pixel.hpp"
+#include "encoder.hpp"
+#include "decoder.hpp"
+#include "error.hpp"
+#include "instrument.hpp"
+#include "bc.hpp"
+#include "mipmap.hpp"
+
+// directdraw surfaces, the first surface is read with its mipmaps
+namespace impp
+{
+	namespace dds
+	{
+		enum dds_format : uint8_t {
+			DDS_FORMAT_RGBA8 = 0,                       // uncompressed 32bit rgba
+			DDS_FORMAT_BC1 = bc::BC_FORMAT_BC1,         // stored as DXT1
+			DDS_FORMAT_BC2 = bc::BC_FORMAT_BC2,         // stored as DXT3
+			DDS_FORMAT_BC3 = bc::BC_FORMAT_BC3,         // stored as DXT5
+			DDS_FORMAT_BC7 = bc::BC_FORMAT_BC7,         // stored with the DX10 header
+		};
+
+		enum dds_flags : uint32_t {
+			DDSD_CAPS = 0x1,
+			DDSD_HEIGHT = 0x2,
+			DDSD_WIDTH = 0x4,
+			DDSD_PITCH = 0x8,
+			DDSD_PIXELFORMAT = 0x1000,
+			DDSD_MIPMAPCOUNT = 0x20000,
+			DDSD_LINEARSIZE = 0x80000,
+		};
+
+		enum dds_pixelformat_flags : uint32_t {
+			DDPF_ALPHAPIXELS = 0x1,
+			DDPF_FOURCC = 0x4,
+			DDPF_RGB = 0x40,
+		};
+
+		enum dxgi_format : uint32_t {
+			DXGI_FORMAT_R8G8B8A8_UNORM = 28,
+			DXGI_FORMAT_R8G8B8A8_UNORM_SRGB = 29,
+			DXGI_FORMAT_BC1_UNORM = 71,
+			DXGI_FORMAT_BC1_UNORM_SRGB = 72,
+			DXGI_FORMAT_BC2_UNORM = 74,
+			DXGI_FORMAT_BC2_UNORM_SRGB = 75,
+			DXGI_FORMAT_BC3_UNORM = 77,
+			DXGI_FORMAT_BC3_UNORM_SRGB = 78,
+			DXGI_FORMAT_B8G8R8A8_UNORM = 87,
+			DXGI_FORMAT_B8G8R8X8_UNORM = 88,
+			DXGI_FORMAT_B8G8R8A8_UNORM_SRGB = 91,
+			DXGI_FORMAT_B8G8R8X8_UNORM_SRGB = 93,
+			DXGI_FORMAT_BC7_UNORM = 98,
+			DXGI_FORMAT_BC7_UNORM_SRGB = 99,
+		};
+
+		constexpr uint8_t DDS_MAGIC[] = { 'D', 'D', 'S', ' ' };
+		constexpr uint32_t DDS_CAPS_COMPLEX = 0x8;
+		constexpr uint32_t DDS_CAPS_TEXTURE = 0x1000;
+		constexpr uint32_t DDS_CAPS_MIPMAP = 0x400000;
+		constexpr uint32_t DDS_DIMENSION_TEXTURE2D = 3;
+		constexpr size_t DDS_PIXELS_MAX = 400000000;
+
+		constexpr uint32_t dds_fourcc(char a, char b, char c, char d)
+		{
+			return uint32_t(uint8_t(a)) | uint32_t(uint8_t(b)) << 8 | uint32_t(uint8_t(c)) << 16 | uint32_t(uint8_t(d)) << 24;
+		}
+
+#pragma pack(push, 1)
+		struct dds_pixelformat
+		{
+			uint32_t size;
+			uint32_t flags;
+			uint32_t fourcc;
+			uint32_t bitcount;
+			uint32_t rmask;
+			uint32_t gmask;
+			uint32_t bmask;
+			uint32_t amask;
+		};
+
+		// follows the magic
+		struct dds_header
+		{
+			uint32_t size;
+			uint32_t flags;
+			uint32_t height;
+			uint32_t width;
+			uint32_t pitch_or_linear_size;
+			uint32_t depth;
+			uint32_t mipmap_count;
+			uint32_t reserved1[11];
+			dds_pixelformat pixelformat;
+			uint32_t caps;
+			uint32_t caps2;
+			uint32_t caps3;
+			uint32_t caps4;
+			uint32_t reserved2;
+		};
+
+		// follows the header when the fourcc is DX10
+		struct dds_header_dx10
+		{
+			uint32_t dxgi_format;
+			uint32_t resource_dimension;
+			uint32_t misc_flag;
+			uint32_t array_size;
+			uint32_t misc_flags2;
+		};
+#pragma pack(pop)
+
+		static_assert(sizeof(dds_header) == 124 && sizeof(dds_pixelformat) == 32 && sizeof(dds_header_dx10) == 20);
+
+		namespace detail
+		{
+			// how the first surface is stored, either blocks or byte aligned channels
+			struct dds_layout
+			{
+				bc::bc_format blocks = {};  // 0 for uncompressed data
+				uint32_t bytes = 0;         // bytes per uncompressed pixel
+				int shift[4] = {};          // bit offset of r, g, b and a, -1 for a missing alpha
+			};
+
+			// 8 bit masks are the only uncompressed layouts read
+			inline int dds_mask_shift(uint32_t mask, uint32_t bitcount)
+			{
+				for (int shift = 0; shift + 8 <= static_cast<int>(bitcount); shift += 8)
+					if (mask == 0xFFu << shift)
+						return shift;
+				return -2;
+			}
+
+			inline bool dds_dxgi_layout(uint32_t format, dds_layout* layout)
+			{
+				switch (format)
+				{
+				case DXGI_FORMAT_BC1_UNORM: case DXGI_FORMAT_BC1_UNORM_SRGB: layout->blocks = bc::BC_FORMAT_BC1; return true;
+				case DXGI_FORMAT_BC2_UNORM: case DXGI_FORMAT_BC2_UNORM_SRGB: layout->blocks = bc::BC_FORMAT_BC2; return true;
+				case DXGI_FORMAT_BC3_UNORM: case DXGI_FORMAT_BC3_UNORM_SRGB: layout->blocks = bc::BC_FORMAT_BC3; return true;
+				case DXGI_FORMAT_BC7_UNORM: case DXGI_FORMAT_BC7_UNORM_SRGB: layout->blocks = bc::BC_FORMAT_BC7; return true;
+				case DXGI_FORMAT_R8G8B8A8_UNORM: case DXGI_FORMAT_R8G8B8A8_UNORM_SRGB:
+					*layout = { {}, 4, { 0, 8, 16, 24 } };
+					return true;
+				case DXGI_FORMAT_B8G8R8A8_UNORM: case DXGI_FORMAT_B8G8R8A8_UNORM_SRGB:
+					*layout = { {}, 4, { 16, 8, 0, 24 } };
+					return true;
+				case DXGI_FORMAT_B8G8R8X8_UNORM: case DXGI_FORMAT_B8G8R8X8_UNORM_SRGB:
+					*layout = { {}, 4, { 16, 8, 0, -1 } };
+					return true;
+				}
+				return false;
+			}
+
+			template<pixel_type pixel>
+			inline void dds_decode_uncompressed(const uint8_t* data, const dds_layout& layout, uint32_t width, uint32_t height, pixel* pixels)
+			{
+				for (uint32_t row = 0; row < height; row++)
+				{
+					const uint8_t* src = data + static_cast<size_t>(row) * width * layout.bytes;
+					auto* dst = pixels + static_cast<size_t>(height - 1 - row) * width;
+					for (uint32_t x = 0; x < width; x++, src += layout.bytes)
+					{
+						uint32_t value = 0;
+						memcpy(&value, src, layout.bytes);
+						const pixel32rgba px{ uint8_t(value >> layout.shift[0]), uint8_t(value >> layout.shift[1]), uint8_t(value >> layout.shift[2]),
+							layout.shift[3] < 0 ? uint8_t(UINT8_MAX) : uint8_t(value >> layout.shift[3]) };
+						dst[x] = pixel_cast<pixel>(px);
+					}
+				}
+			}
+
+			// reads the magic and the headers up to the first surface, false is returned with the error recorded in the decoder
+			inline bool dds_read_header(decoder& decoder, dds_header* header, dds_layout* layout)
+			{
+				IMPP_INSTRUMENT_STAGE(STAGE_HEADER);
+				const auto* bytes = decoder.peek<uint8_t>(sizeof(DDS_MAGIC) + sizeof(*header));
+				decoder.proceed_reading(sizeof(DDS_MAGIC) + sizeof(*header));
+				if (decoder.failed())
+					return false;
+				if (memcmp(bytes, DDS_MAGIC, sizeof(DDS_MAGIC)) != 0)
+					return decoder.fail(error::ERROR_INVALID_HEADER, "dds: invalid magic.");
+				memcpy(header, bytes + sizeof(DDS_MAGIC), sizeof(*header));
+				if (header->size != sizeof(dds_header) || header->pixelformat.size != sizeof(dds_pixelformat))
+					return decoder.fail(error::ERROR_INVALID_HEADER, "dds: invalid header size.");
+
+				const auto& pf = header->pixelformat;
+				if (pf.flags & DDPF_FOURCC)
+				{
+					switch (pf.fourcc)
+					{
+					case dds_fourcc('D', 'X', 'T', '1'): layout->blocks = bc::BC_FORMAT_BC1; break;
+					case dds_fourcc('D', 'X', 'T', '2'):
+					case dds_fourcc('D', 'X', 'T', '3'): layout->blocks = bc::BC_FORMAT_BC2; break;
+					case dds_fourcc('D', 'X', 'T', '4'):
+					case dds_fourcc('D', 'X', 'T', '5'): layout->blocks = bc::BC_FORMAT_BC3; break;
+					case dds_fourcc('D', 'X', '1', '0'):
+					{
+						dds_header_dx10 dx10;
+						const auto* ext = decoder.peek<uint8_t>(sizeof(dx10));
+						decoder.proceed_reading(sizeof(dx10));
+						if (decoder.failed())
+							return false;
+						memcpy(&dx10, ext, sizeof(dx10));
+						if (dx10.resource_dimension != DDS_DIMENSION_TEXTURE2D)
+							return decoder.reject(error::ERROR_UNSUPPORTED, "dds: only 2d textures are supported.");
+						if (!dds_dxgi_layout(dx10.dxgi_format, layout))
+							return decoder.reject(error::ERROR_UNSUPPORTED, "dds: unsupported dxgi format.");
+						break;
+					}
+					default:
+						return decoder.reject(error::ERROR_UNSUPPORTED, "dds: unsupported fourcc.");
+					}
+				}
+				else if ((pf.flags & DDPF_RGB) && (pf.bitcount == 24 || pf.bitcount == 32))
+				{
+					layout->bytes = pf.bitcount / 8;
+					layout->shift[0] = dds_mask_shift(pf.rmask, pf.bitcount);
+					layout->shift[1] = dds_mask_shift(pf.gmask, pf.bitcount);
+					layout->shift[2] = dds_mask_shift(pf.bmask, pf.bitcount);
+					layout->shift[3] = (pf.flags & DDPF_ALPHAPIXELS) ? dds_mask_shift(pf.amask, pf.bitcount) : -1;
+					if (std::any_of(layout->shift, layout->shift + 4, [](int shift) { return shift == -2; }))
+						return decoder.reject(error::ERROR_UNSUPPORTED, "dds: channels must be 8 bit.");
+				}
+				else
+					return decoder.reject(error::ERROR_UNSUPPORTED, "dds: unsupported pixel format.");
+
+				if (header->width == 0 || header->height == 0)
+					return decoder.fail(error::ERROR_INVALID_HEADER, "dds: image sides must not be 0.");
+				if (static_cast<size_t>(header->width) * header->height > DDS_PIXELS_MAX)
+					return decoder.reject(error::ERROR_UNSUPPORTED, "dds: images are limited to 400 million pixels.");
+				return true;
+			}
+
+			// bytes stored for the surface of one level
+			inline size_t dds_surface_size(const dds_layout& layout, uint32_t width, uint32_t height)
+			{
+				return layout.blocks ? bc::get_compressed_size(layout.blocks, width, height) : static_cast<size_t>(width) * height * layout.bytes;
+			}
+
+			// reported where the input ends like a read past it
+			inline bool dds_truncated(decoder& decoder)
+			{
+				decoder.proceed_reading(decoder.get_readable());
+				return decoder.fail(error::ERROR_TRUNCATED, "dds: surface exceeds input.");
+			}
+
+			// decodes the surface of one level at the read offset into bottom-up rows
+			template<pixel_type pixel>
+			inline bool dds_decode_surface(decoder& decoder, const dds_layout& layout, uint32_t width, uint32_t height, pixel* pixels)
+			{
+				const size_t size = dds_surface_size(layout, width, height);
+				const auto* data = decoder.peek<uint8_t>(size);
+				if (decoder.failed())
+					return false;
+
+				IMPP_INSTRUMENT_STAGE(STAGE_DECODE);
+				if (layout.blocks)
+				{
+					size_t offset = 0;
+					if (!bc::detail::bc_decompress_pixels(data, layout.blocks, width, height, pixels, &offset))
+					{
+						decoder.proceed_reading(offset);
+						return decoder.reject(error::ERROR_UNSUPPORTED, "dds: bc7 block mode is not supported.");
+					}
+				}
+				else
+					dds_decode_uncompressed(data, layout, width, height, pixels);
+				decoder.proceed_reading(size);
+				return true;
+			}
+
+			// decodes the top level of the first surface, false is returned with the error recorded in the decoder
+			template<pixel_type pixel, class imagesize = image<pixel>::size>
+			inline bool dds_load_memory(decoder& decoder, imagesize* width, imagesize* height, std::vector<pixel>* pixels)
+			{
+				dds_header header;
+				dds_layout layout;
+				if (!dds_read_header(decoder, &header, &layout))
+					return false;
+
+				// the surface must be in the input before its pixels are allocated
+				if (dds_surface_size(layout, header.width, header.height) > decoder.get_readable())
+					return dds_truncated(decoder);
+
+				const auto pcount = static_cast<size_t>(header.width) * header.height;
+				std::vector<pixel> temp_pixel(pcount);
+				IMPP_INSTRUMENT_ALLOCATION(pcount * sizeof(pixel));
+				if (!dds_decode_surface(decoder, layout, header.width, header.height, temp_pixel.data()))
+					return false;
+
+				IMPP_INSTRUMENT_COUNT(bytes_read, decoder.get_read_offset());
+				*width = header.width;
+				*height = header.height;
+				*pixels = std::move(temp_pixel);
+				return true;
+			}
+
+			// decodes every level of the first surface, a missing mipmap count reads the top level only
+			template<pixel_type pixel>
+			inline bool dds_load_mipmaps(decoder& decoder, mipmap_chain<pixel>* chain)
+			{
+				dds_header header;
+				dds_layout layout;
+				if (!dds_read_header(decoder, &header, &layout))
+					return false;
+
+				const size_t count = (header.flags & DDSD_MIPMAPCOUNT) ? std::max<uint32_t>(header.mipmap_count, 1) : 1;
+				if (count > mipmap_chain<pixel>::get_full_count(header.width, header.height))
+					return decoder.fail(error::ERROR_INVALID_HEADER, "dds: more mipmaps than the sides allow.");
+
+				// every level must be in the input before the chain is allocated
+				size_t surfaces = 0;
+				for (uint32_t i = 0, w = header.width, h = header.height; i < count; i++, w = std::max(w / 2, 1u), h = std::max(h / 2, 1u))
+					surfaces += dds_surface_size(layout, w, h);
+				if (surfaces > decoder.get_readable())
+					return dds_truncated(decoder);
+
+				auto temp_chain = mipmap_chain<pixel>::create(header.width, header.height, count);
+				IMPP_INSTRUMENT_ALLOCATION(temp_chain.get_pixels().size() * sizeof(pixel));
+				for (size_t i = 0; i < count; i++)
+				{
+					const auto& level = temp_chain.get_level(i);
+					if (!dds_decode_surface(decoder, layout, level.width, level.height, temp_chain.get_level_pixels(i)))
+						return false;
+				}
+
+				IMPP_INSTRUMENT_COUNT(bytes_read, decoder.get_read_offset());
+				*chain = std::move(temp_chain);
+				return true;
+			}
+
+			// header of a texture with levels mipmaps, the DX10 extension is only used by bc7
+			inline void dds_make_header(uint32_t width, uint32_t height, size_t levels, dds_format format, dds_header* header, dds_header_dx10* dx10)
+			{
+				*header = {};
+				*dx10 = {};
+				header->size = sizeof(dds_header);
+				header->flags = DDSD_CAPS | DDSD_HEIGHT | DDSD_WIDTH | DDSD_PIXELFORMAT | DDSD_MIPMAPCOUNT;
+				header->width = width;
+				header->height = height;
+				header->mipmap_count = static_cast<uint32_t>(levels);
+				header->caps = DDS_CAPS_TEXTURE | (levels > 1 ? DDS_CAPS_COMPLEX | DDS_CAPS_MIPMAP : 0);
+				header->pixelformat.size = sizeof(dds_pixelformat);
+
+				if (format == DDS_FORMAT_RGBA8)
+				{
+					header->flags |= DDSD_PITCH;
+					header->pitch_or_linear_size = width * 4;
+					header->pixelformat.flags = DDPF_RGB | DDPF_ALPHAPIXELS;
+					header->pixelformat.bitcount = 32;
+					header->pixelformat.rmask = 0x000000FF;
+					header->pixelformat.gmask = 0x0000FF00;
+					header->pixelformat.bmask = 0x00FF0000;
+					header->pixelformat.amask = 0xFF000000;
+					return;
+				}
+
+				const auto blocks = static_cast<bc::bc_format>(format);
+				header->flags |= DDSD_LINEARSIZE;
+				header->pitch_or_linear_size = static_cast<uint32_t>(std::min<size_t>(bc::get_compressed_size(blocks, width, height), UINT32_MAX));
+				header->pixelformat.flags = DDPF_FOURCC;
+				switch (format)
+				{
+				case DDS_FORMAT_BC1: header->pixelformat.fourcc = dds_fourcc('D', 'X', 'T', '1'); break;
+				case DDS_FORMAT_BC2: header->pixelformat.fourcc = dds_fourcc('D', 'X', 'T', '3'); break;
+				case DDS_FORMAT_BC3: header->pixelformat.fourcc = dds_fourcc('D', 'X', 'T', '5'); break;
+				default:
+					header->pixelformat.fourcc = dds_fourcc('D', 'X', '1', '0');
+					dx10->dxgi_format = DXGI_FORMAT_BC7_UNORM;
+					dx10->resource_dimension = DDS_DIMENSION_TEXTURE2D;
+					dx10->array_size = 1;
+					break;
+				}
+			}
+
+			// writes the surface of one level, rows go top to bottom
+			template<pixel_type pixel, encoder_type encoder>
+			inline void dds_write_surface(const image<pixel>& source, encoder& enc, dds_format format, unsigned threads)
+			{
+				if (format == DDS_FORMAT_RGBA8)
+				{
+					IMPP_INSTRUMENT_STAGE(STAGE_ENCODE);
+					std::vector<pixel32rgba> row(source.width);
+					for (size_t y = source.height; y-- > 0; )
+					{
+						const auto* src = source.pixels.data() + y * source.width;
+						std::transform(src, src + source.width, row.begin(), [](const pixel& px) { return pixel_cast<pixel32rgba>(px); });
+						enc.write(row.data(), row.size() * sizeof(pixel32rgba));
+					}
+					return;
+				}
+
+				const auto blocks = static_cast<bc::bc_format>(format);
+				std::vector<uint8_t> data;
+				{
+					IMPP_INSTRUMENT_STAGE(STAGE_ENCODE);
+					if constexpr (std::is_same_v<pixel, pixel32rgba>)
+						data = bc::compress(source, blocks, threads);
+					else
+						data = bc::compress(image<pixel32rgba>::create(source.width, source.height, pixel_convert<pixel32rgba>(source.pixels)), blocks, threads);
+				}
+				IMPP_INSTRUMENT_STAGE(STAGE_IO);
+				enc.write(data.data(), data.size());
+			}
+
+			template<encoder_type encoder>
+			inline bool dds_check_format(encoder& enc, dds_format format)
+			{
+				if (format != DDS_FORMAT_RGBA8 && !bc::is_valid_format(static_cast<bc::bc_format>(format)))
+					return enc.reject(error::ERROR_INVALID_ARGUMENT, "dds: unknown format.");
+				return true;
+			}
+
+			template<encoder_type encoder>
+			inline void dds_write_header(encoder& enc, const dds_header& header, const dds_header_dx10& dx10, dds_format format)
+			{
+				IMPP_INSTRUMENT_STAGE(STAGE_IO);
+				enc.write(DDS_MAGIC, sizeof(DDS_MAGIC));
+				enc.write(&header, sizeof(header));
+				if (format == DDS_FORMAT_BC7)
+					enc.write(&dx10, sizeof(dx10));
+			}
+		}
+
+		// true when the data starts with the magic and a well formed header size
+		inline bool has_signature(const void* memory, size_t size)
+		{
+			const auto* bytes = reinterpret_cast<const uint8_t*>(memory);
+			return size >= sizeof(DDS_MAGIC) + sizeof(dds_header) && memcmp(bytes, DDS_MAGIC, sizeof(DDS_MAGIC)) == 0
+				&& bytes[4] == sizeof(dds_header) && bytes[5] == 0 && bytes[6] == 0 && bytes[7] == 0;
+		}
+
+		// try_* functions never throw nor call the error handler, failures are returned with their cause
+
+		template<pixel_type pixel>
+		inline result<image<pixel>> try_load_memory(const void* memory, size_t size) {
+			IMPP_INSTRUMENT_CALL("dds", "load_memory");
+			typename image<pixel>::size width = 0, height = 0;
+			typename image<pixel>::pixelvec pixels{};
+
+			auto decoder = decoder::create(memory, size, error::ERROR_POLICY_RECORD);
+			const bool decoded = detail::dds_load_memory(decoder, &width, &height, &pixels);
+			return impp::detail::decoded_image(decoder, decoded, width, height, std::move(pixels));
+		}
+
+		template<pixel_type pixel>
+		inline result<image<pixel>> try_load(const std::string& filename) {
+			IMPP_INSTRUMENT_CALL("dds", "load");
+			std::vector<uint8_t> bytes;
+			if (!impp::detail::read_file(filename, &bytes))
+				return error::error_info{ error::ERROR_FILE_OPEN, 0, "dds: unable to read file." };
+			return try_load_memory<pixel>(bytes.data(), bytes.size());
+		}
+
+		// every level stored in the file, as many as the header declares
+		template<pixel_type pixel>
+		inline result<mipmap_chain<pixel>> try_load_mipmaps_memory(const void* memory, size_t size) {
+			IMPP_INSTRUMENT_CALL("dds", "load_mipmaps_memory");
+			mipmap_chain<pixel> chain;
+			auto decoder = decoder::create(memory, size, error::ERROR_POLICY_RECORD);
+			if (!detail::dds_load_mipmaps(decoder, &chain) || decoder.failed())
+				return decoder.get_error();
+			IMPP_INSTRUMENT_SUCCEEDED();
+			return chain;
+		}
+
+		template<pixel_type pixel>
+		inline result<mipmap_chain<pixel>> try_load_mipmaps(const std::string& filename) {
+			IMPP_INSTRUMENT_CALL("dds", "load_mipmaps");
+			std::vector<uint8_t> bytes;
+			if (!impp::detail::read_file(filename, &bytes))
+				return error::error_info{ error::ERROR_FILE_OPEN, 0, "dds: unable to read file." };
+			return try_load_mipmaps_memory<pixel>(bytes.data(), bytes.size());
+		}
+
+		// load functions return a null image on failure, errors found in the data are forwarded to the error handler
+
+		template<pixel_type pixel>
+		inline image<pixel> load(const std::string& filename) {
+			auto res = try_load<pixel>(filename);
+			return error::detail::report(res) ? std::move(res).value() : image<pixel>::null();
+		}
+
+		template<pixel_type pixel>
+		inline image<pixel> load_memory(const void* memory, size_t size) {
+			auto res = try_load_memory<pixel>(memory, size);
+			return error::detail::report(res) ? std::move(res).value() : image<pixel>::null();
+		}
+
+		// writes a single level texture, bc1 to bc3 use the legacy fourcc header and bc7 the DX10 one;
+		// threads is the number of block compression workers, 0 uses every hardware thread
+		template<pixel_type pixel, encoder_type encoder>
+		inline bool save_to_encoder(const image<pixel>& source, encoder& enc, dds_format format = DDS_FORMAT_BC3, unsigned threads = 0)
+		{
+			IMPP_INSTRUMENT_CALL("dds", "save_to_encoder");
+			enc.reset();
+			if (source.width == 0 || source.height == 0 || source.pixels.size() != static_cast<size_t>(source.width) * source.height)
+				return enc.reject(error::ERROR_INVALID_ARGUMENT, "dds: image is empty or inconsistent.");
+			if (!detail::dds_check_format(enc, format))
+				return false;
+			if (source.pixels.size() > DDS_PIXELS_MAX)
+				return enc.reject(error::ERROR_UNSUPPORTED, "dds: images are limited to 400 million pixels.");
+
+			dds_header header;
+			dds_header_dx10 dx10;
+			detail::dds_make_header(source.width, source.height, 1, format, &header, &dx10);
+			detail::dds_write_header(enc, header, dx10, format);
+			detail::dds_write_surface(source, enc, format, threads);
+
+			if (enc.failed())
+				return false;
+
+			IMPP_INSTRUMENT_COUNT(bytes_written, enc.get_writesize());
+			IMPP_INSTRUMENT_SUCCEEDED();
+			return true;
+		}
+
+		// writes every level of the chain after one header, largest first
+		template<pixel_type pixel, encoder_type encoder>
+		inline bool save_mipmaps_to_encoder(const mipmap_chain<pixel>& chain, encoder& enc, dds_format format = DDS_FORMAT_BC3, unsigned threads = 0)
+		{
+			IMPP_INSTRUMENT_CALL("dds", "save_mipmaps_to_encoder");
+			enc.reset();
+			if (chain.empty())
+				return enc.reject(error::ERROR_INVALID_ARGUMENT, "dds: mipmap chain is empty.");
+			if (!detail::dds_check_format(enc, format))
+				return false;
+			const auto& top = chain.get_level(0);
+			if (static_cast<size_t>(top.width) * top.height > DDS_PIXELS_MAX)
+				return enc.reject(error::ERROR_UNSUPPORTED, "dds: images are limited to 400 million pixels.");
+
+			dds_header header;
+			dds_header_dx10 dx10;
+			detail::dds_make_header(top.width, top.height, chain.get_level_count(), format, &header, &dx10);
+			detail::dds_write_header(enc, header, dx10, format);
+			for (size_t i = 0; i < chain.get_level_count() && !enc.failed(); i++)
+				detail::dds_write_surface(chain.get_image(i), enc, format, threads);
+
+			if (enc.failed())
+				return false;
+
+			IMPP_INSTRUMENT_COUNT(bytes_written, enc.get_writesize());
+			IMPP_INSTRUMENT_SUCCEEDED();
+			return true;
+		}
+
+		// returns the number of bytes written
+		template<pixel_type pixel>
+		inline result<size_t> try_save_to_file(const image<pixel>& source, const std::string& filename, dds_format format = DDS_FORMAT_BC3, unsigned threads = 0)
+		{
+			IMPP_INSTRUMENT_CALL("dds", "save_to_file");
+			auto enc = file_encoder::create(filename, error::ERROR_POLICY_RECORD);
+			if (!enc.is_open())
+				return error::error_info{ error::ERROR_FILE_OPEN, 0, "dds: unable to create file." };
+
+			if (!save_to_encoder(source, enc, format, threads) || !enc.flush())
+				return enc.get_error();
+			return enc.get_writesize();
+		}
+
+		template<pixel_type pixel>
+		inline result<size_t> try_save_to_memory(const image<pixel>& source, memory_encoder& encoder, dds_format format = DDS_FORMAT_BC3, unsigned threads = 0)
+		{
+			IMPP_INSTRUMENT_CALL("dds", "save_to_memory");
+			if (!save_to_encoder(source, encoder, format, threads))
+				return encoder.get_error();
+			return encoder.get_writesize();
+		}
+
+		template<pixel_type pixel>
+		inline result<size_t> try_save_mipmaps_to_file(const mipmap_chain<pixel>& chain, const std::string& filename, dds_format format = DDS_FORMAT_BC3, unsigned threads = 0)
+		{
+			IMPP_INSTRUMENT_CALL("dds", "save_mipmaps_to_file");
+			auto enc = file_encoder::create(filename, error::ERROR_POLICY_RECORD);
+			if (!enc.is_open())
+				return error::error_info{ error::ERROR_FILE_OPEN, 0, "dds: unable to create file." };
+
+			if (!save_mipmaps_to_encoder(chain, enc, format, threads) || !enc.flush())
+				return enc.get_error();
+			return enc.get_writesize();
+		}
+
+		template<pixel_type pixel>
+		inline result<size_t> try_save_mipmaps_to_memory(const mipmap_chain<pixel>& chain, memory_encoder& encoder, dds_format format = DDS_FORMAT_BC3, unsigned threads = 0)
+		{
+			IMPP_INSTRUMENT_CALL("dds", "save_mipmaps_to_memory");
+			if (!save_mipmaps_to_encoder(chain, encoder, format, threads))
+				return encoder.get_error();
+			return encoder.get_writesize();
+		}
+
+		template<pixel_type pixel>
+		inline bool save_to_file(const image<pixel>& source, const std::string& filename, dds_format format = DDS_FORMAT_BC3, unsigned threads = 0)
+		{
+			return error::detail::report(try_save_to_file(source, filename, format, threads));
+		}
+
+		template<pixel_type pixel>
+		inline bool save_to_memory(const image<pixel>& source, memory_encoder& encoder, dds_format format = DDS_FORMAT_BC3, unsigned threads = 0)
+		{
+			return error::detail::report(try_save_to_memory(source, encoder, format, threads));
+		}
+
+		template<pixel_type pixel>
+		inline bool save_mipmaps_to_file(const mipmap_chain<pixel>& chain, const std::string& filename, dds_format format = DDS_FORMAT_BC3, unsigned threads = 0)
+		{
+			return error::detail::report(try_save_mipmaps_to_file(chain, filename, format, threads));
+		}
+
+		template<pixel_type pixel>
+		inline bool save_mipmaps_to_memory(const mipmap_chain<pixel>& chain, memory_encoder& encoder, dds_format format = DDS_FORMAT_BC3, unsigned threads = 0)
+		{
+			return error::detail::report(try_save_mipmaps_to_memory(chain, encoder, format, threads));
+		}
+	}
+}
+
+#endif //INCLUDE_IMPLUSPLUS_DDS_HPP
@@ -1,31 +1,64 @@
 #pragma once
 #ifndef INCLUDE_IMPLUSPLUS_DECODER_HPP
 #define INCLUDE_IMPLUSPLUS_DECODER_HPP
+#include <algorithm>
 #include <cstddef>
-#include <stdexcept>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <type_traits>
+#include <vector>
+#include "error.hpp"
+#include "instrument.hpp"
 
 namespace impp
 {
+    namespace detail
+    {
+        // zeroed bytes handed out by failed reads and peeks whatever size was asked
+        // peeks sized from the input must be checked against get_readable() or followed by failed() before use
+        inline constexpr size_t decoder_scratch_size = 1024;
+        alignas(std::max_align_t) inline constexpr uint8_t decoder_scratch[decoder_scratch_size] = {};
+    }
+
+    // under ERROR_POLICY_RECORD failed reads return zeroed data and the decoder stays at the end of its input
     class decoder {
     private:
         using memory_byte = uint8_t;
         const memory_byte* _readmem = nullptr;
         size_t _readsize = 0;
         size_t _readoffset = 0;
+        error::error_state _errors;
+
+        const memory_byte* truncated(const char* message)
+        {
+            _errors.fail(error::ERROR_TRUNCATED, _readoffset, message);
+            _readoffset = _readsize;
+            return detail::decoder_scratch;
+        }
 
     public:
-        static decoder create(const void* mem, size_t size)
+        static decoder create(const void* mem, size_t size, error::error_policy policy = error::default_policy)
         {
-            return { mem, size };
+            return { mem, size, policy };
         }
 
-        decoder(const void* mem, size_t size) : _readmem(reinterpret_cast<const memory_byte*>(mem)), _readsize(size) {}
+        decoder(const void* mem, size_t size, error::error_policy policy = error::default_policy) :
+            _readmem(reinterpret_cast<const memory_byte*>(mem)), _readsize(size), _errors(policy) {}
         decoder(const decoder&) = default;
 
         void read(void* mem, size_t size)
         {
+            // mem may be null when there is nothing to read
+            if(size == 0)
+                return;
             if(_readsize - _readoffset < size)
-                throw std::runtime_error("decoder read<mem, size>: not enough bytes.");
+            {
+                truncated("decoder read<mem, size>: not enough bytes.");
+                memset(mem, 0, size);
+                return;
+            }
             memcpy(mem, _readmem + _readoffset, size);
             _readoffset += size;
         }
@@ -33,8 +66,9 @@ namespace impp
         template <typename tval>
         const tval& read()
         {
+            static_assert(sizeof(tval) <= detail::decoder_scratch_size);
             if(_readsize - _readoffset < sizeof(tval))
-                throw std::runtime_error("decoder read<tval>: not enough bytes.");
+                return *reinterpret_cast<const tval*>(truncated("decoder read<tval>: not enough bytes."));
             auto offset = _readoffset;
             _readoffset += sizeof(tval);
             return *reinterpret_cast<const tval*>(_readmem + offset);
@@ -53,20 +87,258 @@ namespace impp
         void proceed_reading(size_t size)
         {
             if (_readsize - _readoffset < size)
-                throw std::runtime_error("decoder proceed_reading: not enough bytes.");
+            {
+                truncated("decoder proceed_reading: not enough bytes.");
+                return;
+            }
             _readoffset += size;
         }
 
         template <class tval>
-        const tval* peek() const
+        const tval* peek(size_t count = 1)
         {
+            if(_readsize - _readoffset < count * sizeof(tval))
+                return reinterpret_cast<const tval*>(truncated("decoder peek: not enough bytes."));
             return reinterpret_cast<const tval*>(_readmem + _readoffset);
         }
 
+        // records an error met while interpreting the data, see error::error_state
+        bool fail(error::error_code code, const char* message)
+        {
+            return _errors.fail(code, _readoffset, message);
+        }
+
+        bool reject(error::error_code code, const char* message)
+        {
+            return _errors.reject(code, _readoffset, message);
+        }
+
+        bool failed() const
+        {
+            return _errors.failed();
+        }
+
+        const error::error_info& get_error() const
+        {
+            return _errors.get_error();
+        }
+
         void reset()
         {
             _readoffset = 0;
+            _errors.clear();
         }
     };
+
+    // decoder reading a file through a small window instead of loading it whole
+    // returned references and pointers are valid until the next read/peek call
+    class file_decoder {
+    private:
+        using memory_byte = uint8_t;
+        static constexpr size_t window_size = 64 * 1024;
+
+        std::ifstream _stream;
+        std::vector<memory_byte> _window;
+        size_t _windowbegin = 0;
+        size_t _windowend = 0;
+        size_t _readsize = 0;
+        size_t _readoffset = 0;
+        error::error_state _errors;
+
+        const memory_byte* failure(error::error_code code, const char* message)
+        {
+            _errors.fail(code, _readoffset, message);
+            _readoffset = _readsize;
+            _windowbegin = _windowend = 0;
+            return detail::decoder_scratch;
+        }
+
+        // makes sure at least size bytes are buffered starting from _windowbegin
+        bool fill(size_t size)
+        {
+            if(_windowend - _windowbegin >= size)
+                return true;
+
+            // moving the unread tail at the beginning of the window
+            const auto remaining = _windowend - _windowbegin;
+            if(remaining != 0 && _windowbegin != 0)
+                memmove(_window.data(), _window.data() + _windowbegin, remaining);
+            _windowbegin = 0;
+            _windowend = remaining;
+
+            if(_window.size() < size)
+                _window.resize(size);
+
+            IMPP_INSTRUMENT_STAGE(STAGE_IO);
+            const auto toread = std::min(_window.size() - remaining, _readsize - _readoffset - remaining);
+            _stream.read(reinterpret_cast<char*>(_window.data() + remaining), static_cast<std::streamsize>(toread));
+            _windowend += static_cast<size_t>(_stream.gcount());
+            return _windowend >= size;
+        }
+
+    public:
+        static file_decoder create(const std::string& filename, error::error_policy policy = error::default_policy)
+        {
+            return file_decoder(filename, policy);
+        }
+
+        file_decoder(const std::string& filename, error::error_policy policy = error::default_policy) : _window(window_size), _errors(policy)
+        {
+            _stream = std::ifstream(filename, std::ios::binary | std::ios::ate);
+            if(!_stream.is_open())
+                return;
+            _readsize = static_cast<size_t>(_stream.tellg());
+            _stream.seekg(0);
+        }
+
+        file_decoder(file_decoder&&) = default;
+
+        bool is_open() const
+        {
+            return _stream.is_open();
+        }
+
+        void read(void* mem, size_t size)
+        {
+            // mem may be null when there is nothing to read
+            if(size == 0)
+                return;
+            if(_readsize - _readoffset < size)
+            {
+                failure(error::ERROR_TRUNCATED, "file_decoder read<mem, size>: not enough bytes.");
+                memset(mem, 0, size);
+                return;
+            }
+
+            // consuming buffered bytes first and reading the rest directly
+            auto* to = reinterpret_cast<memory_byte*>(mem);
+            const auto buffered = std::min(size, _windowend - _windowbegin);
+            memcpy(to, _window.data() + _windowbegin, buffered);
+            _windowbegin += buffered;
+            _readoffset += buffered;
+
+            if(buffered != size)
+            {
+                IMPP_INSTRUMENT_STAGE(STAGE_IO);
+                _stream.read(reinterpret_cast<char*>(to + buffered), static_cast<std::streamsize>(size - buffered));
+                if(static_cast<size_t>(_stream.gcount()) != size - buffered)
+                {
+                    failure(error::ERROR_IO, "file_decoder read<mem, size>: stream corrupted.");
+                    memset(to, 0, size);
+                    return;
+                }
+                _readoffset += size - buffered;
+            }
+        }
+
+        template <typename tval>
+        const tval& read()
+        {
+            static_assert(sizeof(tval) <= detail::decoder_scratch_size);
+            if(_readsize - _readoffset < sizeof(tval))
+                return *reinterpret_cast<const tval*>(failure(error::ERROR_TRUNCATED, "file_decoder read<tval>: not enough bytes."));
+            if(!fill(sizeof(tval)))
+                return *reinterpret_cast<const tval*>(failure(error::ERROR_IO, "file_decoder read<tval>: stream corrupted."));
+            auto offset = _windowbegin;
+            _windowbegin += sizeof(tval);
+            _readoffset += sizeof(tval);
+            return *reinterpret_cast<const tval*>(_window.data() + offset);
+        }
+
+        size_t get_readable() const
+        {
+            return _readsize - _readoffset;
+        }
+
+        size_t get_read_offset() const
+        {
+            return _readoffset;
+        }
+
+        void proceed_reading(size_t size)
+        {
+            if (_readsize - _readoffset < size)
+            {
+                failure(error::ERROR_TRUNCATED, "file_decoder proceed_reading: not enough bytes.");
+                return;
+            }
+
+            // skipping inside the window when possible, seeking otherwise
+            if(_windowend - _windowbegin >= size)
+            {
+                _windowbegin += size;
+                _readoffset += size;
+                return;
+            }
+
+            IMPP_INSTRUMENT_STAGE(STAGE_IO);
+            _readoffset += size;
+            _windowbegin = _windowend = 0;
+            _stream.clear();
+            _stream.seekg(static_cast<std::streamoff>(_readoffset));
+        }
+
+        template <class tval>
+        const tval* peek(size_t count = 1)
+        {
+            if(_readsize - _readoffset < count * sizeof(tval))
+                return reinterpret_cast<const tval*>(failure(error::ERROR_TRUNCATED, "file_decoder peek: not enough bytes."));
+            if(!fill(count * sizeof(tval)))
+                return reinterpret_cast<const tval*>(failure(error::ERROR_IO, "file_decoder peek: stream corrupted."));
+            return reinterpret_cast<const tval*>(_window.data() + _windowbegin);
+        }
+
+        bool fail(error::error_code code, const char* message)
+        {
+            return _errors.fail(code, _readoffset, message);
+        }
+
+        bool reject(error::error_code code, const char* message)
+        {
+            return _errors.reject(code, _readoffset, message);
+        }
+
+        bool failed() const
+        {
+            return _errors.failed();
+        }
+
+        const error::error_info& get_error() const
+        {
+            return _errors.get_error();
+        }
+
+        void reset()
+        {
+            _readoffset = 0;
+            _windowbegin = _windowend = 0;
+            _errors.clear();
+            _stream.clear();
+            _stream.seekg(0);
+        }
+    };
+
+    namespace detail
+    {
+        // reads a whole file in memory, false when it cannot be opened or read
+        // a limit reads only the start of the file, shorter files are read whole
+        inline bool read_file(const std::string& filename, std::vector<uint8_t>* bytes, size_t limit = SIZE_MAX)
+        {
+            IMPP_INSTRUMENT_STAGE(STAGE_IO);
+            std::ifstream f(filename, std::ios::binary | std::ios::ate);
+            if(!f.is_open())
+                return false;
+
+            const auto size = std::min(static_cast<size_t>(f.tellg()), limit);
+            f.seekg(0);
+            bytes->resize(size);
+            IMPP_INSTRUMENT_ALLOCATION(size);
+            f.read(reinterpret_cast<char*>(bytes->data()), static_cast<std::streamsize>(size));
+            return static_cast<size_t>(f.gcount()) == size;
+        }
+    }
+
+    template<class type>
+    concept decoder_type = std::is_same_v<type, decoder> || std::is_same_v<type, file_decoder>;
 }
 #endif //INCLUDE_IMPLUSPLUS_DECODER_HPP
@@ -0,0 +1,1052 @@
+/*
+MIT License
+
+Copyright (c) 2022 IkarusDeveloper
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#pragma once
+#ifndef INCLUDE_IMPLUSPLUS_DEFLATE_HPP
+#define INCLUDE_IMPLUSPLUS_DEFLATE_HPP
+#include <string.h>
+#include <stdint.h>
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <queue>
+#include <vector>
+#include "error.hpp"
+
+// deflate (rfc 1951) and zlib (rfc 1950) streams, bit buffers assume a little-endian target
+namespace impp
+{
+	namespace deflate
+	{
+		// compression levels trading ratio for speed
+		enum deflate_level {
+			DEFLATE_STORE = 0,      // stored blocks only
+			DEFLATE_RLE,            // runs of the previous byte only (distance 1 matches)
+			DEFLATE_FAST,           // greedy matching with a short hash chain
+			DEFLATE_DEFAULT,        // lazy matching with a longer hash chain
+		};
+
+		namespace detail
+		{
+			constexpr uint16_t length_base[29] = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+			constexpr uint8_t length_extra[29] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+			constexpr uint16_t dist_base[30] = { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+			constexpr uint8_t dist_extra[30] = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+			constexpr uint8_t codelen_order[19] = { 16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 };
+
+			constexpr size_t window_size = 32768;
+			constexpr size_t max_match = 258;
+			constexpr size_t min_match = 3;
+
+			inline uint32_t adler32(uint32_t adler, const uint8_t* data, size_t size)
+			{
+				uint32_t a = adler & 0xFFFF, b = adler >> 16;
+				while (size != 0)
+				{
+					// 5552 is the largest block keeping b below 2^32 before the modulo
+					auto block = std::min<size_t>(size, 5552);
+					size -= block;
+					for (; block >= 4; block -= 4, data += 4)
+					{
+						a += data[0]; b += a;
+						a += data[1]; b += a;
+						a += data[2]; b += a;
+						a += data[3]; b += a;
+					}
+					for (; block != 0; block--)
+					{
+						a += *data++;
+						b += a;
+					}
+					a %= 65521;
+					b %= 65521;
+				}
+				return b << 16 | a;
+			}
+
+			inline uint32_t reverse_bits(uint32_t code, unsigned length)
+			{
+				uint32_t ret = 0;
+				for (unsigned i = 0; i < length; i++, code >>= 1)
+					ret = (ret << 1) | (code & 1);
+				return ret;
+			}
+
+			// lsb-first bit reader refilled 8 bytes at a time, reading past the end yields zeros
+			class bit_reader
+			{
+			public:
+				bit_reader(const uint8_t* data, size_t size) : _begin(data), _p(data), _end(data + size) {}
+
+				void refill()
+				{
+					if (_end - _p >= 8)
+					{
+						uint64_t value;
+						memcpy(&value, _p, sizeof(value));
+						_bits |= value << _count;
+						_p += (63 - _count) >> 3;
+						_count |= 56;
+						return;
+					}
+					while (_count < 56)
+					{
+						uint64_t value = 0;
+						if (_p != _end)
+							value = *_p++;
+						else
+							_overrun++;
+						_bits |= value << _count;
+						_count += 8;
+					}
+				}
+
+				// callers refill before peeking up to 56 bits
+				uint32_t peek(unsigned count) const
+				{
+					return static_cast<uint32_t>(_bits & ((uint64_t(1) << count) - 1));
+				}
+
+				void consume(unsigned count)
+				{
+					_bits >>= count;
+					_count -= count;
+				}
+
+				uint32_t bits(unsigned count)
+				{
+					if (_count < count)
+						refill();
+					const auto value = peek(count);
+					consume(count);
+					return value;
+				}
+
+				// moves to the next byte boundary dropping the buffered bits
+				void align()
+				{
+					consume(_count & 7);
+					const size_t buffered = _count >> 3;
+					_p -= std::min(buffered - std::min(buffered, _overrun), static_cast<size_t>(_p - _begin));
+					if (buffered < _overrun)
+						_overrun -= buffered;
+					else
+						_overrun = 0;
+					_bits = 0;
+					_count = 0;
+				}
+
+				// copies bytes after align(), false when the input is too short
+				bool read_bytes(void* out, size_t size)
+				{
+					if (_overrun != 0 || static_cast<size_t>(_end - _p) < size)
+						return false;
+					if (size != 0)
+						memcpy(out, _p, size);
+					_p += size;
+					return true;
+				}
+
+				// true once bits past the end of the input have been consumed
+				bool overflowed() const
+				{
+					return _overrun * 8 > _count;
+				}
+
+				size_t get_offset() const
+				{
+					return static_cast<size_t>(_p - _begin);
+				}
+
+			private:
+				const uint8_t* _begin;
+				const uint8_t* _p;
+				const uint8_t* _end;
+				uint64_t _bits = 0;
+				unsigned _count = 0;
+				size_t _overrun = 0;
+			};
+
+			// canonical huffman decoding: codes up to fast_bits long are resolved with a single lookup
+			class huffman_table
+			{
+			public:
+				static constexpr unsigned fast_bits = 10;
+				static constexpr unsigned max_bits = 15;
+				static constexpr uint16_t invalid = 0xFFFF;
+
+				// false when the lengths describe an over-subscribed code
+				bool build(const uint8_t* lengths, size_t count)
+				{
+					_count.fill(0);
+					_fast.fill(0);
+					for (size_t i = 0; i < count; i++)
+						_count[lengths[i]]++;
+					_count[0] = 0;
+
+					int left = 1;
+					for (unsigned len = 1; len <= max_bits; len++)
+					{
+						left = (left << 1) - _count[len];
+						if (left < 0)
+							return false;
+					}
+
+					std::array<uint16_t, max_bits + 2> offsets{};
+					std::array<uint32_t, max_bits + 2> next_code{};
+					uint32_t code = 0;
+					for (unsigned len = 1; len <= max_bits; len++)
+					{
+						offsets[len + 1] = offsets[len] + _count[len];
+						code = (code + _count[len - 1]) << 1;
+						next_code[len] = code;
+					}
+
+					for (size_t symbol = 0; symbol < count; symbol++)
+					{
+						const unsigned len = lengths[symbol];
+						if (len == 0)
+							continue;
+						_symbols[offsets[len]++] = static_cast<uint16_t>(symbol);
+						if (len > fast_bits)
+							continue;
+
+						// every index starting with the reversed code resolves to the symbol
+						const auto reversed = reverse_bits(next_code[len]++, len);
+						const uint32_t entry = static_cast<uint32_t>(symbol) | len << 16;
+						for (uint32_t i = reversed; i < (1u << fast_bits); i += 1u << len)
+							_fast[i] = entry;
+					}
+					return true;
+				}
+
+				// callers refill so at least max_bits are buffered
+				uint16_t decode(bit_reader& reader) const
+				{
+					const auto entry = _fast[reader.peek(fast_bits)];
+					if (entry != 0)
+					{
+						reader.consume(entry >> 16);
+						return static_cast<uint16_t>(entry);
+					}
+
+					// longer codes are decoded one bit at a time
+					const auto bits = reader.peek(max_bits);
+					int code = 0, first = 0, index = 0;
+					for (unsigned len = 1; len <= max_bits; len++)
+					{
+						code |= (bits >> (len - 1)) & 1;
+						const int count = _count[len];
+						if (code - count < first)
+						{
+							reader.consume(len);
+							return _symbols[index + (code - first)];
+						}
+						index += count;
+						first = (first + count) << 1;
+						code <<= 1;
+					}
+					return invalid;
+				}
+
+			private:
+				std::array<uint32_t, 1u << fast_bits> _fast{};
+				std::array<uint16_t, max_bits + 1> _count{};
+				std::array<uint16_t, 288> _symbols{};
+			};
+
+			inline void fixed_lengths(uint8_t* litlen, uint8_t* dist)
+			{
+				std::fill(litlen, litlen + 144, 8);
+				std::fill(litlen + 144, litlen + 256, 9);
+				std::fill(litlen + 256, litlen + 280, 7);
+				std::fill(litlen + 280, litlen + 288, 8);
+				std::fill(dist, dist + 30, 5);
+			}
+
+			inline error::error_info inflate_error(error::error_code code, const bit_reader& reader, const char* message)
+			{
+				// data cut short shows up as garbage codes once the reader runs out
+				if (reader.overflowed())
+					return { error::ERROR_TRUNCATED, reader.get_offset(), "deflate: stream ends before the last block." };
+				return { code, reader.get_offset(), message };
+			}
+
+			inline bool read_dynamic_tables(bit_reader& reader, huffman_table& litlen, huffman_table& dist, error::error_info* error)
+			{
+				reader.refill();
+				const unsigned hlit = reader.bits(5) + 257;
+				const unsigned hdist = reader.bits(5) + 1;
+				const unsigned hclen = reader.bits(4) + 4;
+				if (hlit > 286 || hdist > 30)
+				{
+					*error = inflate_error(error::ERROR_CORRUPT_DATA, reader, "deflate: too many length or distance codes.");
+					return false;
+				}
+
+				uint8_t codelen_lengths[19] = {};
+				reader.refill();
+				for (unsigned i = 0; i < hclen; i++)
+					codelen_lengths[codelen_order[i]] = static_cast<uint8_t>(reader.bits(3));
+
+				huffman_table codelen;
+				if (!codelen.build(codelen_lengths, 19))
+				{
+					*error = inflate_error(error::ERROR_CORRUPT_DATA, reader, "deflate: invalid code length code.");
+					return false;
+				}
+
+				uint8_t lengths[286 + 30] = {};
+				for (unsigned i = 0; i < hlit + hdist; )
+				{
+					reader.refill();
+					const auto symbol = codelen.decode(reader);
+					if (symbol < 16)
+					{
+						lengths[i++] = static_cast<uint8_t>(symbol);
+						continue;
+					}
+
+					uint8_t value = 0;
+					unsigned repeat = 0;
+					if (symbol == 16)
+					{
+						if (i == 0)
+						{
+							*error = inflate_error(error::ERROR_CORRUPT_DATA, reader, "deflate: repeated length without a previous one.");
+							return false;
+						}
+						value = lengths[i - 1];
+						repeat = 3 + reader.bits(2);
+					}
+					else if (symbol == 17)
+						repeat = 3 + reader.bits(3);
+					else if (symbol == 18)
+						repeat = 11 + reader.bits(7);
+
+					if (symbol > 18 || repeat > hlit + hdist - i)
+					{
+						*error = inflate_error(error::ERROR_CORRUPT_DATA, reader, "deflate: invalid code lengths.");
+						return false;
+					}
+					std::fill_n(lengths + i, repeat, value);
+					i += repeat;
+				}
+
+				if (lengths[256] == 0 || !litlen.build(lengths, hlit) || !dist.build(lengths + hlit, hdist))
+				{
+					*error = inflate_error(error::ERROR_CORRUPT_DATA, reader, "deflate: invalid literal/length or distance code.");
+					return false;
+				}
+				return true;
+			}
+
+			// decodes the compressed blocks of a raw deflate stream into exactly sized memory
+			inline result<size_t> inflate_blocks(bit_reader& reader, uint8_t* out, size_t outsize)
+			{
+				huffman_table litlen, dist;
+				size_t pos = 0;
+				bool final = false;
+
+				while (!final)
+				{
+					reader.refill();
+					final = reader.bits(1) != 0;
+					const auto type = reader.bits(2);
+
+					if (type == 0)
+					{
+						reader.align();
+						uint8_t header[4];
+						if (!reader.read_bytes(header, sizeof(header)))
+							return error::error_info{ error::ERROR_TRUNCATED, reader.get_offset(), "deflate: stored block header exceeds input." };
+						const size_t len = header[0] | header[1] << 8;
+						const size_t nlen = header[2] | header[3] << 8;
+						if (len != (~nlen & 0xFFFF))
+							return error::error_info{ error::ERROR_CORRUPT_DATA, reader.get_offset(), "deflate: stored block length mismatch." };
+						if (len > outsize - pos)
+							return error::error_info{ error::ERROR_CORRUPT_DATA, reader.get_offset(), "deflate: data exceeds the expected size." };
+						if (!reader.read_bytes(out + pos, len))
+							return error::error_info{ error::ERROR_TRUNCATED, reader.get_offset(), "deflate: stored block exceeds input." };
+						pos += len;
+						continue;
+					}
+
+					if (type == 1)
+					{
+						uint8_t litlen_lengths[288], dist_lengths[30];
+						fixed_lengths(litlen_lengths, dist_lengths);
+						litlen.build(litlen_lengths, 288);
+						dist.build(dist_lengths, 30);
+					}
+					else if (type == 2)
+					{
+						error::error_info error;
+						if (!read_dynamic_tables(reader, litlen, dist, &error))
+							return error;
+					}
+					else
+						return inflate_error(error::ERROR_CORRUPT_DATA, reader, "deflate: invalid block type.");
+
+					for (;;)
+					{
+						reader.refill();
+						auto symbol = litlen.decode(reader);
+						if (symbol < 256)
+						{
+							if (pos == outsize)
+								return inflate_error(error::ERROR_CORRUPT_DATA, reader, "deflate: data exceeds the expected size.");
+							out[pos++] = static_cast<uint8_t>(symbol);
+							continue;
+						}
+						if (symbol == 256)
+							break;
+
+						symbol -= 257;
+						if (symbol >= 29)
+							return inflate_error(error::ERROR_CORRUPT_DATA, reader, "deflate: invalid length code.");
+						const size_t len = length_base[symbol] + reader.bits(length_extra[symbol]);
+
+						reader.refill();
+						const auto dsymbol = dist.decode(reader);
+						if (dsymbol >= 30)
+							return inflate_error(error::ERROR_CORRUPT_DATA, reader, "deflate: invalid distance code.");
+						const size_t distance = dist_base[dsymbol] + reader.bits(dist_extra[dsymbol]);
+
+						if (distance > pos)
+							return inflate_error(error::ERROR_CORRUPT_DATA, reader, "deflate: distance before the start of the data.");
+						if (len > outsize - pos)
+							return inflate_error(error::ERROR_CORRUPT_DATA, reader, "deflate: data exceeds the expected size.");
+
+						auto* dst = out + pos;
+						const auto* src = dst - distance;
+						pos += len;
+						if (distance >= 8 && outsize - pos >= 8)
+						{
+							// whole words may write a few bytes past the match, they are rewritten later
+							for (size_t i = 0; i < len; i += 8)
+								memcpy(dst + i, src + i, 8);
+						}
+						else if (distance == 1)
+							memset(dst, *src, len);
+						else
+						{
+							for (size_t i = 0; i < len; i++)
+								dst[i] = src[i];
+						}
+					}
+
+					if (reader.overflowed())
+						return inflate_error(error::ERROR_TRUNCATED, reader, "");
+				}
+
+				reader.align();
+				if (reader.overflowed())
+					return inflate_error(error::ERROR_TRUNCATED, reader, "");
+				return pos;
+			}
+
+			// lsb-first bit writer appending to a vector
+			class bit_writer
+			{
+			public:
+				explicit bit_writer(std::vector<uint8_t>& out) : _out(out) {}
+
+				// count must not exceed 32
+				void put(uint32_t value, unsigned count)
+				{
+					_bits |= uint64_t(value) << _count;
+					_count += count;
+					if (_count >= 32)
+					{
+						const auto word = static_cast<uint32_t>(_bits);
+						const auto size = _out.size();
+						_out.resize(size + 4);
+						memcpy(_out.data() + size, &word, 4);
+						_bits >>= 32;
+						_count -= 32;
+					}
+				}
+
+				// pads to the next byte boundary
+				void flush()
+				{
+					while (_count > 0)
+					{
+						_out.push_back(static_cast<uint8_t>(_bits));
+						_bits >>= 8;
+						_count = _count > 8 ? _count - 8 : 0;
+					}
+					_bits = 0;
+				}
+
+				std::vector<uint8_t>& get_output()
+				{
+					return _out;
+				}
+
+			private:
+				std::vector<uint8_t>& _out;
+				uint64_t _bits = 0;
+				unsigned _count = 0;
+			};
+
+			// length limited huffman code lengths, frequencies are halved until the limit is met
+			inline void huffman_lengths(const uint32_t* freqs, size_t count, unsigned limit, uint8_t* lengths)
+			{
+				std::fill(lengths, lengths + count, 0);
+				std::vector<uint32_t> weights(freqs, freqs + count);
+				std::vector<uint16_t> leaves;
+				for (size_t i = 0; i < count; i++)
+					if (freqs[i] != 0)
+						leaves.push_back(static_cast<uint16_t>(i));
+
+				if (leaves.empty())
+					return;
+				if (leaves.size() == 1)
+				{
+					lengths[leaves[0]] = 1;
+					return;
+				}
+
+				using node = std::pair<uint64_t, uint32_t>;
+				std::vector<uint32_t> parents(leaves.size() * 2);
+				std::vector<uint8_t> depths(leaves.size() * 2);
+				for (;;)
+				{
+					std::priority_queue<node, std::vector<node>, std::greater<node>> queue;
+					for (uint32_t i = 0; i < leaves.size(); i++)
+						queue.emplace(weights[leaves[i]], i);
+
+					// internal nodes are numbered after the leaves in creation order
+					auto next = static_cast<uint32_t>(leaves.size());
+					while (queue.size() > 1)
+					{
+						const auto a = queue.top();
+						queue.pop();
+						const auto b = queue.top();
+						queue.pop();
+						parents[a.second] = parents[b.second] = next;
+						queue.emplace(a.first + b.first, next++);
+					}
+
+					// parents always come after their children
+					const auto root = next - 1;
+					depths[root] = 0;
+					unsigned deepest = 0;
+					for (auto i = root; i-- > 0; )
+					{
+						depths[i] = depths[parents[i]] + 1;
+						deepest = std::max<unsigned>(deepest, depths[i]);
+					}
+
+					if (deepest <= limit)
+					{
+						for (size_t i = 0; i < leaves.size(); i++)
+							lengths[leaves[i]] = depths[i];
+						return;
+					}
+					for (auto leaf : leaves)
+						weights[leaf] = (weights[leaf] + 1) >> 1;
+				}
+			}
+
+			// canonical codes of the given lengths, bit reversed for the lsb-first writer
+			inline void huffman_codes(const uint8_t* lengths, size_t count, uint16_t* codes)
+			{
+				uint16_t bl_count[16] = {};
+				for (size_t i = 0; i < count; i++)
+					bl_count[lengths[i]]++;
+				bl_count[0] = 0;
+
+				uint16_t next_code[16] = {};
+				uint32_t code = 0;
+				for (unsigned len = 1; len < 16; len++)
+				{
+					code = (code + bl_count[len - 1]) << 1;
+					next_code[len] = static_cast<uint16_t>(code);
+				}
+				for (size_t i = 0; i < count; i++)
+					codes[i] = lengths[i] ? static_cast<uint16_t>(reverse_bits(next_code[lengths[i]]++, lengths[i])) : 0;
+			}
+
+			constexpr auto length_codes = [] {
+				std::array<uint8_t, max_match + 1> table{};
+				for (unsigned code = 0; code < 29; code++)
+					for (unsigned len = length_base[code]; len < (code == 28 ? max_match + 1 : length_base[code + 1]); len++)
+						table[len] = static_cast<uint8_t>(code);
+				return table;
+			}();
+
+			// distances up to 256 are looked up directly, longer ones by their upper bits
+			constexpr auto dist_codes = [] {
+				std::array<uint8_t, 512> table{};
+				for (unsigned code = 0; code < 30; code++)
+					for (unsigned d = dist_base[code]; d < dist_base[code] + (1u << dist_extra[code]); d++)
+						table[d <= 256 ? d - 1 : 256 + ((d - 1) >> 7)] = static_cast<uint8_t>(code);
+				return table;
+			}();
+
+			inline unsigned dist_code(size_t distance)
+			{
+				return distance <= 256 ? dist_codes[distance - 1] : dist_codes[256 + ((distance - 1) >> 7)];
+			}
+
+			// literal when dist is 0, match of length len otherwise
+			struct deflate_symbol
+			{
+				uint16_t len;
+				uint16_t dist;
+			};
+
+			class deflate_compressor
+			{
+			public:
+				static constexpr size_t hash_bits = 15;
+				static constexpr size_t block_symbols = 1 << 15;
+
+				deflate_compressor(deflate_level level, std::vector<uint8_t>& out) : _level(level), _writer(out)
+				{
+					_chain = level == DEFLATE_DEFAULT ? 16 : 4;
+					_lazy = level == DEFLATE_DEFAULT;
+				}
+
+				void compress(const uint8_t* data, size_t size)
+				{
+					if (_level == DEFLATE_STORE || size == 0)
+					{
+						_data = data;
+						write_stored(0, size, true);
+						_writer.flush();
+						return;
+					}
+
+					// positions are 32 bit, huge inputs are split in segments not sharing matches
+					for (size_t offset = 0; offset < size; offset += segment_size)
+						compress_segment(data + offset, std::min(segment_size, size - offset), offset + segment_size >= size);
+					_writer.flush();
+				}
+
+			private:
+				static constexpr size_t segment_size = size_t(1) << 30;
+				static constexpr size_t nice_length = 128;
+				// matches at least this long make the lazy search shorter
+				static constexpr size_t good_length = 32;
+				// 3 byte matches further than this cost more than their literals
+				static constexpr size_t too_far = 4096;
+				// fast matching skips hashing inside matches longer than this
+				static constexpr size_t max_insert = 16;
+
+				void compress_segment(const uint8_t* data, size_t size, bool final)
+				{
+					_data = data;
+					_size = size;
+					if (_level != DEFLATE_RLE)
+					{
+						_head.assign(size_t(1) << hash_bits, 0);
+						_prev.assign(window_size, 0);
+					}
+					_symbols.reserve(block_symbols + 2);
+
+					size_t pos = 0, block_start = 0;
+					size_t cur_len = 0, cur_dist = 0;
+					bool carried = false;
+					while (pos < size)
+					{
+						if (_symbols.size() >= block_symbols)
+						{
+							write_block(block_start, pos, false);
+							block_start = pos;
+						}
+
+						if (_level == DEFLATE_RLE)
+						{
+							size_t len = 0;
+							if (pos > 0 && data[pos] == data[pos - 1])
+								len = match_length(pos - 1, pos, std::min(max_match, size - pos));
+							if (len >= min_match)
+							{
+								add_match(len, 1);
+								pos += len;
+							}
+							else
+								add_literal(data[pos++]);
+							continue;
+						}
+
+						if (!carried)
+							find_match(pos, _chain, &cur_len, &cur_dist);
+						carried = false;
+						insert(pos);
+
+						if (cur_len < min_match)
+						{
+							add_literal(data[pos++]);
+							continue;
+						}
+
+						// a longer match starting at the next byte is worth a literal
+						if (_lazy && cur_len < nice_length && pos + 1 < size)
+						{
+							size_t next_len, next_dist;
+							find_match(pos + 1, cur_len >= good_length ? _chain / 4 : _chain, &next_len, &next_dist);
+							if (next_len > cur_len)
+							{
+								add_literal(data[pos++]);
+								cur_len = next_len;
+								cur_dist = next_dist;
+								carried = true;
+								continue;
+							}
+						}
+
+						add_match(cur_len, cur_dist);
+						if (_lazy || cur_len <= max_insert)
+						{
+							for (size_t i = 1; i < cur_len; i++)
+								insert(pos + i);
+						}
+						pos += cur_len;
+					}
+
+					write_block(block_start, size, final);
+				}
+
+				uint32_t hash(size_t pos) const
+				{
+					const uint32_t value = _data[pos] | _data[pos + 1] << 8 | _data[pos + 2] << 16;
+					return (value * 2654435761u) >> (32 - hash_bits);
+				}
+
+				// positions are stored plus one so 0 means empty
+				void insert(size_t pos)
+				{
+					if (pos + min_match > _size)
+						return;
+					auto& head = _head[hash(pos)];
+					_prev[pos & (window_size - 1)] = head;
+					head = static_cast<uint32_t>(pos + 1);
+				}
+
+				size_t match_length(size_t from, size_t pos, size_t limit) const
+				{
+					size_t len = 0;
+					for (; len + 8 <= limit; len += 8)
+					{
+						uint64_t a, b;
+						memcpy(&a, _data + from + len, 8);
+						memcpy(&b, _data + pos + len, 8);
+						if (a != b)
+							return len + (std::countr_zero(a ^ b) >> 3);
+					}
+					while (len < limit && _data[from + len] == _data[pos + len])
+						len++;
+					return len;
+				}
+
+				void find_match(size_t pos, size_t chain, size_t* best_len, size_t* best_dist) const
+				{
+					*best_len = 0;
+					*best_dist = 0;
+					const size_t limit = std::min(max_match, _size - pos);
+					if (limit < min_match)
+						return;
+
+					size_t candidate = _head[hash(pos)];
+					for (; candidate != 0 && chain != 0; chain--)
+					{
+						const size_t from = candidate - 1;
+						if (from >= pos || pos - from > window_size)
+							break;
+
+						// the byte which would extend the best match rejects most candidates
+						if (_data[from + *best_len] == _data[pos + *best_len])
+						{
+							const auto len = match_length(from, pos, limit);
+							if (len > *best_len && (len > min_match || pos - from <= too_far))
+							{
+								*best_len = len;
+								*best_dist = pos - from;
+								if (len == limit)
+									break;
+							}
+						}
+
+						const size_t next = _prev[from & (window_size - 1)];
+						if (next >= candidate)
+							break;
+						candidate = next;
+					}
+				}
+
+				void add_literal(uint8_t value)
+				{
+					_symbols.push_back({ value, 0 });
+				}
+
+				void add_match(size_t len, size_t dist)
+				{
+					_symbols.push_back({ static_cast<uint16_t>(len), static_cast<uint16_t>(dist) });
+				}
+
+				void write_stored(size_t begin, size_t end, bool final)
+				{
+					do
+					{
+						const auto len = std::min<size_t>(end - begin, 65535);
+						const bool last = final && begin + len == end;
+						_writer.put(last ? 1 : 0, 3);
+						_writer.flush();
+						const uint8_t header[4] = { uint8_t(len), uint8_t(len >> 8), uint8_t(~len), uint8_t(~len >> 8) };
+						auto& out = _writer.get_output();
+						out.insert(out.end(), header, header + 4);
+						out.insert(out.end(), _data + begin, _data + begin + len);
+						begin += len;
+					} while (begin != end);
+				}
+
+				void write_symbols(const uint16_t* litlen_codes, const uint8_t* litlen_lengths, const uint16_t* dist_codes_, const uint8_t* dist_lengths)
+				{
+					for (const auto& symbol : _symbols)
+					{
+						if (symbol.dist == 0)
+						{
+							_writer.put(litlen_codes[symbol.len], litlen_lengths[symbol.len]);
+							continue;
+						}
+						const auto lcode = length_codes[symbol.len];
+						_writer.put(litlen_codes[257 + lcode], litlen_lengths[257 + lcode]);
+						_writer.put(symbol.len - length_base[lcode], length_extra[lcode]);
+						const auto dcode = dist_code(symbol.dist);
+						_writer.put(dist_codes_[dcode], dist_lengths[dcode]);
+						_writer.put(symbol.dist - dist_base[dcode], dist_extra[dcode]);
+					}
+					_writer.put(litlen_codes[256], litlen_lengths[256]);
+				}
+
+				// picks the cheapest of stored, fixed and dynamic huffman blocks
+				void write_block(size_t begin, size_t end, bool final)
+				{
+					uint32_t litlen_freqs[286] = {}, dist_freqs[30] = {};
+					uint64_t extra_bits = 0;
+					for (const auto& symbol : _symbols)
+					{
+						if (symbol.dist == 0)
+						{
+							litlen_freqs[symbol.len]++;
+							continue;
+						}
+						const auto lcode = length_codes[symbol.len];
+						const auto dcode = dist_code(symbol.dist);
+						litlen_freqs[257 + lcode]++;
+						dist_freqs[dcode]++;
+						extra_bits += length_extra[lcode] + dist_extra[dcode];
+					}
+					litlen_freqs[256] = 1;
+
+					uint8_t litlen_lengths[288] = {}, dist_lengths[30] = {};
+					huffman_lengths(litlen_freqs, 286, 15, litlen_lengths);
+					huffman_lengths(dist_freqs, 30, 15, dist_lengths);
+
+					// the code length sequence run-length encoded with symbols 16, 17 and 18
+					unsigned hlit = 286, hdist = 30;
+					while (hlit > 257 && litlen_lengths[hlit - 1] == 0)
+						hlit--;
+					while (hdist > 1 && dist_lengths[hdist - 1] == 0)
+						hdist--;
+
+					uint8_t all_lengths[286 + 30];
+					std::copy_n(litlen_lengths, hlit, all_lengths);
+					std::copy_n(dist_lengths, hdist, all_lengths + hlit);
+
+					std::vector<std::pair<uint8_t, uint8_t>> items;
+					uint32_t codelen_freqs[19] = {};
+					for (unsigned i = 0, total = hlit + hdist; i < total; )
+					{
+						const auto value = all_lengths[i];
+						unsigned run = 1;
+						while (i + run < total && all_lengths[i + run] == value)
+							run++;
+						i += run;
+
+						if (value == 0)
+						{
+							for (; run >= 11; )
+							{
+								const auto n = std::min(run, 138u);
+								items.emplace_back(18, static_cast<uint8_t>(n - 11));
+								run -= n;
+							}
+							if (run >= 3)
+							{
+								items.emplace_back(17, static_cast<uint8_t>(run - 3));
+								run = 0;
+							}
+						}
+						else
+						{
+							items.emplace_back(value, 0);
+							run--;
+							for (; run >= 3; )
+							{
+								const auto n = std::min(run, 6u);
+								items.emplace_back(16, static_cast<uint8_t>(n - 3));
+								run -= n;
+							}
+						}
+						for (; run > 0; run--)
+							items.emplace_back(value, 0);
+					}
+					for (const auto& item : items)
+						codelen_freqs[item.first]++;
+
+					uint8_t codelen_lengths[19] = {};
+					huffman_lengths(codelen_freqs, 19, 7, codelen_lengths);
+					unsigned hclen = 19;
+					while (hclen > 4 && codelen_lengths[codelen_order[hclen - 1]] == 0)
+						hclen--;
+
+					uint8_t fixed_litlen[288], fixed_dist[30];
+					fixed_lengths(fixed_litlen, fixed_dist);
+
+					uint64_t dynamic_bits = 3 + 14 + 3 * hclen + extra_bits, fixed_bits = 3 + extra_bits;
+					for (const auto& item : items)
+						dynamic_bits += codelen_lengths[item.first] + (item.first == 16 ? 2 : item.first == 17 ? 3 : item.first == 18 ? 7 : 0);
+					for (unsigned i = 0; i < 286; i++)
+					{
+						dynamic_bits += uint64_t(litlen_freqs[i]) * litlen_lengths[i];
+						fixed_bits += uint64_t(litlen_freqs[i]) * fixed_litlen[i];
+					}
+					for (unsigned i = 0; i < 30; i++)
+					{
+						dynamic_bits += uint64_t(dist_freqs[i]) * dist_lengths[i];
+						fixed_bits += uint64_t(dist_freqs[i]) * fixed_dist[i];
+					}
+					const uint64_t stored_bits = (end - begin + 5 * ((end - begin) / 65535 + 1)) * 8 + 7;
+
+					if (stored_bits <= dynamic_bits && stored_bits <= fixed_bits)
+						write_stored(begin, end, final);
+					else if (fixed_bits <= dynamic_bits)
+					{
+						uint16_t litlen_codes[288], dist_codes_[30];
+						huffman_codes(fixed_litlen, 288, litlen_codes);
+						huffman_codes(fixed_dist, 30, dist_codes_);
+						_writer.put((final ? 1 : 0) | 1 << 1, 3);
+						write_symbols(litlen_codes, fixed_litlen, dist_codes_, fixed_dist);
+					}
+					else
+					{
+						uint16_t litlen_codes[288], dist_codes_[30], codelen_codes[19];
+						huffman_codes(litlen_lengths, 286, litlen_codes);
+						huffman_codes(dist_lengths, 30, dist_codes_);
+						huffman_codes(codelen_lengths, 19, codelen_codes);
+
+						_writer.put((final ? 1 : 0) | 2 << 1, 3);
+						_writer.put(hlit - 257, 5);
+						_writer.put(hdist - 1, 5);
+						_writer.put(hclen - 4, 4);
+						for (unsigned i = 0; i < hclen; i++)
+							_writer.put(codelen_lengths[codelen_order[i]], 3);
+						for (const auto& item : items)
+						{
+							_writer.put(codelen_codes[item.first], codelen_lengths[item.first]);
+							if (item.first >= 16)
+								_writer.put(item.second, item.first == 16 ? 2 : item.first == 17 ? 3 : 7);
+						}
+						write_symbols(litlen_codes, litlen_lengths, dist_codes_, dist_lengths);
+					}
+					_symbols.clear();
+				}
+
+				deflate_level _level;
+				bit_writer _writer;
+				const uint8_t* _data = nullptr;
+				size_t _size = 0;
+				size_t _chain = 0;
+				bool _lazy = false;
+				std::vector<uint32_t> _head;
+				std::vector<uint32_t> _prev;
+				std::vector<deflate_symbol> _symbols;
+			};
+		}
+
+		// decompresses a raw deflate stream into out, the size of the decompressed data is returned
+		inline result<size_t> inflate(const void* data, size_t size, void* out, size_t outsize)
+		{
+			detail::bit_reader reader(reinterpret_cast<const uint8_t*>(data), size);
+			return detail::inflate_blocks(reader, reinterpret_cast<uint8_t*>(out), outsize);
+		}
+
+		// decompresses a zlib stream verifying its checksum
+		inline result<size_t> zlib_decompress(const void* data, size_t size, void* out, size_t outsize)
+		{
+			const auto* bytes = reinterpret_cast<const uint8_t*>(data);
+			if (size < 6)
+				return error::error_info{ error::ERROR_TRUNCATED, 0, "zlib: stream too short." };
+			if ((bytes[0] & 0x0F) != 8 || (bytes[0] >> 4) > 7 || (bytes[0] << 8 | bytes[1]) % 31 != 0)
+				return error::error_info{ error::ERROR_CORRUPT_DATA, 0, "zlib: invalid stream header." };
+			if (bytes[1] & 0x20)
+				return error::error_info{ error::ERROR_UNSUPPORTED, 1, "zlib: preset dictionaries are not supported." };
+
+			detail::bit_reader reader(bytes + 2, size - 2);
+			auto res = detail::inflate_blocks(reader, reinterpret_cast<uint8_t*>(out), outsize);
+			if (!res)
+			{
+				auto error = res.get_error();
+				error.offset += 2;
+				return error;
+			}
+
+			uint8_t checksum[4];
+			if (!reader.read_bytes(checksum, sizeof(checksum)))
+				return error::error_info{ error::ERROR_TRUNCATED, reader.get_offset() + 2, "zlib: missing checksum." };
+			const uint32_t expected = uint32_t(checksum[0]) << 24 | checksum[1] << 16 | checksum[2] << 8 | checksum[3];
+			if (detail::adler32(1, reinterpret_cast<const uint8_t*>(out), *res) != expected)
+				return error::error_info{ error::ERROR_CORRUPT_DATA, reader.get_offset() + 2, "zlib: checksum mismatch." };
+			return res;
+		}
+
+		// appends a raw deflate stream to out
+		inline void compress(const void* data, size_t size, deflate_level level, std::vector<uint8_t>* out)
+		{
+			detail::deflate_compressor compressor(level, *out);
+			compressor.compress(reinterpret_cast<const uint8_t*>(data), size);
+		}
+
+		// appends a zlib stream to out
+		inline void zlib_compress(const void* data, size_t size, deflate_level level, std::vector<uint8_t>* out)
+		{
+			// the header advertises the level: fastest, fast or default
+			static constexpr uint8_t flags[] = { 0x01, 0x01, 0x5E, 0x9C };
+			out->push_back(0x78);
+			out->push_back(flags[level]);
+			compress(data, size, level, out);
+
+			const auto adler = detail::adler32(1, reinterpret_cast<const uint8_t*>(data), size);
+			const uint8_t checksum[4] = { uint8_t(adler >> 24), uint8_t(adler >> 16), uint8_t(adler >> 8), uint8_t(adler) };
+			out->insert(out->end(), checksum, checksum + 4);
+		}
+	}
+}
+
+#endif //INCLUDE_IMPLUSPLUS_DEFLATE_HPP
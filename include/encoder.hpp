@@ -2,26 +2,33 @@
 #ifndef INCLUDE_IMPLUSPLUS_ENCODER_HPP
 #define INCLUDE_IMPLUSPLUS_ENCODER_HPP
 #include <cstddef>
-#include <stdexcept>
+#include <cstdint>
+#include <cstring>
 #include <fstream>
+#include <string>
+#include <vector>
+#include "error.hpp"
+#include "pixel.hpp"
 
 namespace impp
 {
+    // under ERROR_POLICY_RECORD failed writes are dropped and the first error is kept
     class file_encoder 
     {
 
     private:
         std::ofstream _stream;
         size_t _writesize = 0;
+        error::error_state _errors;
 
     public:
-        static file_encoder create(const std::string& filename)
+        static file_encoder create(const std::string& filename, error::error_policy policy = error::default_policy)
         {
-            return { filename };
+            return { filename, policy };
         }
 
         file_encoder(const file_encoder&) = default;
-        file_encoder(const std::string& filename)
+        file_encoder(const std::string& filename, error::error_policy policy = error::default_policy) : _errors(policy)
         {
             _stream = std::ofstream(filename, std::ios::binary|std::ios::out);
         }
@@ -43,10 +50,27 @@ namespace impp
             write(pixels.data(), pixels.size() * sizeof(pixel));
         }
 
+        // converts while writing, the destination is held a few cache sized ranges at a time
+        template<pixel_type pixelto, pixel_type pixelfrom>
+        void write_converted(const pixelfrom* pixels, size_t count, unsigned threads = 1)
+        {
+            const size_t chunk = detail::convert_grain<pixelfrom, pixelto> * detail::parallel_threads(threads);
+            std::vector<pixelto> converted(std::min(count, chunk));
+            for (size_t i = 0; i < count; i += converted.size())
+            {
+                const size_t pcount = std::min(converted.size(), count - i);
+                pixel_convert(pixels + i, converted.data(), pcount, threads);
+                write(converted.data(), pcount * sizeof(pixelto));
+            }
+        }
+
         void write(const void* mem, size_t size)
         {
             if (!_stream.good())
-                throw std::runtime_error("encoder write<mem,size> : _stream corrupted");
+            {
+                _errors.fail(error::ERROR_IO, _writesize, "encoder write<mem,size> : _stream corrupted");
+                return;
+            }
             _stream.write(reinterpret_cast<const char*>(mem), size);
             _writesize += size;
         }
@@ -54,7 +78,10 @@ namespace impp
         void cancel_write(size_t size)
         {
             if(size > _writesize)
-                throw std::runtime_error("cancel_write : size is too large");
+            {
+                _errors.fail(error::ERROR_INVALID_ARGUMENT, _writesize, "cancel_write : size is too large");
+                return;
+            }
             _writesize -= size;
             _stream.seekp(_writesize);
         }
@@ -64,9 +91,40 @@ namespace impp
             return _writesize;
         }
 
+        // records an error met while producing the data, see error::error_state
+        bool fail(error::error_code code, const char* message)
+        {
+            return _errors.fail(code, _writesize, message);
+        }
+
+        bool reject(error::error_code code, const char* message)
+        {
+            return _errors.reject(code, _writesize, message);
+        }
+
+        bool failed() const
+        {
+            return _errors.failed();
+        }
+
+        const error::error_info& get_error() const
+        {
+            return _errors.get_error();
+        }
+
+        // buffered writes may only fail once flushed
+        bool flush()
+        {
+            _stream.flush();
+            if(!_stream.good())
+                return _errors.fail(error::ERROR_IO, _writesize, "encoder flush : _stream corrupted");
+            return true;
+        }
+
         void reset()
         {
             _writesize = 0;
+            _errors.clear();
             _stream.seekp(0);
         }
     };
@@ -77,10 +135,11 @@ namespace impp
     private:
         std::vector<uint8_t> _stream;
         size_t _writesize = 0;
+        error::error_state _errors;
 
     public:
         memory_encoder(const memory_encoder&) = default;
-        memory_encoder() = default;
+        memory_encoder(error::error_policy policy = error::default_policy) : _errors(policy) {}
 
         template <class tval>
         void write(const tval& val)
@@ -94,6 +153,17 @@ namespace impp
             write(pixels.data(), pixels.size() * sizeof(pixel));
         }
 
+        // converts straight into the stream
+        template<pixel_type pixelto, pixel_type pixelfrom>
+        void write_converted(const pixelfrom* pixels, size_t count, unsigned threads = 1)
+        {
+            const size_t size = count * sizeof(pixelto);
+            if(_stream.size() - _writesize < size)
+                _stream.resize(_writesize + size);
+            pixel_convert(pixels, reinterpret_cast<pixelto*>(_stream.data() + _writesize), count, threads);
+            _writesize += size;
+        }
+
         void write(const void* mem, size_t size)
         {
             if(_stream.size() - _writesize < size)
@@ -107,7 +177,10 @@ namespace impp
         void cancel_write(size_t size)
         {
             if (size > _writesize)
-                throw std::runtime_error("cancel_write : size is too large");
+            {
+                _errors.fail(error::ERROR_INVALID_ARGUMENT, _writesize, "cancel_write : size is too large");
+                return;
+            }
             _writesize -= size;
         }
 
@@ -116,9 +189,35 @@ namespace impp
             return _writesize;
         }
 
+        const uint8_t* get_data() const
+        {
+            return _stream.data();
+        }
+
+        bool fail(error::error_code code, const char* message)
+        {
+            return _errors.fail(code, _writesize, message);
+        }
+
+        bool reject(error::error_code code, const char* message)
+        {
+            return _errors.reject(code, _writesize, message);
+        }
+
+        bool failed() const
+        {
+            return _errors.failed();
+        }
+
+        const error::error_info& get_error() const
+        {
+            return _errors.get_error();
+        }
+
         void reset()
         {
             _writesize = 0;
+            _errors.clear();
             _stream.clear();
         }
     };
@@ -1,12 +1,168 @@
 #pragma once
 #ifndef INCLUDE_IMPLUSPLUS_ERROR_HPP
 #define INCLUDE_IMPLUSPLUS_ERROR_HPP
+#include <cstddef>
+#include <cstdint>
 #include <functional>
+#include <optional>
 #include <stdexcept>
 #include <string>
+#include <utility>
+
+// impp never throws when exceptions are disabled, errors are only returned by the try_* functions
+#if defined(__cpp_exceptions) || defined(__EXCEPTIONS) || defined(_CPPUNWIND)
+#define IMPP_EXCEPTIONS 1
+#else
+#define IMPP_EXCEPTIONS 0
+#endif
 
 namespace impp
 {
+	namespace error
+	{
+		enum error_code : uint8_t {
+			ERROR_NONE = 0,
+			ERROR_FILE_OPEN,        // file could not be opened or created
+			ERROR_IO,               // reading or writing the stream failed
+			ERROR_TRUNCATED,        // input ended before the data it announces
+			ERROR_INVALID_HEADER,   // header fields are inconsistent
+			ERROR_UNSUPPORTED,      // valid data using a feature impp does not handle
+			ERROR_CORRUPT_DATA,     // pixel data is inconsistent with the header
+			ERROR_INVALID_ARGUMENT  // caller supplied values impp cannot honor
+		};
+
+		constexpr const char* error_name(error_code code)
+		{
+			constexpr const char* names[] = { "none", "file_open", "io", "truncated", "invalid_header", "unsupported", "corrupt_data", "invalid_argument" };
+			return code <= ERROR_INVALID_ARGUMENT ? names[code] : "unknown";
+		}
+
+		// what went wrong and where, message is always a string literal
+		struct error_info
+		{
+			error_code code = ERROR_NONE;
+			size_t offset = 0;           // input/output byte offset where the error was detected
+			const char* message = "";
+			bool reported = false;       // load/save forward it to the error handler
+
+			explicit operator bool() const
+			{
+				return code != ERROR_NONE;
+			}
+		};
+
+		enum error_policy {
+			ERROR_POLICY_THROW = 0,     // errors are thrown as std::runtime_error
+			ERROR_POLICY_RECORD         // errors are recorded and reading/writing goes on with zeroed data
+		};
+
+		constexpr error_policy default_policy = IMPP_EXCEPTIONS ? ERROR_POLICY_THROW : ERROR_POLICY_RECORD;
+
+		// first error met by a decoder or an encoder
+		class error_state
+		{
+		public:
+			explicit error_state(error_policy policy = default_policy) : _policy(policy) {}
+
+			// records the error and throws it when the policy asks so, it always returns false
+			bool fail(error_code code, size_t offset, const char* message)
+			{
+				if(!_error)
+					_error = { code, offset, message, true };
+#if IMPP_EXCEPTIONS
+				if(_policy == ERROR_POLICY_THROW)
+					throw std::runtime_error(message);
+#endif
+				return false;
+			}
+
+			// records an error which load/save silently turn into a null result, it always returns false
+			bool reject(error_code code, size_t offset, const char* message)
+			{
+				if(!_error)
+					_error = { code, offset, message, false };
+				return false;
+			}
+
+			bool failed() const
+			{
+				return static_cast<bool>(_error);
+			}
+
+			const error_info& get_error() const
+			{
+				return _error;
+			}
+
+			error_policy get_policy() const
+			{
+				return _policy;
+			}
+
+			void clear()
+			{
+				_error = {};
+			}
+
+		private:
+			error_policy _policy;
+			error_info _error{};
+		};
+	}
+
+	// value returned by the try_* functions, it holds either the value or the error which prevented it
+	template<class tval>
+	class result
+	{
+	public:
+		result(tval value) : _value(std::move(value)) {}
+		result(const error::error_info& error) : _error(error)
+		{
+			// a failing call always carries an error code
+			if(!_error)
+				_error.code = error::ERROR_UNSUPPORTED;
+		}
+
+		bool has_value() const
+		{
+			return _value.has_value();
+		}
+
+		explicit operator bool() const
+		{
+			return has_value();
+		}
+
+		tval& value() & { return *_value; }
+		const tval& value() const& { return *_value; }
+		tval&& value() && { return std::move(*_value); }
+
+		tval& operator*() & { return *_value; }
+		const tval& operator*() const& { return *_value; }
+		tval&& operator*() && { return std::move(*_value); }
+		tval* operator->() { return &*_value; }
+		const tval* operator->() const { return &*_value; }
+
+		tval value_or(tval fallback) const&
+		{
+			return _value ? *_value : std::move(fallback);
+		}
+
+		tval value_or(tval fallback) &&
+		{
+			return _value ? std::move(*_value) : std::move(fallback);
+		}
+
+		const error::error_info& get_error() const
+		{
+			return _error;
+		}
+
+	private:
+		std::optional<tval> _value;
+		error::error_info _error{};
+	};
+
 	namespace error
 	{
 		using error_handler = std::function<void(const std::runtime_error&)>;
@@ -14,7 +170,14 @@ namespace impp
 		{
 			struct error_handling
 			{
-				static void default_throw_wrapper(const std::runtime_error& err){ throw err; }
+				static void default_throw_wrapper(const std::runtime_error& err)
+				{
+#if IMPP_EXCEPTIONS
+					throw err;
+#else
+					(void)err;
+#endif
+				}
 				static inline error_handler _handler = error_handling::default_throw_wrapper;
 			};
 
@@ -23,6 +186,15 @@ namespace impp
 				if(error_handling::_handler)
 					error_handling::_handler(err);
 			}
+
+			// forwards a failed result to the error handler when it has to be reported
+			template<class tval>
+			inline bool report(const result<tval>& res)
+			{
+				if(!res && res.get_error().reported)
+					on_error(std::runtime_error(res.get_error().message));
+				return res.has_value();
+			}
 		}
 
 		//method used to set an error handler - it can be an empty function used to silence errors
@@ -0,0 +1,601 @@
+/*
+MIT License
+
+Copyright (c) 2022 IkarusDeveloper
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#pragma once
+#ifndef INCLUDE_IMPLUSPLUS_FILTER_HPP
+#define INCLUDE_IMPLUSPLUS_FILTER_HPP
+#include "image.hpp"
+
+#include <string.h>
+#include <stdint.h>
+#include <algorithm>
+#include <cmath>
+#include <vector>
+#include "parallel.hpp"
+#include "pixel.hpp"
+#include "simd.hpp"
+
+namespace impp
+{
+	// how pixels past the sides of the image are read
+	enum filter_edge : uint8_t {
+		FILTER_EDGE_CLAMP = 0,      // the side pixel is repeated
+		FILTER_EDGE_WRAP,           // the opposite side continues the image
+		FILTER_EDGE_MIRROR,         // reflected around the side pixel, which is not repeated
+	};
+
+	struct filter_options
+	{
+		filter_edge edge = FILTER_EDGE_CLAMP;
+		// tiles are shared among workers, 0 asks for one per hardware thread
+		unsigned threads = 1;
+	};
+
+	// centered 1d kernel of an odd number of taps, left to right or top to bottom
+	class filter_kernel
+	{
+	public:
+		filter_kernel() = default;
+
+		// the mean of 2 * radius + 1 pixels, filtered with running sums whatever the radius
+		static filter_kernel box(uint32_t radius)
+		{
+			filter_kernel kernel;
+			kernel._weights.assign(2 * size_t(radius) + 1, 1.0f / (2 * radius + 1));
+			kernel._box = true;
+			return kernel;
+		}
+
+		// radius 0 covers three sigmas, a sigma not above 0 leaves the image as it is
+		static filter_kernel gaussian(float sigma, uint32_t radius = 0)
+		{
+			filter_kernel kernel;
+			if (!(sigma > 0.0f))
+				return kernel;
+			if (radius == 0)
+				radius = static_cast<uint32_t>(std::ceil(sigma * 3.0f));
+			kernel._weights.resize(2 * size_t(radius) + 1);
+			double sum = 0;
+			for (size_t i = 0; i < kernel._weights.size(); i++)
+			{
+				const double x = static_cast<double>(i) - radius;
+				sum += kernel._weights[i] = static_cast<float>(std::exp(-x * x / (2.0 * sigma * sigma)));
+			}
+			for (auto& weight : kernel._weights)
+				weight = static_cast<float>(weight / sum);
+			return kernel;
+		}
+
+		// weights are used as given, an even count gets a last zero tap and no weights is the identity
+		static filter_kernel custom(std::vector<float> weights)
+		{
+			filter_kernel kernel;
+			if (weights.empty())
+				return kernel;
+			if (weights.size() % 2 == 0)
+				weights.push_back(0.0f);
+			kernel._weights = std::move(weights);
+			return kernel;
+		}
+
+		uint32_t get_radius() const { return static_cast<uint32_t>(_weights.size() / 2); }
+		const std::vector<float>& get_weights() const { return _weights; }
+		bool is_box() const { return _box; }
+
+	private:
+		std::vector<float> _weights{ 1.0f };
+		bool _box = false;
+	};
+
+	// centered 2d kernel of odd sides, rows from the top of the image
+	class filter_kernel2d
+	{
+	public:
+		filter_kernel2d() = default;
+
+		// missing weights are zeros, even sides get a last zero column or row
+		static filter_kernel2d custom(uint32_t width, uint32_t height, const std::vector<float>& weights)
+		{
+			filter_kernel2d kernel;
+			if (width == 0 || height == 0)
+				return kernel;
+			kernel._width = width | 1;
+			kernel._height = height | 1;
+			kernel._weights.assign(size_t(kernel._width) * kernel._height, 0.0f);
+			for (size_t i = 0; i < std::min(weights.size(), size_t(width) * height); i++)
+				kernel._weights[(i / width) * kernel._width + i % width] = weights[i];
+			return kernel;
+		}
+
+		uint32_t get_width() const { return _width; }
+		uint32_t get_height() const { return _height; }
+		const std::vector<float>& get_weights() const { return _weights; }
+
+	private:
+		uint32_t _width = 1;
+		uint32_t _height = 1;
+		std::vector<float> _weights{ 1.0f };
+	};
+
+	namespace detail
+	{
+		// cache a tile keeps its rings of rows within
+		constexpr size_t filter_cache_budget = 256 * 1024;
+		constexpr size_t filter_min_tile = 64;
+		// extra elements after every row so vector loops can run past the end
+		constexpr size_t filter_slack = 16;
+
+		inline int64_t filter_edge_index(int64_t i, int64_t count, filter_edge edge)
+		{
+			if (i >= 0 && i < count)
+				return i;
+			switch (edge)
+			{
+			case FILTER_EDGE_WRAP:
+				return (i % count + count) % count;
+			case FILTER_EDGE_MIRROR:
+			{
+				if (count == 1)
+					return 0;
+				const int64_t period = 2 * (count - 1);
+				i = (i < 0 ? -i : i) % period;
+				return i < count ? i : period - i;
+			}
+			default:
+				return std::clamp<int64_t>(i, 0, count - 1);
+			}
+		}
+
+		// weights in fixed point, their absolute sum scaled by at most 2^14 so every product and sum fits
+		// in 32 bits; the rounding error is moved to the largest weight so flat areas stay flat
+		struct filter_fixed
+		{
+			std::vector<int16_t> weights;
+			int bits = 0;
+			double gain = 0;        // absolute sum of the weights
+		};
+
+		inline filter_fixed filter_quantize(const std::vector<float>& weights)
+		{
+			filter_fixed fixed;
+			double sum = 0;
+			size_t largest = 0;
+			for (size_t i = 0; i < weights.size(); i++)
+			{
+				sum += weights[i];
+				fixed.gain += std::fabs(weights[i]);
+				if (std::fabs(weights[i]) > std::fabs(weights[largest]))
+					largest = i;
+			}
+			fixed.bits = 14;
+			while (fixed.bits > 0 && fixed.gain * (1 << fixed.bits) > 16384.0)
+				fixed.bits--;
+
+			int32_t total = 0;
+			fixed.weights.resize(weights.size());
+			for (size_t i = 0; i < weights.size(); i++)
+				total += fixed.weights[i] = static_cast<int16_t>(std::lround(weights[i] * (1 << fixed.bits)));
+			fixed.weights[largest] = static_cast<int16_t>(fixed.weights[largest] + std::lround(sum * (1 << fixed.bits)) - total);
+			return fixed;
+		}
+
+		struct filter_tile
+		{
+			uint32_t x0, x1;
+			uint32_t y0, y1;
+		};
+
+		// bands of rows cut in columns narrow enough for rows bytes per column in the ring to fit the cache,
+		// bands are tall enough to pay for the rows read again around them
+		inline std::vector<filter_tile> filter_tiles(uint32_t width, uint32_t height, size_t bytes_per_column, uint32_t radius)
+		{
+			const auto columns = static_cast<uint32_t>(std::min<size_t>(std::max(filter_cache_budget / std::max<size_t>(bytes_per_column, 1), filter_min_tile), width));
+			const auto rows = static_cast<uint32_t>(std::max<size_t>(64, 8 * size_t(radius)));
+			std::vector<filter_tile> tiles;
+			for (uint32_t y = 0; y < height; y += std::min(rows, height - y))
+				for (uint32_t x = 0; x < width; x += std::min(columns, width - x))
+					tiles.push_back({ x, x + std::min(columns, width - x), y, y + std::min(rows, height - y) });
+			return tiles;
+		}
+
+		// columns [x0, x0 + count) of a row as bytes, the ones outside the image read through the edge mode
+		inline void filter_pad_row(const uint8_t* row, uint32_t width, size_t channels, int64_t x0, size_t count, filter_edge edge, uint8_t* out)
+		{
+			const int64_t inside_begin = std::clamp<int64_t>(x0, 0, width);
+			const int64_t inside_end = std::clamp<int64_t>(x0 + static_cast<int64_t>(count), 0, width);
+			for (int64_t x = x0; x < inside_begin; x++)
+				memcpy(out + (x - x0) * channels, row + filter_edge_index(x, width, edge) * channels, channels);
+			if (inside_end > inside_begin)
+				memcpy(out + (inside_begin - x0) * channels, row + inside_begin * channels, (inside_end - inside_begin) * channels);
+			for (int64_t x = std::max(inside_end, x0); x < x0 + static_cast<int64_t>(count); x++)
+				memcpy(out + (x - x0) * channels, row + filter_edge_index(x, width, edge) * channels, channels);
+		}
+
+		inline int32_t filter_round(int shift)
+		{
+			return shift > 0 ? int32_t(1) << (shift - 1) : 0;
+		}
+
+#ifdef IMPP_SIMD_SSE2
+		// two taps of 8 lanes, products summed in pairs by madd
+		inline __m128i simd_filter_pair(int16_t first, int16_t second)
+		{
+			return _mm_set1_epi32(static_cast<int32_t>(static_cast<uint16_t>(first) | (static_cast<uint32_t>(static_cast<uint16_t>(second)) << 16)));
+		}
+
+		inline __m128i simd_filter_load8(const uint8_t* bytes)
+		{
+			return _mm_unpacklo_epi8(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(bytes)), _mm_setzero_si128());
+		}
+#endif
+
+		// horizontal pass of lanes bytes into 16bit values scaled down by shift, taps are channels bytes apart
+		inline void filter_horizontal(const uint8_t* padded, size_t lanes, size_t channels, const filter_fixed& kernel, int shift, int16_t* out)
+		{
+			const size_t taps = kernel.weights.size();
+			const int32_t round = filter_round(shift);
+			size_t j = 0;
+#ifdef IMPP_SIMD_SSE2
+			const __m128i bias = _mm_set1_epi32(round);
+			const __m128i count = _mm_cvtsi32_si128(shift);
+			for (; j < lanes; j += 8)
+			{
+				__m128i lo = bias, hi = bias;
+				for (size_t k = 0; k < taps; k += 2)
+				{
+					const bool single = k + 1 == taps;
+					const __m128i a = simd_filter_load8(padded + j + k * channels);
+					const __m128i b = single ? a : simd_filter_load8(padded + j + (k + 1) * channels);
+					const __m128i w = simd_filter_pair(kernel.weights[k], single ? 0 : kernel.weights[k + 1]);
+					lo = _mm_add_epi32(lo, _mm_madd_epi16(_mm_unpacklo_epi16(a, b), w));
+					hi = _mm_add_epi32(hi, _mm_madd_epi16(_mm_unpackhi_epi16(a, b), w));
+				}
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(out + j), _mm_packs_epi32(_mm_sra_epi32(lo, count), _mm_sra_epi32(hi, count)));
+			}
+#endif
+			for (; j < lanes; j++)
+			{
+				int32_t sum = round;
+				for (size_t k = 0; k < taps; k++)
+					sum += kernel.weights[k] * padded[j + k * channels];
+				out[j] = static_cast<int16_t>(std::clamp<int32_t>(sum >> shift, INT16_MIN, INT16_MAX));
+			}
+		}
+
+		// vertical pass of one 16bit row per tap into bytes
+		inline void filter_vertical(const int16_t* const* rows, size_t lanes, const filter_fixed& kernel, int shift, uint8_t* out)
+		{
+			const size_t taps = kernel.weights.size();
+			const int32_t round = filter_round(shift);
+			size_t j = 0;
+#ifdef IMPP_SIMD_SSE2
+			const __m128i bias = _mm_set1_epi32(round);
+			const __m128i count = _mm_cvtsi32_si128(shift);
+			for (; j < lanes; j += 8)
+			{
+				__m128i lo = bias, hi = bias;
+				for (size_t k = 0; k < taps; k += 2)
+				{
+					const bool single = k + 1 == taps;
+					const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(rows[k] + j));
+					const __m128i b = single ? a : _mm_loadu_si128(reinterpret_cast<const __m128i*>(rows[k + 1] + j));
+					const __m128i w = simd_filter_pair(kernel.weights[k], single ? 0 : kernel.weights[k + 1]);
+					lo = _mm_add_epi32(lo, _mm_madd_epi16(_mm_unpacklo_epi16(a, b), w));
+					hi = _mm_add_epi32(hi, _mm_madd_epi16(_mm_unpackhi_epi16(a, b), w));
+				}
+				const __m128i words = _mm_packs_epi32(_mm_sra_epi32(lo, count), _mm_sra_epi32(hi, count));
+				_mm_storel_epi64(reinterpret_cast<__m128i*>(out + j), _mm_packus_epi16(words, words));
+			}
+#endif
+			for (; j < lanes; j++)
+			{
+				int32_t sum = round;
+				for (size_t k = 0; k < taps; k++)
+					sum += kernel.weights[k] * rows[k][j];
+				out[j] = static_cast<uint8_t>(std::clamp<int32_t>(std::clamp<int32_t>(sum >> shift, INT16_MIN, INT16_MAX), 0, UINT8_MAX));
+			}
+		}
+
+		// 2d kernel over one padded byte row per kernel row
+		inline void filter_convolve_row(const uint8_t* const* rows, size_t lanes, size_t channels, const filter_fixed& kernel, size_t width, uint8_t* out)
+		{
+			const size_t height = kernel.weights.size() / width;
+			const int shift = kernel.bits;
+			const int32_t round = filter_round(shift);
+			size_t j = 0;
+#ifdef IMPP_SIMD_SSE2
+			const __m128i bias = _mm_set1_epi32(round);
+			const __m128i count = _mm_cvtsi32_si128(shift);
+			for (; j < lanes; j += 8)
+			{
+				__m128i lo = bias, hi = bias;
+				for (size_t ky = 0; ky < height; ky++)
+				{
+					const int16_t* weights = kernel.weights.data() + ky * width;
+					for (size_t kx = 0; kx < width; kx += 2)
+					{
+						const bool single = kx + 1 == width;
+						const __m128i a = simd_filter_load8(rows[ky] + j + kx * channels);
+						const __m128i b = single ? a : simd_filter_load8(rows[ky] + j + (kx + 1) * channels);
+						const __m128i w = simd_filter_pair(weights[kx], single ? 0 : weights[kx + 1]);
+						lo = _mm_add_epi32(lo, _mm_madd_epi16(_mm_unpacklo_epi16(a, b), w));
+						hi = _mm_add_epi32(hi, _mm_madd_epi16(_mm_unpackhi_epi16(a, b), w));
+					}
+				}
+				const __m128i words = _mm_packs_epi32(_mm_sra_epi32(lo, count), _mm_sra_epi32(hi, count));
+				_mm_storel_epi64(reinterpret_cast<__m128i*>(out + j), _mm_packus_epi16(words, words));
+			}
+#endif
+			for (; j < lanes; j++)
+			{
+				int32_t sum = round;
+				for (size_t ky = 0; ky < height; ky++)
+					for (size_t kx = 0; kx < width; kx++)
+						sum += kernel.weights[ky * width + kx] * rows[ky][j + kx * channels];
+				out[j] = static_cast<uint8_t>(std::clamp<int32_t>(std::clamp<int32_t>(sum >> shift, INT16_MIN, INT16_MAX), 0, UINT8_MAX));
+			}
+		}
+
+		// the rows a tile reads, virtual rows past the sides resolved through the edge mode
+		struct filter_rows
+		{
+			const uint8_t* pixels;
+			uint32_t width;
+			uint32_t height;
+			size_t channels;
+			filter_edge edge;
+
+			const uint8_t* row(int64_t y) const
+			{
+				return pixels + filter_edge_index(y, height, edge) * width * channels;
+			}
+		};
+
+		// separable kernels, horizontally filtered rows are kept in a ring as long as vertical taps need them
+		inline void filter_separable_tile(const filter_rows& src, const filter_tile& tile, const filter_fixed& h, const filter_fixed& v, int inner, uint8_t* dst)
+		{
+			const size_t channels = src.channels;
+			const int64_t rh = static_cast<int64_t>(h.weights.size() / 2), rv = static_cast<int64_t>(v.weights.size() / 2);
+			const size_t slots = v.weights.size();
+			const size_t lanes = size_t(tile.x1 - tile.x0) * channels;
+			const size_t stride = lanes + filter_slack;
+
+			std::vector<uint8_t> padded((tile.x1 - tile.x0 + 2 * rh) * channels + filter_slack);
+			std::vector<int16_t> ring(slots * stride);
+			std::vector<const int16_t*> rows(slots);
+			std::vector<uint8_t> out(stride);
+
+			const auto filter_row = [&](int64_t y) {
+				filter_pad_row(src.row(y), src.width, channels, int64_t(tile.x0) - rh, tile.x1 - tile.x0 + 2 * rh, src.edge, padded.data());
+				const size_t slot = static_cast<size_t>(y - (int64_t(tile.y0) - rv)) % slots;
+				filter_horizontal(padded.data(), lanes, channels, h, h.bits - inner, ring.data() + slot * stride);
+			};
+
+			for (int64_t y = int64_t(tile.y0) - rv; y < int64_t(tile.y0) + rv; y++)
+				filter_row(y);
+			for (int64_t y = tile.y0; y < tile.y1; y++)
+			{
+				filter_row(y + rv);
+				for (size_t k = 0; k < slots; k++)
+					rows[k] = ring.data() + static_cast<size_t>(y - rv + int64_t(k) - (int64_t(tile.y0) - rv)) % slots * stride;
+				filter_vertical(rows.data(), lanes, v, v.bits + inner, out.data());
+				memcpy(dst + (size_t(y) * src.width + tile.x0) * channels, out.data(), lanes);
+			}
+		}
+
+		// box kernels, running sums along rows then along columns, the cost does not depend on the radius
+		inline void filter_box_tile(const filter_rows& src, const filter_tile& tile, uint32_t radius_h, uint32_t radius_v, uint8_t* dst)
+		{
+			const size_t channels = src.channels;
+			const int64_t rh = radius_h, rv = radius_v;
+			const size_t nh = 2 * size_t(radius_h) + 1, slots = 2 * size_t(radius_v) + 1;
+			const size_t lanes = size_t(tile.x1 - tile.x0) * channels;
+			const uint64_t area = uint64_t(nh) * slots;
+			// rounded division by a reciprocal, exact while sums stay below 2^40 / area
+			const uint64_t inverse = ((uint64_t(1) << 40) + area - 1) / area;
+			const bool reciprocal = area < 65536;
+
+			std::vector<uint8_t> padded((tile.x1 - tile.x0 + 2 * rh) * channels);
+			std::vector<uint32_t> ring(slots * lanes);
+			std::vector<uint32_t> sums(lanes, 0);
+
+			const auto filter_row = [&](int64_t y) {
+				filter_pad_row(src.row(y), src.width, channels, int64_t(tile.x0) - rh, tile.x1 - tile.x0 + 2 * rh, src.edge, padded.data());
+				uint32_t* row = ring.data() + static_cast<size_t>(y - (int64_t(tile.y0) - rv)) % slots * lanes;
+				for (size_t c = 0; c < channels; c++)
+				{
+					uint32_t sum = 0;
+					for (size_t k = 0; k < nh; k++)
+						sum += padded[k * channels + c];
+					row[c] = sum;
+					for (size_t j = c + channels; j < lanes; j += channels)
+					{
+						sum += padded[j + (nh - 1) * channels] - padded[j - channels];
+						row[j] = sum;
+					}
+				}
+				return row;
+			};
+
+			for (int64_t y = int64_t(tile.y0) - rv; y < int64_t(tile.y0) + rv; y++)
+			{
+				const uint32_t* row = filter_row(y);
+				for (size_t j = 0; j < lanes; j++)
+					sums[j] += row[j];
+			}
+			for (int64_t y = tile.y0; y < tile.y1; y++)
+			{
+				// the row leaving the window shares its slot with the one entering it
+				if (y != tile.y0)
+				{
+					const uint32_t* leaving = ring.data() + static_cast<size_t>(y - 1 - rv - (int64_t(tile.y0) - rv)) % slots * lanes;
+					for (size_t j = 0; j < lanes; j++)
+						sums[j] -= leaving[j];
+				}
+				const uint32_t* entering = filter_row(y + rv);
+				for (size_t j = 0; j < lanes; j++)
+					sums[j] += entering[j];
+
+				uint8_t* out = dst + (size_t(y) * src.width + tile.x0) * channels;
+				if (reciprocal)
+					for (size_t j = 0; j < lanes; j++)
+						out[j] = static_cast<uint8_t>(((sums[j] + area / 2) * inverse) >> 40);
+				else
+					for (size_t j = 0; j < lanes; j++)
+						out[j] = static_cast<uint8_t>((sums[j] + area / 2) / area);
+			}
+		}
+
+		// 2d kernels, padded source rows are kept in a ring as long as the kernel rows need them
+		inline void filter_convolve_tile(const filter_rows& src, const filter_tile& tile, const filter_fixed& kernel, size_t width, uint8_t* dst)
+		{
+			const size_t channels = src.channels;
+			const size_t slots = kernel.weights.size() / width;
+			const int64_t rx = static_cast<int64_t>(width / 2), ry = static_cast<int64_t>(slots / 2);
+			const size_t lanes = size_t(tile.x1 - tile.x0) * channels;
+			const size_t stride = (tile.x1 - tile.x0 + 2 * rx) * channels + filter_slack;
+
+			std::vector<uint8_t> ring(slots * stride);
+			std::vector<const uint8_t*> rows(slots);
+			std::vector<uint8_t> out(lanes + filter_slack);
+
+			const auto pad_row = [&](int64_t y) {
+				const size_t slot = static_cast<size_t>(y - (int64_t(tile.y0) - ry)) % slots;
+				filter_pad_row(src.row(y), src.width, channels, int64_t(tile.x0) - rx, tile.x1 - tile.x0 + 2 * rx, src.edge, ring.data() + slot * stride);
+			};
+
+			for (int64_t y = int64_t(tile.y0) - ry; y < int64_t(tile.y0) + ry; y++)
+				pad_row(y);
+			for (int64_t y = tile.y0; y < tile.y1; y++)
+			{
+				pad_row(y + ry);
+				for (size_t k = 0; k < slots; k++)
+					rows[k] = ring.data() + static_cast<size_t>(y - ry + int64_t(k) - (int64_t(tile.y0) - ry)) % slots * stride;
+				filter_convolve_row(rows.data(), lanes, channels, kernel, width, out.data());
+				memcpy(dst + (size_t(y) * src.width + tile.x0) * channels, out.data(), lanes);
+			}
+		}
+
+		// memory rows run against the y axis of LEFT_TOP images, so their vertical taps are reversed
+		template<pixel_type pixel>
+		inline bool filter_reversed(const image<pixel>& source)
+		{
+			return source.orientation == image<pixel>::LEFT_TOP;
+		}
+
+		template<pixel_type pixel>
+		inline image<pixel> filter_output(const image<pixel>& source)
+		{
+			auto ret = image<pixel>::create(source.width, source.height);
+			ret.orientation = source.orientation;
+			return ret;
+		}
+	}
+
+	// every channel is filtered on its own, premultiply straight alpha images first to avoid dark fringes
+	// 8bit channels are filtered in fixed point, kernels with a large absolute sum lose precision
+	template<pixel_type pixel>
+	inline image<pixel> filter_separable(const image<pixel>& source, const filter_kernel& horizontal, const filter_kernel& vertical, const filter_options& options = {})
+	{
+		auto ret = detail::filter_output(source);
+		if (source.empty())
+			return ret;
+		const detail::filter_rows src{ source.get_bytes(), source.width, source.height, sizeof(pixel), options.edge };
+		auto* dst = reinterpret_cast<uint8_t*>(ret.pixels.data());
+
+		if (horizontal.is_box() && vertical.is_box())
+		{
+			const auto tiles = detail::filter_tiles(source.width, source.height, vertical.get_weights().size() * sizeof(uint32_t) * sizeof(pixel), vertical.get_radius());
+			detail::parallel_for(tiles.size(), 1, options.threads, [&](size_t begin, size_t end) {
+				for (size_t t = begin; t < end; t++)
+					detail::filter_box_tile(src, tiles[t], horizontal.get_radius(), vertical.get_radius(), dst);
+			});
+			return ret;
+		}
+
+		auto weights = vertical.get_weights();
+		if (detail::filter_reversed(source))
+			std::reverse(weights.begin(), weights.end());
+		const auto h = detail::filter_quantize(horizontal.get_weights());
+		const auto v = detail::filter_quantize(weights);
+		// bits kept between the passes, as many as the largest horizontal sums leave room for in 16bit
+		int inner = 0;
+		while (inner < 7 && UINT8_MAX * h.gain * (2 << inner) <= INT16_MAX)
+			inner++;
+		inner = std::min(inner, h.bits);
+
+		const auto tiles = detail::filter_tiles(source.width, source.height, weights.size() * sizeof(int16_t) * sizeof(pixel), vertical.get_radius());
+		detail::parallel_for(tiles.size(), 1, options.threads, [&](size_t begin, size_t end) {
+			for (size_t t = begin; t < end; t++)
+				detail::filter_separable_tile(src, tiles[t], h, v, inner, dst);
+		});
+		return ret;
+	}
+
+	template<pixel_type pixel>
+	inline image<pixel> filter_convolve(const image<pixel>& source, const filter_kernel2d& kernel, const filter_options& options = {})
+	{
+		auto ret = detail::filter_output(source);
+		if (source.empty())
+			return ret;
+		const detail::filter_rows src{ source.get_bytes(), source.width, source.height, sizeof(pixel), options.edge };
+		auto* dst = reinterpret_cast<uint8_t*>(ret.pixels.data());
+
+		auto weights = kernel.get_weights();
+		if (detail::filter_reversed(source))
+			for (size_t top = 0, bottom = kernel.get_height() - 1; top < bottom; top++, bottom--)
+				std::swap_ranges(weights.begin() + top * kernel.get_width(), weights.begin() + (top + 1) * kernel.get_width(), weights.begin() + bottom * kernel.get_width());
+		const auto fixed = detail::filter_quantize(weights);
+
+		const auto tiles = detail::filter_tiles(source.width, source.height, kernel.get_height() * sizeof(pixel), kernel.get_height() / 2);
+		detail::parallel_for(tiles.size(), 1, options.threads, [&](size_t begin, size_t end) {
+			for (size_t t = begin; t < end; t++)
+				detail::filter_convolve_tile(src, tiles[t], fixed, kernel.get_width(), dst);
+		});
+		return ret;
+	}
+
+	template<pixel_type pixel>
+	inline image<pixel> box_blur(const image<pixel>& source, uint32_t radius, const filter_options& options = {})
+	{
+		const auto kernel = filter_kernel::box(radius);
+		return filter_separable(source, kernel, kernel, options);
+	}
+
+	template<pixel_type pixel>
+	inline image<pixel> gaussian_blur(const image<pixel>& source, float sigma, const filter_options& options = {})
+	{
+		const auto kernel = filter_kernel::gaussian(sigma);
+		return filter_separable(source, kernel, kernel, options);
+	}
+
+	// amount 0 leaves the image as it is, 1 subtracts the four neighbors of every pixel once more
+	template<pixel_type pixel>
+	inline image<pixel> sharpen(const image<pixel>& source, float amount, const filter_options& options = {})
+	{
+		const auto kernel = filter_kernel2d::custom(3, 3, { 0.0f, -amount, 0.0f, -amount, 1.0f + 4.0f * amount, -amount, 0.0f, -amount, 0.0f });
+		return filter_convolve(source, kernel, options);
+	}
+}
+
+#endif //INCLUDE_IMPLUSPLUS_FILTER_HPP
@@ -0,0 +1,391 @@
+/*
+MIT License
+
+Copyright (c) 2022 IkarusDeveloper
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#pragma once
+#ifndef INCLUDE_IMPLUSPLUS_HASH_HPP
+#define INCLUDE_IMPLUSPLUS_HASH_HPP
+#include "image.hpp"
+
+#include <string.h>
+#include <stdint.h>
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cmath>
+#include <vector>
+#include "pixel.hpp"
+#include "mipmap.hpp"
+#include "simd.hpp"
+
+namespace impp
+{
+	struct hash128
+	{
+		uint64_t low = 0;
+		uint64_t high = 0;
+
+		bool operator==(const hash128& r) const { return low == r.low && high == r.high; }
+		bool operator!=(const hash128& r) const { return !(*this == r); }
+	};
+
+	namespace detail
+	{
+		constexpr uint64_t hash_prime64_1 = 0x9E3779B185EBCA87ull;
+		constexpr uint64_t hash_prime64_2 = 0xC2B2AE3D27D4EB4Full;
+		constexpr uint64_t hash_prime32 = 0x9E3779B1u;
+		constexpr size_t hash_stripe = 64;          // bytes accumulated at once, 8 lanes of 64 bits
+		constexpr size_t hash_block = 16;           // stripes between two scrambles of the lanes
+
+		constexpr uint64_t hash_splitmix(uint64_t x)
+		{
+			x += 0x9E3779B97F4A7C15ull;
+			x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+			x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+			return x ^ (x >> 31);
+		}
+
+		// every stripe of a block uses the keys shifted by one lane, the last 8 scramble the lanes
+		constexpr auto hash_keys = [] {
+			std::array<uint64_t, 8 + hash_block + 8> keys{};
+			for (size_t i = 0; i < keys.size(); i++)
+				keys[i] = hash_splitmix(i);
+			return keys;
+		}();
+
+		inline uint64_t hash_read64(const uint8_t* data)
+		{
+			uint64_t value;
+			memcpy(&value, data, sizeof(value));
+			return value;
+		}
+
+		// 64x64 bit product with the high half folded into the low one
+		inline uint64_t hash_mul_fold(uint64_t a, uint64_t b)
+		{
+#if defined(__SIZEOF_INT128__)
+			const auto product = static_cast<unsigned __int128>(a) * b;
+			return static_cast<uint64_t>(product) ^ static_cast<uint64_t>(product >> 64);
+#else
+			const uint64_t lo_lo = (a & 0xFFFFFFFF) * (b & 0xFFFFFFFF);
+			const uint64_t hi_lo = (a >> 32) * (b & 0xFFFFFFFF);
+			const uint64_t lo_hi = (a & 0xFFFFFFFF) * (b >> 32);
+			const uint64_t hi_hi = (a >> 32) * (b >> 32);
+			const uint64_t cross = (lo_lo >> 32) + (hi_lo & 0xFFFFFFFF) + lo_hi;
+			const uint64_t upper = (hi_lo >> 32) + (cross >> 32) + hi_hi;
+			const uint64_t lower = (cross << 32) | (lo_lo & 0xFFFFFFFF);
+			return lower ^ upper;
+#endif
+		}
+
+		inline uint64_t hash_avalanche(uint64_t h)
+		{
+			h ^= h >> 37;
+			h *= 0x165667919E3779F9ull;
+			return h ^ (h >> 32);
+		}
+
+		// each lane adds the product of the halves of data ^ key and the data of its neighbor lane
+		inline void hash_accumulate(uint64_t* acc, const uint8_t* data, const uint64_t* keys)
+		{
+#ifdef IMPP_SIMD_SSE2
+			for (int i = 0; i < 4; i++)
+			{
+				const __m128i value = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data) + i);
+				const __m128i key = _mm_xor_si128(value, _mm_loadu_si128(reinterpret_cast<const __m128i*>(keys) + i));
+				const __m128i product = _mm_mul_epu32(key, _mm_shuffle_epi32(key, _MM_SHUFFLE(0, 3, 0, 1)));
+				const __m128i swapped = _mm_shuffle_epi32(value, _MM_SHUFFLE(1, 0, 3, 2));
+				__m128i lanes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(acc) + i);
+				lanes = _mm_add_epi64(lanes, _mm_add_epi64(product, swapped));
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(acc) + i, lanes);
+			}
+#else
+			for (int i = 0; i < 8; i++)
+			{
+				const uint64_t value = hash_read64(data + i * 8);
+				const uint64_t key = value ^ keys[i];
+				acc[i ^ 1] += value;
+				acc[i] += (key & 0xFFFFFFFF) * (key >> 32);
+			}
+#endif
+		}
+
+		// streaming 128 bit hash in the xxh3 style, the sse2 and scalar paths give the same values
+		class hash_state
+		{
+		public:
+			explicit hash_state(uint64_t seed = 0)
+			{
+				for (size_t i = 0; i < 8; i++)
+					_acc[i] = hash_keys[i] ^ hash_splitmix(seed + i);
+			}
+
+			void update(const void* memory, size_t size)
+			{
+				const auto* data = reinterpret_cast<const uint8_t*>(memory);
+				_total += size;
+				if (_buffered != 0)
+				{
+					const size_t take = std::min(size, hash_stripe - _buffered);
+					memcpy(_buffer + _buffered, data, take);
+					_buffered += take;
+					data += take;
+					size -= take;
+					if (_buffered < hash_stripe)
+						return;
+					stripe(_buffer);
+					_buffered = 0;
+				}
+				for (; size >= hash_stripe; data += hash_stripe, size -= hash_stripe)
+					stripe(data);
+				memcpy(_buffer, data, size);
+				_buffered = size;
+			}
+
+			hash128 finish() const
+			{
+				auto state = *this;
+				if (state._buffered != 0)
+				{
+					memset(state._buffer + state._buffered, 0, hash_stripe - state._buffered);
+					state.stripe(state._buffer);
+				}
+
+				const uint64_t* keys = hash_keys.data() + hash_block;
+				hash128 ret{ _total * hash_prime64_1, ~(_total * hash_prime64_2) };
+				for (size_t i = 0; i < 4; i++)
+				{
+					ret.low += hash_mul_fold(state._acc[i * 2] ^ keys[i * 2], state._acc[i * 2 + 1] ^ keys[i * 2 + 1]);
+					ret.high += hash_mul_fold(state._acc[i * 2] ^ keys[7 - i * 2], state._acc[i * 2 + 1] ^ keys[6 - i * 2]);
+				}
+				return { hash_avalanche(ret.low), hash_avalanche(ret.high) };
+			}
+
+		private:
+			void stripe(const uint8_t* data)
+			{
+				hash_accumulate(_acc, data, hash_keys.data() + _stripes);
+				if (++_stripes == hash_block)
+				{
+					const uint64_t* keys = hash_keys.data() + 8 + hash_block;
+					for (size_t i = 0; i < 8; i++)
+					{
+						_acc[i] ^= _acc[i] >> 47;
+						_acc[i] ^= keys[i];
+						_acc[i] *= hash_prime32;
+					}
+					_stripes = 0;
+				}
+			}
+
+			uint64_t _acc[8] = {};
+			uint8_t _buffer[hash_stripe] = {};
+			size_t _buffered = 0;
+			size_t _stripes = 0;
+			uint64_t _total = 0;
+		};
+
+		// rows are hashed as 32bit rgba, other pixel types go through a small chunk kept in cache
+		template<pixel_type pixel>
+		inline void hash_row(hash_state& state, const pixel* row, uint32_t width)
+		{
+			if constexpr (std::is_same_v<pixel, pixel32rgba>)
+				state.update(row, static_cast<size_t>(width) * sizeof(pixel));
+			else
+			{
+				alignas(16) uint32_t chunk[256];
+				for (uint32_t x = 0; x < width; )
+				{
+					const uint32_t count = std::min<uint32_t>(width - x, 256);
+					uint32_t i = 0;
+					if constexpr (std::is_same_v<pixel, pixel32bgra>)
+					{
+#ifdef IMPP_SIMD_SSE2
+						// swaps the first and third byte of every pixel
+						const __m128i keep = _mm_set1_epi32(static_cast<int>(0xFF00FF00u)), low = _mm_set1_epi32(0xFF);
+						for (; i + 4 <= count; i += 4)
+						{
+							const __m128i px = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + x + i));
+							const __m128i swapped = _mm_or_si128(_mm_and_si128(px, keep),
+								_mm_or_si128(_mm_and_si128(_mm_srli_epi32(px, 16), low), _mm_slli_epi32(_mm_and_si128(px, low), 16)));
+							_mm_store_si128(reinterpret_cast<__m128i*>(chunk + i), swapped);
+						}
+#endif
+					}
+					else if constexpr (pixel_is24bit<pixel>)
+					{
+						// 4 byte loads stop one pixel early to stay inside the row
+						const auto* bytes = reinterpret_cast<const uint8_t*>(row + x);
+						for (; i + 1 < count; i++)
+						{
+							uint32_t value;
+							memcpy(&value, bytes + i * 3, sizeof(value));
+							if constexpr (std::is_same_v<pixel, pixel24bgr>)
+								value = (value & 0x00FF00) | (value >> 16 & 0xFF) | (value & 0xFF) << 16;
+							chunk[i] = (value & 0xFFFFFF) | 0xFF000000u;
+						}
+					}
+					for (; i < count; i++)
+					{
+						const auto px = pixel_cast<pixel32rgba>(row[x + i]);
+						chunk[i] = uint32_t(px.r) | uint32_t(px.g) << 8 | uint32_t(px.b) << 16 | uint32_t(px.a) << 24;
+					}
+					state.update(chunk, count * sizeof(uint32_t));
+					x += count;
+				}
+			}
+		}
+
+		// luma of the image resampled to width x height with area weights, rows top to bottom
+		template<pixel_type pixel>
+		inline std::vector<float> hash_luma(const image<pixel>& source, uint32_t width, uint32_t height)
+		{
+			const auto h = mip_make_taps(source.width, width, MIPMAP_BOX);
+			const auto v = mip_make_taps(source.height, height, MIPMAP_BOX);
+
+			// every source row is reduced to width values first, then the rows are combined
+			std::vector<float> rows(static_cast<size_t>(source.height) * width);
+			std::vector<float> luma(source.width);
+			for (uint32_t y = 0; y < source.height; y++)
+			{
+				const auto* row = image_top_row(source, y);
+				for (uint32_t x = 0; x < source.width; x++)
+				{
+					const auto px = pixel_cast<pixel32rgba>(row[x]);
+					luma[x] = 0.299f * px.r + 0.587f * px.g + 0.114f * px.b;
+				}
+				float* out = rows.data() + static_cast<size_t>(y) * width;
+				for (uint32_t x = 0; x < width; x++)
+				{
+					float sum = 0;
+					for (size_t k = 0; k < h.count; k++)
+						sum += luma[h.index[x * h.count + k]] * h.weight[x * h.count + k];
+					out[x] = sum;
+				}
+			}
+
+			std::vector<float> ret(static_cast<size_t>(width) * height, 0.0f);
+			for (uint32_t y = 0; y < height; y++)
+				for (size_t k = 0; k < v.count; k++)
+				{
+					const float w = v.weight[y * v.count + k];
+					const float* row = rows.data() + static_cast<size_t>(v.index[y * v.count + k]) * width;
+					for (uint32_t x = 0; x < width; x++)
+						ret[y * width + x] += row[x] * w;
+				}
+			return ret;
+		}
+	}
+
+	// hash of any bytes, the same as content_hash of an image only by chance
+	inline hash128 hash_bytes(const void* data, size_t size, uint64_t seed = 0)
+	{
+		detail::hash_state state(seed);
+		state.update(data, size);
+		return state.finish();
+	}
+
+	// 128 bit hash of the sides and the pixels read top-left first as 32bit rgba, 24bit pixels being opaque;
+	// the same picture gives the same hash whatever its pixel type and orientation
+	template<pixel_type pixel>
+	inline hash128 content_hash(const image<pixel>& source)
+	{
+		detail::hash_state state(static_cast<uint64_t>(source.width) << 32 | source.height);
+		if (source.pixels.size() == static_cast<size_t>(source.width) * source.height)
+			for (uint32_t y = 0; y < source.height; y++)
+				detail::hash_row(state, detail::image_top_row(source, y), source.width);
+		return state.finish();
+	}
+
+	template<pixel_type pixel>
+	inline uint64_t content_hash64(const image<pixel>& source)
+	{
+		return content_hash(source).low;
+	}
+
+	// perceptual hashes are compared with hash_distance, a few bits apart are near duplicates;
+	// alpha is ignored and empty images hash to 0
+
+	// dhash: one bit per horizontal gradient of a 9x8 luma thumbnail
+	template<pixel_type pixel>
+	inline uint64_t difference_hash(const image<pixel>& source)
+	{
+		if (source.width == 0 || source.height == 0 || source.pixels.size() != static_cast<size_t>(source.width) * source.height)
+			return 0;
+		const auto luma = detail::hash_luma(source, 9, 8);
+		uint64_t hash = 0;
+		for (uint32_t y = 0; y < 8; y++)
+			for (uint32_t x = 0; x < 8; x++)
+				hash = hash << 1 | (luma[y * 9 + x + 1] > luma[y * 9 + x] ? 1 : 0);
+		return hash;
+	}
+
+	// phash: signs against the median of the 8x8 lowest frequencies of the dct of a 32x32 luma thumbnail
+	template<pixel_type pixel>
+	inline uint64_t perceptual_hash(const image<pixel>& source)
+	{
+		if (source.width == 0 || source.height == 0 || source.pixels.size() != static_cast<size_t>(source.width) * source.height)
+			return 0;
+		constexpr int size = 32, low = 8;
+		const auto luma = detail::hash_luma(source, size, size);
+
+		float basis[low][size];
+		for (int u = 0; u < low; u++)
+			for (int x = 0; x < size; x++)
+				basis[u][x] = std::cos((2 * x + 1) * u * 3.14159265358979f / (2 * size));
+
+		// separable dct, rows first and only the frequencies kept
+		float rows[size][low] = {};
+		for (int y = 0; y < size; y++)
+			for (int u = 0; u < low; u++)
+				for (int x = 0; x < size; x++)
+					rows[y][u] += luma[y * size + x] * basis[u][x];
+		std::array<float, low * low> dct{};
+		for (int v = 0; v < low; v++)
+			for (int u = 0; u < low; u++)
+				for (int y = 0; y < size; y++)
+					dct[v * low + u] += rows[y][u] * basis[v][y];
+
+		// the dc term only tells the brightness, it is left out of the median
+		auto sorted = dct;
+		std::nth_element(sorted.begin() + 1, sorted.begin() + 32, sorted.end());
+		const float median = sorted[32];
+		uint64_t hash = 0;
+		for (const auto coefficient : dct)
+			hash = hash << 1 | (coefficient > median ? 1 : 0);
+		return hash;
+	}
+
+	inline unsigned hash_distance(uint64_t a, uint64_t b)
+	{
+		return static_cast<unsigned>(std::popcount(a ^ b));
+	}
+}
+
+template<impp::pixel_type pixel>
+struct std::hash<impp::image<pixel>> {
+	size_t operator()(const impp::image<pixel>& value) const {
+		return static_cast<size_t>(impp::content_hash64(value));
+	}
+};
+
+#endif //INCLUDE_IMPLUSPLUS_HASH_HPP
@@ -28,11 +28,38 @@ SOFTWARE.
 #include <stdint.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <algorithm>
 #include <fstream>
 #include "pixel.hpp"
+#include "blend.hpp"
+#include "transform.hpp"
+#include "error.hpp"
+#include "instrument.hpp"
 
 namespace impp
 {
+	// filters used when reducing images (e.g. decode-time downscaling)
+	enum scale_filter { SCALE_BOX = 0, SCALE_NEAREST = 1 };
+
+	// rectangle of an image expressed in top-left based coordinates
+	struct image_region
+	{
+		uint32_t x = 0;
+		uint32_t y = 0;
+		uint32_t width = UINT32_MAX;
+		uint32_t height = UINT32_MAX;
+
+		// clips the region to the image space returning false when nothing is left
+		bool clip(uint32_t imgwidth, uint32_t imgheight)
+		{
+			if (x >= imgwidth || y >= imgheight)
+				return false;
+			width = std::min(width, imgwidth - x);
+			height = std::min(height, imgheight - y);
+			return width != 0 && height != 0;
+		}
+	};
+
 	template<class _pixel = pixel32rgba>
 	class image
 	{
@@ -42,6 +69,7 @@ namespace impp
 		using pixelvec = std::vector<pixel>;
 
 		enum orientation_value { LEFT_BOTTOM = 0, LEFT_TOP = 1 };
+		enum rotation_value { ROTATE_90 = 90, ROTATE_180 = 180, ROTATE_270 = 270 }; // clockwise
 		static image from_file(const std::string& filename);
 		static image from_buffer(void* memory, size_t size);
 		static image create(size width, size height);
@@ -65,9 +93,16 @@ namespace impp
 		const pixel* get_pixel(size x, size y) const;
 		void fill_rect(size x, size y, size width, size height, const pixel& color);
 		void blank_rect(size x, size y, size width, size height);
-		void overwrite(size x, size y, const image& src);
+		void overwrite(size x, size y, const image& src, blend_mode mode = BLEND_NONE);
 		void vertical_mirror();
 		void horizontal_mirror();
+		void flip(bool horizontal, bool vertical);
+		void transpose();
+		void transverse();
+		void rotate(rotation_value rotation);
+
+	private:
+		void transpose_layout(bool flip_rows, bool flip_columns);
 
 	public:
 		size width = 0;
@@ -167,43 +202,162 @@ namespace impp
 	}
 
 	template<class pixel>
-	inline void image<pixel>::overwrite(size x, size y, const image& source) {
-		auto oror = orientation;
-		const auto fx = std::min<size>(x + source.width, width);
-		const auto fy = std::min<size>(y + source.height, height);
-		auto sy = 0;
-		set_orientation(source.orientation);
-		for (size_t py = y; py < fy; py++, sy++)
-			for (size_t px = x, sx = 0; px < fx; px++, sx++)
-				if (auto* color = source.get_pixel(sx, sy))
-					set_pixel(px, py, *color);
-		set_orientation(oror);
+	inline void image<pixel>::overwrite(size x, size y, const image& source, blend_mode mode) {
+		// avoiding violation accessing on memory
+		if (x >= width || y >= height)
+			return;
+
+		const auto w = std::min<size>(source.width, width - x);
+		const auto h = std::min<size>(source.height, height - y);
+
+		// both images are addressed through the source orientation, blending a row span at a time
+		const bool reversed = source.orientation == LEFT_TOP;
+		for (size_t sy = 0; sy < h; sy++)
+		{
+			const size_t srow = reversed ? source.height - sy - 1 : sy;
+			const size_t drow = reversed ? height - (y + sy) - 1 : y + sy;
+			blend_pixels(source.pixels.data() + srow * source.width, pixels.data() + drow * width + x, w, mode);
+		}
 	}
 
 	template<class pixel>
 	inline void image<pixel>::vertical_mirror()
 	{
-		auto copy = pixels;
-		const auto* from = copy.data() + copy.size() - width;
-		auto* to = pixels.data();
-		for (size_t py = 0; py < height; py++, from -= width, to += width)
-			memcpy(to, from, width * sizeof(*from));
+		flip(false, true);
 	}
 
 	template<class pixel>
 	inline void image<pixel>::horizontal_mirror()
 	{
-		auto* from = pixels.data();
-		auto* to = pixels.data() + width;
-		for(size_t py = 0; py < height; py++, from += width, to += width)
-			std::reverse(from, to);
+		flip(true, false);
+	}
+
+	template<class pixel>
+	inline void image<pixel>::flip(bool horizontal, bool vertical)
+	{
+		// rows are swapped in place instead of copying the whole image
+		detail::flip_inplace(pixels.data(), width, height, horizontal, vertical);
+	}
+
+	template<class pixel>
+	inline void image<pixel>::transpose()
+	{
+		// memory rows run against the y axis on LEFT_TOP images so the layout must also be rotated by 180
+		const bool reversed = orientation == LEFT_TOP;
+		transpose_layout(reversed, reversed);
+	}
+
+	template<class pixel>
+	inline void image<pixel>::transverse()
+	{
+		const bool reversed = orientation == LEFT_TOP;
+		transpose_layout(!reversed, !reversed);
+	}
+
+	template<class pixel>
+	inline void image<pixel>::rotate(rotation_value rotation)
+	{
+		const bool reversed = orientation == LEFT_TOP;
+		switch (rotation)
+		{
+		case ROTATE_90:
+			transpose_layout(reversed, !reversed);
+			break;
+
+		case ROTATE_180:
+			std::reverse(pixels.begin(), pixels.end());
+			break;
+
+		case ROTATE_270:
+			transpose_layout(!reversed, reversed);
+			break;
+		}
 	}
 
+	template<class pixel>
+	inline void image<pixel>::transpose_layout(bool flip_rows, bool flip_columns)
+	{
+		// square images are transposed in place, the others need a second buffer
+		if (width == height)
+		{
+			detail::transpose_square_inplace(pixels.data(), width);
+			detail::flip_inplace(pixels.data(), width, height, flip_columns, flip_rows);
+			return;
+		}
+
+		pixelvec transposed(pixels.size());
+		detail::transpose_blocked(pixels.data(), width, height, transposed.data(), flip_rows, flip_columns);
+		pixels = std::move(transposed);
+		std::swap(width, height);
+	}
+
+	// threads splits the conversion in cache sized ranges, 0 asks for one worker per hardware thread
 	template<class pixelto, class pixelfrom>
-	image<pixelto> image_convert(const image<pixelfrom>& source)
+	image<pixelto> image_convert(const image<pixelfrom>& source, unsigned threads = 1)
+	{
+		auto ret = image<pixelto>::create(source.width, source.height, pixel_convert<pixelto>(source.pixels, threads));
+		ret.orientation = static_cast<typename image<pixelto>::orientation_value>(source.orientation);
+		return ret;
+	}
+
+	// drops alpha compositing the image over an opaque background color
+	template<pixel_type pixelto, pixel_type pixelfrom, std::enable_if_t<pixel_is32bit<pixelfrom> && pixel_is24bit<pixelto>, int> = 0>
+	image<pixelto> image_flatten(const image<pixelfrom>& source, const pixelto& background)
+	{
+		auto ret = image<pixelto>::create(source.width, source.height);
+		ret.orientation = static_cast<typename image<pixelto>::orientation_value>(source.orientation);
+
+		// blending small chunks keeps the temporary buffer in cache
+		std::array<pixelfrom, 256> chunk;
+		const auto bg = pixel_cast<pixelfrom>(background);
+		for (size_t i = 0; i < source.pixels.size(); i += chunk.size())
+		{
+			const auto count = std::min(chunk.size(), source.pixels.size() - i);
+			std::fill_n(chunk.data(), count, bg);
+			blend_pixels(source.pixels.data() + i, chunk.data(), count, BLEND_SRC_OVER);
+			pixel_convert(chunk.data(), ret.pixels.data() + i, count);
+		}
+
+		return ret;
+	}
+
+	template<pixel_type pixel, std::enable_if_t<pixel_is32bit<pixel>, int> = 0>
+	void image_premultiply(image<pixel>& source)
 	{
-		auto pixels = pixel_convert<pixelto>(source.pixels);
-		return image<pixelto>::create(source.width, source.height, std::move(pixels));
+		premultiply_pixels(source.pixels.data(), source.pixels.size());
+	}
+
+	template<pixel_type pixel, std::enable_if_t<pixel_is32bit<pixel>, int> = 0>
+	void image_unpremultiply(image<pixel>& source)
+	{
+		unpremultiply_pixels(source.pixels.data(), source.pixels.size());
+	}
+
+	namespace detail
+	{
+		// storage row holding the top-left based row y
+		template<pixel_type pixel>
+		inline const pixel* image_top_row(const image<pixel>& img, uint32_t y)
+		{
+			const size_t row = img.orientation == image<pixel>::LEFT_TOP ? img.height - 1 - y : y;
+			return img.pixels.data() + row * img.width;
+		}
+
+		template<pixel_type pixel>
+		inline pixel* image_top_row(image<pixel>& img, uint32_t y)
+		{
+			return const_cast<pixel*>(image_top_row(static_cast<const image<pixel>&>(img), y));
+		}
+
+		// turns the outcome of a decoding function into a result, failures are recorded in the decoder
+		template<pixel_type pixel, class decoder_t>
+		inline result<image<pixel>> decoded_image(const decoder_t& decoder, bool decoded, typename image<pixel>::size width, typename image<pixel>::size height, std::vector<pixel>&& pixels)
+		{
+			if(!decoded || decoder.failed())
+				return decoder.get_error();
+			IMPP_INSTRUMENT_SUCCEEDED();
+			return image<pixel>::create(width, height, std::move(pixels));
+		}
 	}
 }
 
@@ -0,0 +1,339 @@
+#pragma once
+#ifndef INCLUDE_IMPLUSPLUS_INSTRUMENT_HPP
+#define INCLUDE_IMPLUSPLUS_INSTRUMENT_HPP
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+
+// load/save calls report what they did to a sink when IMPP_ENABLE_INSTRUMENTATION is defined
+// without it the IMPP_INSTRUMENT_* macros expand to nothing and the codecs are left untouched
+namespace impp
+{
+	namespace instrument
+	{
+		enum stage : uint8_t {
+			STAGE_IO = 0,       // reading/writing files
+			STAGE_HEADER,       // header, color map and palette parsing
+			STAGE_DECODE,       // pixel decoding, conversion to the requested pixel is fused in it
+			STAGE_CONVERT,      // standalone pixel conversions
+			STAGE_PALETTE,      // palette building
+			STAGE_ENCODE,       // pixel encoding
+			STAGE_COUNT
+		};
+
+		constexpr const char* stage_name(stage value)
+		{
+			constexpr const char* names[] = { "io", "header", "decode", "convert", "palette", "encode" };
+			return value < STAGE_COUNT ? names[value] : "unknown";
+		}
+
+		// everything measured during a single public load/save call
+		struct call_report
+		{
+			const char* format = "";
+			const char* operation = "";
+			bool succeeded = false;
+			uint64_t total_ns = 0;
+			std::array<uint64_t, STAGE_COUNT> stage_ns{};
+
+			uint64_t bytes_read = 0;
+			uint64_t bytes_written = 0;
+			uint64_t rle_run_packets = 0;
+			uint64_t rle_raw_packets = 0;
+			uint64_t rle_run_pixels = 0;
+			uint64_t rle_raw_pixels = 0;
+			uint64_t palette_size = 0;
+			uint64_t allocations = 0;
+			uint64_t allocated_bytes = 0;
+
+			// share of the rle pixels coming from run packets
+			double rle_run_ratio() const
+			{
+				const auto total = rle_run_pixels + rle_raw_pixels;
+				return total ? static_cast<double>(rle_run_pixels) / total : 0.0;
+			}
+		};
+
+		using sink = std::function<void(const call_report&)>;
+
+		namespace detail
+		{
+			// set_sink may run while other threads report, calls keep the sink they read alive
+			struct sink_holder
+			{
+				static inline std::mutex _mutex;
+				static inline std::shared_ptr<const sink> _sink;
+
+				static std::shared_ptr<const sink> get()
+				{
+					std::lock_guard lock(_mutex);
+					return _sink;
+				}
+
+				static void set(std::shared_ptr<const sink> value)
+				{
+					std::lock_guard lock(_mutex);
+					_sink.swap(value);
+				}
+			};
+
+			// report of the outermost instrumented call running on this thread
+			inline thread_local call_report* current = nullptr;
+
+			inline uint64_t now_ns()
+			{
+				return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+					std::chrono::steady_clock::now().time_since_epoch()).count());
+			}
+
+			// nested calls (e.g. a file load going through the memory one) are merged in the outer report
+			class call_scope
+			{
+			public:
+				call_scope(const char* format, const char* operation)
+				{
+					if(current || !sink_holder::get())
+						return;
+					_report.format = format;
+					_report.operation = operation;
+					_begin = now_ns();
+					current = &_report;
+				}
+
+				call_scope(const call_scope&) = delete;
+				call_scope& operator=(const call_scope&) = delete;
+
+				~call_scope()
+				{
+					if(current != &_report)
+						return;
+					_report.total_ns = now_ns() - _begin;
+					current = nullptr;
+					if(const auto func = sink_holder::get())
+						(*func)(_report);
+				}
+
+			private:
+				call_report _report;
+				uint64_t _begin = 0;
+			};
+
+			// stages are exclusive: a nested stage pauses the enclosing one until it ends
+			class stage_scope
+			{
+			public:
+				explicit stage_scope(stage value) : _report(current), _stage(value)
+				{
+					if(!_report)
+						return;
+					_begin = now_ns();
+					_parent = active;
+					if(_parent)
+						_report->stage_ns[_parent->_stage] += _begin - _parent->_begin;
+					active = this;
+				}
+
+				stage_scope(const stage_scope&) = delete;
+				stage_scope& operator=(const stage_scope&) = delete;
+
+				~stage_scope()
+				{
+					if(!_report)
+						return;
+					const auto end = now_ns();
+					_report->stage_ns[_stage] += end - _begin;
+					active = _parent;
+					if(_parent)
+						_parent->_begin = end;
+				}
+
+			private:
+				static inline thread_local stage_scope* active = nullptr;
+
+				call_report* _report;
+				stage_scope* _parent = nullptr;
+				stage _stage;
+				uint64_t _begin = 0;
+			};
+
+			inline void count(uint64_t call_report::* field, uint64_t value)
+			{
+				if(current)
+					current->*field += value;
+			}
+
+			inline void maximum(uint64_t call_report::* field, uint64_t value)
+			{
+				if(current)
+					current->*field = std::max(current->*field, value);
+			}
+
+			// used by calls discovering the format while running
+			inline void format(const char* name)
+			{
+				if(current)
+					current->format = name;
+			}
+
+			inline void succeeded()
+			{
+				if(current)
+					current->succeeded = true;
+			}
+		}
+
+		//method used to set the report sink - an empty function disables reporting, it is safe to call while other threads report
+		inline void set_sink(sink func)
+		{
+			detail::sink_holder::set(func ? std::make_shared<const sink>(std::move(func)) : nullptr);
+		}
+
+		// ready-made sink aggregating reports per format and operation
+		// it is not copyable, use set_sink(std::ref(histograms)) to install it
+		class histogram_sink
+		{
+		public:
+			// log2 buckets of nanoseconds, the last one gathers everything above 2^39 ns
+			static constexpr size_t bucket_count = 40;
+
+			struct histogram
+			{
+				uint64_t count = 0;
+				uint64_t total = 0;
+				uint64_t min = UINT64_MAX;
+				uint64_t max = 0;
+				std::array<uint64_t, bucket_count> buckets{};
+
+				void add(uint64_t value)
+				{
+					count++;
+					total += value;
+					min = std::min(min, value);
+					max = std::max(max, value);
+					buckets[std::min<size_t>(std::bit_width(value), bucket_count - 1)]++;
+				}
+
+				// upper bound of the bucket holding the requested percentile
+				uint64_t percentile(double p) const
+				{
+					const auto target = static_cast<uint64_t>(p * count);
+					uint64_t seen = 0;
+					for(size_t i = 0; i < bucket_count; i++)
+					{
+						seen += buckets[i];
+						if(seen > target)
+							return std::min(max, (uint64_t(1) << i) - 1);
+					}
+					return max;
+				}
+			};
+
+			struct entry
+			{
+				uint64_t calls = 0;
+				uint64_t failures = 0;
+				histogram total;
+				std::array<histogram, STAGE_COUNT> stages;
+				uint64_t bytes_read = 0;
+				uint64_t bytes_written = 0;
+				uint64_t rle_run_packets = 0;
+				uint64_t rle_raw_packets = 0;
+				uint64_t rle_run_pixels = 0;
+				uint64_t rle_raw_pixels = 0;
+				uint64_t palette_max = 0;
+				uint64_t allocations = 0;
+				uint64_t allocated_bytes = 0;
+			};
+
+			void operator()(const call_report& report)
+			{
+				std::lock_guard<std::mutex> lock(_mutex);
+				auto& e = _entries[std::string(report.format) + "/" + report.operation];
+				e.calls++;
+				e.failures += report.succeeded ? 0 : 1;
+				e.total.add(report.total_ns);
+				for(size_t i = 0; i < STAGE_COUNT; i++)
+					if(report.stage_ns[i])
+						e.stages[i].add(report.stage_ns[i]);
+				e.bytes_read += report.bytes_read;
+				e.bytes_written += report.bytes_written;
+				e.rle_run_packets += report.rle_run_packets;
+				e.rle_raw_packets += report.rle_raw_packets;
+				e.rle_run_pixels += report.rle_run_pixels;
+				e.rle_raw_pixels += report.rle_raw_pixels;
+				e.palette_max = std::max(e.palette_max, report.palette_size);
+				e.allocations += report.allocations;
+				e.allocated_bytes += report.allocated_bytes;
+			}
+
+			// entries are keyed by "format/operation"
+			std::map<std::string, entry> snapshot() const
+			{
+				std::lock_guard<std::mutex> lock(_mutex);
+				return _entries;
+			}
+
+			void clear()
+			{
+				std::lock_guard<std::mutex> lock(_mutex);
+				_entries.clear();
+			}
+
+			void print(std::ostream& out) const
+			{
+				for(const auto& [name, e] : snapshot())
+				{
+					out << name << ": " << e.calls << " calls, " << e.failures << " failed, mean " << e.total.total / std::max<uint64_t>(e.total.count, 1)
+						<< " ns, p50 <= " << e.total.percentile(0.5) << " ns, p99 <= " << e.total.percentile(0.99) << " ns, max " << e.total.max << " ns\n";
+					for(size_t i = 0; i < STAGE_COUNT; i++)
+						if(e.stages[i].count)
+							out << "  " << stage_name(static_cast<stage>(i)) << ": mean " << e.stages[i].total / e.stages[i].count << " ns\n";
+					out << "  read " << e.bytes_read << " bytes, wrote " << e.bytes_written << " bytes, " << e.allocations << " allocations (" << e.allocated_bytes << " bytes)\n";
+					if(e.rle_run_packets + e.rle_raw_packets)
+						out << "  rle " << e.rle_run_packets << " run / " << e.rle_raw_packets << " raw packets, "
+							<< e.rle_run_pixels << " run / " << e.rle_raw_pixels << " raw pixels\n";
+					if(e.palette_max)
+						out << "  largest palette " << e.palette_max << " colors\n";
+				}
+			}
+
+		private:
+			mutable std::mutex _mutex;
+			std::map<std::string, entry> _entries;
+		};
+	}
+}
+
+#define IMPP_INSTRUMENT_CONCAT_IMPL(a, b) a##b
+#define IMPP_INSTRUMENT_CONCAT(a, b) IMPP_INSTRUMENT_CONCAT_IMPL(a, b)
+
+#if defined(IMPP_ENABLE_INSTRUMENTATION)
+// opens the report of a public call, it is delivered to the sink when the scope ends
+#define IMPP_INSTRUMENT_CALL(format, operation) ::impp::instrument::detail::call_scope impp_instrument_call(format, operation)
+// times the rest of the enclosing scope as the given stage
+#define IMPP_INSTRUMENT_STAGE(value) ::impp::instrument::detail::stage_scope IMPP_INSTRUMENT_CONCAT(impp_instrument_stage_, __LINE__)(::impp::instrument::value)
+#define IMPP_INSTRUMENT_COUNT(field, value) ::impp::instrument::detail::count(&::impp::instrument::call_report::field, static_cast<uint64_t>(value))
+#define IMPP_INSTRUMENT_MAX(field, value) ::impp::instrument::detail::maximum(&::impp::instrument::call_report::field, static_cast<uint64_t>(value))
+#define IMPP_INSTRUMENT_ALLOCATION(bytes) (IMPP_INSTRUMENT_COUNT(allocations, 1), IMPP_INSTRUMENT_COUNT(allocated_bytes, bytes))
+#define IMPP_INSTRUMENT_SUCCEEDED() ::impp::instrument::detail::succeeded()
+#define IMPP_INSTRUMENT_FORMAT(name) ::impp::instrument::detail::format(name)
+#else
+// arguments are not evaluated when instrumentation is disabled
+#define IMPP_INSTRUMENT_CALL(format, operation) ((void)0)
+#define IMPP_INSTRUMENT_STAGE(value) ((void)0)
+#define IMPP_INSTRUMENT_COUNT(field, value) ((void)0)
+#define IMPP_INSTRUMENT_MAX(field, value) ((void)0)
+#define IMPP_INSTRUMENT_ALLOCATION(bytes) ((void)0)
+#define IMPP_INSTRUMENT_SUCCEEDED() ((void)0)
+#define IMPP_INSTRUMENT_FORMAT(name) ((void)0)
+#endif
+
+#endif //INCLUDE_IMPLUSPLUS_INSTRUMENT_HPP
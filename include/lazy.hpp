@@ -0,0 +1,203 @@
+/*
+MIT License
+
+Copyright (c) 2022 IkarusDeveloper
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#pragma once
+#ifndef INCLUDE_IMPLUSPLUS_LAZY_HPP
+#define INCLUDE_IMPLUSPLUS_LAZY_HPP
+#include "image.hpp"
+
+#include <chrono>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <vector>
+#include "codec.hpp"
+#include "error.hpp"
+
+namespace impp
+{
+	// an image known by its header, the pixels are decoded once on the first access from any thread
+	// copies share the source and the decoded pixels, which can be released and decoded again later
+	template<pixel_type pixel>
+	class lazy_image
+	{
+	public:
+		using handle = std::shared_ptr<const image<pixel>>;
+
+		lazy_image() = default;
+
+		static result<lazy_image> try_open(const std::string& filename)
+		{
+			auto info = try_probe(filename);
+			if (!info)
+				return info.get_error();
+			auto opened = std::make_shared<state>(*info);
+			opened->filename = filename;
+			return lazy_image(std::move(opened));
+		}
+
+		// the memory is not copied, it must outlive every copy of the image like a mapped file region does
+		static result<lazy_image> try_open_memory(const void* memory, size_t size)
+		{
+			auto info = try_probe_memory(memory, size);
+			if (!info)
+				return info.get_error();
+			auto opened = std::make_shared<state>(*info);
+			opened->memory = memory;
+			opened->size = size;
+			return lazy_image(std::move(opened));
+		}
+
+		// the encoded data is kept by the image
+		static result<lazy_image> try_open_memory(std::vector<uint8_t> bytes)
+		{
+			auto info = try_probe_memory(bytes.data(), bytes.size());
+			if (!info)
+				return info.get_error();
+			auto opened = std::make_shared<state>(*info);
+			opened->owned = std::move(bytes);
+			opened->memory = opened->owned.data();
+			opened->size = opened->owned.size();
+			return lazy_image(std::move(opened));
+		}
+
+		// open functions return an empty image on failure, errors found in the data are forwarded to the error handler
+
+		static lazy_image open(const std::string& filename)
+		{
+			auto res = try_open(filename);
+			return error::detail::report(res) ? std::move(res).value() : lazy_image{};
+		}
+
+		static lazy_image open_memory(const void* memory, size_t size)
+		{
+			auto res = try_open_memory(memory, size);
+			return error::detail::report(res) ? std::move(res).value() : lazy_image{};
+		}
+
+		bool empty() const { return _state == nullptr; }
+		const image_info& get_info() const { return _state ? _state->info : _empty_info; }
+		uint32_t get_width() const { return get_info().width; }
+		uint32_t get_height() const { return get_info().height; }
+		const char* get_format() const { return get_info().format; }
+
+		// decodes on the first call, the others wait for it; a failure is returned again until release
+		result<handle> try_get() const
+		{
+			if (!_state)
+				return error::error_info{ error::ERROR_INVALID_ARGUMENT, 0, "lazy: empty image." };
+			std::lock_guard lock(_state->mutex);
+			return _state->decode();
+		}
+
+		// returns a null handle on failure, errors found in the data are forwarded to the error handler
+		handle get() const
+		{
+			auto res = try_get();
+			return error::detail::report(res) ? std::move(res).value() : handle{};
+		}
+
+		bool is_decoded() const
+		{
+			if (!_state)
+				return false;
+			std::lock_guard lock(_state->mutex);
+			return _state->decoded != nullptr;
+		}
+
+		// starts decoding on another thread, accesses made meanwhile wait for it
+		void prefetch() const
+		{
+			if (!_state)
+				return;
+			std::lock_guard lock(_state->mutex);
+			auto& pending = _state->prefetching;
+			if (_state->decoded || _state->failure || (pending.valid() && pending.wait_for(std::chrono::seconds(0)) != std::future_status::ready))
+				return;
+			pending = std::async(std::launch::async, [decoding = _state.get()] {
+				std::lock_guard lock(decoding->mutex);
+				decoding->decode();
+			});
+		}
+
+		// drops the decoded pixels under memory pressure, handles given out keep theirs alive
+		// returns the bytes held by the pixels, the next access decodes them again
+		size_t release() const
+		{
+			if (!_state)
+				return 0;
+			std::lock_guard lock(_state->mutex);
+			const size_t bytes = _state->decoded ? _state->decoded->pixels.size() * sizeof(pixel) : 0;
+			_state->decoded.reset();
+			_state->failure.reset();
+			return bytes;
+		}
+
+	private:
+		struct state
+		{
+			explicit state(const image_info& probed) : info(probed) {}
+
+			// called with the mutex held
+			result<handle> decode()
+			{
+				if (decoded)
+					return decoded;
+				if (failure)
+					return *failure;
+
+				auto res = filename.empty() ? impp::try_load_memory<pixel>(memory, size) : impp::try_load<pixel>(filename);
+				if (res && (res->width != info.width || res->height != info.height))
+					res = error::error_info{ error::ERROR_INVALID_HEADER, 0, "lazy: the image changed since it was opened.", true };
+				if (!res)
+				{
+					failure = res.get_error();
+					return *failure;
+				}
+				decoded = std::make_shared<const image<pixel>>(std::move(res).value());
+				return decoded;
+			}
+
+			const image_info info;
+			std::string filename;
+			std::vector<uint8_t> owned;
+			const void* memory = nullptr;
+			size_t size = 0;
+
+			std::mutex mutex;
+			handle decoded;
+			std::optional<error::error_info> failure;
+			// destroyed first, waiting for a decoding still running in the background
+			std::future<void> prefetching;
+		};
+
+		explicit lazy_image(std::shared_ptr<state> opened) : _state(std::move(opened)) {}
+
+		static inline const image_info _empty_info{};
+		std::shared_ptr<state> _state;
+	};
+}
+
+#endif //INCLUDE_IMPLUSPLUS_LAZY_HPP
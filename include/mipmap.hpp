@@ -0,0 +1,395 @@
+/*
+MIT License
+
+Copyright (c) 2022 IkarusDeveloper
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#pragma once
+#ifndef INCLUDE_IMPLUSPLUS_MIPMAP_HPP
+#define INCLUDE_IMPLUSPLUS_MIPMAP_HPP
+#include "image.hpp"
+
+#include <string.h>
+#include <stdint.h>
+#include <algorithm>
+#include <cmath>
+#include <vector>
+#include "pixel.hpp"
+#include "parallel.hpp"
+#include "simd.hpp"
+
+namespace impp
+{
+	enum mipmap_filter {
+		MIPMAP_BOX = 0,     // area average of the covered pixels
+		MIPMAP_KAISER,      // kaiser windowed sinc, radius 3, alpha 4
+		MIPMAP_LANCZOS,     // lanczos 3
+	};
+
+	// every level of a pyramid in a single allocation, level 0 has the full size and each next one
+	// halves both sides rounding down until 1x1; rows are stored bottom-up as in image
+	template<pixel_type pixel>
+	class mipmap_chain
+	{
+	public:
+		struct level
+		{
+			uint32_t width = 0;
+			uint32_t height = 0;
+			size_t offset = 0;      // first pixel of the level in get_pixels()
+		};
+
+		// count limits the number of levels, 0 keeps all of them
+		static mipmap_chain create(uint32_t width, uint32_t height, size_t count = 0)
+		{
+			mipmap_chain chain;
+			if (width == 0 || height == 0)
+				return chain;
+
+			size_t total = 0;
+			for (;;)
+			{
+				chain._levels.push_back({ width, height, total });
+				total += static_cast<size_t>(width) * height;
+				if ((width == 1 && height == 1) || chain._levels.size() == count)
+					break;
+				width = std::max(width / 2, 1u);
+				height = std::max(height / 2, 1u);
+			}
+			chain._pixels.resize(total);
+			return chain;
+		}
+
+		// levels a full chain of a width x height image has
+		static size_t get_full_count(uint32_t width, uint32_t height)
+		{
+			size_t count = 1;
+			for (auto side = std::max(width, height); side > 1; side /= 2)
+				count++;
+			return count;
+		}
+
+		bool empty() const { return _levels.empty(); }
+		size_t get_level_count() const { return _levels.size(); }
+		const level& get_level(size_t index) const { return _levels[index]; }
+		pixel* get_level_pixels(size_t index) { return _pixels.data() + _levels[index].offset; }
+		const pixel* get_level_pixels(size_t index) const { return _pixels.data() + _levels[index].offset; }
+		const std::vector<pixel>& get_pixels() const { return _pixels; }
+
+		// copy of a level as a standalone image
+		image<pixel> get_image(size_t index) const
+		{
+			const auto& lvl = _levels[index];
+			const auto* begin = get_level_pixels(index);
+			return image<pixel>::create(lvl.width, lvl.height, std::vector<pixel>(begin, begin + static_cast<size_t>(lvl.width) * lvl.height));
+		}
+
+	private:
+		std::vector<level> _levels;
+		std::vector<pixel> _pixels;
+	};
+
+	namespace detail
+	{
+		// source pixels and weights of every output pixel along one axis
+		struct mip_taps
+		{
+			size_t count = 0;               // taps per output pixel
+			std::vector<uint32_t> index;
+			std::vector<float> weight;
+		};
+
+		inline float mip_sinc(float x)
+		{
+			constexpr float pi = 3.14159265358979f;
+			return x == 0.0f ? 1.0f : std::sin(pi * x) / (pi * x);
+		}
+
+		// modified bessel function of the first kind, order 0
+		inline float mip_bessel0(float x)
+		{
+			float sum = 1.0f, term = 1.0f;
+			for (int k = 1; k < 32 && term > sum * 1e-8f; k++)
+			{
+				term *= (x / (2.0f * k)) * (x / (2.0f * k));
+				sum += term;
+			}
+			return sum;
+		}
+
+		constexpr float mip_support = 3.0f;
+
+		inline float mip_kernel(mipmap_filter filter, float x)
+		{
+			x = std::fabs(x);
+			if (x >= mip_support)
+				return 0.0f;
+			if (filter == MIPMAP_LANCZOS)
+				return mip_sinc(x) * mip_sinc(x / mip_support);
+
+			constexpr float alpha = 4.0f;
+			const float t = x / mip_support;
+			return mip_sinc(x) * mip_bessel0(alpha * std::sqrt(1.0f - t * t)) / mip_bessel0(alpha);
+		}
+
+		// box weights are the exact overlap of each source pixel with the output one, which keeps odd sides
+		// correct (3 taps per pixel); the other filters are stretched over the scale and clamped at the edges
+		inline mip_taps mip_make_taps(uint32_t src, uint32_t dst, mipmap_filter filter)
+		{
+			mip_taps taps;
+			const double scale = static_cast<double>(src) / dst;
+			const double radius = filter == MIPMAP_BOX ? scale / 2 : mip_support * scale;
+			taps.count = static_cast<size_t>(std::ceil(radius * 2)) + 1;
+			taps.index.resize(taps.count * dst);
+			taps.weight.resize(taps.count * dst);
+
+			for (uint32_t x = 0; x < dst; x++)
+			{
+				const double center = (x + 0.5) * scale;
+				const auto first = static_cast<int64_t>(std::floor(center - radius));
+				double sum = 0;
+				for (size_t k = 0; k < taps.count; k++)
+				{
+					const int64_t i = first + static_cast<int64_t>(k);
+					double w;
+					if (filter == MIPMAP_BOX)
+						w = std::max(0.0, std::min<double>(i + 1, center + radius) - std::max<double>(i, center - radius));
+					else
+						w = mip_kernel(filter, static_cast<float>((i + 0.5 - center) / scale));
+					taps.index[x * taps.count + k] = static_cast<uint32_t>(std::clamp<int64_t>(i, 0, src - 1));
+					taps.weight[x * taps.count + k] = static_cast<float>(w);
+					sum += w;
+				}
+				for (size_t k = 0; k < taps.count; k++)
+					taps.weight[x * taps.count + k] = static_cast<float>(taps.weight[x * taps.count + k] / sum);
+			}
+			return taps;
+		}
+
+		// 8 floats per pixel: colors weighted by alpha, alpha, plain colors for fully transparent areas;
+		// the source row is expanded once so every tap is a plain multiply add of 8 lanes
+		template<pixel_type pixel>
+		inline void mip_filter_row(const pixel* src, uint32_t sw, const mip_taps& h, uint32_t dw, float* expanded, float* out)
+		{
+			for (uint32_t x = 0; x < sw; x++)
+			{
+				const auto px = pixel_cast<pixel32rgba>(src[x]);
+				const float a = pixel_is32bit<pixel> ? px.a : 1.0f;
+				float* e = expanded + x * 8;
+				e[0] = px.r * a; e[1] = px.g * a; e[2] = px.b * a; e[3] = a;
+				e[4] = px.r; e[5] = px.g; e[6] = px.b; e[7] = 0.0f;
+			}
+			for (uint32_t x = 0; x < dw; x++, out += 8)
+			{
+				float sum[8] = {};
+				for (size_t k = 0; k < h.count; k++)
+				{
+					const float w = h.weight[x * h.count + k];
+					const float* e = expanded + h.index[x * h.count + k] * 8;
+					for (int c = 0; c < 8; c++)
+						sum[c] += e[c] * w;
+				}
+				std::copy_n(sum, 8, out);
+			}
+		}
+
+		// separable resampling of rows [begin, end) of the output, horizontally filtered source rows are kept
+		// in a small ring since neighboring output rows share most of their taps
+		template<pixel_type pixel>
+		inline void mip_resample_rows(const pixel* src, uint32_t sw, pixel* dst, uint32_t dw, const mip_taps& h, const mip_taps& v, size_t begin, size_t end)
+		{
+			const size_t slots = v.count + 2;
+			std::vector<float> ring(slots * dw * 8);
+			std::vector<int64_t> tags(slots, -1);
+			std::vector<float> acc(static_cast<size_t>(dw) * 8);
+			std::vector<float> expanded(static_cast<size_t>(sw) * 8);
+
+			for (size_t y = begin; y < end; y++)
+			{
+				std::fill(acc.begin(), acc.end(), 0.0f);
+				for (size_t k = 0; k < v.count; k++)
+				{
+					const float w = v.weight[y * v.count + k];
+					if (w == 0.0f)
+						continue;
+					const uint32_t row = v.index[y * v.count + k];
+					const size_t slot = row % slots;
+					float* filtered = ring.data() + slot * dw * 8;
+					if (tags[slot] != row)
+					{
+						mip_filter_row(src + static_cast<size_t>(row) * sw, sw, h, dw, expanded.data(), filtered);
+						tags[slot] = row;
+					}
+					for (size_t i = 0; i < acc.size(); i++)
+						acc[i] += filtered[i] * w;
+				}
+
+				auto* out = dst + y * dw;
+				for (uint32_t x = 0; x < dw; x++)
+				{
+					const float* p = acc.data() + x * 8;
+					const float a = p[3];
+					auto channel = [](float value) { return static_cast<uint8_t>(std::clamp(value, 0.0f, 255.0f) + 0.5f); };
+					pixel32rgba px;
+					if (a >= (pixel_is32bit<pixel> ? 0.5f : 1e-6f))
+						px = { channel(p[0] / a), channel(p[1] / a), channel(p[2] / a), channel(a) };
+					else
+						px = { channel(p[4]), channel(p[5]), channel(p[6]), 0 };
+					out[x] = pixel_cast<pixel>(px);
+				}
+			}
+		}
+
+		// averages 4 pixels, colors weighted by alpha unless all of them are transparent
+		inline pixel32rgba mip_average4(const pixel32rgba& p0, const pixel32rgba& p1, const pixel32rgba& p2, const pixel32rgba& p3)
+		{
+			const uint32_t asum = p0.a + p1.a + p2.a + p3.a;
+			auto channel = [&](uint8_t pixel32rgba::*c) {
+				if (asum == 0)
+					return static_cast<uint8_t>((p0.*c + p1.*c + p2.*c + p3.*c + 2) / 4);
+				return static_cast<uint8_t>((p0.a * p0.*c + p1.a * p1.*c + p2.a * p2.*c + p3.a * p3.*c + asum / 2) / asum);
+			};
+			return { channel(&pixel32rgba::r), channel(&pixel32rgba::g), channel(&pixel32rgba::b), static_cast<uint8_t>((asum + 2) / 4) };
+		}
+
+#ifdef IMPP_SIMD_SSE2
+		// the 2x2 average of two pixels of a row pair, 4 float lanes per pixel; sums stay below 2^24 so
+		// the float division rounds exactly as the integer one of mip_average4
+		inline __m128i simd_mip_average4(__m128 p0, __m128 p1, __m128 p2, __m128 p3)
+		{
+			auto alpha = [](__m128 p) { return _mm_shuffle_ps(p, p, _MM_SHUFFLE(3, 3, 3, 3)); };
+			const __m128 plain = _mm_add_ps(_mm_add_ps(p0, p1), _mm_add_ps(p2, p3));
+			const __m128 weighted = _mm_add_ps(_mm_add_ps(_mm_mul_ps(p0, alpha(p0)), _mm_mul_ps(p1, alpha(p1))),
+				_mm_add_ps(_mm_mul_ps(p2, alpha(p2)), _mm_mul_ps(p3, alpha(p3))));
+			const __m128 asum = alpha(plain);
+			const __m128 opaque = _mm_cmpgt_ps(asum, _mm_setzero_ps());
+			const __m128 quarter = _mm_mul_ps(plain, _mm_set1_ps(0.25f));
+			__m128 value = _mm_div_ps(weighted, _mm_max_ps(asum, _mm_set1_ps(1.0f)));
+			value = _mm_or_ps(_mm_and_ps(opaque, value), _mm_andnot_ps(opaque, quarter));
+			// the alpha lane is always the plain average
+			const __m128 alpha_lane = _mm_castsi128_ps(_mm_set_epi32(-1, 0, 0, 0));
+			value = _mm_or_ps(_mm_and_ps(alpha_lane, quarter), _mm_andnot_ps(alpha_lane, value));
+			return _mm_cvttps_epi32(_mm_add_ps(value, _mm_set1_ps(0.5f)));
+		}
+#endif
+
+		// 2x2 box of rows [begin, end) of the output when both source sides are even, a single fused pass
+		template<pixel_type pixel>
+		inline void mip_box_rows(const pixel* src, uint32_t sw, pixel* dst, uint32_t dw, size_t begin, size_t end)
+		{
+			for (size_t y = begin; y < end; y++)
+			{
+				const pixel* r0 = src + y * 2 * sw;
+				const pixel* r1 = r0 + sw;
+				pixel* out = dst + y * dw;
+				uint32_t x = 0;
+
+				if constexpr (pixel_is32bit<pixel>)
+				{
+#ifdef IMPP_SIMD_SSE2
+					const __m128i zero = _mm_setzero_si128();
+					auto lanes = [&](__m128i pixels16, bool high) {
+						return _mm_cvtepi32_ps(high ? _mm_unpackhi_epi16(pixels16, zero) : _mm_unpacklo_epi16(pixels16, zero));
+					};
+					for (; x + 2 <= dw; x += 2)
+					{
+						const __m128i top = _mm_loadu_si128(reinterpret_cast<const __m128i*>(r0 + x * 2));
+						const __m128i bottom = _mm_loadu_si128(reinterpret_cast<const __m128i*>(r1 + x * 2));
+						const __m128i tlo = _mm_unpacklo_epi8(top, zero), thi = _mm_unpackhi_epi8(top, zero);
+						const __m128i blo = _mm_unpacklo_epi8(bottom, zero), bhi = _mm_unpackhi_epi8(bottom, zero);
+						const __m128i d0 = simd_mip_average4(lanes(tlo, false), lanes(tlo, true), lanes(blo, false), lanes(blo, true));
+						const __m128i d1 = simd_mip_average4(lanes(thi, false), lanes(thi, true), lanes(bhi, false), lanes(bhi, true));
+						const __m128i packed = _mm_packs_epi32(d0, d1);
+						_mm_storel_epi64(reinterpret_cast<__m128i*>(out + x), _mm_packus_epi16(packed, packed));
+					}
+#endif
+					// channels are averaged in place, the alpha is the 4th byte of both 32bit pixels
+					for (; x < dw; x++)
+					{
+						pixel32rgba p[4];
+						memcpy(&p[0], r0 + x * 2, sizeof(pixel32rgba));
+						memcpy(&p[1], r0 + x * 2 + 1, sizeof(pixel32rgba));
+						memcpy(&p[2], r1 + x * 2, sizeof(pixel32rgba));
+						memcpy(&p[3], r1 + x * 2 + 1, sizeof(pixel32rgba));
+						const auto avg = mip_average4(p[0], p[1], p[2], p[3]);
+						memcpy(out + x, &avg, sizeof(avg));
+					}
+				}
+				else
+				{
+					const auto* a = reinterpret_cast<const uint8_t*>(r0);
+					const auto* b = reinterpret_cast<const uint8_t*>(r1);
+					auto* o = reinterpret_cast<uint8_t*>(out);
+					for (; x < dw; x++, a += 6, b += 6, o += 3)
+						for (int c = 0; c < 3; c++)
+							o[c] = static_cast<uint8_t>((a[c] + a[c + 3] + b[c] + b[c + 3] + 2) / 4);
+				}
+			}
+		}
+
+		// output pixels from which a level is worth spreading over workers
+		constexpr size_t mip_parallel_pixels = 256 * 256;
+
+		// fills level index + 1 of the chain from level index
+		template<pixel_type pixel>
+		inline void mip_build_level(mipmap_chain<pixel>& chain, size_t index, mipmap_filter filter, unsigned threads)
+		{
+			const auto& from = chain.get_level(index);
+			const auto& to = chain.get_level(index + 1);
+			const pixel* src = chain.get_level_pixels(index);
+			pixel* dst = chain.get_level_pixels(index + 1);
+
+			const size_t pixels = static_cast<size_t>(to.width) * to.height;
+			const unsigned workers = pixels >= mip_parallel_pixels ? threads : 1;
+			const size_t grain = std::max<size_t>(1, 16384 / to.width);
+
+			if (filter == MIPMAP_BOX && from.width == to.width * 2 && from.height == to.height * 2)
+			{
+				parallel_for(to.height, grain, workers, [&](size_t begin, size_t end) {
+					mip_box_rows(src, from.width, dst, to.width, begin, end);
+				});
+				return;
+			}
+
+			const auto h = mip_make_taps(from.width, to.width, filter);
+			const auto v = mip_make_taps(from.height, to.height, filter);
+			parallel_for(to.height, grain, workers, [&](size_t begin, size_t end) {
+				mip_resample_rows(src, from.width, dst, to.width, h, v, begin, end);
+			});
+		}
+	}
+
+	// builds every level from the previous one; threads is the number of workers used on the large levels,
+	// 0 uses every hardware thread. An empty image gives an empty chain
+	template<pixel_type pixel>
+	inline mipmap_chain<pixel> make_mipmaps(const image<pixel>& source, mipmap_filter filter = MIPMAP_BOX, unsigned threads = 0)
+	{
+		if (source.width == 0 || source.height == 0 || source.pixels.size() != static_cast<size_t>(source.width) * source.height)
+			return {};
+
+		auto chain = mipmap_chain<pixel>::create(source.width, source.height);
+		std::copy(source.pixels.begin(), source.pixels.end(), chain.get_level_pixels(0));
+		for (size_t i = 0; i + 1 < chain.get_level_count(); i++)
+			detail::mip_build_level(chain, i, filter, threads);
+		return chain;
+	}
+}
+
+#endif //INCLUDE_IMPLUSPLUS_MIPMAP_HPP
@@ -0,0 +1,82 @@
+/*
+MIT License
+
+Copyright (c) 2022 IkarusDeveloper
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#pragma once
+#ifndef INCLUDE_IMPLUSPLUS_PARALLEL_HPP
+#define INCLUDE_IMPLUSPLUS_PARALLEL_HPP
+#include <stdint.h>
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+namespace impp
+{
+	namespace detail
+	{
+		// 0 asks for one worker per hardware thread
+		inline unsigned parallel_threads(unsigned threads)
+		{
+			if (threads == 0)
+				threads = std::thread::hardware_concurrency();
+			return std::max(threads, 1u);
+		}
+
+		// calls func(begin, end) on ranges of grain items covering [0, count), workers take the next range
+		// as they finish so uneven costs stay balanced, the calling thread works too
+		template<class func_type>
+		inline void parallel_for(size_t count, size_t grain, unsigned threads, func_type&& func)
+		{
+			grain = std::max<size_t>(grain, 1);
+			const size_t ranges = (count + grain - 1) / grain;
+			const auto workers = static_cast<unsigned>(std::min<size_t>(parallel_threads(threads), ranges));
+			if (workers <= 1)
+			{
+				if (count != 0)
+					func(size_t(0), count);
+				return;
+			}
+
+			std::atomic<size_t> next{ 0 };
+			auto work = [&]() {
+				for (;;)
+				{
+					const size_t begin = next.fetch_add(grain, std::memory_order_relaxed);
+					if (begin >= count)
+						return;
+					func(begin, std::min(count, begin + grain));
+				}
+			};
+
+			std::vector<std::thread> pool;
+			pool.reserve(workers - 1);
+			for (unsigned i = 1; i < workers; i++)
+				pool.emplace_back(work);
+			work();
+			for (auto& thread : pool)
+				thread.join();
+		}
+	}
+}
+
+#endif //INCLUDE_IMPLUSPLUS_PARALLEL_HPP
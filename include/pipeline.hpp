@@ -0,0 +1,354 @@
+/*
+MIT License
+
+Copyright (c) 2022 IkarusDeveloper
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#pragma once
+#ifndef INCLUDE_IMPLUSPLUS_PIPELINE_HPP
+#define INCLUDE_IMPLUSPLUS_PIPELINE_HPP
+#include "image.hpp"
+
+#include <stdint.h>
+#include <algorithm>
+#include <functional>
+#include <memory>
+#include <vector>
+#include "parallel.hpp"
+#include "tga.hpp"
+
+namespace impp
+{
+	namespace detail
+	{
+		// rows of a band are sized to stay in the cache while every step runs over them
+		constexpr size_t pipeline_band_bytes = 256 * 1024;
+	}
+
+	// operations recorded on a source image and run later in a single pass over bands of rows
+	// each row is read and converted once, goes through every step while in cache and is written once
+	// the source must outlive the pipeline unless it is moved into it
+	template<pixel_type _pixel>
+	class image_pipeline
+	{
+	public:
+		using pixel = _pixel;
+		using size = typename image<pixel>::size;
+		using orientation_value = typename image<pixel>::orientation_value;
+		// called with a row, its width and its top-left based y, from any worker when running on threads
+		using row_function = std::function<void(pixel* row, size width, size y)>;
+
+		template<pixel_type pixelfrom>
+		static image_pipeline from(const image<pixelfrom>& source)
+		{
+			image_pipeline ret(source.width, source.height, static_cast<orientation_value>(source.orientation));
+			const auto* pixels = source.pixels.data();
+			const size_t width = source.width;
+			ret._read = [pixels, width](size_t row, pixel* out) {
+				pixel_convert(pixels + row * width, out, width);
+			};
+			return ret;
+		}
+
+		template<pixel_type pixelfrom>
+		static image_pipeline from(image<pixelfrom>&& source)
+		{
+			image_pipeline ret(source.width, source.height, static_cast<orientation_value>(source.orientation));
+			auto owned = std::make_shared<const std::vector<pixelfrom>>(std::move(source.pixels));
+			const size_t width = ret._width;
+			ret._read = [owned, width](size_t row, pixel* out) {
+				pixel_convert(owned->data() + row * width, out, width);
+			};
+			return ret;
+		}
+
+		size get_width() const { return _width; }
+		size get_height() const { return _height; }
+		orientation_value get_orientation() const { return _orientation; }
+		bool empty() const { return _width == 0 || _height == 0; }
+
+		image_pipeline& vertical_mirror()
+		{
+			step added{};
+			added.kind = STEP_VERTICAL_MIRROR;
+			_steps.push_back(std::move(added));
+			return *this;
+		}
+
+		image_pipeline& horizontal_mirror()
+		{
+			step added{};
+			added.kind = STEP_HORIZONTAL_MIRROR;
+			_steps.push_back(std::move(added));
+			return *this;
+		}
+
+		// same coordinates and clipping as image::fill_rect
+		image_pipeline& fill_rect(size x, size y, size width, size height, const pixel& color)
+		{
+			step added{};
+			added.kind = STEP_FILL_RECT;
+			added.rect = image_region{ x, y, width, height };
+			added.color = color;
+			_steps.push_back(std::move(added));
+			return *this;
+		}
+
+		// same placement as image::overwrite, the pipeline keeps its own copy of the source
+		image_pipeline& overwrite(size x, size y, const image<pixel>& source, blend_mode mode = BLEND_NONE)
+		{
+			step added{};
+			added.kind = STEP_OVERWRITE;
+			added.rect = image_region{ x, y, source.width, source.height };
+			added.source = std::make_shared<const image<pixel>>(source);
+			added.mode = mode;
+			_steps.push_back(std::move(added));
+			return *this;
+		}
+
+		image_pipeline& transform_rows(row_function func)
+		{
+			step added{};
+			added.kind = STEP_ROWS;
+			added.func = std::move(func);
+			_steps.push_back(std::move(added));
+			return *this;
+		}
+
+		// threads splits the bands among workers, 0 asks for one per hardware thread
+		image<pixel> execute(unsigned threads = 1) const
+		{
+			auto ret = image<pixel>::create(_width, _height);
+			ret.orientation = _orientation;
+			auto* pixels = ret.pixels.data();
+			detail::parallel_for(_height, band_rows(), threads, [&](size_t begin, size_t end) {
+				for (size_t row = begin; row < end; row++)
+					run_row(row, pixels + row * _width);
+			});
+			return ret;
+		}
+
+		// calls sink(rows, first, count) with consecutive bands of storage rows in order, from the calling thread
+		// workers fill one band each before the sink is called on them
+		template<class sink_type>
+		void execute_bands(unsigned threads, sink_type&& sink) const
+		{
+			if (empty())
+				return;
+			const size_t rows = band_rows();
+			const size_t group = std::min<size_t>(rows * detail::parallel_threads(threads), _height);
+			std::vector<pixel> buffer(group * _width);
+			for (size_t first = 0; first < _height; first += group)
+			{
+				const size_t count = std::min<size_t>(group, _height - first);
+				detail::parallel_for(count, rows, threads, [&](size_t begin, size_t end) {
+					for (size_t row = begin; row < end; row++)
+						run_row(first + row, buffer.data() + row * _width);
+				});
+				sink(static_cast<const pixel*>(buffer.data()), first, count);
+			}
+		}
+
+	private:
+		enum step_kind : uint8_t {
+			STEP_VERTICAL_MIRROR = 0,
+			STEP_HORIZONTAL_MIRROR,
+			STEP_FILL_RECT,
+			STEP_OVERWRITE,
+			STEP_ROWS
+		};
+
+		struct step
+		{
+			step_kind kind = STEP_VERTICAL_MIRROR;
+			image_region rect{};
+			pixel color{};
+			blend_mode mode = BLEND_NONE;
+			std::shared_ptr<const image<pixel>> source;
+			row_function func;
+		};
+
+		image_pipeline(size width, size height, orientation_value orientation) :
+			_width(width),
+			_height(height),
+			_orientation(orientation)
+		{
+		}
+
+		size_t band_rows() const
+		{
+			return std::max<size_t>(detail::pipeline_band_bytes / (std::max<size_t>(_width, 1) * sizeof(pixel)), 1);
+		}
+
+		// out receives the storage row of the result
+		void run_row(size_t row, pixel* out) const
+		{
+			// vertical mirrors only change which source row is read
+			size_t current = row;
+			for (const auto& s : _steps)
+				if (s.kind == STEP_VERTICAL_MIRROR)
+					current = _height - 1 - current;
+			_read(current, out);
+
+			// the other steps see the row where it stands after the mirrors recorded before them
+			const bool reversed = _orientation == image<pixel>::LEFT_TOP;
+			for (const auto& s : _steps)
+			{
+				const size_t y = reversed ? _height - 1 - current : current;
+				switch (s.kind)
+				{
+				case STEP_VERTICAL_MIRROR:
+					current = _height - 1 - current;
+					break;
+
+				case STEP_HORIZONTAL_MIRROR:
+					std::reverse(out, out + _width);
+					break;
+
+				case STEP_FILL_RECT:
+					if (y >= s.rect.y && y - s.rect.y < s.rect.height && s.rect.x < _width)
+						std::fill(out + s.rect.x, out + std::min<size_t>(size_t(s.rect.x) + s.rect.width, _width), s.color);
+					break;
+
+				case STEP_OVERWRITE:
+				{
+					// addressed through the orientation of the overwriting image like image::overwrite
+					const auto& src = *s.source;
+					const bool src_reversed = src.orientation == image<pixel>::LEFT_TOP;
+					const size_t top = src_reversed ? _height - 1 - current : current;
+					if (s.rect.x >= _width || s.rect.y >= _height || top < s.rect.y || top - s.rect.y >= std::min<size_t>(src.height, _height - s.rect.y))
+						break;
+					const size_t sy = top - s.rect.y;
+					const size_t srow = src_reversed ? src.height - sy - 1 : sy;
+					const size_t w = std::min<size_t>(src.width, _width - s.rect.x);
+					blend_pixels(src.pixels.data() + srow * src.width, out + s.rect.x, w, s.mode);
+					break;
+				}
+
+				case STEP_ROWS:
+					s.func(out, _width, static_cast<size>(y));
+					break;
+				}
+			}
+		}
+
+		size _width = 0;
+		size _height = 0;
+		orientation_value _orientation = image<pixel>::LEFT_TOP;
+		std::function<void(size_t row, pixel* out)> _read;
+		std::vector<step> _steps;
+	};
+
+	namespace tga
+	{
+		// the rows are encoded as the pipeline produces them, rle packets do not cross the bands
+		// mapped images need every color before the first index so they are executed first
+		template<tga_type type = tga_type::TGA_UNCOMPRESSED_RGB, pixel_type pixel, encoder_type encoder>
+		inline bool save_to_encoder(const image_pipeline<pixel>& source, encoder& enc, tga_rle_mode mode = TGA_RLE_GREEDY, unsigned threads = 1)
+		{
+			using pixel_dest = pixel_bgr_cast<pixel>;
+
+			if constexpr (type == tga_type::TGA_UNCOMPRESSED_MAPPED)
+				return save_to_encoder<type>(source.execute(threads), enc);
+			else
+			{
+				IMPP_INSTRUMENT_CALL("tga", "save_to_encoder");
+				enc.reset();
+				if constexpr (type != tga_type::TGA_UNCOMPRESSED_RGB && type != tga_type::TGA_RLE_RBG)
+					return enc.reject(error::ERROR_UNSUPPORTED, "tga: unsupported image type.");
+
+				if (source.get_width() > UINT16_MAX || source.get_height() > UINT16_MAX)
+					return enc.reject(error::ERROR_UNSUPPORTED, "tga: images are limited to 65535 pixels per side.");
+
+				auto header = detect_header<type>(image<pixel>::null());
+				header.width = static_cast<uint16_t>(source.get_width());
+				header.height = static_cast<uint16_t>(source.get_height());
+				enc.write(header);
+
+				std::vector<uint8_t> packets;
+				source.execute_bands(threads, [&](const pixel* rows, size_t, size_t count) {
+					const size_t pcount = count * source.get_width();
+					if constexpr (type == tga_type::TGA_RLE_RBG)
+					{
+						packets.clear();
+						detail::rle_packets(mode, rows, pcount, sizeof(pixel_dest), [&](bool repeated, size_t begin, size_t length) {
+							packets.push_back(static_cast<uint8_t>(length - 1) | (repeated ? 0x80 : 0));
+							const size_t colors = repeated ? 1 : length;
+							for (size_t i = begin; i < begin + colors; i++)
+							{
+								const auto color = pixel_cast<pixel_dest>(rows[i]);
+								const auto& view = pixel_bytes_view(color);
+								packets.insert(packets.end(), view.begin(), view.end());
+							}
+						});
+						enc.write(packets.data(), packets.size());
+					}
+					else if constexpr (std::is_same_v<pixel, pixel_dest>)
+						enc.write(rows, pcount * sizeof(pixel));
+					else
+						enc.template write_converted<pixel_dest>(rows, pcount);
+				});
+
+				if (enc.failed())
+					return false;
+
+				IMPP_INSTRUMENT_COUNT(bytes_written, enc.get_writesize());
+				IMPP_INSTRUMENT_SUCCEEDED();
+				return true;
+			}
+		}
+
+		template<tga_type type = tga_type::TGA_UNCOMPRESSED_RGB, pixel_type pixel>
+		inline result<size_t> try_save_to_file(const image_pipeline<pixel>& source, const std::string& filename, tga_rle_mode mode = TGA_RLE_GREEDY, unsigned threads = 1)
+		{
+			IMPP_INSTRUMENT_CALL("tga", "save_to_file");
+			auto enc = file_encoder::create(filename, error::ERROR_POLICY_RECORD);
+			if (!enc.is_open())
+				return error::error_info{ error::ERROR_FILE_OPEN, 0, "tga: unable to create file." };
+
+			if (!save_to_encoder<type>(source, enc, mode, threads) || !enc.flush())
+				return enc.get_error();
+			return enc.get_writesize();
+		}
+
+		template<tga_type type = tga_type::TGA_UNCOMPRESSED_RGB, pixel_type pixel>
+		inline result<size_t> try_save_to_memory(const image_pipeline<pixel>& source, memory_encoder& encoder, tga_rle_mode mode = TGA_RLE_GREEDY, unsigned threads = 1)
+		{
+			IMPP_INSTRUMENT_CALL("tga", "save_to_memory");
+			if (!save_to_encoder<type>(source, encoder, mode, threads))
+				return encoder.get_error();
+			return encoder.get_writesize();
+		}
+
+		template<tga_type type = tga_type::TGA_UNCOMPRESSED_RGB, pixel_type pixel>
+		inline bool save_to_file(const image_pipeline<pixel>& source, const std::string& filename, tga_rle_mode mode = TGA_RLE_GREEDY, unsigned threads = 1)
+		{
+			return error::detail::report(try_save_to_file<type>(source, filename, mode, threads));
+		}
+
+		template<tga_type type = tga_type::TGA_UNCOMPRESSED_RGB, pixel_type pixel>
+		inline bool save_to_memory(const image_pipeline<pixel>& source, memory_encoder& encoder, tga_rle_mode mode = TGA_RLE_GREEDY, unsigned threads = 1)
+		{
+			return error::detail::report(try_save_to_memory<type>(source, encoder, mode, threads));
+		}
+	}
+}
+
+#endif //INCLUDE_IMPLUSPLUS_PIPELINE_HPP
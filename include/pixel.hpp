@@ -24,9 +24,12 @@ SOFTWARE.
 #pragma once
 #ifndef INCLUDE_IMPLUSPLUS_PIXEL_HPP
 #define INCLUDE_IMPLUSPLUS_PIXEL_HPP
+#include <stdint.h>
+#include <string.h>
 #include <type_traits>
 #include <vector>
 #include <array>
+#include "parallel.hpp"
 
 namespace impp
 {
@@ -231,14 +234,25 @@ namespace impp
 		}
 	}
 
+	namespace detail
+	{
+		// exact rounded division by 255 for values up to 255 * 255
+		constexpr uint8_t div255(uint32_t value)
+		{
+			value += 128;
+			return static_cast<uint8_t>((value + (value >> 8)) >> 8);
+		}
+	}
+
 	//post process alpha channel making it simulated using a background color
 	template<pixel_type pixelfrom, pixel_type pixelto, std::enable_if_t<
 		pixel_is32bit<pixelfrom>&& pixel_is24bit<pixelto>, int> = 0>
 	void postprocess_pixel32to24(const pixelfrom& from, pixelto& to, const pixelto& bg)
 	{
-		to.b = bg.b * (1.0 - from.a) + from.b * from.a;
-		to.r = bg.r * (1.0 - from.a) + from.r * from.a;
-		to.g = bg.g * (1.0 - from.a) + from.g * from.a;
+		const uint32_t inv = UINT8_MAX - from.a;
+		to.b = detail::div255(from.b * from.a + bg.b * inv);
+		to.r = detail::div255(from.r * from.a + bg.r * inv);
+		to.g = detail::div255(from.g * from.a + bg.g * inv);
 	}
 
 	//impl of pixel24rgb
@@ -258,17 +272,6 @@ namespace impp
 	void pixel32bgra::from(const pixel& from) { pixel_cast(from, *this); }
 
 	// various methods to convert pixels
-	template<pixel_type pixelfrom, pixel_type pixelto,
-		std::enable_if_t<!std::is_same_v<pixelfrom, pixelto>, int> = 0>
-	void pixel_convert(std::vector<uint8_t>* bytes, int pcount) {
-		std::vector<uint8_t> dest(static_cast<size_t>(pcount) * sizeof(pixelto));
-		auto* pfrom = reinterpret_cast<pixelfrom*>(dest.data());
-		auto* pto = reinterpret_cast<pixelto*>(bytes->data());
-		for (int i = 0; i < pcount; i++, pfrom++, pto++)
-			pfrom->from(*pto);
-		*bytes = std::move(dest);
-	}
-
 	template<pixel_type pixelfrom, pixel_type pixelto,
 		std::enable_if_t<!std::is_same_v<pixelfrom, pixelto>, int> = 0>
 	void pixel_convert(const std::vector<pixelfrom>& from, std::vector<pixelto>& to) {
@@ -298,6 +301,80 @@ namespace impp
 			to->from(*from);
 	}
 
+	template<pixel_type pixel>
+	void pixel_convert(const pixel* from, pixel* to, size_t pcount) {
+		memcpy(to, from, pcount * sizeof(pixel));
+	}
+
+	namespace detail
+	{
+		// ranges given to each worker, their source and destination fit in l2 together
+		template<pixel_type pixelfrom, pixel_type pixelto>
+		constexpr size_t convert_grain = 256 * 1024 / (sizeof(pixelfrom) + sizeof(pixelto));
+	}
+
+	// threads splits the pixels in cache sized ranges, 0 asks for one worker per hardware thread
+	template<pixel_type pixelfrom, pixel_type pixelto>
+	void pixel_convert(const pixelfrom* from, pixelto* to, size_t pcount, unsigned threads) {
+		detail::parallel_for(pcount, detail::convert_grain<pixelfrom, pixelto>, threads, [&](size_t begin, size_t end) {
+			pixel_convert(from + begin, to + begin, end - begin);
+		});
+	}
+
+	template<pixel_type pixelto, pixel_type pixelfrom>
+	std::vector<pixelto> pixel_convert(const std::vector<pixelfrom>& from, unsigned threads) {
+		std::vector<pixelto> to(from.size());
+		pixel_convert(from.data(), to.data(), from.size(), threads);
+		return to;
+	}
+
+	// converts pixels without a second buffer, the destination type must not be larger than the source one
+	// pixels are staged through the stack so the two types never alias, smaller ones are converted front to back
+	template<pixel_type pixelfrom, pixel_type pixelto, std::enable_if_t<sizeof(pixelto) <= sizeof(pixelfrom), int> = 0>
+	void pixel_convert_inplace(void* data, size_t pcount, unsigned threads = 1) {
+		if constexpr (!std::is_same_v<pixelfrom, pixelto>)
+		{
+			auto* bytes = static_cast<uint8_t*>(data);
+			const auto convert = [bytes](size_t begin, size_t end) {
+				std::array<pixelfrom, 256> source;
+				std::array<pixelto, 256> dest;
+				for (size_t i = begin; i < end; i += source.size())
+				{
+					const size_t count = std::min(source.size(), end - i);
+					memcpy(source.data(), bytes + i * sizeof(pixelfrom), count * sizeof(pixelfrom));
+					pixel_convert(source.data(), dest.data(), count);
+					memcpy(bytes + i * sizeof(pixelto), dest.data(), count * sizeof(pixelto));
+				}
+			};
+
+			// a smaller destination range overlaps the source of the previous ones
+			if constexpr (sizeof(pixelto) == sizeof(pixelfrom))
+				detail::parallel_for(pcount, detail::convert_grain<pixelfrom, pixelto>, threads, convert);
+			else
+				convert(0, pcount);
+		}
+	}
+
+	// converts the pcount pixels held by bytes, in place unless the destination type is larger
+	template<pixel_type pixelfrom, pixel_type pixelto,
+		std::enable_if_t<!std::is_same_v<pixelfrom, pixelto>, int> = 0>
+	void pixel_convert(std::vector<uint8_t>* bytes, int pcount) {
+		const auto count = static_cast<size_t>(pcount);
+		if constexpr (sizeof(pixelto) <= sizeof(pixelfrom))
+		{
+			pixel_convert_inplace<pixelfrom, pixelto>(bytes->data(), count);
+			bytes->resize(count * sizeof(pixelto));
+		}
+		else
+		{
+			std::vector<uint8_t> dest(count * sizeof(pixelto));
+			std::vector<pixelfrom> source(count);
+			memcpy(source.data(), bytes->data(), count * sizeof(pixelfrom));
+			pixel_convert(source.data(), reinterpret_cast<pixelto*>(dest.data()), count);
+			*bytes = std::move(dest);
+		}
+	}
+
 	template<pixel_type pixel, std::enable_if_t<pixel_is24bit<pixel>, int> = 0>
 	const std::array<uint8_t, 3>& pixel_bytes_view(const pixel& px){
 		return reinterpret_cast<const std::array<uint8_t, 3>&>(px);
@@ -0,0 +1,906 @@
+/*
+MIT License
+
+Copyright (c) 2022 IkarusDeveloper
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#pragma once
+#ifndef INCLUDE_IMPLUSPLUS_PNG_HPP
+#define INCLUDE_IMPLUSPLUS_PNG_HPP
+#include "image.hpp"
+
+#include <string.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <array>
+#include <vector>
+#include "pixel.hpp"
+#include "encoder.hpp"
+#include "decoder.hpp"
+#include "error.hpp"
+#include "instrument.hpp"
+#include "simd.hpp"
+#include "deflate.hpp"
+
+// portable network graphics, see https://www.w3.org/TR/png/
+namespace impp
+{
+	namespace png
+	{
+		enum png_color_type : uint8_t {
+			PNG_GRAY = 0,
+			PNG_RGB = 2,
+			PNG_PALETTE = 3,
+			PNG_GRAY_ALPHA = 4,
+			PNG_RGBA = 6,
+		};
+
+		enum png_filter : uint8_t {
+			PNG_FILTER_NONE = 0,
+			PNG_FILTER_SUB,
+			PNG_FILTER_UP,
+			PNG_FILTER_AVG,
+			PNG_FILTER_PAETH,
+		};
+
+		enum png_interlace : uint8_t {
+			PNG_INTERLACE_NONE = 0,
+			PNG_INTERLACE_ADAM7,
+		};
+
+		constexpr uint8_t PNG_SIGNATURE[] = { 137, 'P', 'N', 'G', '\r', '\n', 26, '\n' };
+		constexpr size_t PNG_IHDR_SIZE = 13;
+		// same limit as qoi, it keeps the pixel count far from overflows
+		constexpr size_t PNG_PIXELS_MAX = 400000000;
+		// image data written by save is split in chunks of this size
+		constexpr size_t PNG_IDAT_SIZE = 256 * 1024;
+
+		// IHDR fields in host byte order, they are stored big-endian
+		struct png_header
+		{
+			uint32_t width = 0;
+			uint32_t height = 0;
+			uint8_t bit_depth = 0;
+			uint8_t color_type = 0;
+			uint8_t interlace = 0;
+		};
+
+		namespace detail
+		{
+			// slicing-by-4 tables, the first one is the classic byte-wise table
+			constexpr auto png_crc_tables = [] {
+				std::array<std::array<uint32_t, 256>, 4> tables{};
+				for (uint32_t n = 0; n < 256; n++)
+				{
+					uint32_t c = n;
+					for (int k = 0; k < 8; k++)
+						c = c & 1 ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+					tables[0][n] = c;
+				}
+				for (uint32_t n = 0; n < 256; n++)
+					for (size_t t = 1; t < tables.size(); t++)
+						tables[t][n] = tables[0][tables[t - 1][n] & 0xFF] ^ (tables[t - 1][n] >> 8);
+				return tables;
+			}();
+
+			inline uint32_t png_crc32(uint32_t crc, const uint8_t* data, size_t size)
+			{
+				const auto& t = png_crc_tables;
+				crc = ~crc;
+				for (; size >= 4; size -= 4, data += 4)
+				{
+					crc ^= uint32_t(data[0]) | uint32_t(data[1]) << 8 | uint32_t(data[2]) << 16 | uint32_t(data[3]) << 24;
+					crc = t[3][crc & 0xFF] ^ t[2][(crc >> 8) & 0xFF] ^ t[1][(crc >> 16) & 0xFF] ^ t[0][crc >> 24];
+				}
+				for (; size != 0; size--)
+					crc = t[0][(crc ^ *data++) & 0xFF] ^ (crc >> 8);
+				return ~crc;
+			}
+
+			inline uint32_t png_read32(const uint8_t* bytes)
+			{
+				return uint32_t(bytes[0]) << 24 | uint32_t(bytes[1]) << 16 | uint32_t(bytes[2]) << 8 | bytes[3];
+			}
+
+			inline void png_write32(uint8_t* bytes, uint32_t value)
+			{
+				bytes[0] = static_cast<uint8_t>(value >> 24);
+				bytes[1] = static_cast<uint8_t>(value >> 16);
+				bytes[2] = static_cast<uint8_t>(value >> 8);
+				bytes[3] = static_cast<uint8_t>(value);
+			}
+
+			inline unsigned png_channels(uint8_t color_type)
+			{
+				switch (color_type)
+				{
+				case PNG_RGB: return 3;
+				case PNG_GRAY_ALPHA: return 2;
+				case PNG_RGBA: return 4;
+				default: return 1;
+				}
+			}
+
+			inline bool png_valid_depth(uint8_t color_type, uint8_t depth)
+			{
+				switch (color_type)
+				{
+				case PNG_GRAY: return depth == 1 || depth == 2 || depth == 4 || depth == 8 || depth == 16;
+				case PNG_PALETTE: return depth == 1 || depth == 2 || depth == 4 || depth == 8;
+				case PNG_RGB: case PNG_GRAY_ALPHA: case PNG_RGBA: return depth == 8 || depth == 16;
+				default: return false;
+				}
+			}
+
+			// bytes of a filtered row without its filter byte
+			inline size_t png_row_size(const png_header& header, size_t width)
+			{
+				return (width * png_channels(header.color_type) * header.bit_depth + 7) / 8;
+			}
+
+			// adam7 passes: x and y of the first pixel, then the steps
+			constexpr uint8_t png_adam7[7][4] = {
+				{ 0, 0, 8, 8 }, { 4, 0, 8, 8 }, { 0, 4, 4, 8 }, { 2, 0, 4, 4 }, { 0, 2, 2, 4 }, { 1, 0, 2, 2 }, { 0, 1, 1, 2 },
+			};
+
+			// images without interlacing are a single pass over every pixel
+			constexpr uint8_t png_progressive[4] = { 0, 0, 1, 1 };
+
+			inline int png_pass_count(const png_header& header)
+			{
+				return header.interlace == PNG_INTERLACE_ADAM7 ? 7 : 1;
+			}
+
+			inline const uint8_t* png_pass_step(const png_header& header, int pass)
+			{
+				return header.interlace == PNG_INTERLACE_ADAM7 ? png_adam7[pass] : png_progressive;
+			}
+
+			inline size_t png_pass_size(size_t side, uint8_t first, uint8_t step)
+			{
+				return side > first ? (side - first + step - 1) / step : 0;
+			}
+
+			inline uint8_t png_paeth(int a, int b, int c)
+			{
+				const int pa = abs(b - c), pb = abs(a - c), pc = abs(a + b - 2 * c);
+				if (pa <= pb && pa <= pc)
+					return static_cast<uint8_t>(a);
+				return static_cast<uint8_t>(pb <= pc ? b : c);
+			}
+
+			inline void png_unfilter_scalar(uint8_t filter, uint8_t* row, const uint8_t* prev, size_t size, size_t bpp)
+			{
+				switch (filter)
+				{
+				case PNG_FILTER_SUB:
+					for (size_t i = bpp; i < size; i++)
+						row[i] += row[i - bpp];
+					break;
+				case PNG_FILTER_UP:
+					for (size_t i = 0; i < size; i++)
+						row[i] += prev[i];
+					break;
+				case PNG_FILTER_AVG:
+					for (size_t i = 0; i < bpp; i++)
+						row[i] += prev[i] >> 1;
+					for (size_t i = bpp; i < size; i++)
+						row[i] += (row[i - bpp] + prev[i]) >> 1;
+					break;
+				case PNG_FILTER_PAETH:
+					for (size_t i = 0; i < bpp; i++)
+						row[i] += prev[i];
+					for (size_t i = bpp; i < size; i++)
+						row[i] += png_paeth(row[i - bpp], prev[i], prev[i - bpp]);
+					break;
+				}
+			}
+
+#ifdef IMPP_SIMD_SSE2
+			// 3 and 4 byte pixels are reconstructed one pixel per vector, the dependency on the left pixel
+			// rules out wider steps but still replaces 3 or 4 scalar chains with one
+			inline __m128i png_load4(const uint8_t* p)
+			{
+				int32_t value;
+				memcpy(&value, p, 4);
+				return _mm_cvtsi32_si128(value);
+			}
+
+			inline __m128i png_load3(const uint8_t* p)
+			{
+				int32_t value = 0;
+				memcpy(&value, p, 3);
+				return _mm_cvtsi32_si128(value);
+			}
+
+			inline void png_store4(uint8_t* p, __m128i v)
+			{
+				const int32_t value = _mm_cvtsi128_si32(v);
+				memcpy(p, &value, 4);
+			}
+
+			inline void png_store3(uint8_t* p, __m128i v)
+			{
+				const int32_t value = _mm_cvtsi128_si32(v);
+				memcpy(p, &value, 3);
+			}
+
+			inline __m128i png_abs_epi16(__m128i x)
+			{
+				const __m128i negative = _mm_cmplt_epi16(x, _mm_setzero_si128());
+				return _mm_add_epi16(_mm_xor_si128(x, negative), _mm_srli_epi16(negative, 15));
+			}
+
+			inline __m128i png_select(__m128i mask, __m128i a, __m128i b)
+			{
+				return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+			}
+
+			// loads only the pixel when it is the last one so the row is never overrun
+			template<size_t bpp>
+			inline __m128i png_load_pixel(const uint8_t* p, size_t left)
+			{
+				if constexpr (bpp == 4)
+					return png_load4(p);
+				else
+					return left >= 4 ? png_load4(p) : png_load3(p);
+			}
+
+			template<size_t bpp>
+			inline void png_store_pixel(uint8_t* p, __m128i v)
+			{
+				if constexpr (bpp == 4)
+					png_store4(p, v);
+				else
+					png_store3(p, v);
+			}
+
+			template<size_t bpp>
+			inline void png_unfilter_sub_sse2(uint8_t* row, size_t size)
+			{
+				__m128i a = _mm_setzero_si128();
+				for (size_t i = 0; i < size; i += bpp)
+				{
+					a = _mm_add_epi8(png_load_pixel<bpp>(row + i, size - i), a);
+					png_store_pixel<bpp>(row + i, a);
+				}
+			}
+
+			inline void png_unfilter_up_sse2(uint8_t* row, const uint8_t* prev, size_t size)
+			{
+				size_t i = 0;
+				for (; i + 16 <= size; i += 16)
+				{
+					const __m128i value = _mm_add_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(row + i)), _mm_loadu_si128(reinterpret_cast<const __m128i*>(prev + i)));
+					_mm_storeu_si128(reinterpret_cast<__m128i*>(row + i), value);
+				}
+				for (; i < size; i++)
+					row[i] += prev[i];
+			}
+
+			template<size_t bpp>
+			inline void png_unfilter_avg_sse2(uint8_t* row, const uint8_t* prev, size_t size)
+			{
+				const __m128i one = _mm_set1_epi8(1);
+				__m128i a = _mm_setzero_si128();
+				for (size_t i = 0; i < size; i += bpp)
+				{
+					const __m128i b = png_load_pixel<bpp>(prev + i, size - i);
+					// png wants a truncating average, _mm_avg_epu8 rounds up
+					__m128i avg = _mm_avg_epu8(a, b);
+					avg = _mm_sub_epi8(avg, _mm_and_si128(_mm_xor_si128(a, b), one));
+					a = _mm_add_epi8(png_load_pixel<bpp>(row + i, size - i), avg);
+					png_store_pixel<bpp>(row + i, a);
+				}
+			}
+
+			template<size_t bpp>
+			inline void png_unfilter_paeth_sse2(uint8_t* row, const uint8_t* prev, size_t size)
+			{
+				const __m128i zero = _mm_setzero_si128();
+				__m128i a = zero, c = zero;
+				for (size_t i = 0; i < size; i += bpp)
+				{
+					const __m128i b = _mm_unpacklo_epi8(png_load_pixel<bpp>(prev + i, size - i), zero);
+					const __m128i d = _mm_unpacklo_epi8(png_load_pixel<bpp>(row + i, size - i), zero);
+
+					// p - a == b - c, p - b == a - c, p - c == (b - c) + (a - c)
+					__m128i pa = _mm_sub_epi16(b, c);
+					__m128i pb = _mm_sub_epi16(a, c);
+					__m128i pc = _mm_add_epi16(pa, pb);
+					pa = png_abs_epi16(pa);
+					pb = png_abs_epi16(pb);
+					pc = png_abs_epi16(pc);
+					const __m128i smallest = _mm_min_epi16(pc, _mm_min_epi16(pa, pb));
+
+					// ties favor a, then b, then c
+					const __m128i nearest = png_select(_mm_cmpeq_epi16(smallest, pa), a, png_select(_mm_cmpeq_epi16(smallest, pb), b, c));
+					// 8 bit adds wrap modulo 256 and leave the zero high bytes alone
+					a = _mm_add_epi8(d, nearest);
+					c = b;
+					png_store_pixel<bpp>(row + i, _mm_packus_epi16(a, a));
+				}
+			}
+
+			template<size_t bpp>
+			inline void png_unfilter_sse2(uint8_t filter, uint8_t* row, const uint8_t* prev, size_t size)
+			{
+				switch (filter)
+				{
+				case PNG_FILTER_SUB: png_unfilter_sub_sse2<bpp>(row, size); break;
+				case PNG_FILTER_UP: png_unfilter_up_sse2(row, prev, size); break;
+				case PNG_FILTER_AVG: png_unfilter_avg_sse2<bpp>(row, prev, size); break;
+				case PNG_FILTER_PAETH: png_unfilter_paeth_sse2<bpp>(row, prev, size); break;
+				}
+			}
+#endif
+
+			// reverses the filter of a row in place, prev is the previous reconstructed row or zeros
+			inline void png_unfilter_row(uint8_t filter, uint8_t* row, const uint8_t* prev, size_t size, size_t bpp)
+			{
+#ifdef IMPP_SIMD_SSE2
+				if (bpp == 3)
+					return png_unfilter_sse2<3>(filter, row, prev, size);
+				if (bpp == 4)
+					return png_unfilter_sse2<4>(filter, row, prev, size);
+				if (filter == PNG_FILTER_UP)
+					return png_unfilter_up_sse2(row, prev, size);
+#endif
+				png_unfilter_scalar(filter, row, prev, size, bpp);
+			}
+
+			inline void png_filter_row(uint8_t filter, const uint8_t* row, const uint8_t* prev, size_t size, size_t bpp, uint8_t* out)
+			{
+				switch (filter)
+				{
+				case PNG_FILTER_NONE:
+					memcpy(out, row, size);
+					break;
+				case PNG_FILTER_SUB:
+					memcpy(out, row, bpp);
+					for (size_t i = bpp; i < size; i++)
+						out[i] = row[i] - row[i - bpp];
+					break;
+				case PNG_FILTER_UP:
+					for (size_t i = 0; i < size; i++)
+						out[i] = row[i] - prev[i];
+					break;
+				case PNG_FILTER_AVG:
+					for (size_t i = 0; i < bpp; i++)
+						out[i] = row[i] - (prev[i] >> 1);
+					for (size_t i = bpp; i < size; i++)
+						out[i] = row[i] - ((row[i - bpp] + prev[i]) >> 1);
+					break;
+				case PNG_FILTER_PAETH:
+					for (size_t i = 0; i < bpp; i++)
+						out[i] = row[i] - prev[i];
+					for (size_t i = bpp; i < size; i++)
+						out[i] = row[i] - png_paeth(row[i - bpp], prev[i], prev[i - bpp]);
+					break;
+				}
+			}
+
+			// palette and transparency found next to the header
+			struct png_colors
+			{
+				std::array<pixel32rgba, 256> palette{};
+				size_t palette_size = 0;
+				bool has_key = false;
+				uint16_t key[3] = {};   // transparent gray or rgb sample
+			};
+
+			// sample at index, rows of less than 8 bit samples are packed msb first
+			inline uint16_t png_sample(const uint8_t* row, size_t index, uint8_t depth)
+			{
+				if (depth == 8)
+					return row[index];
+				if (depth == 16)
+					return static_cast<uint16_t>(row[index * 2] << 8 | row[index * 2 + 1]);
+				const size_t bit = index * depth;
+				return (row[bit >> 3] >> (8 - depth - (bit & 7))) & ((1 << depth) - 1);
+			}
+
+			inline uint8_t png_scale8(uint16_t sample, uint8_t depth)
+			{
+				if (depth == 16)
+					return static_cast<uint8_t>(sample >> 8);
+				if (depth == 8)
+					return static_cast<uint8_t>(sample);
+				return static_cast<uint8_t>(sample * 255 / ((1 << depth) - 1));
+			}
+
+			// converts count pixels of a reconstructed row, false on palette indices out of range
+			template<pixel_type pixel>
+			inline bool png_convert_row(const png_header& header, const png_colors& colors, const uint8_t* src, size_t count, pixel* dst)
+			{
+				const auto depth = header.bit_depth;
+				switch (header.color_type)
+				{
+				case PNG_RGBA:
+					if (depth == 8)
+					{
+						if constexpr (std::is_same_v<pixel, pixel32rgba>)
+							memcpy(dst, src, count * sizeof(pixel));
+						else
+							for (size_t x = 0; x < count; x++, src += 4)
+								dst[x] = pixel_cast<pixel>(pixel32rgba{ src[0], src[1], src[2], src[3] });
+					}
+					else
+						for (size_t x = 0; x < count; x++, src += 8)
+							dst[x] = pixel_cast<pixel>(pixel32rgba{ src[0], src[2], src[4], src[6] });
+					return true;
+
+				case PNG_RGB:
+					if (depth == 8 && !colors.has_key)
+					{
+						if constexpr (std::is_same_v<pixel, pixel24rgb>)
+							memcpy(dst, src, count * sizeof(pixel));
+						else
+							for (size_t x = 0; x < count; x++, src += 3)
+								dst[x] = pixel_cast<pixel>(pixel24rgb{ src[0], src[1], src[2] });
+						return true;
+					}
+					for (size_t x = 0; x < count; x++)
+					{
+						const uint16_t r = png_sample(src, x * 3, depth), g = png_sample(src, x * 3 + 1, depth), b = png_sample(src, x * 3 + 2, depth);
+						const bool transparent = colors.has_key && r == colors.key[0] && g == colors.key[1] && b == colors.key[2];
+						dst[x] = pixel_cast<pixel>(pixel32rgba{ png_scale8(r, depth), png_scale8(g, depth), png_scale8(b, depth), uint8_t(transparent ? 0 : UINT8_MAX) });
+					}
+					return true;
+
+				case PNG_GRAY_ALPHA:
+					for (size_t x = 0; x < count; x++)
+					{
+						const auto v = png_scale8(png_sample(src, x * 2, depth), depth);
+						dst[x] = pixel_cast<pixel>(pixel32rgba{ v, v, v, png_scale8(png_sample(src, x * 2 + 1, depth), depth) });
+					}
+					return true;
+
+				case PNG_GRAY:
+					for (size_t x = 0; x < count; x++)
+					{
+						const auto sample = png_sample(src, x, depth);
+						const auto v = png_scale8(sample, depth);
+						dst[x] = pixel_cast<pixel>(pixel32rgba{ v, v, v, uint8_t(colors.has_key && sample == colors.key[0] ? 0 : UINT8_MAX) });
+					}
+					return true;
+
+				case PNG_PALETTE:
+					for (size_t x = 0; x < count; x++)
+					{
+						const auto index = png_sample(src, x, depth);
+						if (index >= colors.palette_size)
+							return false;
+						dst[x] = pixel_cast<pixel>(colors.palette[index]);
+					}
+					return true;
+				}
+				return false;
+			}
+
+			// reconstructs and converts the inflated image data, rows are written bottom-up as impp keeps them
+			template<pixel_type pixel>
+			inline bool png_decode_pixels(decoder& decoder, const png_header& header, const png_colors& colors, uint8_t* raw, pixel* pixels)
+			{
+				IMPP_INSTRUMENT_STAGE(STAGE_DECODE);
+				const size_t bpp = std::max<size_t>(1, png_channels(header.color_type) * header.bit_depth / 8);
+				std::vector<uint8_t> zeros(png_row_size(header, header.width));
+				std::vector<pixel> pass_row;
+
+				const int passes = png_pass_count(header);
+				for (int pass = 0; pass < passes; pass++)
+				{
+					const auto* step = png_pass_step(header, pass);
+					const uint8_t x0 = step[0], y0 = step[1], dx = step[2], dy = step[3];
+					const size_t width = png_pass_size(header.width, x0, dx), height = png_pass_size(header.height, y0, dy);
+					if (width == 0 || height == 0)
+						continue;
+
+					const size_t size = png_row_size(header, width);
+					const uint8_t* prev = zeros.data();
+					pass_row.resize(passes == 1 ? 0 : width);
+					for (size_t y = 0; y < height; y++, raw += size + 1)
+					{
+						if (raw[0] > PNG_FILTER_PAETH)
+							return decoder.fail(error::ERROR_CORRUPT_DATA, "png: invalid filter type.");
+						png_unfilter_row(raw[0], raw + 1, prev, size, bpp);
+						prev = raw + 1;
+
+						const size_t row = y0 + y * dy;
+						auto* dst = pixels + static_cast<size_t>(header.height - row - 1) * header.width;
+						if (passes == 1)
+						{
+							if (!png_convert_row(header, colors, raw + 1, width, dst))
+								return decoder.fail(error::ERROR_CORRUPT_DATA, "png: palette index out of range.");
+							continue;
+						}
+
+						if (!png_convert_row(header, colors, raw + 1, width, pass_row.data()))
+							return decoder.fail(error::ERROR_CORRUPT_DATA, "png: palette index out of range.");
+						for (size_t x = 0; x < width; x++)
+							dst[x0 + x * dx] = pass_row[x];
+					}
+				}
+				return true;
+			}
+
+			// parses the chunks and decodes a whole image, false is returned with the error recorded in the decoder
+			template<pixel_type pixel, class imagesize = image<pixel>::size>
+			inline bool png_load_memory(decoder& decoder, imagesize* width, imagesize* height, std::vector<pixel>* pixels, png_header* pheader = nullptr)
+			{
+				png_header header;
+				png_colors colors;
+				const uint8_t* idat = nullptr;
+				size_t idat_size = 0;
+				std::vector<uint8_t> idat_joined;
+				{
+					IMPP_INSTRUMENT_STAGE(STAGE_HEADER);
+					const auto* signature = decoder.peek<uint8_t>(sizeof(PNG_SIGNATURE));
+					decoder.proceed_reading(sizeof(PNG_SIGNATURE));
+					if (decoder.failed())
+						return false;
+					if (memcmp(signature, PNG_SIGNATURE, sizeof(PNG_SIGNATURE)) != 0)
+						return decoder.fail(error::ERROR_INVALID_HEADER, "png: invalid signature.");
+
+					bool seen_header = false, seen_end = false;
+					while (!seen_end)
+					{
+						const auto* chunk = decoder.peek<uint8_t>(8);
+						if (decoder.failed())
+							return false;
+						const auto length = png_read32(chunk);
+						if (length > INT32_MAX)
+							return decoder.fail(error::ERROR_CORRUPT_DATA, "png: invalid chunk length.");
+						if (length + 12 > decoder.get_readable())
+						{
+							// reported where the input ends like a read past it
+							decoder.proceed_reading(decoder.get_readable());
+							return decoder.fail(error::ERROR_TRUNCATED, "png: chunk exceeds input.");
+						}
+						chunk = decoder.peek<uint8_t>(length + 12);
+						if (decoder.failed())
+							return false;
+
+						const auto* type = chunk + 4;
+						const auto* data = chunk + 8;
+						const bool critical = (type[0] & 0x20) == 0;
+						const bool is_data = memcmp(type, "IDAT", 4) == 0;
+
+						// image data is covered by the zlib checksum, other chunks by their own crc
+						if (!is_data && png_crc32(0, type, length + 4) != png_read32(data + length))
+						{
+							if (critical)
+								return decoder.fail(error::ERROR_CORRUPT_DATA, "png: chunk crc mismatch.");
+							decoder.proceed_reading(length + 12);
+							continue;
+						}
+
+						if (!seen_header && memcmp(type, "IHDR", 4) != 0)
+							return decoder.fail(error::ERROR_INVALID_HEADER, "png: the first chunk must be IHDR.");
+
+						if (memcmp(type, "IHDR", 4) == 0)
+						{
+							if (seen_header || length != PNG_IHDR_SIZE)
+								return decoder.fail(error::ERROR_INVALID_HEADER, "png: invalid IHDR chunk.");
+							seen_header = true;
+							header.width = png_read32(data);
+							header.height = png_read32(data + 4);
+							header.bit_depth = data[8];
+							header.color_type = data[9];
+							header.interlace = data[12];
+							if (header.width == 0 || header.height == 0 || header.width > INT32_MAX || header.height > INT32_MAX)
+								return decoder.fail(error::ERROR_INVALID_HEADER, "png: invalid image sides.");
+							if (!png_valid_depth(header.color_type, header.bit_depth))
+								return decoder.fail(error::ERROR_INVALID_HEADER, "png: invalid color type and bit depth.");
+							if (data[10] != 0 || data[11] != 0 || header.interlace > PNG_INTERLACE_ADAM7)
+								return decoder.fail(error::ERROR_INVALID_HEADER, "png: invalid compression, filter or interlace method.");
+							if (static_cast<size_t>(header.width) * header.height > PNG_PIXELS_MAX)
+								return decoder.reject(error::ERROR_UNSUPPORTED, "png: images are limited to 400 million pixels.");
+						}
+						else if (memcmp(type, "PLTE", 4) == 0)
+						{
+							if (length == 0 || length % 3 != 0 || length / 3 > 256)
+								return decoder.fail(error::ERROR_CORRUPT_DATA, "png: invalid palette size.");
+							colors.palette_size = length / 3;
+							for (size_t i = 0; i < colors.palette_size; i++)
+								colors.palette[i] = pixel32rgba{ data[i * 3], data[i * 3 + 1], data[i * 3 + 2], UINT8_MAX };
+						}
+						else if (memcmp(type, "tRNS", 4) == 0)
+						{
+							if (header.color_type == PNG_PALETTE)
+							{
+								for (size_t i = 0; i < std::min<size_t>(length, colors.palette.size()); i++)
+									colors.palette[i].a = data[i];
+							}
+							else if ((header.color_type == PNG_GRAY && length == 2) || (header.color_type == PNG_RGB && length == 6))
+							{
+								colors.has_key = true;
+								for (size_t i = 0; i < length / 2; i++)
+									colors.key[i] = static_cast<uint16_t>(data[i * 2] << 8 | data[i * 2 + 1]);
+							}
+						}
+						else if (is_data)
+						{
+							// a single chunk is inflated in place, several are joined first
+							if (idat == nullptr)
+								idat = data;
+							else
+							{
+								if (idat_joined.empty())
+									idat_joined.assign(idat, idat + idat_size);
+								idat_joined.insert(idat_joined.end(), data, data + length);
+							}
+							idat_size += length;
+						}
+						else if (memcmp(type, "IEND", 4) == 0)
+							seen_end = true;
+						else if (critical)
+							return decoder.reject(error::ERROR_UNSUPPORTED, "png: unknown critical chunk.");
+
+						decoder.proceed_reading(length + 12);
+					}
+
+					if (header.color_type == PNG_PALETTE && colors.palette_size == 0)
+						return decoder.fail(error::ERROR_CORRUPT_DATA, "png: missing palette.");
+					if (idat_size == 0)
+						return decoder.fail(error::ERROR_CORRUPT_DATA, "png: missing image data.");
+				}
+
+				// filter bytes and rows of every pass
+				size_t raw_size = 0;
+				for (int pass = 0; pass < png_pass_count(header); pass++)
+				{
+					const auto* step = png_pass_step(header, pass);
+					const size_t pwidth = png_pass_size(header.width, step[0], step[2]);
+					const size_t pheight = png_pass_size(header.height, step[1], step[3]);
+					if (pwidth != 0 && pheight != 0)
+						raw_size += (png_row_size(header, pwidth) + 1) * pheight;
+				}
+
+				// deflate expands a byte at most 1032 times, larger images cannot fit the input
+				if (raw_size / 1032 > idat_size)
+					return decoder.fail(error::ERROR_TRUNCATED, "png: image data exceeds input.");
+
+				if (pheader)
+					*pheader = header;
+
+				std::vector<uint8_t> raw(raw_size);
+				{
+					IMPP_INSTRUMENT_STAGE(STAGE_DECODE);
+					const auto* compressed = idat_joined.empty() ? idat : idat_joined.data();
+					auto inflated = deflate::zlib_decompress(compressed, idat_size, raw.data(), raw.size());
+					if (!inflated)
+						return decoder.fail(inflated.get_error().code, inflated.get_error().message);
+					if (*inflated != raw_size)
+						return decoder.fail(error::ERROR_TRUNCATED, "png: image data ends before the last row.");
+				}
+
+				const auto pcount = static_cast<size_t>(header.width) * header.height;
+				std::vector<pixel> temp_pixel(pcount);
+				IMPP_INSTRUMENT_ALLOCATION(raw_size + pcount * sizeof(pixel));
+				if (!png_decode_pixels(decoder, header, colors, raw.data(), temp_pixel.data()))
+					return false;
+
+				IMPP_INSTRUMENT_COUNT(bytes_read, decoder.get_read_offset());
+				*width = header.width;
+				*height = header.height;
+				*pixels = std::move(temp_pixel);
+				return true;
+			}
+
+			template<encoder_type encoder>
+			inline void png_write_chunk(encoder& enc, const char* type, const uint8_t* data, size_t size)
+			{
+				uint8_t head[8];
+				png_write32(head, static_cast<uint32_t>(size));
+				memcpy(head + 4, type, 4);
+				uint8_t tail[4];
+				png_write32(tail, png_crc32(png_crc32(0, head + 4, 4), data, size));
+
+				enc.write(head, sizeof(head));
+				if (size != 0)
+					enc.write(data, size);
+				enc.write(tail, sizeof(tail));
+			}
+
+			// cheap levels use a fixed filter, the default one picks the filter with the smallest sum of absolute differences per row
+			inline uint8_t png_level_filter(deflate::deflate_level level)
+			{
+				switch (level)
+				{
+				case deflate::DEFLATE_STORE: return PNG_FILTER_NONE;
+				case deflate::DEFLATE_RLE: return PNG_FILTER_UP;
+				case deflate::DEFLATE_FAST: return PNG_FILTER_UP;
+				default: return UINT8_MAX;
+				}
+			}
+
+			inline void png_adaptive_filter(const uint8_t* row, const uint8_t* prev, size_t size, size_t bpp, uint8_t* scratch, uint8_t* out)
+			{
+				uint64_t best_sum = UINT64_MAX;
+				for (uint8_t filter = PNG_FILTER_NONE; filter <= PNG_FILTER_PAETH; filter++)
+				{
+					png_filter_row(filter, row, prev, size, bpp, scratch);
+					uint64_t sum = 0;
+					for (size_t i = 0; i < size; i++)
+						sum += static_cast<uint64_t>(abs(static_cast<int8_t>(scratch[i])));
+					if (sum < best_sum)
+					{
+						best_sum = sum;
+						out[0] = filter;
+						memcpy(out + 1, scratch, size);
+					}
+				}
+			}
+		}
+
+		// true when the data starts with the png signature
+		inline bool has_signature(const void* memory, size_t size)
+		{
+			return size >= sizeof(PNG_SIGNATURE) && memcmp(memory, PNG_SIGNATURE, sizeof(PNG_SIGNATURE)) == 0;
+		}
+
+		// try_* functions never throw nor call the error handler, failures are returned with their cause
+
+		template<pixel_type pixel>
+		inline result<image<pixel>> try_load_memory(const void* memory, size_t size) {
+			IMPP_INSTRUMENT_CALL("png", "load_memory");
+			typename image<pixel>::size width = 0, height = 0;
+			typename image<pixel>::pixelvec pixels{};
+
+			auto decoder = decoder::create(memory, size, error::ERROR_POLICY_RECORD);
+			const bool decoded = detail::png_load_memory(decoder, &width, &height, &pixels);
+			return impp::detail::decoded_image(decoder, decoded, width, height, std::move(pixels));
+		}
+
+		template<pixel_type pixel>
+		inline result<image<pixel>> try_load(const std::string& filename) {
+			IMPP_INSTRUMENT_CALL("png", "load");
+			std::vector<uint8_t> bytes;
+			if (!impp::detail::read_file(filename, &bytes))
+				return error::error_info{ error::ERROR_FILE_OPEN, 0, "png: unable to read file." };
+			return try_load_memory<pixel>(bytes.data(), bytes.size());
+		}
+
+		// load functions return a null image on failure, errors found in the data are forwarded to the error handler
+
+		template<pixel_type pixel>
+		inline image<pixel> load(const std::string& filename) {
+			auto res = try_load<pixel>(filename);
+			return error::detail::report(res) ? std::move(res).value() : image<pixel>::null();
+		}
+
+		template<pixel_type pixel>
+		inline image<pixel> load_memory(const void* memory, size_t size) {
+			auto res = try_load_memory<pixel>(memory, size);
+			return error::detail::report(res) ? std::move(res).value() : image<pixel>::null();
+		}
+
+		// 24bit images are stored as 8 bit rgb, 32bit ones as 8 bit rgba
+		template<pixel_type pixel, encoder_type encoder>
+		inline bool save_to_encoder(const image<pixel>& source, encoder& enc, deflate::deflate_level level = deflate::DEFLATE_DEFAULT)
+		{
+			IMPP_INSTRUMENT_CALL("png", "save_to_encoder");
+			enc.reset();
+			if (source.width == 0 || source.height == 0 || source.pixels.size() != static_cast<size_t>(source.width) * source.height)
+				return enc.reject(error::ERROR_INVALID_ARGUMENT, "png: image is empty or inconsistent.");
+			if (source.width > INT32_MAX || source.height > INT32_MAX || source.pixels.size() > PNG_PIXELS_MAX)
+				return enc.reject(error::ERROR_UNSUPPORTED, "png: images are limited to 400 million pixels.");
+
+			uint8_t header[PNG_IHDR_SIZE] = {};
+			detail::png_write32(header, source.width);
+			detail::png_write32(header + 4, source.height);
+			header[8] = 8;
+			header[9] = pixel_is32bit<pixel> ? PNG_RGBA : PNG_RGB;
+			{
+				IMPP_INSTRUMENT_STAGE(STAGE_IO);
+				enc.write(PNG_SIGNATURE, sizeof(PNG_SIGNATURE));
+				detail::png_write_chunk(enc, "IHDR", header, sizeof(header));
+			}
+
+			std::vector<uint8_t> compressed;
+			{
+				IMPP_INSTRUMENT_STAGE(STAGE_ENCODE);
+				using png_pixel = std::conditional_t<pixel_is32bit<pixel>, pixel32rgba, pixel24rgb>;
+				const size_t bpp = sizeof(png_pixel);
+				const size_t size = source.width * bpp;
+				const auto filter = detail::png_level_filter(level);
+
+				// rows are stored top-down
+				std::vector<uint8_t> filtered((size + 1) * source.height);
+				std::vector<uint8_t> rows(size * 2), scratch(size);
+				uint8_t* row = rows.data();
+				uint8_t* prev = rows.data() + size;
+				std::fill_n(prev, size, 0);
+				auto* out = filtered.data();
+				for (size_t y = source.height; y-- > 0; out += size + 1)
+				{
+					const auto* src = source.pixels.data() + y * source.width;
+					auto* dst = reinterpret_cast<png_pixel*>(row);
+					for (size_t x = 0; x < source.width; x++)
+						dst[x] = pixel_cast<png_pixel>(src[x]);
+
+					if (filter == UINT8_MAX)
+						detail::png_adaptive_filter(row, prev, size, bpp, scratch.data(), out);
+					else
+					{
+						out[0] = filter;
+						detail::png_filter_row(filter, row, prev, size, bpp, out + 1);
+					}
+					std::swap(row, prev);
+				}
+
+				deflate::zlib_compress(filtered.data(), filtered.size(), level, &compressed);
+			}
+
+			{
+				IMPP_INSTRUMENT_STAGE(STAGE_IO);
+				for (size_t offset = 0; offset < compressed.size(); offset += PNG_IDAT_SIZE)
+					detail::png_write_chunk(enc, "IDAT", compressed.data() + offset, std::min(PNG_IDAT_SIZE, compressed.size() - offset));
+				detail::png_write_chunk(enc, "IEND", nullptr, 0);
+			}
+
+			if (enc.failed())
+				return false;
+
+			IMPP_INSTRUMENT_COUNT(bytes_written, enc.get_writesize());
+			IMPP_INSTRUMENT_SUCCEEDED();
+			return true;
+		}
+
+		// returns the number of bytes written
+		template<pixel_type pixel>
+		inline result<size_t> try_save_to_file(const image<pixel>& source, const std::string& filename, deflate::deflate_level level = deflate::DEFLATE_DEFAULT)
+		{
+			IMPP_INSTRUMENT_CALL("png", "save_to_file");
+			auto enc = file_encoder::create(filename, error::ERROR_POLICY_RECORD);
+			if (!enc.is_open())
+				return error::error_info{ error::ERROR_FILE_OPEN, 0, "png: unable to create file." };
+
+			if (!save_to_encoder(source, enc, level) || !enc.flush())
+				return enc.get_error();
+			return enc.get_writesize();
+		}
+
+		template<pixel_type pixel>
+		inline result<size_t> try_save_to_memory(const image<pixel>& source, memory_encoder& encoder, deflate::deflate_level level = deflate::DEFLATE_DEFAULT)
+		{
+			IMPP_INSTRUMENT_CALL("png", "save_to_memory");
+			if (!save_to_encoder(source, encoder, level))
+				return encoder.get_error();
+			return encoder.get_writesize();
+		}
+
+		template<pixel_type pixel>
+		inline bool save_to_file(const image<pixel>& source, const std::string& filename, deflate::deflate_level level = deflate::DEFLATE_DEFAULT)
+		{
+			return error::detail::report(try_save_to_file(source, filename, level));
+		}
+
+		template<pixel_type pixel>
+		inline bool save_to_memory(const image<pixel>& source, memory_encoder& encoder, deflate::deflate_level level = deflate::DEFLATE_DEFAULT)
+		{
+			return error::detail::report(try_save_to_memory(source, encoder, level));
+		}
+	}
+}
+
+#endif //INCLUDE_IMPLUSPLUS_PNG_HPP
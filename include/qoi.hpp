@@ -0,0 +1,496 @@
+/*
+MIT License
+
+Copyright (c) 2022 IkarusDeveloper
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#pragma once
+#ifndef INCLUDE_IMPLUSPLUS_QOI_HPP
+#define INCLUDE_IMPLUSPLUS_QOI_HPP
+#include "image.hpp"
+
+#include <string.h>
+#include <stdint.h>
+#include <algorithm>
+#include <array>
+#include <vector>
+#include "pixel.hpp"
+#include "encoder.hpp"
+#include "decoder.hpp"
+#include "error.hpp"
+#include "instrument.hpp"
+
+// "quite ok image" format, see https://qoiformat.org/qoi-specification.pdf
+namespace impp
+{
+	namespace qoi
+	{
+		enum qoi_colorspace {
+			QOI_SRGB = 0,       // srgb color channels with linear alpha
+			QOI_LINEAR = 1,     // all channels linear
+		};
+
+		enum qoi_op : uint8_t {
+			QOI_OP_INDEX = 0x00,
+			QOI_OP_DIFF = 0x40,
+			QOI_OP_LUMA = 0x80,
+			QOI_OP_RUN = 0xC0,
+			QOI_OP_RGB = 0xFE,
+			QOI_OP_RGBA = 0xFF,
+		};
+
+		constexpr uint8_t QOI_MAGIC[] = { 'q', 'o', 'i', 'f' };
+		constexpr size_t QOI_HEADER_SIZE = 14;
+		constexpr uint8_t QOI_PADDING[] = { 0, 0, 0, 0, 0, 0, 0, 1 };
+		// limit of the reference implementation, it keeps the pixel count far from overflows
+		constexpr size_t QOI_PIXELS_MAX = 400000000;
+
+		// header fields in host byte order, they are stored big-endian
+		struct qoi_header
+		{
+			uint32_t width = 0;
+			uint32_t height = 0;
+			uint8_t channels = 0;
+			uint8_t colorspace = 0;
+		};
+
+		namespace detail
+		{
+			inline uint32_t qoi_read32(const uint8_t* bytes)
+			{
+				return uint32_t(bytes[0]) << 24 | uint32_t(bytes[1]) << 16 | uint32_t(bytes[2]) << 8 | bytes[3];
+			}
+
+			inline void qoi_write32(uint8_t* bytes, uint32_t value)
+			{
+				bytes[0] = static_cast<uint8_t>(value >> 24);
+				bytes[1] = static_cast<uint8_t>(value >> 16);
+				bytes[2] = static_cast<uint8_t>(value >> 8);
+				bytes[3] = static_cast<uint8_t>(value);
+			}
+
+			inline uint8_t qoi_hash(const pixel32rgba& px)
+			{
+				return (px.r * 3 + px.g * 5 + px.b * 7 + px.a * 11) & 63;
+			}
+
+			inline uint32_t qoi_value(const pixel32rgba& px)
+			{
+				uint32_t value;
+				memcpy(&value, &px, sizeof(value));
+				return value;
+			}
+
+			// decodes the chunks following the header, rows are written bottom-up as impp keeps them
+			template<pixel_type pixel>
+			inline bool qoi_decode_pixels(decoder& decoder, uint32_t width, uint32_t height, pixel* pixels)
+			{
+				IMPP_INSTRUMENT_STAGE(STAGE_DECODE);
+				const auto size = decoder.get_readable();
+				const auto* data = decoder.peek<uint8_t>(size);
+				if (size < sizeof(QOI_PADDING))
+					return decoder.fail(error::ERROR_TRUNCATED, "qoi: missing end marker.");
+
+				// chunks are at most 5 bytes long so reading up to the padding never leaves the input
+				const uint8_t* p = data;
+				const uint8_t* chunks_end = data + size - sizeof(QOI_PADDING);
+
+				std::array<pixel32rgba, 64> index{};
+				pixel32rgba px{ 0, 0, 0, UINT8_MAX };
+				size_t run = 0;
+
+				for (uint32_t row = 0; row < height; row++)
+				{
+					auto* dst = pixels + static_cast<size_t>(height - row - 1) * width;
+					auto* const rowend = dst + width;
+
+					// runs may span rows
+					if (run != 0)
+					{
+						const auto count = std::min<size_t>(run, width);
+						dst = std::fill_n(dst, count, pixel_cast<pixel>(px));
+						run -= count;
+					}
+
+					while (dst != rowend)
+					{
+						if (p >= chunks_end)
+						{
+							decoder.proceed_reading(p - data);
+							return decoder.fail(error::ERROR_TRUNCATED, "qoi: pixel data ends before the last pixel.");
+						}
+
+						const uint8_t b1 = *p++;
+						switch (b1 >> 6)
+						{
+						case QOI_OP_INDEX >> 6:
+							px = index[b1];
+							break;
+
+						case QOI_OP_DIFF >> 6:
+							px.r += ((b1 >> 4) & 0x03) - 2;
+							px.g += ((b1 >> 2) & 0x03) - 2;
+							px.b += (b1 & 0x03) - 2;
+							break;
+
+						case QOI_OP_LUMA >> 6:
+						{
+							const uint8_t b2 = *p++;
+							const int vg = (b1 & 0x3F) - 32;
+							px.r += vg - 8 + ((b2 >> 4) & 0x0F);
+							px.g += vg;
+							px.b += vg - 8 + (b2 & 0x0F);
+							break;
+						}
+
+						default:
+							if (b1 == QOI_OP_RGB)
+							{
+								px.r = p[0];
+								px.g = p[1];
+								px.b = p[2];
+								p += 3;
+							}
+							else if (b1 == QOI_OP_RGBA)
+							{
+								px.r = p[0];
+								px.g = p[1];
+								px.b = p[2];
+								px.a = p[3];
+								p += 4;
+							}
+							else
+							{
+								IMPP_INSTRUMENT_COUNT(rle_run_packets, 1);
+								IMPP_INSTRUMENT_COUNT(rle_run_pixels, (b1 & 0x3F) + 1);
+								index[qoi_hash(px)] = px;
+								const size_t count = std::min<size_t>((b1 & 0x3F) + 1, rowend - dst);
+								dst = std::fill_n(dst, count, pixel_cast<pixel>(px));
+								run = (b1 & 0x3F) + 1 - count;
+								continue;
+							}
+							break;
+						}
+
+						index[qoi_hash(px)] = px;
+						*dst++ = pixel_cast<pixel>(px);
+					}
+				}
+
+				// the 8 byte end marker must be there but its content is not checked
+				decoder.proceed_reading(std::min<size_t>(size, p - data + sizeof(QOI_PADDING)));
+				return true;
+			}
+
+			// decodes a whole image, false is returned with the error recorded in the decoder
+			template<pixel_type pixel, class imagesize = image<pixel>::size>
+			inline bool qoi_load_memory(decoder& decoder, imagesize* width, imagesize* height, std::vector<pixel>* pixels, qoi_header* pheader = nullptr)
+			{
+				qoi_header header;
+				{
+					IMPP_INSTRUMENT_STAGE(STAGE_HEADER);
+					const auto* bytes = decoder.peek<uint8_t>(QOI_HEADER_SIZE);
+					decoder.proceed_reading(QOI_HEADER_SIZE);
+					if (decoder.failed())
+						return false;
+					if (memcmp(bytes, QOI_MAGIC, sizeof(QOI_MAGIC)) != 0)
+						return decoder.fail(error::ERROR_INVALID_HEADER, "qoi: invalid magic.");
+
+					header.width = qoi_read32(bytes + 4);
+					header.height = qoi_read32(bytes + 8);
+					header.channels = bytes[12];
+					header.colorspace = bytes[13];
+				}
+
+				if (header.width == 0 || header.height == 0)
+					return decoder.fail(error::ERROR_INVALID_HEADER, "qoi: image sides must not be 0.");
+				if ((header.channels != 3 && header.channels != 4) || header.colorspace > QOI_LINEAR)
+					return decoder.fail(error::ERROR_INVALID_HEADER, "qoi: invalid channels or colorspace.");
+
+				const auto pcount = static_cast<size_t>(header.width) * header.height;
+				if (pcount > QOI_PIXELS_MAX)
+					return decoder.reject(error::ERROR_UNSUPPORTED, "qoi: images are limited to 400 million pixels.");
+
+				// a chunk byte expands at most into a 62 pixel run, larger images cannot fit the input
+				if (pcount / 62 > decoder.get_readable())
+					return decoder.fail(error::ERROR_TRUNCATED, "qoi: pixel data exceeds input.");
+
+				if (pheader)
+					*pheader = header;
+
+				std::vector<pixel> temp_pixel(pcount);
+				IMPP_INSTRUMENT_ALLOCATION(pcount * sizeof(pixel));
+				if (!qoi_decode_pixels(decoder, header.width, header.height, temp_pixel.data()))
+					return false;
+
+				IMPP_INSTRUMENT_COUNT(bytes_read, decoder.get_read_offset());
+				*width = header.width;
+				*height = header.height;
+				*pixels = std::move(temp_pixel);
+				return true;
+			}
+
+			// encodes into a small buffer handed to the encoder whenever it fills up
+			template<encoder_type encoder>
+			class qoi_chunk_writer
+			{
+			public:
+				static constexpr size_t buffer_size = 64 * 1024;
+				static constexpr size_t chunk_max = 5;
+
+				explicit qoi_chunk_writer(encoder& enc) : _enc(enc), _buffer(buffer_size) {}
+
+				uint8_t* reserve()
+				{
+					if (buffer_size - _used < chunk_max)
+						flush();
+					return _buffer.data() + _used;
+				}
+
+				void commit(size_t size)
+				{
+					_used += size;
+				}
+
+				void put(uint8_t value)
+				{
+					*reserve() = value;
+					_used++;
+				}
+
+				void flush()
+				{
+					_enc.write(_buffer.data(), _used);
+					_used = 0;
+				}
+
+			private:
+				encoder& _enc;
+				std::vector<uint8_t> _buffer;
+				size_t _used = 0;
+			};
+		}
+
+		// true when the data starts with a qoi header
+		inline bool has_signature(const void* memory, size_t size)
+		{
+			const auto* bytes = reinterpret_cast<const uint8_t*>(memory);
+			return size >= QOI_HEADER_SIZE && memcmp(bytes, QOI_MAGIC, sizeof(QOI_MAGIC)) == 0
+				&& (bytes[12] == 3 || bytes[12] == 4) && bytes[13] <= QOI_LINEAR;
+		}
+
+		// try_* functions never throw nor call the error handler, failures are returned with their cause
+
+		template<pixel_type pixel>
+		inline result<image<pixel>> try_load_memory(const void* memory, size_t size) {
+			IMPP_INSTRUMENT_CALL("qoi", "load_memory");
+			typename image<pixel>::size width = 0, height = 0;
+			typename image<pixel>::pixelvec pixels{};
+
+			auto decoder = decoder::create(memory, size, error::ERROR_POLICY_RECORD);
+			const bool decoded = detail::qoi_load_memory(decoder, &width, &height, &pixels);
+			return impp::detail::decoded_image(decoder, decoded, width, height, std::move(pixels));
+		}
+
+		template<pixel_type pixel>
+		inline result<image<pixel>> try_load(const std::string& filename) {
+			IMPP_INSTRUMENT_CALL("qoi", "load");
+			std::vector<uint8_t> bytes;
+			if (!impp::detail::read_file(filename, &bytes))
+				return error::error_info{ error::ERROR_FILE_OPEN, 0, "qoi: unable to read file." };
+			return try_load_memory<pixel>(bytes.data(), bytes.size());
+		}
+
+		// load functions return a null image on failure, errors found in the data are forwarded to the error handler
+
+		template<pixel_type pixel>
+		inline image<pixel> load(const std::string& filename) {
+			auto res = try_load<pixel>(filename);
+			return error::detail::report(res) ? std::move(res).value() : image<pixel>::null();
+		}
+
+		template<pixel_type pixel>
+		inline image<pixel> load_memory(const void* memory, size_t size) {
+			auto res = try_load_memory<pixel>(memory, size);
+			return error::detail::report(res) ? std::move(res).value() : image<pixel>::null();
+		}
+
+		// 24bit images are stored with 3 channels, 32bit ones with 4
+		template<pixel_type pixel, encoder_type encoder>
+		inline bool save_to_encoder(const image<pixel>& source, encoder& enc, qoi_colorspace colorspace = QOI_SRGB)
+		{
+			IMPP_INSTRUMENT_CALL("qoi", "save_to_encoder");
+			enc.reset();
+			if (source.width == 0 || source.height == 0 || source.pixels.size() != static_cast<size_t>(source.width) * source.height)
+				return enc.reject(error::ERROR_INVALID_ARGUMENT, "qoi: image is empty or inconsistent.");
+			if (source.pixels.size() > QOI_PIXELS_MAX)
+				return enc.reject(error::ERROR_UNSUPPORTED, "qoi: images are limited to 400 million pixels.");
+
+			uint8_t header[QOI_HEADER_SIZE];
+			memcpy(header, QOI_MAGIC, sizeof(QOI_MAGIC));
+			detail::qoi_write32(header + 4, source.width);
+			detail::qoi_write32(header + 8, source.height);
+			header[12] = pixel_is32bit<pixel> ? 4 : 3;
+			header[13] = static_cast<uint8_t>(colorspace);
+			{
+				IMPP_INSTRUMENT_STAGE(STAGE_IO);
+				enc.write(header, sizeof(header));
+			}
+
+			IMPP_INSTRUMENT_STAGE(STAGE_ENCODE);
+			detail::qoi_chunk_writer<encoder> writer(enc);
+			std::array<pixel32rgba, 64> index{};
+			pixel32rgba prev{ 0, 0, 0, UINT8_MAX };
+			uint8_t run = 0;
+
+			// rows are stored top-down
+			for (size_t row = source.height; row-- > 0; )
+			{
+				const auto* src = source.pixels.data() + row * source.width;
+				for (size_t x = 0; x < source.width; x++)
+				{
+					const auto px = pixel_cast<pixel32rgba>(src[x]);
+					if (detail::qoi_value(px) == detail::qoi_value(prev))
+					{
+						if (++run == 62)
+						{
+							IMPP_INSTRUMENT_COUNT(rle_run_packets, 1);
+							IMPP_INSTRUMENT_COUNT(rle_run_pixels, run);
+							writer.put(QOI_OP_RUN | (run - 1));
+							run = 0;
+						}
+						continue;
+					}
+
+					if (run != 0)
+					{
+						IMPP_INSTRUMENT_COUNT(rle_run_packets, 1);
+						IMPP_INSTRUMENT_COUNT(rle_run_pixels, run);
+						writer.put(QOI_OP_RUN | (run - 1));
+						run = 0;
+					}
+
+					const auto hash = detail::qoi_hash(px);
+					if (detail::qoi_value(index[hash]) == detail::qoi_value(px))
+					{
+						writer.put(QOI_OP_INDEX | hash);
+						prev = px;
+						continue;
+					}
+					index[hash] = px;
+
+					auto* out = writer.reserve();
+					if (px.a == prev.a)
+					{
+						const int8_t vr = static_cast<int8_t>(px.r - prev.r);
+						const int8_t vg = static_cast<int8_t>(px.g - prev.g);
+						const int8_t vb = static_cast<int8_t>(px.b - prev.b);
+						const int8_t vg_r = static_cast<int8_t>(vr - vg);
+						const int8_t vg_b = static_cast<int8_t>(vb - vg);
+
+						if (vr > -3 && vr < 2 && vg > -3 && vg < 2 && vb > -3 && vb < 2)
+						{
+							out[0] = static_cast<uint8_t>(QOI_OP_DIFF | (vr + 2) << 4 | (vg + 2) << 2 | (vb + 2));
+							writer.commit(1);
+						}
+						else if (vg_r > -9 && vg_r < 8 && vg > -33 && vg < 32 && vg_b > -9 && vg_b < 8)
+						{
+							out[0] = static_cast<uint8_t>(QOI_OP_LUMA | (vg + 32));
+							out[1] = static_cast<uint8_t>((vg_r + 8) << 4 | (vg_b + 8));
+							writer.commit(2);
+						}
+						else
+						{
+							out[0] = QOI_OP_RGB;
+							out[1] = px.r;
+							out[2] = px.g;
+							out[3] = px.b;
+							writer.commit(4);
+						}
+					}
+					else
+					{
+						out[0] = QOI_OP_RGBA;
+						out[1] = px.r;
+						out[2] = px.g;
+						out[3] = px.b;
+						out[4] = px.a;
+						writer.commit(5);
+					}
+					prev = px;
+				}
+			}
+
+			if (run != 0)
+			{
+				IMPP_INSTRUMENT_COUNT(rle_run_packets, 1);
+				IMPP_INSTRUMENT_COUNT(rle_run_pixels, run);
+				writer.put(QOI_OP_RUN | (run - 1));
+			}
+			for (auto b : QOI_PADDING)
+				writer.put(b);
+			writer.flush();
+
+			if (enc.failed())
+				return false;
+
+			IMPP_INSTRUMENT_COUNT(bytes_written, enc.get_writesize());
+			IMPP_INSTRUMENT_SUCCEEDED();
+			return true;
+		}
+
+		// returns the number of bytes written
+		template<pixel_type pixel>
+		inline result<size_t> try_save_to_file(const image<pixel>& source, const std::string& filename, qoi_colorspace colorspace = QOI_SRGB)
+		{
+			IMPP_INSTRUMENT_CALL("qoi", "save_to_file");
+			auto enc = file_encoder::create(filename, error::ERROR_POLICY_RECORD);
+			if (!enc.is_open())
+				return error::error_info{ error::ERROR_FILE_OPEN, 0, "qoi: unable to create file." };
+
+			if (!save_to_encoder(source, enc, colorspace) || !enc.flush())
+				return enc.get_error();
+			return enc.get_writesize();
+		}
+
+		template<pixel_type pixel>
+		inline result<size_t> try_save_to_memory(const image<pixel>& source, memory_encoder& encoder, qoi_colorspace colorspace = QOI_SRGB)
+		{
+			IMPP_INSTRUMENT_CALL("qoi", "save_to_memory");
+			if (!save_to_encoder(source, encoder, colorspace))
+				return encoder.get_error();
+			return encoder.get_writesize();
+		}
+
+		template<pixel_type pixel>
+		inline bool save_to_file(const image<pixel>& source, const std::string& filename, qoi_colorspace colorspace = QOI_SRGB)
+		{
+			return error::detail::report(try_save_to_file(source, filename, colorspace));
+		}
+
+		template<pixel_type pixel>
+		inline bool save_to_memory(const image<pixel>& source, memory_encoder& encoder, qoi_colorspace colorspace = QOI_SRGB)
+		{
+			return error::detail::report(try_save_to_memory(source, encoder, colorspace));
+		}
+	}
+}
+
+#endif //INCLUDE_IMPLUSPLUS_QOI_HPP
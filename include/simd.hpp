@@ -0,0 +1,58 @@
+/*
+MIT License
+
+Copyright (c) 2022 IkarusDeveloper
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#pragma once
+#ifndef INCLUDE_IMPLUSPLUS_SIMD_HPP
+#define INCLUDE_IMPLUSPLUS_SIMD_HPP
+
+// sse2 kernels are enabled whenever the target guarantees them, define IMPP_NO_SIMD to force scalar code
+#if !defined(IMPP_NO_SIMD) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#define IMPP_SIMD_SSE2 1
+#include <emmintrin.h>
+#endif
+
+#include <stdint.h>
+
+namespace impp
+{
+	namespace detail
+	{
+#ifdef IMPP_SIMD_SSE2
+		// exact rounded division by 255 of 16bit lanes holding values up to 255 * 255
+		inline __m128i simd_div255_epu16(__m128i value)
+		{
+			value = _mm_add_epi16(value, _mm_set1_epi16(128));
+			return _mm_mulhi_epu16(value, _mm_set1_epi16(257));
+		}
+
+		// broadcasts the alpha lane (the fourth one) of both the pixels held in 16bit lanes
+		inline __m128i simd_alpha_epu16(__m128i value)
+		{
+			value = _mm_shufflelo_epi16(value, _MM_SHUFFLE(3, 3, 3, 3));
+			return _mm_shufflehi_epi16(value, _MM_SHUFFLE(3, 3, 3, 3));
+		}
+#endif
+	}
+}
+
+#endif //INCLUDE_IMPLUSPLUS_SIMD_HPP
@@ -0,0 +1,281 @@
+/*
+MIT License
+
+Copyright (c) 2022 IkarusDeveloper
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#pragma once
+#ifndef INCLUDE_IMPLUSPLUS_STATS_HPP
+#define INCLUDE_IMPLUSPLUS_STATS_HPP
+#include "image.hpp"
+
+#include <stdint.h>
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <mutex>
+#include <vector>
+#include "parallel.hpp"
+#include "simd.hpp"
+
+namespace impp
+{
+	// how the alpha channel of an image is used, 24bit images are always opaque
+	enum alpha_usage : uint8_t {
+		ALPHA_OPAQUE = 0,       // every alpha is 255
+		ALPHA_BINARY,           // alphas are 0 or 255
+		ALPHA_TRANSLUCENT       // any other alpha is found
+	};
+
+	// occurrences of every value of each channel, 24bit images count 255 alphas
+	struct image_histogram
+	{
+		std::array<uint64_t, 256> r{};
+		std::array<uint64_t, 256> g{};
+		std::array<uint64_t, 256> b{};
+		std::array<uint64_t, 256> a{};
+	};
+
+	namespace detail
+	{
+		// pixels given to each worker
+		constexpr size_t stats_grain = 256 * 1024;
+		// pixels checked between two looks at the results of the other workers
+		constexpr size_t stats_slice = 4096;
+		// pixels counted in 32bit bins before they are added to the totals
+		constexpr size_t stats_block = size_t(1) << 24;
+
+		// four tables per byte lane, consecutive pixels update different tables so increments of the
+		// same bin do not wait for the previous store to complete
+		template<size_t lanes>
+		inline void stats_histogram(const uint8_t* data, size_t count, std::array<uint64_t, 256>* totals)
+		{
+			std::vector<uint32_t> tables(lanes * 4 * 256);
+			for (size_t block = 0; block < count; block += stats_block)
+			{
+				std::fill(tables.begin(), tables.end(), 0);
+				const size_t end = std::min(count, block + stats_block);
+				size_t i = block;
+				for (; i + 4 <= end; i += 4)
+					for (size_t sub = 0; sub < 4; sub++)
+						for (size_t lane = 0; lane < lanes; lane++)
+							tables[(lane * 4 + sub) * 256 + data[(i + sub) * lanes + lane]]++;
+				for (; i < end; i++)
+					for (size_t lane = 0; lane < lanes; lane++)
+						tables[lane * 4 * 256 + data[i * lanes + lane]]++;
+
+				for (size_t lane = 0; lane < lanes; lane++)
+					for (size_t sub = 0; sub < 4; sub++)
+						for (size_t bin = 0; bin < 256; bin++)
+							totals[lane][bin] += tables[(lane * 4 + sub) * 256 + bin];
+			}
+		}
+
+		// returns as soon as a translucent pixel is found
+		template<pixel_type pixel>
+		inline alpha_usage stats_alpha(const pixel* pixels, size_t count)
+		{
+			auto usage = ALPHA_OPAQUE;
+			size_t i = 0;
+#ifdef IMPP_SIMD_SSE2
+			const __m128i mask = _mm_set1_epi32(static_cast<int>(0xFF000000u));
+			const __m128i zero = _mm_setzero_si128();
+			for (; i + 16 <= count; i += 16)
+			{
+				__m128i alpha[4];
+				for (size_t v = 0; v < 4; v++)
+					alpha[v] = _mm_and_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(pixels + i + v * 4)), mask);
+
+				// sixteen opaque pixels take a single test
+				const __m128i all = _mm_and_si128(_mm_and_si128(alpha[0], alpha[1]), _mm_and_si128(alpha[2], alpha[3]));
+				if (_mm_movemask_epi8(_mm_cmpeq_epi32(all, mask)) == 0xFFFF)
+					continue;
+				for (size_t v = 0; v < 4; v++)
+					if (_mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi32(alpha[v], mask), _mm_cmpeq_epi32(alpha[v], zero))) != 0xFFFF)
+						return ALPHA_TRANSLUCENT;
+				usage = ALPHA_BINARY;
+			}
+#endif
+			for (; i < count; i++)
+			{
+				if (pixels[i].a == UINT8_MAX)
+					continue;
+				if (pixels[i].a != 0)
+					return ALPHA_TRANSLUCENT;
+				usage = ALPHA_BINARY;
+			}
+			return usage;
+		}
+
+		// colors are compared by their bytes, the order of the channels does not change the count
+		template<pixel_type pixel>
+		inline uint32_t stats_color_key(const pixel& px)
+		{
+			uint32_t key = 0;
+			memcpy(&key, &px, sizeof(pixel));
+			return key;
+		}
+
+		// open addressing set of colors, the zero key marks free slots so the color 0 is kept apart
+		class stats_color_set
+		{
+		public:
+			explicit stats_color_set(size_t limit)
+			{
+				const size_t slots = std::bit_ceil(std::max<size_t>(limit * 2, 64));
+				_slots.assign(slots, 0);
+				_shift = 32 - std::countr_zero(slots);
+			}
+
+			bool insert(uint32_t key)
+			{
+				if (key == 0)
+				{
+					const bool added = !_zero;
+					_zero = true;
+					_size += added;
+					return added;
+				}
+				const size_t mask = _slots.size() - 1;
+				for (size_t slot = (key * 2654435761u) >> _shift;; slot = (slot + 1) & mask)
+				{
+					if (_slots[slot] == key)
+						return false;
+					if (_slots[slot] == 0)
+					{
+						_slots[slot] = key;
+						_size++;
+						return true;
+					}
+				}
+			}
+
+			// stops once the set holds limit colors
+			void merge(const stats_color_set& other, size_t limit)
+			{
+				if (other._zero && _size < limit)
+					insert(0);
+				for (const auto key : other._slots)
+					if (key != 0 && _size < limit)
+						insert(key);
+			}
+
+			size_t size() const
+			{
+				return _size;
+			}
+
+		private:
+			std::vector<uint32_t> _slots;
+			size_t _size = 0;
+			int _shift = 0;
+			bool _zero = false;
+		};
+	}
+
+	// per channel histograms, threads splits the pixels among workers, 0 asks for one per hardware thread
+	template<pixel_type pixel>
+	inline image_histogram histogram(const image<pixel>& source, unsigned threads = 1)
+	{
+		constexpr size_t lanes = sizeof(pixel);
+		std::array<std::array<uint64_t, 256>, lanes> totals{};
+		std::mutex mutex;
+		const auto* data = reinterpret_cast<const uint8_t*>(source.pixels.data());
+		detail::parallel_for(source.pixels.size(), detail::stats_grain, threads, [&](size_t begin, size_t end) {
+			std::array<std::array<uint64_t, 256>, lanes> local{};
+			detail::stats_histogram<lanes>(data + begin * lanes, end - begin, local.data());
+			std::lock_guard lock(mutex);
+			for (size_t lane = 0; lane < lanes; lane++)
+				for (size_t bin = 0; bin < 256; bin++)
+					totals[lane][bin] += local[lane][bin];
+		});
+
+		// the lanes follow the memory order of the pixel type
+		const auto order = pixel_bytes_view(pixel_cast<pixel>(pixel32rgba{ 0, 1, 2, 3 }));
+		image_histogram ret;
+		std::array<uint64_t, 256>* channels[] = { &ret.r, &ret.g, &ret.b, &ret.a };
+		for (size_t lane = 0; lane < lanes; lane++)
+			*channels[order[lane]] = totals[lane];
+		if constexpr (pixel_is24bit<pixel>)
+			ret.a[UINT8_MAX] = source.pixels.size();
+		return ret;
+	}
+
+	// the scan stops at the first translucent pixel, a good check before saving a 32bit image as 24bit
+	template<pixel_type pixel>
+	inline alpha_usage classify_alpha(const image<pixel>& source, unsigned threads = 1)
+	{
+		if constexpr (pixel_is24bit<pixel>)
+			return ALPHA_OPAQUE;
+		else
+		{
+			std::atomic<uint8_t> usage{ ALPHA_OPAQUE };
+			const auto* pixels = source.pixels.data();
+			detail::parallel_for(source.pixels.size(), detail::stats_grain, threads, [&](size_t begin, size_t end) {
+				for (size_t i = begin; i < end && usage.load(std::memory_order_relaxed) != ALPHA_TRANSLUCENT; i += detail::stats_slice)
+				{
+					const auto found = detail::stats_alpha(pixels + i, std::min(detail::stats_slice, end - i));
+					auto current = usage.load(std::memory_order_relaxed);
+					while (found > current && !usage.compare_exchange_weak(current, found, std::memory_order_relaxed));
+				}
+			});
+			return static_cast<alpha_usage>(usage.load());
+		}
+	}
+
+	// distinct colors counted up to limit, the result is limit when the image holds at least as many
+	// 65536 is enough to choose between a mapped image and the other encodings
+	template<pixel_type pixel>
+	inline size_t count_colors(const image<pixel>& source, size_t limit = 65536, unsigned threads = 1)
+	{
+		limit = std::min(limit, source.pixels.size());
+		if (limit == 0)
+			return 0;
+
+		detail::stats_color_set colors(limit);
+		std::atomic<bool> full{ false };
+		std::mutex mutex;
+		const auto* pixels = source.pixels.data();
+		detail::parallel_for(source.pixels.size(), detail::stats_grain, threads, [&](size_t begin, size_t end) {
+			detail::stats_color_set local(std::min(limit, end - begin));
+			// runs of the same color are common and skip the set
+			uint32_t previous = detail::stats_color_key(pixels[begin]);
+			local.insert(previous);
+			for (size_t i = begin + 1; i < end && local.size() < limit; i++)
+			{
+				if ((i - begin) % detail::stats_slice == 0 && full.load(std::memory_order_relaxed))
+					return;
+				const auto key = detail::stats_color_key(pixels[i]);
+				if (key != previous)
+					local.insert(key);
+				previous = key;
+			}
+
+			std::lock_guard lock(mutex);
+			colors.merge(local, limit);
+			if (colors.size() >= limit)
+				full.store(true, std::memory_order_relaxed);
+		});
+		return std::min(colors.size(), limit);
+	}
+}
+
+#endif //INCLUDE_IMPLUSPLUS_STATS_HPP
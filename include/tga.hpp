@@ -29,10 +29,15 @@ SOFTWARE.
 #include <string.h>
 #include <stdint.h>
 #include <fstream>
+#include <memory>
+#include <tuple>
+#include <unordered_map>
 #include "pixel.hpp"
 #include "encoder.hpp"
 #include "decoder.hpp"
 #include "error.hpp"
+#include "instrument.hpp"
+#include "stats.hpp"
 
 namespace impp
 {
@@ -45,6 +50,15 @@ namespace impp
 			TGA_RLE_RBG = 10,
 		};
 
+		// how rle images are split in packets
+		enum tga_rle_mode : uint8_t {
+			TGA_RLE_GREEDY = 0,     // a run for every repeated pixel, single pass
+			TGA_RLE_OPTIMAL,        // the fewest bytes, a few times slower
+		};
+
+		// imagedesc bit telling rows are stored from the top of the image
+		constexpr uint8_t TGA_ORIGIN_TOP = 0x20;
+
 #pragma pack(push, 1)
 		struct tga_header
 		{
@@ -67,12 +81,34 @@ namespace impp
 
 		namespace detail
 		{
+			// palette indexes are not aligned in the stream
+			template<class palette_type>
+			inline palette_type tga_palette_index(const uint8_t* indexes, size_t i)
+			{
+				palette_type index;
+				memcpy(&index, indexes + i * sizeof(palette_type), sizeof(palette_type));
+				return index;
+			}
+
 			template<pixel_type pixelfrom, pixel_type pixelto, class palette_type>
-			void tga_load_paletted(decoder& decoder, const uint8_t* colormap, pixelto* pxto, size_t size)
+			void tga_load_paletted(decoder& decoder, const uint8_t* colormap, size_t colormap_len, pixelto* pxto, size_t size)
 			{
 				const auto* map_pixels = reinterpret_cast<const pixelfrom*>(colormap);
+				const auto* indexes = decoder.peek<uint8_t>(size * sizeof(palette_type));
+				decoder.proceed_reading(size * sizeof(palette_type));
+				if (decoder.failed())
+					return;
+
 				for (size_t i = 0; i < size; i++, pxto++)
-					pxto->from(map_pixels[decoder.read<palette_type>()]);
+				{
+					const auto index = tga_palette_index<palette_type>(indexes, i);
+					if (index >= colormap_len)
+					{
+						decoder.fail(error::ERROR_CORRUPT_DATA, "tga: color index out of color map.");
+						return;
+					}
+					*pxto = pixel_cast<pixelto>(map_pixels[index]);
+				}
 			}
 
 			template<pixel_type pixelfrom, pixel_type pixelto>
@@ -80,22 +116,35 @@ namespace impp
 			{
 				size_t i, j, pcount;
 
-				for (i = 0; i < size; )
+				for (i = 0; i < size && !decoder.failed(); )
 				{
 					const auto& blockhead = decoder.read<uint8_t>();
 					pcount = static_cast<size_t>(blockhead & 0x7F) + 1;
 
+					// packets must not run past the last pixel
+					if (pcount > size - i)
+					{
+						decoder.fail(error::ERROR_CORRUPT_DATA, "tga: rle packet exceeds image size.");
+						return;
+					}
+
 					if (blockhead & 0x80)
 					{
+						IMPP_INSTRUMENT_COUNT(rle_run_packets, 1);
+						IMPP_INSTRUMENT_COUNT(rle_run_pixels, pcount);
 						const auto& from = decoder.read<pixelfrom>();
 						for (j = 0; j < pcount; j++, pxto++)
-							pxto->from(from);
+							*pxto = pixel_cast<pixelto>(from);
 						i += pcount;
 					}
 					else
 					{
-						for (j = 0; j < pcount; j++, pxto++)
-							pxto->from(decoder.read<pixelfrom>());
+						IMPP_INSTRUMENT_COUNT(rle_raw_packets, 1);
+						IMPP_INSTRUMENT_COUNT(rle_raw_pixels, pcount);
+						const auto* pxfrom = decoder.peek<pixelfrom>(pcount);
+						decoder.proceed_reading(pcount * sizeof(pixelfrom));
+						pixel_convert(pxfrom, pxto, pcount);
+						pxto += pcount;
 						i += pcount;
 					}
 				}
@@ -104,16 +153,39 @@ namespace impp
 			template<pixel_type pixelfrom, pixel_type pixelto>
 			void tga_load_uncompressed_true_color(decoder& decoder, pixelto* pxto, size_t size)
 			{
-				const auto* pxfrom = decoder.peek<pixelfrom>();
+				const auto* pxfrom = decoder.peek<pixelfrom>(size);
 				decoder.proceed_reading(size * sizeof(pixelfrom));
+				if (decoder.failed())
+					return;
 				pixel_convert(pxfrom, pxto, size);
 			}
 
+			// bytes from the start of the file to the pixel data, the id and the colormap included
+			inline size_t tga_header_size(const tga_header& header)
+			{
+				const size_t colormap_size = header.colormap_type == 1 ? static_cast<size_t>(header.colormap_len) * ((header.colormap_entrysize + 7) / 8) : 0;
+				return sizeof(header) + header.idlen + colormap_size;
+			}
+
+			// least bytes of pixel data holding the pixels the header declares, checked before they are allocated
+			// raw data stores every pixel while a rle packet of 1 + bpp bytes gives at most 128 pixels
+			inline size_t tga_min_data_size(const tga_header& header)
+			{
+				const size_t pcount = static_cast<size_t>(header.width) * header.height;
+				const size_t stored = header.bits / 8;
+				if (header.image_type == TGA_RLE_RBG)
+					return (pcount + 127) / 128 * (1 + stored);
+				return pcount * stored;
+			}
+
+			// decodes a whole image, false is returned with the error recorded in the decoder
 			template<pixel_type pixel, class imagesize = image<pixel>::size>
-			inline bool tga_load_memory(const uint8_t* data, size_t size, imagesize* width, imagesize* height, imagesize* bpp, std::vector<pixel>* pixels, tga_header* pheader = nullptr)
+			inline bool tga_load_memory(decoder& decoder, imagesize* width, imagesize* height, imagesize* bpp, std::vector<pixel>* pixels, tga_header* pheader = nullptr)
 			{
-				auto decoder = decoder::create(data, size);
-				const auto& header = decoder.read<tga_header>();
+				IMPP_INSTRUMENT_STAGE(STAGE_HEADER);
+				const auto header = decoder.read<tga_header>();
+				if(decoder.failed())
+					return false;
 
 				if(pheader)
 					*pheader = header;
@@ -122,12 +194,12 @@ namespace impp
 					decoder.proceed_reading(header.idlen);
 
 				// extracting color map info
-				const auto cmap_entry_size = header.colormap_entrysize / 8;
-				const auto cmap_size = header.colormap_type == 1 ? header.colormap_len * cmap_entry_size : 0;
-				const auto cmap = decoder.peek<uint8_t>();
+				const size_t cmap_entry_size = header.colormap_entrysize / 8;
+				const size_t cmap_size = header.colormap_type == 1 ? header.colormap_len * cmap_entry_size : 0;
 
 				if (decoder.get_readable() < cmap_size)
-					return false;
+					return decoder.reject(error::ERROR_TRUNCATED, "tga: color map exceeds input.");
+				const auto cmap = decoder.peek<uint8_t>(cmap_size);
 
 				const auto pcount = static_cast<imagesize>(header.width) * static_cast<imagesize>(header.height);
 				const auto psize = header.colormap_type == 0 ? (header.bits / 8) : cmap_entry_size;
@@ -138,24 +210,36 @@ namespace impp
 				if (header.colormap_type == 1){
 					// supported mapped images can only use 16bit or 8bit palette
 					if (header.bits != 8 && header.bits != 16)
-						return false;
+						return decoder.reject(error::ERROR_UNSUPPORTED, "tga: color indexes must be 8 or 16 bit.");
 					if (header.bits * pcount < dsize)
-						return false;
+						return decoder.reject(error::ERROR_INVALID_HEADER, "tga: color indexes do not match input size.");
 
 					decoder.proceed_reading(cmap_size);
 				}
 
 				// supported images can only use 24bit or 32bit pixels
 				if(psize != 3 && psize != 4)
-					return false;
+					return decoder.reject(error::ERROR_UNSUPPORTED, "tga: pixels must be 24 or 32 bit.");
+
+				if (header.image_type != TGA_UNCOMPRESSED_MAPPED && header.image_type != TGA_UNCOMPRESSED_RGB && header.image_type != TGA_RLE_RBG)
+					return decoder.reject(error::ERROR_UNSUPPORTED, "tga: unsupported image type.");
+				if (dsize < tga_min_data_size(header))
+				{
+					// reported where the input ends like a read past it
+					decoder.proceed_reading(decoder.get_readable());
+					return decoder.fail(error::ERROR_TRUNCATED, "tga: pixel data exceeds input.");
+				}
 
 				// allocating temp pixels
 				std::vector<pixel> temp_pixel;
 				temp_pixel.resize(pcount);
+				IMPP_INSTRUMENT_ALLOCATION(pcount * sizeof(pixel));
+				IMPP_INSTRUMENT_MAX(palette_size, header.colormap_type == 1 ? header.colormap_len : 0);
 
 				// getting pixel pointer
 				auto bytes = temp_pixel.data();
 
+				IMPP_INSTRUMENT_STAGE(STAGE_DECODE);
 				switch (header.image_type)
 				{
 
@@ -166,16 +250,16 @@ namespace impp
 					case 3:
 						switch (header.bits)
 						{
-						case 8:  tga_load_paletted<pixel24bgr, pixel, uint8_t>(decoder, cmap, bytes, pcount); break;
-						case 16: tga_load_paletted<pixel24bgr, pixel, uint16_t>(decoder, cmap, bytes, pcount); break;
+						case 8:  tga_load_paletted<pixel24bgr, pixel, uint8_t>(decoder, cmap, header.colormap_len, bytes, pcount); break;
+						case 16: tga_load_paletted<pixel24bgr, pixel, uint16_t>(decoder, cmap, header.colormap_len, bytes, pcount); break;
 						}
 						break;
 
 					case 4:
 						switch (header.bits)
 						{
-						case 8:  tga_load_paletted<pixel32bgra, pixel, uint8_t>(decoder, cmap, bytes, pcount); break;
-						case 16: tga_load_paletted<pixel32bgra, pixel, uint16_t>(decoder, cmap, bytes, pcount); break;
+						case 8:  tga_load_paletted<pixel32bgra, pixel, uint8_t>(decoder, cmap, header.colormap_len, bytes, pcount); break;
+						case 16: tga_load_paletted<pixel32bgra, pixel, uint16_t>(decoder, cmap, header.colormap_len, bytes, pcount); break;
 						}
 						break;
 					}
@@ -187,7 +271,7 @@ namespace impp
 				{
 					// mismatching between remaining bytes and pixel space
 					if (dsize < isize)
-						return false;
+						return decoder.reject(error::ERROR_TRUNCATED, "tga: pixel data exceeds input.");
 
 					switch(psize)
 					{
@@ -211,9 +295,21 @@ namespace impp
 				}
 
 				default:
+					return decoder.reject(error::ERROR_UNSUPPORTED, "tga: unsupported image type.");
+				}
+
+				if (decoder.failed())
 					return false;
+
+				// images are kept bottom-up so top-left origin ones must be flipped
+				if (header.imagedesc & TGA_ORIGIN_TOP)
+				{
+					const size_t rowsize = header.width;
+					for (size_t top = 0, bottom = header.height - 1; top < bottom; top++, bottom--)
+						std::swap_ranges(bytes + top * rowsize, bytes + (top + 1) * rowsize, bytes + bottom * rowsize);
 				}
 
+				IMPP_INSTRUMENT_COUNT(bytes_read, decoder.get_read_offset());
 				*width = header.width;
 				*height = header.height;
 				*bpp = static_cast<int>(psize);
@@ -221,21 +317,353 @@ namespace impp
 				return true;
 			}
 
-			template<pixel_type pixel>
-			inline bool tga_load(const char* filename, typename image<pixel>::size* width, typename image<pixel>::size* height, typename image<pixel>::size* bpp, std::vector<pixel>* bytes, tga_header* header = nullptr)
+			// reads the header and the color map validating the supported formats
+			template<decoder_type decoder_t>
+			inline bool tga_read_header(decoder_t& decoder, tga_header* header, std::vector<uint8_t>* colormap)
 			{
-				std::ifstream f(filename, std::ios::binary | std::ios::ate);
-				if (!f.is_open())
+				IMPP_INSTRUMENT_STAGE(STAGE_HEADER);
+				*header = decoder.template read<tga_header>();
+				if(header->idlen != 0)
+					decoder.proceed_reading(header->idlen);
+				if(decoder.failed())
 					return false;
 
-				size_t size = f.tellg();
-				f.seekg(0);
+				// extracting color map
+				if(header->colormap_type == 1)
+				{
+					const auto cmap_size = static_cast<size_t>(header->colormap_len) * (header->colormap_entrysize / 8);
+					if(decoder.get_readable() < cmap_size)
+						return decoder.reject(error::ERROR_TRUNCATED, "tga: color map exceeds input.");
+					colormap->resize(cmap_size);
+					decoder.read(colormap->data(), cmap_size);
+					IMPP_INSTRUMENT_MAX(palette_size, header->colormap_len);
+				}
+
+				switch(header->image_type)
+				{
+				case TGA_UNCOMPRESSED_MAPPED:
+					// supported mapped images can only use 16bit or 8bit palette of 24bit or 32bit colors
+					if(header->colormap_type != 1 || (header->bits != 8 && header->bits != 16))
+						return decoder.reject(error::ERROR_UNSUPPORTED, "tga: color indexes must be 8 or 16 bit.");
+					if(header->colormap_entrysize != 24 && header->colormap_entrysize != 32)
+						return decoder.reject(error::ERROR_UNSUPPORTED, "tga: color map entries must be 24 or 32 bit.");
+					break;
+
+				case TGA_UNCOMPRESSED_RGB:
+				case TGA_RLE_RBG:
+					// supported images can only use 24bit or 32bit pixels
+					if(header->bits != 24 && header->bits != 32)
+						return decoder.reject(error::ERROR_UNSUPPORTED, "tga: pixels must be 24 or 32 bit.");
+					break;
 
-				auto buffer = std::make_unique<uint8_t[]>(size);
-				f.read((char*)buffer.get(), size);
-				f.close();
+				default:
+					return decoder.reject(error::ERROR_UNSUPPORTED, "tga: unsupported image type.");
+				}
 
-				return tga_load_memory(buffer.get(), size, width, height, bpp, bytes, header);
+				if(decoder.get_readable() < tga_min_data_size(*header))
+				{
+					decoder.proceed_reading(decoder.get_readable());
+					return decoder.fail(error::ERROR_TRUNCATED, "tga: pixel data exceeds input.");
+				}
+				return true;
+			}
+
+			// decodes a tga stream one row at a time in file order
+			template<pixel_type pixel, decoder_type decoder_t>
+			class tga_scanline_decoder
+			{
+			public:
+				tga_scanline_decoder(decoder_t& decoder, const tga_header& header, const std::vector<uint8_t>& colormap) :
+					_decoder(decoder), _header(header), _colormap(colormap), _width(header.width) {}
+
+				// decodes the next row converting only the pixels in [x, x + count)
+				void read_row(pixel* pxto, size_t x, size_t count)
+				{
+					switch (_header.image_type)
+					{
+					case TGA_UNCOMPRESSED_MAPPED:
+						if(_header.colormap_entrysize == 24)
+							_header.bits == 8 ? read_mapped<pixel24bgr, uint8_t>(pxto, x, count) : read_mapped<pixel24bgr, uint16_t>(pxto, x, count);
+						else
+							_header.bits == 8 ? read_mapped<pixel32bgra, uint8_t>(pxto, x, count) : read_mapped<pixel32bgra, uint16_t>(pxto, x, count);
+						break;
+
+					case TGA_UNCOMPRESSED_RGB:
+						_header.bits == 24 ? read_raw<pixel24bgr>(pxto, x, count) : read_raw<pixel32bgra>(pxto, x, count);
+						break;
+
+					case TGA_RLE_RBG:
+						if(_header.bits == 24)
+						{
+							skip_rle<pixel24bgr>(x);
+							read_rle<pixel24bgr>(pxto, count);
+							skip_rle<pixel24bgr>(_width - x - count);
+						}
+						else
+						{
+							skip_rle<pixel32bgra>(x);
+							read_rle<pixel32bgra>(pxto, count);
+							skip_rle<pixel32bgra>(_width - x - count);
+						}
+						break;
+					}
+				}
+
+				// skips the next rows without converting any pixel
+				void skip_rows(size_t rows)
+				{
+					switch (_header.image_type)
+					{
+					case TGA_UNCOMPRESSED_MAPPED:
+					case TGA_UNCOMPRESSED_RGB:
+						_decoder.proceed_reading(rows * _width * (_header.bits / 8));
+						break;
+
+					case TGA_RLE_RBG:
+						_header.bits == 24 ? skip_rle<pixel24bgr>(rows * _width) : skip_rle<pixel32bgra>(rows * _width);
+						break;
+					}
+				}
+
+			private:
+				template<pixel_type pixelfrom>
+				void read_raw(pixel* pxto, size_t x, size_t count)
+				{
+					_decoder.proceed_reading(x * sizeof(pixelfrom));
+					const auto* pxfrom = _decoder.template peek<pixelfrom>(count);
+					_decoder.proceed_reading(count * sizeof(pixelfrom));
+					if(_decoder.failed())
+						return;
+					pixel_convert(pxfrom, pxto, count);
+					_decoder.proceed_reading((_width - x - count) * sizeof(pixelfrom));
+				}
+
+				template<pixel_type pixelfrom, class palette_type>
+				void read_mapped(pixel* pxto, size_t x, size_t count)
+				{
+					const auto* map_pixels = reinterpret_cast<const pixelfrom*>(_colormap.data());
+					const auto map_len = _colormap.size() / sizeof(pixelfrom);
+
+					_decoder.proceed_reading(x * sizeof(palette_type));
+					const auto* indexes = _decoder.template peek<uint8_t>(count * sizeof(palette_type));
+					_decoder.proceed_reading(count * sizeof(palette_type));
+					if(_decoder.failed())
+						return;
+
+					for (size_t i = 0; i < count; i++, pxto++)
+					{
+						const auto index = tga_palette_index<palette_type>(indexes, i);
+						if(index >= map_len)
+						{
+							_decoder.fail(error::ERROR_CORRUPT_DATA, "tga: color index out of color map.");
+							return;
+						}
+						*pxto = pixel_cast<pixel>(map_pixels[index]);
+					}
+
+					_decoder.proceed_reading((_width - x - count) * sizeof(palette_type));
+				}
+
+				template<pixel_type pixelfrom>
+				void next_packet()
+				{
+					const auto blockhead = _decoder.template read<uint8_t>();
+					_packetleft = static_cast<size_t>(blockhead & 0x7F) + 1;
+					_packetrun = (blockhead & 0x80) != 0;
+					if(_packetrun)
+						_decoder.read(_packetcolor.data(), sizeof(pixelfrom));
+
+					IMPP_INSTRUMENT_COUNT(rle_run_packets, _packetrun ? 1 : 0);
+					IMPP_INSTRUMENT_COUNT(rle_raw_packets, _packetrun ? 0 : 1);
+					IMPP_INSTRUMENT_COUNT(rle_run_pixels, _packetrun ? _packetleft : 0);
+					IMPP_INSTRUMENT_COUNT(rle_raw_pixels, _packetrun ? 0 : _packetleft);
+				}
+
+				// packets may span over rows so their state is kept between calls
+				template<pixel_type pixelfrom>
+				void read_rle(pixel* pxto, size_t count)
+				{
+					while(count != 0 && !_decoder.failed())
+					{
+						if(_packetleft == 0)
+							next_packet<pixelfrom>();
+
+						const auto pcount = std::min(count, _packetleft);
+						if(_packetrun)
+						{
+							const auto color = pixel_cast<pixel>(*reinterpret_cast<const pixelfrom*>(_packetcolor.data()));
+							std::fill_n(pxto, pcount, color);
+						}
+						else
+						{
+							const auto* pxfrom = _decoder.template peek<pixelfrom>(pcount);
+							_decoder.proceed_reading(pcount * sizeof(pixelfrom));
+							pixel_convert(pxfrom, pxto, pcount);
+						}
+
+						pxto += pcount;
+						count -= pcount;
+						_packetleft -= pcount;
+					}
+				}
+
+				template<pixel_type pixelfrom>
+				void skip_rle(size_t count)
+				{
+					while(count != 0 && !_decoder.failed())
+					{
+						if(_packetleft == 0)
+							next_packet<pixelfrom>();
+
+						const auto pcount = std::min(count, _packetleft);
+						if(!_packetrun)
+							_decoder.proceed_reading(pcount * sizeof(pixelfrom));
+
+						count -= pcount;
+						_packetleft -= pcount;
+					}
+				}
+
+			private:
+				decoder_t& _decoder;
+				const tga_header _header;
+				const std::vector<uint8_t>& _colormap;
+				const size_t _width;
+
+				size_t _packetleft = 0;
+				bool _packetrun = false;
+				std::array<uint8_t, 4> _packetcolor{};
+			};
+
+			// reduces the image by a power of two factor while decoding it
+			// only the output, one decoded row and one accumulator row are kept in memory
+			template<pixel_type pixel, decoder_type decoder_t, class imagesize = image<pixel>::size>
+			inline bool tga_load_scaled(decoder_t& decoder, size_t factor, scale_filter filter, imagesize* width, imagesize* height, std::vector<pixel>* pixels)
+			{
+				// factor must be a power of two and small enough to fit the accumulator
+				if(factor == 0 || factor > 4096 || (factor & (factor - 1)) != 0)
+					return decoder.reject(error::ERROR_INVALID_ARGUMENT, "tga: scale factor must be a power of two up to 4096.");
+
+				tga_header header{};
+				std::vector<uint8_t> colormap;
+				if(!tga_read_header(decoder, &header, &colormap))
+					return false;
+
+				size_t shift = 0;
+				while((size_t(1) << shift) != factor)
+					shift++;
+
+				const size_t srcw = header.width;
+				const size_t srch = header.height;
+				const size_t dstw = (srcw + factor - 1) >> shift;
+				const size_t dsth = (srch + factor - 1) >> shift;
+
+				IMPP_INSTRUMENT_STAGE(STAGE_DECODE);
+				std::vector<pixel> temp_pixel(dstw * dsth);
+				std::vector<pixel> row(srcw);
+				IMPP_INSTRUMENT_ALLOCATION((dstw * dsth + srcw) * sizeof(pixel));
+				auto scanlines = tga_scanline_decoder<pixel, decoder_t>(decoder, header, colormap);
+
+				// output rows are kept bottom-up whatever the file origin is
+				const bool topdown = (header.imagedesc & TGA_ORIGIN_TOP) != 0;
+				auto dstrow = [&](size_t dy){ return temp_pixel.data() + (topdown ? dsth - dy - 1 : dy) * dstw; };
+
+				if(filter == SCALE_NEAREST)
+				{
+					for(size_t dy = 0; dy < dsth; dy++)
+					{
+						const auto band = std::min(factor, srch - (dy << shift));
+						scanlines.read_row(row.data(), 0, srcw);
+						scanlines.skip_rows(band - 1);
+						if(decoder.failed())
+							return false;
+
+						auto* to = dstrow(dy);
+						for(size_t dx = 0; dx < dstw; dx++)
+							to[dx] = row[dx << shift];
+					}
+				}
+
+				else
+				{
+					// pixels are averaged channel by channel whatever their order is
+					constexpr size_t channels = sizeof(pixel);
+					std::vector<uint32_t> accumulator(dstw * channels);
+					IMPP_INSTRUMENT_ALLOCATION(accumulator.size() * sizeof(uint32_t));
+
+					for(size_t dy = 0; dy < dsth; dy++)
+					{
+						const auto band = std::min(factor, srch - (dy << shift));
+						std::fill(accumulator.begin(), accumulator.end(), 0);
+
+						for(size_t r = 0; r < band; r++)
+						{
+							scanlines.read_row(row.data(), 0, srcw);
+							if(decoder.failed())
+								return false;
+							const auto* bytes = reinterpret_cast<const uint8_t*>(row.data());
+							for(size_t sx = 0; sx < srcw; sx++, bytes += channels)
+							{
+								auto* acc = accumulator.data() + (sx >> shift) * channels;
+								for(size_t c = 0; c < channels; c++)
+									acc[c] += bytes[c];
+							}
+						}
+
+						auto* to = reinterpret_cast<uint8_t*>(dstrow(dy));
+						const auto* acc = accumulator.data();
+						for(size_t dx = 0; dx < dstw; dx++)
+						{
+							const auto count = static_cast<uint32_t>(std::min(factor, srcw - (dx << shift)) * band);
+							for(size_t c = 0; c < channels; c++, to++, acc++)
+								*to = static_cast<uint8_t>((*acc + count / 2) / count);
+						}
+					}
+				}
+
+				*width = static_cast<imagesize>(dstw);
+				IMPP_INSTRUMENT_COUNT(bytes_read, decoder.get_read_offset());
+				*height = static_cast<imagesize>(dsth);
+				*pixels = std::move(temp_pixel);
+				return true;
+			}
+
+			// decodes only the rows and columns covered by region
+			// uncompressed rows are seeked directly while rle packets outside the region are skipped unconverted
+			template<pixel_type pixel, decoder_type decoder_t, class imagesize = image<pixel>::size>
+			inline bool tga_load_region(decoder_t& decoder, image_region region, imagesize* width, imagesize* height, std::vector<pixel>* pixels)
+			{
+				tga_header header{};
+				std::vector<uint8_t> colormap;
+				if(!tga_read_header(decoder, &header, &colormap))
+					return false;
+
+				if(!region.clip(header.width, header.height))
+					return decoder.reject(error::ERROR_INVALID_ARGUMENT, "tga: region outside of the image.");
+
+				// region is top-left based while file rows start from the origin
+				const bool topdown = (header.imagedesc & TGA_ORIGIN_TOP) != 0;
+				const size_t first = topdown ? region.y : header.height - region.y - region.height;
+
+				IMPP_INSTRUMENT_STAGE(STAGE_DECODE);
+				std::vector<pixel> temp_pixel(static_cast<size_t>(region.width) * region.height);
+				IMPP_INSTRUMENT_ALLOCATION(temp_pixel.size() * sizeof(pixel));
+				auto scanlines = tga_scanline_decoder<pixel, decoder_t>(decoder, header, colormap);
+				scanlines.skip_rows(first);
+
+				for(size_t i = 0; i < region.height && !decoder.failed(); i++)
+				{
+					const auto dy = topdown ? region.height - i - 1 : i;
+					scanlines.read_row(temp_pixel.data() + dy * region.width, region.x, region.width);
+				}
+				if(decoder.failed())
+					return false;
+
+				IMPP_INSTRUMENT_COUNT(bytes_read, decoder.get_read_offset());
+				*width = region.width;
+				*height = region.height;
+				*pixels = std::move(temp_pixel);
+				return true;
 			}
 
 			template<class palette_type = uint16_t, class imagetype, pixel_type pixelfrom = typename imagetype::pixel, pixel_type pixelto = pixel_bgr_cast<pixelfrom>>
@@ -264,115 +692,295 @@ namespace impp
 					colortable.emplace_back(pfx);
 				}
 
+				IMPP_INSTRUMENT_MAX(palette_size, colortable.size());
+				IMPP_INSTRUMENT_ALLOCATION(data.size() * sizeof(palette_type) + colortable.capacity() * sizeof(pixelto));
 				return std::make_tuple(colortable, data);
 			}
 
-			template<class imagetype, pixel_type pixel = typename imagetype::pixel, pixel_type pixelto = pixel_bgr_cast<pixel>>
-			std::vector<uint8_t> rle_compress_pixels(const imagetype& source){
-				static auto single_rle_chunk = [](auto iter, auto end, auto& ret){
-					// at least 1 element is required
-					if(iter == end)
-						return end;
-
-					// searching for equality
-					auto next = std::next(iter);
-					for(;next != end && std::distance(iter, next) < 128; next++){
-						if(*next != *iter)
-							break;
-					}
+			// splits pixels in packets of at most 128 pixels, calling emit(repeated, begin, length) for each
+			// runs hold two or more equal pixels, raw packets end where the next run starts
+			template<pixel_type pixel, class emit_type>
+			inline void rle_packets(const pixel* pixels, size_t count, emit_type&& emit)
+			{
+				for (size_t i = 0; i < count;)
+				{
+					size_t length = 1;
+					while (i + length < count && length < 128 && pixels[i + length] == pixels[i])
+						length++;
+					const bool repeated = length > 1;
+					if (!repeated)
+						while (i + length < count && length < 128 && (i + length + 1 == count || !(pixels[i + length] == pixels[i + length + 1])))
+							length++;
+					emit(repeated, i, length);
+					i += length;
+				}
+			}
 
-					const auto eqcount = std::distance(iter, next);
-					if(eqcount > 1)
-					{
-						// encoding header
-						const uint8_t eqheader = static_cast<uint8_t>(eqcount-1) | 0x80;
-						ret.emplace_back(eqheader);
+			// pixels planned at once by rle_packets_optimal, packets do not cross segments so the scratch stays bounded
+			constexpr size_t rle_optimal_segment = 64 * 1024;
 
-						// encoding color
-						auto color = pixel_cast<pixelto>(*iter);
-						const auto& view = pixel_bytes_view(color);
+			// the packets storing pixels in the fewest bytes, short runs inside noise are kept in raw packets
+			// when their own headers would cost more than storing their pixels again
+			template<pixel_type pixel, class emit_type>
+			inline void rle_packets_optimal(const pixel* pixels, size_t count, size_t color_bytes, emit_type&& emit)
+			{
+				const size_t scratch = std::min(count, rle_optimal_segment);
+				std::vector<size_t> cost(scratch + 1);
+				std::vector<uint8_t> headers(scratch);
+				std::vector<size_t> queue(scratch + 1);
 
-						for(const auto& b : view)
-							ret.emplace_back(b);
-						
-						return next;
-					}
+				for (size_t base = 0; base < count; base += rle_optimal_segment)
+				{
+					const size_t size = std::min(count - base, rle_optimal_segment);
+					const pixel* segment = pixels + base;
 
-					// no equality means raw packet is being appended
-					next = std::next(iter);
-					auto prev = iter;
+					// the bytes taken by the pixels from i onwards never grow with i, so runs are as long as they can be
+					// and raw packets need the cheapest of the 128 next packet starts, kept in a monotonic queue
+					cost[size] = 0;
+					size_t front = 0, back = 0;
+					const auto queued = [&](size_t j) { return cost[j] + j * color_bytes; };
 
-					for (; next != end && std::distance(iter, next) < 128; next++, prev = next) {
-						if (*next == *prev)
-							break;
+					size_t run = 0;
+					for (size_t i = size; i-- > 0;)
+					{
+						run = i + 1 < size && segment[i] == segment[i + 1] ? std::min<size_t>(run + 1, 128) : 1;
+
+						while (back != front && queued(queue[back - 1]) >= queued(i + 1))
+							back--;
+						queue[back++] = i + 1;
+						if (queue[front] > i + 128)
+							front++;
+
+						const size_t raw_end = queue[front];
+						cost[i] = 1 + queued(raw_end) - i * color_bytes;
+						headers[i] = static_cast<uint8_t>(raw_end - i - 1);
+						if (run > 1 && 1 + color_bytes + cost[i + run] <= cost[i])
+						{
+							cost[i] = 1 + color_bytes + cost[i + run];
+							headers[i] = static_cast<uint8_t>(run - 1) | 0x80;
+						}
 					}
 
-					// encoding header
-					const auto count = std::distance(iter, next);
-					const uint8_t header = static_cast<uint8_t>(count-1);
-					ret.emplace_back(header);
-
-					// encoding colors
-					for(; iter != next && iter != end; iter++)
+					for (size_t i = 0; i < size;)
 					{
-						auto color = pixel_cast<pixelto>(*iter);
-						const auto& view = pixel_bytes_view(color);
-
-						for (auto& b : view)
-							ret.emplace_back(b);
+						const size_t length = (headers[i] & 0x7F) + 1;
+						emit((headers[i] & 0x80) != 0, base + i, length);
+						i += length;
 					}
+				}
+			}
 
-					return next;
-				};
+			template<pixel_type pixel, class emit_type>
+			inline void rle_packets(tga_rle_mode mode, const pixel* pixels, size_t count, size_t color_bytes, emit_type&& emit)
+			{
+				if (mode == TGA_RLE_OPTIMAL)
+					rle_packets_optimal(pixels, count, color_bytes, emit);
+				else
+					rle_packets(pixels, count, emit);
+			}
 
-				auto iter = source.pixels.begin();
-				auto end = source.pixels.end();
-				
-				// encoding into buffer
+			template<class imagetype, pixel_type pixel = typename imagetype::pixel, pixel_type pixelto = pixel_bgr_cast<pixel>>
+			std::vector<uint8_t> rle_compress_pixels(const imagetype& source, tga_rle_mode mode = TGA_RLE_GREEDY){
 				std::vector<uint8_t> ret{};
-				while(iter != end)
-					iter = single_rle_chunk(iter, end, ret);
+				rle_packets(mode, source.pixels.data(), source.pixels.size(), sizeof(pixelto), [&](bool repeated, size_t begin, size_t length) {
+					if (repeated)
+					{
+						IMPP_INSTRUMENT_COUNT(rle_run_packets, 1);
+						IMPP_INSTRUMENT_COUNT(rle_run_pixels, length);
+					}
+					else
+					{
+						IMPP_INSTRUMENT_COUNT(rle_raw_packets, 1);
+						IMPP_INSTRUMENT_COUNT(rle_raw_pixels, length);
+					}
 
+					// a run stores its color once
+					ret.push_back(static_cast<uint8_t>(length - 1) | (repeated ? 0x80 : 0));
+					const size_t colors = repeated ? 1 : length;
+					for (size_t i = begin; i < begin + colors; i++)
+					{
+						const auto color = pixel_cast<pixelto>(source.pixels[i]);
+						const auto& view = pixel_bytes_view(color);
+						ret.insert(ret.end(), view.begin(), view.end());
+					}
+				});
+				IMPP_INSTRUMENT_ALLOCATION(ret.capacity());
 				return ret;
 			}
+
+			// rle size of evenly spaced rows scaled to the whole image, 0 rows encodes all of them
+			template<pixel_type pixel>
+			inline size_t rle_estimate_size(const image<pixel>& source, size_t color_bytes, uint32_t sample_rows, tga_rle_mode mode = TGA_RLE_GREEDY)
+			{
+				if (source.pixels.empty())
+					return 0;
+				const size_t rows = sample_rows == 0 ? source.height : std::min<size_t>(sample_rows, source.height);
+				size_t bytes = 0;
+				for (size_t sample = 0; sample < rows; sample++)
+				{
+					const size_t y = sample * source.height / rows;
+					rle_packets(mode, source.pixels.data() + y * source.width, source.width, color_bytes, [&](bool repeated, size_t, size_t length) {
+						bytes += 1 + (repeated ? 1 : length) * color_bytes;
+					});
+				}
+				return (bytes * source.height + rows / 2) / rows;
+			}
 		}
 
-		template<pixel_type pixel>
-		inline image<pixel> load(const std::string& filename) {
-			typename image<pixel>::pixelvec pixels{};
-			typename image<pixel>::size width = 0, height = 0, bpp = 0;
-			try
+		// tga 2.0 files end with a footer holding this signature
+		constexpr char TGA_FOOTER_SIGNATURE[] = "TRUEVISION-XFILE.";
+		constexpr size_t TGA_FOOTER_SIZE = 8 + sizeof(TGA_FOOTER_SIGNATURE);
+
+		inline bool has_footer(const void* memory, size_t size)
+		{
+			if (size < sizeof(tga_header) + TGA_FOOTER_SIZE)
+				return false;
+			const auto* footer = reinterpret_cast<const uint8_t*>(memory) + size - TGA_FOOTER_SIZE;
+			return memcmp(footer + 8, TGA_FOOTER_SIGNATURE, sizeof(TGA_FOOTER_SIGNATURE)) == 0;
+		}
+
+		// tga has no magic number so the header is checked for values a tga file can hold
+		// unsupported but valid types pass the check, loading them reports ERROR_UNSUPPORTED
+		inline bool is_plausible_header(const void* memory, size_t size)
+		{
+			tga_header header;
+			if (size < sizeof(header))
+				return false;
+			memcpy(&header, memory, sizeof(header));
+
+			const auto type = header.image_type & ~0x08;
+			if ((header.image_type & 0xF4) != 0 || type < 1 || type > 3)
+				return false;
+			if (header.colormap_type > 1 || (type == TGA_UNCOMPRESSED_MAPPED && header.colormap_type != 1))
+				return false;
+			if (header.width == 0 || header.height == 0 || (header.imagedesc & 0xC0) != 0)
+				return false;
+
+			switch (header.bits)
 			{
-				if (!detail::tga_load(filename.c_str(), &width, &height, &bpp, &pixels) || (bpp != 3 && bpp != 4))
-					return image<pixel>::null();
-				return image<pixel>::create(width, height, std::move(pixels));
+			case 8: case 15: case 16: case 24: case 32: break;
+			default: return false;
 			}
 
-			catch (const std::runtime_error& error)
+			size_t colormap_size = 0;
+			if (header.colormap_type == 1)
 			{
-				error::detail::on_error(error);
-				return image<pixel>::null();
+				switch (header.colormap_entrysize)
+				{
+				case 15: case 16: case 24: case 32: break;
+				default: return false;
+				}
+				colormap_size = static_cast<size_t>(header.colormap_len) * ((header.colormap_entrysize + 7) / 8);
 			}
+			return size - sizeof(header) >= header.idlen + colormap_size;
 		}
 
+		// try_* functions never throw nor call the error handler, failures are returned with their cause
+
 		template<pixel_type pixel>
-		inline image<pixel> load_memory(const void* memory, size_t size) {
-			auto* data = reinterpret_cast<const uint8_t*>(memory);
+		inline result<image<pixel>> try_load_memory(const void* memory, size_t size) {
+			IMPP_INSTRUMENT_CALL("tga", "load_memory");
 			typename image<pixel>::size width = 0, height = 0, bpp = 0;
 			typename image<pixel>::pixelvec pixels{};
 
-			try
-			{
-				if (!detail::tga_load_memory(data, size, &width, &height, &bpp, &pixels) || (bpp != 3 && bpp != 4))
-					return image<pixel>::null();
-				return image<pixel>::create(width, height, std::move(pixels));
-			}
+			auto decoder = decoder::create(memory, size, error::ERROR_POLICY_RECORD);
+			const bool decoded = detail::tga_load_memory(decoder, &width, &height, &bpp, &pixels);
+			return impp::detail::decoded_image(decoder, decoded, width, height, std::move(pixels));
+		}
 
-			catch (const std::runtime_error& error)
-			{
-				error::detail::on_error(error);
-				return image<pixel>::null();
-			}
+		template<pixel_type pixel>
+		inline result<image<pixel>> try_load(const std::string& filename) {
+			IMPP_INSTRUMENT_CALL("tga", "load");
+			std::vector<uint8_t> bytes;
+			if (!impp::detail::read_file(filename, &bytes))
+				return error::error_info{ error::ERROR_FILE_OPEN, 0, "tga: unable to read file." };
+			return try_load_memory<pixel>(bytes.data(), bytes.size());
+		}
+
+		template<pixel_type pixel>
+		inline result<image<pixel>> try_load_memory_scaled(const void* memory, size_t size, size_t factor, scale_filter filter = SCALE_BOX) {
+			IMPP_INSTRUMENT_CALL("tga", "load_memory_scaled");
+			typename image<pixel>::size width = 0, height = 0;
+			typename image<pixel>::pixelvec pixels{};
+
+			auto decoder = decoder::create(memory, size, error::ERROR_POLICY_RECORD);
+			const bool decoded = detail::tga_load_scaled(decoder, factor, filter, &width, &height, &pixels);
+			return impp::detail::decoded_image(decoder, decoded, width, height, std::move(pixels));
+		}
+
+		template<pixel_type pixel>
+		inline result<image<pixel>> try_load_scaled(const std::string& filename, size_t factor, scale_filter filter = SCALE_BOX) {
+			IMPP_INSTRUMENT_CALL("tga", "load_scaled");
+			typename image<pixel>::size width = 0, height = 0;
+			typename image<pixel>::pixelvec pixels{};
+
+			auto decoder = file_decoder::create(filename, error::ERROR_POLICY_RECORD);
+			if (!decoder.is_open())
+				return error::error_info{ error::ERROR_FILE_OPEN, 0, "tga: unable to read file." };
+			const bool decoded = detail::tga_load_scaled(decoder, factor, filter, &width, &height, &pixels);
+			return impp::detail::decoded_image(decoder, decoded, width, height, std::move(pixels));
+		}
+
+		template<pixel_type pixel>
+		inline result<image<pixel>> try_load_memory_region(const void* memory, size_t size, uint32_t x, uint32_t y, uint32_t width, uint32_t height) {
+			IMPP_INSTRUMENT_CALL("tga", "load_memory_region");
+			typename image<pixel>::size rwidth = 0, rheight = 0;
+			typename image<pixel>::pixelvec pixels{};
+
+			auto decoder = decoder::create(memory, size, error::ERROR_POLICY_RECORD);
+			const bool decoded = detail::tga_load_region(decoder, image_region{x, y, width, height}, &rwidth, &rheight, &pixels);
+			return impp::detail::decoded_image(decoder, decoded, rwidth, rheight, std::move(pixels));
+		}
+
+		template<pixel_type pixel>
+		inline result<image<pixel>> try_load_region(const std::string& filename, uint32_t x, uint32_t y, uint32_t width, uint32_t height) {
+			IMPP_INSTRUMENT_CALL("tga", "load_region");
+			typename image<pixel>::size rwidth = 0, rheight = 0;
+			typename image<pixel>::pixelvec pixels{};
+
+			auto decoder = file_decoder::create(filename, error::ERROR_POLICY_RECORD);
+			if (!decoder.is_open())
+				return error::error_info{ error::ERROR_FILE_OPEN, 0, "tga: unable to read file." };
+			const bool decoded = detail::tga_load_region(decoder, image_region{x, y, width, height}, &rwidth, &rheight, &pixels);
+			return impp::detail::decoded_image(decoder, decoded, rwidth, rheight, std::move(pixels));
+		}
+
+		// load functions return a null image on failure, errors found in the data are forwarded to the error handler
+
+		template<pixel_type pixel>
+		inline image<pixel> load(const std::string& filename) {
+			auto res = try_load<pixel>(filename);
+			return error::detail::report(res) ? std::move(res).value() : image<pixel>::null();
+		}
+
+		template<pixel_type pixel>
+		inline image<pixel> load_memory(const void* memory, size_t size) {
+			auto res = try_load_memory<pixel>(memory, size);
+			return error::detail::report(res) ? std::move(res).value() : image<pixel>::null();
+		}
+
+		template<pixel_type pixel>
+		inline image<pixel> load_scaled(const std::string& filename, size_t factor, scale_filter filter = SCALE_BOX) {
+			auto res = try_load_scaled<pixel>(filename, factor, filter);
+			return error::detail::report(res) ? std::move(res).value() : image<pixel>::null();
+		}
+
+		template<pixel_type pixel>
+		inline image<pixel> load_memory_scaled(const void* memory, size_t size, size_t factor, scale_filter filter = SCALE_BOX) {
+			auto res = try_load_memory_scaled<pixel>(memory, size, factor, filter);
+			return error::detail::report(res) ? std::move(res).value() : image<pixel>::null();
+		}
+
+		template<pixel_type pixel>
+		inline image<pixel> load_region(const std::string& filename, uint32_t x, uint32_t y, uint32_t width, uint32_t height) {
+			auto res = try_load_region<pixel>(filename, x, y, width, height);
+			return error::detail::report(res) ? std::move(res).value() : image<pixel>::null();
+		}
+
+		template<pixel_type pixel>
+		inline image<pixel> load_memory_region(const void* memory, size_t size, uint32_t x, uint32_t y, uint32_t width, uint32_t height) {
+			auto res = try_load_memory_region<pixel>(memory, size, x, y, width, height);
+			return error::detail::report(res) ? std::move(res).value() : image<pixel>::null();
 		}
 
 		template<tga_type type, pixel_type pixel>
@@ -390,7 +998,7 @@ namespace impp
 			header.bits = detect_bits<type, pixel>();
 			header.colormap_type = type == tga_type::TGA_UNCOMPRESSED_MAPPED ? 1 : 0;
 			header.colormap_entrysize = pixel_is24bit<pixel> ? 24 : 32;
-			header.colormap_origin = tga_type::TGA_UNCOMPRESSED_MAPPED ? sizeof(header) : 0;
+			header.colormap_origin = 0;
 			header.height = static_cast<uint16_t>(source.height);
 			header.width = static_cast<uint16_t>(source.width);
 			header.idlen = 0;
@@ -400,13 +1008,18 @@ namespace impp
 		}		
 
 		template<tga_type type = tga_type::TGA_UNCOMPRESSED_RGB, pixel_type pixel, encoder_type encoder>
-		inline bool save_to_encoder(const image<pixel>& source, encoder& enc)
+		inline bool save_to_encoder(const image<pixel>& source, encoder& enc, tga_rle_mode mode = TGA_RLE_GREEDY)
 		{
 			using pixel_dest = pixel_bgr_cast<pixel>;
 
+			IMPP_INSTRUMENT_CALL("tga", "save_to_encoder");
 			enc.reset();
 			if constexpr (type == tga_type::TGA_NONE)
-				return false;
+				return enc.reject(error::ERROR_INVALID_ARGUMENT, "tga: no image type given.");
+
+			// header fields are 16 bit wide
+			if (source.width > UINT16_MAX || source.height > UINT16_MAX)
+				return enc.reject(error::ERROR_UNSUPPORTED, "tga: images are limited to 65535 pixels per side.");
 
 			// writing header detecting it
 			auto header = detect_header<type>(source);
@@ -414,72 +1027,219 @@ namespace impp
 			// handling mapped images
 			if constexpr (type == tga_type::TGA_UNCOMPRESSED_MAPPED)
 			{
+				IMPP_INSTRUMENT_STAGE(STAGE_PALETTE);
 				auto [colortable, pixels] = detail::make_mapped_data(source);
-				header.colormap_len = colortable.size();
+				if (colortable.size() > UINT16_MAX)
+					return enc.reject(error::ERROR_UNSUPPORTED, "tga: mapped images are limited to 65535 colors.");
+				header.colormap_len = static_cast<uint16_t>(colortable.size());
 
-				enc.write(header);
-				enc.write_pixels(colortable);
-				enc.write(pixels.data(), pixels.size() * sizeof(pixels[0]));
-				return true;
+				IMPP_INSTRUMENT_STAGE(STAGE_IO);
+				// small palettes take a byte per index
+				if (colortable.size() <= 256)
+				{
+					header.bits = 8;
+					const std::vector<uint8_t> indexes(pixels.begin(), pixels.end());
+					enc.write(header);
+					enc.write_pixels(colortable);
+					enc.write_pixels(indexes);
+				}
+				else
+				{
+					enc.write(header);
+					enc.write_pixels(colortable);
+					enc.write(pixels.data(), pixels.size() * sizeof(pixels[0]));
+				}
 			}
 
 			// handling RLE images
 			else if constexpr (type == tga_type::TGA_RLE_RBG)
 			{
-				auto compressed_pixels = detail::rle_compress_pixels(source);
+				IMPP_INSTRUMENT_STAGE(STAGE_ENCODE);
+				auto compressed_pixels = detail::rle_compress_pixels(source, mode);
+
+				IMPP_INSTRUMENT_STAGE(STAGE_IO);
 				enc.write(header);
 				enc.write(compressed_pixels.data(), compressed_pixels.size());
-				return true;
 			}
 
 			// handling uncompressed rgb
 			else if constexpr (type == tga_type::TGA_UNCOMPRESSED_RGB)
 			{
+				IMPP_INSTRUMENT_STAGE(STAGE_IO);
 				enc.write(header);
 				if constexpr (std::is_same_v<pixel, pixel_dest>)
 					enc.write_pixels(source.pixels);
 				else
-					enc.write_pixels(
-						pixel_convert<pixel_dest>(source.pixels));
-				return true;
+					enc.template write_converted<pixel_dest>(source.pixels.data(), source.pixels.size());
 			}
 
-			return false;
+			else
+				return enc.reject(error::ERROR_UNSUPPORTED, "tga: unsupported image type.");
+
+			if (enc.failed())
+				return false;
+
+			IMPP_INSTRUMENT_COUNT(bytes_written, enc.get_writesize());
+			IMPP_INSTRUMENT_SUCCEEDED();
+			return true;
 		}
 
+		// returns the number of bytes written, mode only applies to rle images
 		template<tga_type type = tga_type::TGA_UNCOMPRESSED_RGB, pixel_type pixel>
-		inline bool save_to_file(const image<pixel>& source, const std::string& filename)
+		inline result<size_t> try_save_to_file(const image<pixel>& source, const std::string& filename, tga_rle_mode mode = TGA_RLE_GREEDY)
 		{
-			try
-			{
-				// using encoder to write output file
-				auto enc = file_encoder::create(filename);
-				if(!enc.is_open())
-					return false;
+			IMPP_INSTRUMENT_CALL("tga", "save_to_file");
+			auto enc = file_encoder::create(filename, error::ERROR_POLICY_RECORD);
+			if (!enc.is_open())
+				return error::error_info{ error::ERROR_FILE_OPEN, 0, "tga: unable to create file." };
+
+			if (!save_to_encoder<type>(source, enc, mode) || !enc.flush())
+				return enc.get_error();
+			return enc.get_writesize();
+		}
 
-				return save_to_encoder<type>(source, enc);
-			}
+		template<tga_type type = tga_type::TGA_UNCOMPRESSED_RGB, pixel_type pixel>
+		inline result<size_t> try_save_to_memory(const image<pixel>& source, memory_encoder& encoder, tga_rle_mode mode = TGA_RLE_GREEDY)
+		{
+			IMPP_INSTRUMENT_CALL("tga", "save_to_memory");
+			if (!save_to_encoder<type>(source, encoder, mode))
+				return encoder.get_error();
+			return encoder.get_writesize();
+		}
 
-			catch(const std::runtime_error& error)
+		template<tga_type type = tga_type::TGA_UNCOMPRESSED_RGB, pixel_type pixel>
+		inline bool save_to_file(const image<pixel>& source, const std::string& filename, tga_rle_mode mode = TGA_RLE_GREEDY)
+		{
+			return error::detail::report(try_save_to_file<type>(source, filename, mode));
+		}
+
+		template<tga_type type = tga_type::TGA_UNCOMPRESSED_RGB, pixel_type pixel>
+		inline bool save_to_memory(const image<pixel>& source, memory_encoder& encoder, tga_rle_mode mode = TGA_RLE_GREEDY)
+		{
+			return error::detail::report(try_save_to_memory<type>(source, encoder, mode));
+		}
+
+		// a format chosen by save_auto
+		struct tga_format
+		{
+			tga_type type = TGA_UNCOMPRESSED_RGB;
+			uint8_t bits = 0;               // per stored pixel, the size of the indexes for mapped images
+			uint8_t color_bits = 0;         // 24 or 32, of the palette entries for mapped images
+			size_t estimated_size = 0;
+			size_t size = 0;                // written bytes
+		};
+
+		struct tga_auto_options
+		{
+			// a format faster to decode is kept while its estimate exceeds the smallest one by at most this fraction
+			double tolerance = 0.0;
+			// rows encoded to estimate the rle size, 0 encodes all of them
+			uint32_t sample_rows = 64;
+			unsigned threads = 1;
+			tga_rle_mode rle_mode = TGA_RLE_GREEDY;
+		};
+
+		// estimates the size of every format from the image statistics without encoding it
+		// opaque 32bit images are stored as 24bit, mapped images need at most 65535 colors
+		template<pixel_type pixel>
+		inline tga_format choose_format(const image<pixel>& source, const tga_auto_options& options = {})
+		{
+			const size_t pixels = source.pixels.size();
+			const uint8_t color_bits = classify_alpha(source, options.threads) == ALPHA_OPAQUE ? 24 : 32;
+			const size_t color_bytes = color_bits / 8;
+
+			// ordered by decoding speed
+			std::vector<tga_format> candidates;
+			candidates.push_back({ TGA_UNCOMPRESSED_RGB, color_bits, color_bits, sizeof(tga_header) + pixels * color_bytes });
+			const size_t colors = count_colors(source, UINT16_MAX + 1, options.threads);
+			if (colors <= UINT16_MAX)
 			{
-				error::detail::on_error(error);
-				return false;
+				const uint8_t index_bits = colors <= 256 ? 8 : 16;
+				candidates.push_back({ TGA_UNCOMPRESSED_MAPPED, index_bits, color_bits, sizeof(tga_header) + colors * color_bytes + pixels * (index_bits / 8) });
 			}
+			candidates.push_back({ TGA_RLE_RBG, color_bits, color_bits, sizeof(tga_header) + detail::rle_estimate_size(source, color_bytes, options.sample_rows, options.rle_mode) });
+
+			size_t smallest = SIZE_MAX;
+			for (const auto& candidate : candidates)
+				smallest = std::min(smallest, candidate.estimated_size);
+			const double accepted = static_cast<double>(smallest) * (1.0 + std::max(options.tolerance, 0.0));
+			for (const auto& candidate : candidates)
+				if (static_cast<double>(candidate.estimated_size) <= accepted)
+					return candidate;
+			return candidates.front();
 		}
 
-		template<tga_type type = tga_type::TGA_UNCOMPRESSED_RGB, pixel_type pixel>
-		inline bool save_to_memory(const image<pixel>& source, memory_encoder& encoder)
+		namespace detail
 		{
-			try
+			template<tga_type type, pixel_type pixel, encoder_type encoder>
+			inline bool tga_save_format(const image<pixel>& source, const tga_format& format, encoder& enc, const tga_auto_options& options)
 			{
-				return save_to_encoder<type>(source, encoder);
+				if constexpr (pixel_is32bit<pixel>)
+					if (format.color_bits == 24)
+						return save_to_encoder<type>(image_convert<pixel24bgr>(source, options.threads), enc, options.rle_mode);
+				return save_to_encoder<type>(source, enc, options.rle_mode);
 			}
+		}
 
-			catch(const std::runtime_error& error)
+		template<pixel_type pixel, encoder_type encoder>
+		inline bool save_auto_to_encoder(const image<pixel>& source, encoder& enc, tga_format* chosen, const tga_auto_options& options = {})
+		{
+			IMPP_INSTRUMENT_CALL("tga", "save_auto_to_encoder");
+			auto format = choose_format(source, options);
+			bool saved = false;
+			switch (format.type)
 			{
-				error::detail::on_error(error);
-				return false;
+			case TGA_UNCOMPRESSED_MAPPED: saved = detail::tga_save_format<TGA_UNCOMPRESSED_MAPPED>(source, format, enc, options); break;
+			case TGA_RLE_RBG: saved = detail::tga_save_format<TGA_RLE_RBG>(source, format, enc, options); break;
+			default: saved = detail::tga_save_format<TGA_UNCOMPRESSED_RGB>(source, format, enc, options); break;
 			}
+			format.size = enc.get_writesize();
+			*chosen = format;
+			return saved;
+		}
+
+		// returns the chosen format along with the number of bytes written
+		template<pixel_type pixel>
+		inline result<tga_format> try_save_auto_to_file(const image<pixel>& source, const std::string& filename, const tga_auto_options& options = {})
+		{
+			IMPP_INSTRUMENT_CALL("tga", "save_auto_to_file");
+			auto enc = file_encoder::create(filename, error::ERROR_POLICY_RECORD);
+			if (!enc.is_open())
+				return error::error_info{ error::ERROR_FILE_OPEN, 0, "tga: unable to create file." };
+
+			tga_format format;
+			if (!save_auto_to_encoder(source, enc, &format, options) || !enc.flush())
+				return enc.get_error();
+			return format;
+		}
+
+		template<pixel_type pixel>
+		inline result<tga_format> try_save_auto_to_memory(const image<pixel>& source, memory_encoder& encoder, const tga_auto_options& options = {})
+		{
+			IMPP_INSTRUMENT_CALL("tga", "save_auto_to_memory");
+			tga_format format;
+			if (!save_auto_to_encoder(source, encoder, &format, options))
+				return encoder.get_error();
+			return format;
+		}
+
+		// the chosen format is stored in chosen when given
+		template<pixel_type pixel>
+		inline bool save_auto_to_file(const image<pixel>& source, const std::string& filename, tga_format* chosen = nullptr, const tga_auto_options& options = {})
+		{
+			auto res = try_save_auto_to_file(source, filename, options);
+			if (res && chosen)
+				*chosen = *res;
+			return error::detail::report(res);
+		}
+
+		template<pixel_type pixel>
+		inline bool save_auto_to_memory(const image<pixel>& source, memory_encoder& encoder, tga_format* chosen = nullptr, const tga_auto_options& options = {})
+		{
+			auto res = try_save_auto_to_memory(source, encoder, options);
+			if (res && chosen)
+				*chosen = *res;
+			return error::detail::report(res);
 		}
 	}
 }
@@ -0,0 +1,200 @@
+/*
+MIT License
+
+Copyright (c) 2022 IkarusDeveloper
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#pragma once
+#ifndef INCLUDE_IMPLUSPLUS_TRANSFORM_HPP
+#define INCLUDE_IMPLUSPLUS_TRANSFORM_HPP
+#include <stdint.h>
+#include <algorithm>
+#include <utility>
+#include "pixel.hpp"
+#include "simd.hpp"
+
+namespace impp
+{
+	namespace detail
+	{
+		// square tiles of this size stay in l1 for every pixel type
+		constexpr size_t transform_tile = 32;
+
+#ifdef IMPP_SIMD_SSE2
+		// transposes 4x4 32bit pixels held one row per register
+		inline void simd_transpose4x4_epi32(__m128i& r0, __m128i& r1, __m128i& r2, __m128i& r3)
+		{
+			const auto t0 = _mm_unpacklo_epi32(r0, r1);
+			const auto t1 = _mm_unpacklo_epi32(r2, r3);
+			const auto t2 = _mm_unpackhi_epi32(r0, r1);
+			const auto t3 = _mm_unpackhi_epi32(r2, r3);
+			r0 = _mm_unpacklo_epi64(t0, t1);
+			r1 = _mm_unpackhi_epi64(t0, t1);
+			r2 = _mm_unpacklo_epi64(t2, t3);
+			r3 = _mm_unpackhi_epi64(t2, t3);
+		}
+#endif
+
+		// writes the transpose of the width x height memory layout into dst (height pixels per row)
+		// flip_rows reverses the order of the output rows and flip_columns the pixels of each output row
+		template<pixel_type pixel>
+		void transpose_blocked(const pixel* src, size_t width, size_t height, pixel* dst, bool flip_rows, bool flip_columns)
+		{
+			auto dstrow = [&](size_t x) { return dst + (flip_rows ? width - x - 1 : x) * height; };
+			auto dstcol = [&](size_t y) { return flip_columns ? height - y - 1 : y; };
+
+			for (size_t by = 0; by < height; by += transform_tile)
+			{
+				const auto ey = std::min(by + transform_tile, height);
+				for (size_t bx = 0; bx < width; bx += transform_tile)
+				{
+					const auto ex = std::min(bx + transform_tile, width);
+					size_t y = by;
+
+#ifdef IMPP_SIMD_SSE2
+					if constexpr (sizeof(pixel) == 4)
+					{
+						// 4x4 blocks are transposed in registers, the tile borders fall back to the scalar loop
+						for (; y + 4 <= ey; y += 4)
+						{
+							size_t x = bx;
+							for (; x + 4 <= ex; x += 4)
+							{
+								const auto* from = src + y * width + x;
+								auto r0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(from));
+								auto r1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(from + width));
+								auto r2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(from + width * 2));
+								auto r3 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(from + width * 3));
+								simd_transpose4x4_epi32(r0, r1, r2, r3);
+
+								if (flip_columns)
+								{
+									r0 = _mm_shuffle_epi32(r0, _MM_SHUFFLE(0, 1, 2, 3));
+									r1 = _mm_shuffle_epi32(r1, _MM_SHUFFLE(0, 1, 2, 3));
+									r2 = _mm_shuffle_epi32(r2, _MM_SHUFFLE(0, 1, 2, 3));
+									r3 = _mm_shuffle_epi32(r3, _MM_SHUFFLE(0, 1, 2, 3));
+								}
+
+								const auto column = flip_columns ? height - y - 4 : y;
+								_mm_storeu_si128(reinterpret_cast<__m128i*>(dstrow(x) + column), r0);
+								_mm_storeu_si128(reinterpret_cast<__m128i*>(dstrow(x + 1) + column), r1);
+								_mm_storeu_si128(reinterpret_cast<__m128i*>(dstrow(x + 2) + column), r2);
+								_mm_storeu_si128(reinterpret_cast<__m128i*>(dstrow(x + 3) + column), r3);
+							}
+
+							for (size_t yy = y; yy < y + 4; yy++)
+								for (size_t xx = x; xx < ex; xx++)
+									dstrow(xx)[dstcol(yy)] = src[yy * width + xx];
+						}
+					}
+#endif
+
+					for (; y < ey; y++)
+						for (size_t x = bx; x < ex; x++)
+							dstrow(x)[dstcol(y)] = src[y * width + x];
+				}
+			}
+		}
+
+		// transposes a size x size memory layout in place swapping mirrored tiles
+		template<pixel_type pixel>
+		void transpose_square_inplace(pixel* data, size_t size)
+		{
+			size_t aligned = 0;
+
+#ifdef IMPP_SIMD_SSE2
+			if constexpr (sizeof(pixel) == 4)
+			{
+				aligned = size & ~size_t(3);
+				auto load = [&](size_t y, size_t x, __m128i* rows) {
+					for (size_t i = 0; i < 4; i++)
+						rows[i] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + (y + i) * size + x));
+				};
+				auto store = [&](size_t y, size_t x, const __m128i* rows) {
+					for (size_t i = 0; i < 4; i++)
+						_mm_storeu_si128(reinterpret_cast<__m128i*>(data + (y + i) * size + x), rows[i]);
+				};
+
+				for (size_t by = 0; by < aligned; by += transform_tile)
+				{
+					const auto ey = std::min(by + transform_tile, aligned);
+					for (size_t bx = by; bx < aligned; bx += transform_tile)
+					{
+						const auto ex = std::min(bx + transform_tile, aligned);
+						for (size_t y = by; y < ey; y += 4)
+						{
+							for (size_t x = bx == by ? y : bx; x < ex; x += 4)
+							{
+								__m128i upper[4], lower[4];
+								load(y, x, upper);
+								simd_transpose4x4_epi32(upper[0], upper[1], upper[2], upper[3]);
+								if (x == y)
+								{
+									store(y, x, upper);
+									continue;
+								}
+
+								load(x, y, lower);
+								simd_transpose4x4_epi32(lower[0], lower[1], lower[2], lower[3]);
+								store(x, y, upper);
+								store(y, x, lower);
+							}
+						}
+					}
+				}
+			}
+#endif
+
+			// scalar tiles, or only the strips left by the 4x4 blocks
+			for (size_t by = 0; by < size; by += transform_tile)
+			{
+				const auto ey = std::min(by + transform_tile, size);
+				for (size_t bx = by; bx < size; bx += transform_tile)
+				{
+					const auto ex = std::min(bx + transform_tile, size);
+					if (ex <= aligned)
+						continue;
+
+					for (size_t y = by; y < ey; y++)
+						for (size_t x = std::max({ bx, y + 1, aligned }); x < ex; x++)
+							std::swap(data[y * size + x], data[x * size + y]);
+				}
+			}
+		}
+
+		// reverses rows order and/or pixels order inside each row of a width x height memory layout
+		template<pixel_type pixel>
+		void flip_inplace(pixel* data, size_t width, size_t height, bool flip_columns, bool flip_rows)
+		{
+			if (flip_columns && flip_rows)
+				std::reverse(data, data + width * height);
+
+			else if (flip_columns)
+				for (size_t y = 0; y < height; y++)
+					std::reverse(data + y * width, data + (y + 1) * width);
+
+			else if (flip_rows && height > 1)
+				for (size_t top = 0, bottom = height - 1; top < bottom; top++, bottom--)
+					std::swap_ranges(data + top * width, data + (top + 1) * width, data + bottom * width);
+		}
+	}
+}
+
+#endif //INCLUDE_IMPLUSPLUS_TRANSFORM_HPP
@@ -0,0 +1,483 @@
+/*
+MIT License
+
+Copyright (c) 2022 IkarusDeveloper
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#pragma once
+#ifndef INCLUDE_IMPLUSPLUS_YUV_HPP
+#define INCLUDE_IMPLUSPLUS_YUV_HPP
+#include "image.hpp"
+
+#include <string.h>
+#include <stdint.h>
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <vector>
+#include "parallel.hpp"
+#include "pixel.hpp"
+#include "simd.hpp"
+
+namespace impp
+{
+	enum yuv_matrix : uint8_t {
+		YUV_BT601 = 0,      // standard definition video, jpeg
+		YUV_BT709,          // high definition video
+	};
+
+	enum yuv_range : uint8_t {
+		YUV_RANGE_LIMITED = 0,      // luma 16 to 235, chroma 16 to 240, what video encoders expect
+		YUV_RANGE_FULL,             // every plane 0 to 255
+	};
+
+	enum yuv_layout : uint8_t {
+		YUV_444 = 0,        // three full size planes
+		YUV_I420,           // full size luma, then cb and cr planes of half the sides rounded up
+		YUV_NV12,           // full size luma, then a half size plane of interleaved cb and cr
+	};
+
+	struct yuv_options
+	{
+		yuv_matrix matrix = YUV_BT601;
+		yuv_range range = YUV_RANGE_LIMITED;
+		// bands of rows are shared among workers, 0 asks for one per hardware thread
+		unsigned threads = 1;
+	};
+
+	// the planes of a frame in a single buffer without padding, rows run from the top of the image
+	class yuv_frame
+	{
+	public:
+		yuv_frame() = default;
+
+		static yuv_frame create(uint32_t width, uint32_t height, yuv_layout layout)
+		{
+			yuv_frame frame;
+			frame._width = width;
+			frame._height = height;
+			frame._layout = layout;
+			const size_t luma = size_t(width) * height;
+			const size_t chroma = size_t(frame.get_chroma_width()) * frame.get_chroma_height();
+			frame._offsets = { 0, luma, layout == YUV_NV12 ? luma : luma + chroma };
+			frame._data.resize(layout == YUV_444 ? luma * 3 : luma + chroma * 2);
+			return frame;
+		}
+
+		uint32_t get_width() const { return _width; }
+		uint32_t get_height() const { return _height; }
+		yuv_layout get_layout() const { return _layout; }
+		uint32_t get_chroma_width() const { return _layout == YUV_444 ? _width : (_width + 1) / 2; }
+		uint32_t get_chroma_height() const { return _layout == YUV_444 ? _height : (_height + 1) / 2; }
+		// 3 planes, nv12 frames have 2 with the second holding cb and cr pairs
+		size_t get_plane_count() const { return _layout == YUV_NV12 ? 2 : 3; }
+		uint8_t* get_plane(size_t index) { return _data.data() + _offsets[index]; }
+		const uint8_t* get_plane(size_t index) const { return _data.data() + _offsets[index]; }
+
+		// bytes between two rows of a plane
+		size_t get_stride(size_t index) const
+		{
+			if (index == 0)
+				return _width;
+			return _layout == YUV_NV12 ? size_t(get_chroma_width()) * 2 : get_chroma_width();
+		}
+
+		const std::vector<uint8_t>& get_data() const { return _data; }
+		bool empty() const { return _data.empty(); }
+
+	private:
+		uint32_t _width = 0;
+		uint32_t _height = 0;
+		yuv_layout _layout = YUV_444;
+		std::array<size_t, 3> _offsets{};
+		std::vector<uint8_t> _data;
+	};
+
+	namespace detail
+	{
+		// pixels converted by each worker, rounded to pairs of rows
+		constexpr size_t yuv_grain = 64 * 1024;
+		constexpr int yuv_forward_bits = 14;
+		constexpr int yuv_inverse_bits = 13;
+
+		// integer coefficients of both directions, forward ones in the byte order of the pixels
+		struct yuv_coefficients
+		{
+			std::array<int16_t, 4> y{};
+			std::array<int16_t, 4> cb{};
+			std::array<int16_t, 4> cr{};
+			int32_t y_offset = 0;
+			// inverse ones in rgb order
+			int16_t luma = 0;
+			int16_t r_cr = 0;
+			int16_t g_cb = 0;
+			int16_t g_cr = 0;
+			int16_t b_cb = 0;
+			int16_t y_base = 0;
+		};
+
+		// byte offsets of red, green and blue in a pixel
+		template<pixel_type pixel>
+		inline std::array<size_t, 3> yuv_channel_order()
+		{
+			const auto bytes = pixel_bytes_view(pixel_cast<pixel>(pixel32rgba{ 0, 1, 2, 3 }));
+			std::array<size_t, 3> order{};
+			for (size_t i = 0; i < 3; i++)
+				order[bytes[i]] = i;
+			return order;
+		}
+
+		template<pixel_type pixel>
+		inline yuv_coefficients yuv_make_coefficients(yuv_matrix matrix, yuv_range range)
+		{
+			const double kr = matrix == YUV_BT709 ? 0.2126 : 0.299;
+			const double kb = matrix == YUV_BT709 ? 0.0722 : 0.114;
+			const double kg = 1.0 - kr - kb;
+			const bool limited = range == YUV_RANGE_LIMITED;
+			const double ys = limited ? 219.0 / 255.0 : 1.0;
+			const double cs = limited ? 224.0 / 255.0 : 1.0;
+			const auto order = yuv_channel_order<pixel>();
+			const auto fixed = [](double value, int bits) { return static_cast<int16_t>(std::lround(value * (1 << bits))); };
+
+			yuv_coefficients c;
+			// white keeps its exact luma and grays their exact neutral chroma
+			c.y[order[0]] = fixed(kr * ys, yuv_forward_bits);
+			c.y[order[2]] = fixed(kb * ys, yuv_forward_bits);
+			c.y[order[1]] = static_cast<int16_t>(fixed(ys, yuv_forward_bits) - c.y[order[0]] - c.y[order[2]]);
+			c.cb[order[0]] = fixed(-kr * cs / (2 * (1 - kb)), yuv_forward_bits);
+			c.cb[order[2]] = fixed(cs / 2, yuv_forward_bits);
+			c.cb[order[1]] = static_cast<int16_t>(-c.cb[order[0]] - c.cb[order[2]]);
+			c.cr[order[0]] = fixed(cs / 2, yuv_forward_bits);
+			c.cr[order[2]] = fixed(-kb * cs / (2 * (1 - kr)), yuv_forward_bits);
+			c.cr[order[1]] = static_cast<int16_t>(-c.cr[order[0]] - c.cr[order[2]]);
+			c.y_offset = limited ? 16 : 0;
+
+			c.luma = fixed(1 / ys, yuv_inverse_bits);
+			c.r_cr = fixed(2 * (1 - kr) / cs, yuv_inverse_bits);
+			c.g_cb = fixed(2 * (1 - kb) * kb / (kg * cs), yuv_inverse_bits);
+			c.g_cr = fixed(2 * (1 - kr) * kr / (kg * cs), yuv_inverse_bits);
+			c.b_cb = fixed(2 * (1 - kb) / cs, yuv_inverse_bits);
+			c.y_base = static_cast<int16_t>(c.y_offset);
+			return c;
+		}
+
+		inline uint8_t yuv_clamp(int32_t value)
+		{
+			return static_cast<uint8_t>(std::clamp<int32_t>(value, 0, UINT8_MAX));
+		}
+
+		inline int32_t yuv_dot(const std::array<int16_t, 4>& coefficients, const int32_t* channels)
+		{
+			return coefficients[0] * channels[0] + coefficients[1] * channels[1] + coefficients[2] * channels[2];
+		}
+
+#ifdef IMPP_SIMD_SSE2
+		// sums the two pairs of every pixel of two madd results, one 32bit value per pixel
+		inline __m128i simd_yuv_hadd(__m128i first, __m128i second)
+		{
+			const __m128 a = _mm_castsi128_ps(first), b = _mm_castsi128_ps(second);
+			return _mm_add_epi32(_mm_castps_si128(_mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0))), _mm_castps_si128(_mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1))));
+		}
+
+		inline __m128i simd_yuv_coefficients(const std::array<int16_t, 4>& c)
+		{
+			return _mm_setr_epi16(c[0], c[1], c[2], c[3], c[0], c[1], c[2], c[3]);
+		}
+
+		// 8 results of 4 registers of two 16bit pixels each, rounded, shifted and offset
+		inline __m128i simd_yuv_dot8(const __m128i* pixels, __m128i coefficients, __m128i bias, int shift)
+		{
+			const __m128i count = _mm_cvtsi32_si128(shift);
+			const __m128i lo = _mm_sra_epi32(_mm_add_epi32(simd_yuv_hadd(_mm_madd_epi16(pixels[0], coefficients), _mm_madd_epi16(pixels[1], coefficients)), bias), count);
+			const __m128i hi = _mm_sra_epi32(_mm_add_epi32(simd_yuv_hadd(_mm_madd_epi16(pixels[2], coefficients), _mm_madd_epi16(pixels[3], coefficients)), bias), count);
+			const __m128i words = _mm_packs_epi32(lo, hi);
+			return _mm_packus_epi16(words, words);
+		}
+
+		inline void simd_yuv_load8(const uint8_t* bytes, __m128i* pixels)
+		{
+			const __m128i zero = _mm_setzero_si128();
+			const __m128i first = _mm_loadu_si128(reinterpret_cast<const __m128i*>(bytes));
+			const __m128i second = _mm_loadu_si128(reinterpret_cast<const __m128i*>(bytes + 16));
+			pixels[0] = _mm_unpacklo_epi8(first, zero);
+			pixels[1] = _mm_unpackhi_epi8(first, zero);
+			pixels[2] = _mm_unpacklo_epi8(second, zero);
+			pixels[3] = _mm_unpackhi_epi8(second, zero);
+		}
+#endif
+
+		// one row of luma, with full resolution chroma for 4:4:4 frames
+		template<pixel_type pixel>
+		inline void yuv_encode_row(const pixel* row, uint32_t width, const yuv_coefficients& c, uint8_t* luma, uint8_t* cb, uint8_t* cr)
+		{
+			const auto* bytes = reinterpret_cast<const uint8_t*>(row);
+			const int32_t luma_bias = (c.y_offset << yuv_forward_bits) + (1 << (yuv_forward_bits - 1));
+			const int32_t chroma_bias = (128 << yuv_forward_bits) + (1 << (yuv_forward_bits - 1));
+			uint32_t x = 0;
+#ifdef IMPP_SIMD_SSE2
+			if constexpr (pixel_is32bit<pixel>)
+			{
+				const __m128i ky = simd_yuv_coefficients(c.y), kcb = simd_yuv_coefficients(c.cb), kcr = simd_yuv_coefficients(c.cr);
+				const __m128i ybias = _mm_set1_epi32(luma_bias), cbias = _mm_set1_epi32(chroma_bias);
+				for (; x + 8 <= width; x += 8)
+				{
+					__m128i pixels[4];
+					simd_yuv_load8(bytes + x * 4, pixels);
+					_mm_storel_epi64(reinterpret_cast<__m128i*>(luma + x), simd_yuv_dot8(pixels, ky, ybias, yuv_forward_bits));
+					if (cb)
+					{
+						_mm_storel_epi64(reinterpret_cast<__m128i*>(cb + x), simd_yuv_dot8(pixels, kcb, cbias, yuv_forward_bits));
+						_mm_storel_epi64(reinterpret_cast<__m128i*>(cr + x), simd_yuv_dot8(pixels, kcr, cbias, yuv_forward_bits));
+					}
+				}
+			}
+#endif
+			for (; x < width; x++)
+			{
+				const uint8_t* p = bytes + size_t(x) * sizeof(pixel);
+				const int32_t channels[3] = { p[0], p[1], p[2] };
+				luma[x] = yuv_clamp((yuv_dot(c.y, channels) + luma_bias) >> yuv_forward_bits);
+				if (cb)
+				{
+					cb[x] = yuv_clamp((yuv_dot(c.cb, channels) + chroma_bias) >> yuv_forward_bits);
+					cr[x] = yuv_clamp((yuv_dot(c.cr, channels) + chroma_bias) >> yuv_forward_bits);
+				}
+			}
+		}
+
+		// chroma of the 2x2 blocks of a pair of rows, the same row twice for the last one of odd heights
+		// the four pixels are summed before the coefficients apply, step is 2 for interleaved nv12 planes
+		template<pixel_type pixel>
+		inline void yuv_encode_chroma(const pixel* top, const pixel* bottom, uint32_t width, const yuv_coefficients& c, uint8_t* cb, uint8_t* cr, size_t step)
+		{
+			const auto* t = reinterpret_cast<const uint8_t*>(top);
+			const auto* b = reinterpret_cast<const uint8_t*>(bottom);
+			constexpr int shift = yuv_forward_bits + 2;
+			const int32_t bias = (128 << shift) + (1 << (shift - 1));
+			const uint32_t blocks = (width + 1) / 2;
+			uint32_t block = 0;
+#ifdef IMPP_SIMD_SSE2
+			if constexpr (pixel_is32bit<pixel>)
+			{
+				const __m128i kcb = simd_yuv_coefficients(c.cb), kcr = simd_yuv_coefficients(c.cr);
+				const __m128i vbias = _mm_set1_epi32(bias);
+				const __m128i count = _mm_cvtsi32_si128(shift);
+				for (; block + 4 <= width / 2; block += 4)
+				{
+					__m128i upper[4], lower[4], sums[4];
+					simd_yuv_load8(t + block * 8, upper);
+					simd_yuv_load8(b + block * 8, lower);
+					// vertical then horizontal neighbors, each sum ends in the low half of its register
+					for (size_t i = 0; i < 4; i++)
+					{
+						const __m128i column = _mm_add_epi16(upper[i], lower[i]);
+						sums[i] = _mm_add_epi16(column, _mm_srli_si128(column, 8));
+					}
+					const __m128i first = _mm_unpacklo_epi64(sums[0], sums[1]);
+					const __m128i second = _mm_unpacklo_epi64(sums[2], sums[3]);
+					const auto dot = [&](__m128i k) {
+						const __m128i value = _mm_sra_epi32(_mm_add_epi32(simd_yuv_hadd(_mm_madd_epi16(first, k), _mm_madd_epi16(second, k)), vbias), count);
+						const __m128i words = _mm_packs_epi32(value, value);
+						return _mm_packus_epi16(words, words);
+					};
+					const __m128i vcb = dot(kcb), vcr = dot(kcr);
+					if (step == 2)
+						_mm_storel_epi64(reinterpret_cast<__m128i*>(cb + block * 2), _mm_unpacklo_epi8(vcb, vcr));
+					else
+					{
+						const int32_t packed_cb = _mm_cvtsi128_si32(vcb), packed_cr = _mm_cvtsi128_si32(vcr);
+						memcpy(cb + block, &packed_cb, 4);
+						memcpy(cr + block, &packed_cr, 4);
+					}
+				}
+			}
+#endif
+			for (; block < blocks; block++)
+			{
+				const size_t left = size_t(block) * 2 * sizeof(pixel);
+				const size_t right = std::min<size_t>(block * 2 + 1, width - 1) * sizeof(pixel);
+				int32_t channels[3];
+				for (size_t i = 0; i < 3; i++)
+					channels[i] = t[left + i] + t[right + i] + b[left + i] + b[right + i];
+				cb[block * step] = yuv_clamp((yuv_dot(c.cb, channels) + bias) >> shift);
+				cr[block * step] = yuv_clamp((yuv_dot(c.cr, channels) + bias) >> shift);
+			}
+		}
+
+		// one row of pixels from luma and chroma rows of the same width, chroma read every step bytes
+		template<pixel_type pixel>
+		inline void yuv_decode_row(const uint8_t* luma, const uint8_t* cb, const uint8_t* cr, size_t step, bool halved, uint32_t width, const yuv_coefficients& c, pixel* row)
+		{
+			auto* bytes = reinterpret_cast<uint8_t*>(row);
+			const auto order = yuv_channel_order<pixel>();
+			constexpr int32_t round = 1 << (yuv_inverse_bits - 1);
+			const auto chroma = [&](const uint8_t* plane, uint32_t x) { return int32_t(plane[(halved ? x / 2 : x) * step]) - 128; };
+			uint32_t x = 0;
+#ifdef IMPP_SIMD_SSE2
+			if constexpr (pixel_is32bit<pixel>)
+			{
+				const __m128i zero = _mm_setzero_si128();
+				const __m128i base = _mm_set1_epi16(c.y_base), neutral = _mm_set1_epi16(128);
+				// 8 chroma values of both planes as 16bit lanes, subsampled ones repeated in pairs
+				const auto load_chroma = [&](uint32_t at, __m128i& u, __m128i& v) {
+					if (step == 2)
+					{
+						const __m128i pairs = _mm_unpacklo_epi8(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(cb + at * 2)), zero);
+						u = _mm_shufflehi_epi16(_mm_shufflelo_epi16(pairs, _MM_SHUFFLE(2, 2, 0, 0)), _MM_SHUFFLE(2, 2, 0, 0));
+						v = _mm_shufflehi_epi16(_mm_shufflelo_epi16(pairs, _MM_SHUFFLE(3, 3, 1, 1)), _MM_SHUFFLE(3, 3, 1, 1));
+					}
+					else if (halved)
+					{
+						int32_t packed_cb, packed_cr;
+						memcpy(&packed_cb, cb + at, 4);
+						memcpy(&packed_cr, cr + at, 4);
+						const __m128i vcb = _mm_cvtsi32_si128(packed_cb), vcr = _mm_cvtsi32_si128(packed_cr);
+						u = _mm_unpacklo_epi8(_mm_unpacklo_epi8(vcb, vcb), zero);
+						v = _mm_unpacklo_epi8(_mm_unpacklo_epi8(vcr, vcr), zero);
+					}
+					else
+					{
+						u = _mm_unpacklo_epi8(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(cb + at)), zero);
+						v = _mm_unpacklo_epi8(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(cr + at)), zero);
+					}
+					u = _mm_sub_epi16(u, neutral);
+					v = _mm_sub_epi16(v, neutral);
+				};
+				const __m128i bias = _mm_set1_epi32(round);
+				const auto pair = [](int16_t first, int16_t second) {
+					return _mm_set1_epi32(static_cast<int32_t>(static_cast<uint16_t>(first) | (static_cast<uint32_t>(static_cast<uint16_t>(second)) << 16)));
+				};
+				const __m128i kr = pair(c.luma, c.r_cr), kg = pair(c.luma, static_cast<int16_t>(-c.g_cb)), kgr = pair(static_cast<int16_t>(-c.g_cr), 0), kb = pair(c.luma, c.b_cb);
+				const auto channel = [&](__m128i lo, __m128i hi) {
+					const __m128i words = _mm_packs_epi32(_mm_srai_epi32(_mm_add_epi32(lo, bias), yuv_inverse_bits), _mm_srai_epi32(_mm_add_epi32(hi, bias), yuv_inverse_bits));
+					return _mm_packus_epi16(words, words);
+				};
+				for (; x + 8 <= width; x += 8)
+				{
+					const __m128i y = _mm_sub_epi16(_mm_unpacklo_epi8(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(luma + x)), zero), base);
+					__m128i vu, vv;
+					load_chroma(halved ? x / 2 : x, vu, vv);
+					const __m128i ycr_lo = _mm_unpacklo_epi16(y, vv), ycr_hi = _mm_unpackhi_epi16(y, vv);
+					const __m128i ycb_lo = _mm_unpacklo_epi16(y, vu), ycb_hi = _mm_unpackhi_epi16(y, vu);
+					const __m128i cr_lo = _mm_unpacklo_epi16(vv, zero), cr_hi = _mm_unpackhi_epi16(vv, zero);
+
+					__m128i rgb[3];
+					rgb[0] = channel(_mm_madd_epi16(ycr_lo, kr), _mm_madd_epi16(ycr_hi, kr));
+					rgb[1] = channel(_mm_add_epi32(_mm_madd_epi16(ycb_lo, kg), _mm_madd_epi16(cr_lo, kgr)), _mm_add_epi32(_mm_madd_epi16(ycb_hi, kg), _mm_madd_epi16(cr_hi, kgr)));
+					rgb[2] = channel(_mm_madd_epi16(ycb_lo, kb), _mm_madd_epi16(ycb_hi, kb));
+
+					// bytes 0 and 2 of the pixels hold red and blue in the order of the pixel type
+					const __m128i first = _mm_unpacklo_epi8(rgb[order[0] == 0 ? 0 : 2], rgb[1]);
+					const __m128i second = _mm_unpacklo_epi8(rgb[order[0] == 0 ? 2 : 0], _mm_set1_epi8(-1));
+					_mm_storeu_si128(reinterpret_cast<__m128i*>(bytes + x * 4), _mm_unpacklo_epi16(first, second));
+					_mm_storeu_si128(reinterpret_cast<__m128i*>(bytes + x * 4 + 16), _mm_unpackhi_epi16(first, second));
+				}
+			}
+#endif
+			for (; x < width; x++)
+			{
+				const int32_t y = (int32_t(luma[x]) - c.y_base) * c.luma;
+				const int32_t u = chroma(cb, x), v = chroma(cr, x);
+				uint8_t* p = bytes + size_t(x) * sizeof(pixel);
+				p[order[0]] = yuv_clamp((y + c.r_cr * v + round) >> yuv_inverse_bits);
+				p[order[1]] = yuv_clamp((y - c.g_cb * u - c.g_cr * v + round) >> yuv_inverse_bits);
+				p[order[2]] = yuv_clamp((y + c.b_cb * u + round) >> yuv_inverse_bits);
+				if constexpr (pixel_is32bit<pixel>)
+					p[3] = UINT8_MAX;
+			}
+		}
+
+		// memory row of the image row y counted from the top
+		template<pixel_type pixel>
+		inline size_t yuv_image_row(const image<pixel>& img, size_t y)
+		{
+			return img.orientation == image<pixel>::LEFT_TOP ? img.height - 1 - y : y;
+		}
+
+		// pairs of rows given to each worker
+		inline size_t yuv_band(uint32_t width)
+		{
+			return std::max<size_t>(1, yuv_grain / 2 / std::max(width, 1u));
+		}
+	}
+
+	// alpha is ignored, chroma of subsampled layouts averages each 2x2 block in the same pass as luma
+	template<pixel_type pixel>
+	inline yuv_frame rgb_to_yuv(const image<pixel>& source, yuv_layout layout, const yuv_options& options = {})
+	{
+		auto frame = yuv_frame::create(source.width, source.height, layout);
+		if (source.empty())
+			return frame;
+		const auto c = detail::yuv_make_coefficients<pixel>(options.matrix, options.range);
+		const auto row = [&](size_t y) { return source.pixels.data() + detail::yuv_image_row(source, y) * source.width; };
+		uint8_t* luma = frame.get_plane(0);
+
+		if (layout == YUV_444)
+		{
+			detail::parallel_for(source.height, detail::yuv_band(source.width) * 2, options.threads, [&](size_t begin, size_t end) {
+				for (size_t y = begin; y < end; y++)
+					detail::yuv_encode_row(row(y), source.width, c, luma + y * source.width, frame.get_plane(1) + y * source.width, frame.get_plane(2) + y * source.width);
+			});
+			return frame;
+		}
+
+		const size_t step = layout == YUV_NV12 ? 2 : 1;
+		uint8_t* cb = frame.get_plane(1);
+		uint8_t* cr = layout == YUV_NV12 ? cb + 1 : frame.get_plane(2);
+		detail::parallel_for(frame.get_chroma_height(), detail::yuv_band(source.width), options.threads, [&](size_t begin, size_t end) {
+			for (size_t pair = begin; pair < end; pair++)
+			{
+				const size_t top = pair * 2, bottom = std::min<size_t>(top + 1, source.height - 1);
+				detail::yuv_encode_row<pixel>(row(top), source.width, c, luma + top * source.width, nullptr, nullptr);
+				if (bottom != top)
+					detail::yuv_encode_row<pixel>(row(bottom), source.width, c, luma + bottom * source.width, nullptr, nullptr);
+				const size_t offset = pair * frame.get_stride(1);
+				detail::yuv_encode_chroma(row(top), row(bottom), source.width, c, cb + offset, cr + offset, step);
+			}
+		});
+		return frame;
+	}
+
+	// subsampled chroma is repeated over its 2x2 block, the options must match the ones of the conversion
+	template<pixel_type pixel = pixel32bgra>
+	inline image<pixel> yuv_to_rgb(const yuv_frame& frame, const yuv_options& options = {})
+	{
+		auto ret = image<pixel>::create(frame.get_width(), frame.get_height());
+		if (frame.empty())
+			return ret;
+		const auto c = detail::yuv_make_coefficients<pixel>(options.matrix, options.range);
+		const bool halved = frame.get_layout() != YUV_444;
+		const size_t step = frame.get_layout() == YUV_NV12 ? 2 : 1;
+		const uint8_t* cb = frame.get_plane(1);
+		const uint8_t* cr = frame.get_layout() == YUV_NV12 ? cb + 1 : frame.get_plane(2);
+
+		detail::parallel_for(frame.get_height(), detail::yuv_band(frame.get_width()) * 2, options.threads, [&](size_t begin, size_t end) {
+			for (size_t y = begin; y < end; y++)
+			{
+				const size_t offset = (halved ? y / 2 : y) * frame.get_stride(1);
+				detail::yuv_decode_row(frame.get_plane(0) + y * frame.get_width(), cb + offset, cr + offset, step, halved, frame.get_width(), c,
+					ret.pixels.data() + detail::yuv_image_row(ret, y) * ret.width);
+			}
+		});
+		return ret;
+	}
+}
+
+#endif //INCLUDE_IMPLUSPLUS_YUV_HPP
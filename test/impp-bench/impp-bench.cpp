@@ -0,0 +1,762 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <unordered_set>
+#include <vector>
+#include <tga.hpp>
+#include <bmp.hpp>
+#include <codec.hpp>
+#include <qoi.hpp>
+#include <png.hpp>
+#include <dds.hpp>
+#include <mipmap.hpp>
+#include <atlas.hpp>
+#include <hash.hpp>
+#include <cache.hpp>
+#include <lazy.hpp>
+#include <stats.hpp>
+#include <colorspace.hpp>
+#include <filter.hpp>
+#include <yuv.hpp>
+#include <pipeline.hpp>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+// impp-bench [--json file] [--filter text] [--sizes 256,1024] [--min-time seconds]
+// every benchmark reports MB/s of raw pixel data and pixels/s, --json writes them for regression tracking
+
+using namespace impp;
+
+namespace
+{
+    struct options
+    {
+        std::string json;
+        std::string filter;
+        std::vector<uint32_t> sizes = { 256, 1024 };
+        double min_time = 0.1;
+    };
+
+    // synthetic content used as benchmark input
+    struct input
+    {
+        std::string kind;
+        image<pixel32rgba> source = image<pixel32rgba>::null();
+        size_t colors = 0;
+    };
+
+    struct result
+    {
+        std::string group;
+        std::string name;
+        std::string kind;
+        uint32_t width = 0;
+        uint32_t height = 0;
+        size_t pixels = 0;
+        size_t bytes = 0;
+        size_t encoded = 0;
+        size_t iterations = 0;
+        double seconds = 0;
+    };
+
+    class suite
+    {
+    public:
+        explicit suite(const options& opt) : _options(opt) {}
+
+        // times func until min_time is reached, pixels and bytes are the raw pixel data touched by a single call
+        template<class func>
+        void run(const std::string& group, const std::string& name, const input& in, size_t pixels, size_t bytes, func&& f, size_t encoded = 0)
+        {
+            const auto fullname = group + "/" + name;
+            if (!_options.filter.empty() && fullname.find(_options.filter) == std::string::npos)
+                return;
+
+            f();
+
+            size_t iterations = 0;
+            const auto begin = std::chrono::steady_clock::now();
+            double elapsed = 0;
+            do
+            {
+                f();
+                iterations++;
+                elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+            } while (elapsed < _options.min_time);
+
+            result res{ group, name, in.kind, in.source.width, in.source.height, pixels, bytes, encoded, iterations, elapsed / iterations };
+            print(res);
+            _results.push_back(res);
+        }
+
+        void write_json(const std::string& filename) const
+        {
+            std::ofstream f(filename);
+            f << "{\n  \"benchmarks\": [\n";
+            for (size_t i = 0; i < _results.size(); i++)
+            {
+                const auto& r = _results[i];
+                f << "    { \"group\": \"" << r.group << "\", \"name\": \"" << r.name << "\", \"input\": \"" << r.kind
+                    << "\", \"width\": " << r.width << ", \"height\": " << r.height
+                    << ", \"pixels\": " << r.pixels << ", \"bytes\": " << r.bytes << ", \"encoded_bytes\": " << r.encoded
+                    << ", \"iterations\": " << r.iterations << ", \"seconds\": " << r.seconds
+                    << ", \"mb_per_s\": " << r.bytes / r.seconds / 1e6
+                    << ", \"pixels_per_s\": " << r.pixels / r.seconds << " }"
+                    << (i + 1 == _results.size() ? "\n" : ",\n");
+            }
+            f << "  ]\n}\n";
+        }
+
+    private:
+        static void print(const result& r)
+        {
+            std::cout << r.group << "/" << r.name << " [" << r.kind << " " << r.width << "x" << r.height << "] "
+                << r.seconds * 1e3 << " ms, " << r.bytes / r.seconds / 1e6 << " MB/s, "
+                << r.pixels / r.seconds / 1e6 << " Mpixels/s";
+            if (r.encoded)
+                std::cout << ", " << r.encoded << " bytes encoded";
+            std::cout << std::endl;
+        }
+
+        const options& _options;
+        std::vector<result> _results;
+    };
+
+    // keeps the compiler from discarding results that are never read
+    template<class value>
+    void do_not_optimize(const value& v)
+    {
+#if defined(_MSC_VER)
+        static volatile const void* sink;
+        sink = &v;
+        _ReadWriteBarrier();
+#else
+        asm volatile("" : : "r"(&v) : "memory");
+#endif
+    }
+
+    input make_input(const std::string& kind, uint32_t size)
+    {
+        std::mt19937 rng(size);
+        auto img = image<pixel32rgba>::create(size, size);
+        const float scale = 1.0f / std::max<uint32_t>(size - 1, 1);
+
+        for (uint32_t y = 0; y < size; y++)
+        {
+            for (uint32_t x = 0; x < size; x++)
+            {
+                auto& px = img.pixels[y * size + x];
+                if (kind == "solid")
+                    px = { 40, 120, 200, 255 };
+
+                else if (kind == "gradient")
+                    px = { static_cast<uint8_t>(x * 255 * scale), static_cast<uint8_t>(y * 255 * scale), static_cast<uint8_t>((x + y) * 127 * scale), 255 };
+
+                else if (kind == "noise")
+                    px = { static_cast<uint8_t>(rng()), static_cast<uint8_t>(rng()), static_cast<uint8_t>(rng()), static_cast<uint8_t>(rng()) };
+
+                else if (kind == "photo")
+                {
+                    // smooth low frequency content with a bit of sensor noise
+                    const float fx = x * scale * 6.0f, fy = y * scale * 6.0f;
+                    const float base = 0.5f + 0.25f * std::sin(fx * 1.3f + std::cos(fy)) + 0.2f * std::cos(fy * 0.7f - fx * 0.4f);
+                    auto channel = [&](float shift) {
+                        const int value = static_cast<int>((base + shift) * 200.0f) + static_cast<int>(rng() % 9) - 4;
+                        return static_cast<uint8_t>(std::clamp(value, 0, 255));
+                    };
+                    px = { channel(0.1f), channel(0.0f), channel(-0.1f), 255 };
+                }
+
+                else // ui: flat panels with borders, glyph-like details and translucent shadows
+                {
+                    const uint32_t panel = (x / 64 + y / 48) % 3;
+                    const pixel32rgba panels[] = { { 236, 236, 240, 255 }, { 52, 120, 220, 255 }, { 250, 250, 250, 255 } };
+                    px = panels[panel];
+                    if (x % 64 == 0 || y % 48 == 0)
+                        px = { 180, 180, 190, 255 };
+                    else if (y % 48 > 16 && y % 48 < 26 && x % 64 > 6 && x % 64 < 56 && ((x * 7 + y * 13) % 5) < 2)
+                        px = { 30, 30, 30, 255 };
+                    else if (x % 64 > 58)
+                        px.a = 160;
+                }
+            }
+        }
+
+        std::unordered_set<pixel32rgba> colors(img.pixels.begin(), img.pixels.end());
+        return { kind + "-" + std::to_string(size), std::move(img), colors.size() };
+    }
+
+    template<class tval>
+    void append(std::vector<uint8_t>& bytes, const tval& value)
+    {
+        auto* from = reinterpret_cast<const uint8_t*>(&value);
+        bytes.insert(bytes.end(), from, from + sizeof(tval));
+    }
+
+    // impp has no bitmap writer so benchmark inputs are assembled here
+    std::vector<uint8_t> make_bitmap(const image<pixel32rgba>& source, uint16_t bitcount)
+    {
+        const size_t stride = (source.width * bitcount + 31) / 32 * 4;
+        bmp::bitmap_info_header iheader{};
+        iheader.ihsize = sizeof(iheader);
+        iheader.width = source.width;
+        iheader.height = source.height;
+        iheader.planes = 1;
+        iheader.bitcount = bitcount;
+
+        bmp::bitmap_file_header fheader{};
+        fheader.type = 19778;
+        fheader.offbits = sizeof(fheader) + sizeof(iheader);
+        fheader.size = static_cast<uint32_t>(fheader.offbits + stride * source.height);
+
+        std::vector<uint8_t> bytes;
+        append(bytes, fheader);
+        append(bytes, iheader);
+        for (uint32_t y = 0; y < source.height; y++)
+        {
+            for (uint32_t x = 0; x < source.width; x++)
+            {
+                const auto px = pixel_cast<pixel32bgra>(source.pixels[y * source.width + x]);
+                bytes.insert(bytes.end(), reinterpret_cast<const uint8_t*>(&px), reinterpret_cast<const uint8_t*>(&px) + bitcount / 8);
+            }
+            bytes.resize(bytes.size() + stride - source.width * bitcount / 8);
+        }
+        return bytes;
+    }
+
+    template<tga::tga_type type>
+    void bench_tga_type(suite& s, const input& in, const std::string& typename_, const std::filesystem::path& tmp)
+    {
+        const auto& img = in.source;
+        const size_t pixels = img.pixels.size();
+        const size_t bytes = pixels * sizeof(pixel32rgba);
+
+        memory_encoder enc;
+        tga::save_to_memory<type>(img, enc);
+        const std::vector<uint8_t> encoded(enc.get_data(), enc.get_data() + enc.get_writesize());
+
+        s.run("tga", "save_to_memory<" + typename_ + ">", in, pixels, bytes, [&] { memory_encoder e; tga::save_to_memory<type>(img, e); }, encoded.size());
+        s.run("tga", "load_memory<" + typename_ + ">", in, pixels, bytes, [&] { do_not_optimize(tga::load_memory<pixel32rgba>(encoded.data(), encoded.size())); }, encoded.size());
+        s.run("tga", "load_memory_scaled<" + typename_ + ",4>", in, pixels, bytes, [&] { do_not_optimize(tga::load_memory_scaled<pixel32rgba>(encoded.data(), encoded.size(), 4)); }, encoded.size());
+        s.run("tga", "load_memory_region<" + typename_ + ",quarter>", in, pixels / 4, bytes / 4, [&] {
+            do_not_optimize(tga::load_memory_region<pixel32rgba>(encoded.data(), encoded.size(), img.width / 4, img.height / 4, img.width / 2, img.height / 2));
+        }, encoded.size());
+
+        const auto filename = (tmp / ("bench-" + typename_ + ".tga")).string();
+        std::ofstream(filename, std::ios::binary).write(reinterpret_cast<const char*>(encoded.data()), encoded.size());
+        s.run("tga", "save_to_file<" + typename_ + ">", in, pixels, bytes, [&] { tga::save_to_file<type>(img, filename); }, encoded.size());
+        s.run("tga", "load<" + typename_ + ">", in, pixels, bytes, [&] { do_not_optimize(tga::load<pixel32rgba>(filename)); }, encoded.size());
+        s.run("tga", "load_scaled<" + typename_ + ",4>", in, pixels, bytes, [&] { do_not_optimize(tga::load_scaled<pixel32rgba>(filename, 4)); }, encoded.size());
+        s.run("auto", "load<tga-" + typename_ + ">", in, pixels, bytes, [&] { do_not_optimize(impp::load<pixel32rgba>(filename)); }, encoded.size());
+        s.run("tga", "load_region<" + typename_ + ",quarter>", in, pixels / 4, bytes / 4, [&] {
+            do_not_optimize(tga::load_region<pixel32rgba>(filename, img.width / 4, img.height / 4, img.width / 2, img.height / 2));
+        }, encoded.size());
+    }
+
+    void bench_tga(suite& s, const input& in, const std::filesystem::path& tmp)
+    {
+        bench_tga_type<tga::TGA_UNCOMPRESSED_RGB>(s, in, "rgb", tmp);
+        bench_tga_type<tga::TGA_RLE_RBG>(s, in, "rle", tmp);
+
+        // mapped images are limited to 16bit palettes
+        if (in.colors <= UINT16_MAX)
+            bench_tga_type<tga::TGA_UNCOMPRESSED_MAPPED>(s, in, "mapped", tmp);
+
+        // both rle packetizers, the encoded sizes tell what the slower one saves
+        const size_t pixels = in.source.pixels.size();
+        for (auto [mode, name] : { std::pair{ tga::TGA_RLE_GREEDY, "greedy" }, std::pair{ tga::TGA_RLE_OPTIMAL, "optimal" } })
+        {
+            memory_encoder rle;
+            tga::save_to_memory<tga::TGA_RLE_RBG>(in.source, rle, mode);
+            s.run("tga", std::string("save_to_memory<rle,") + name + ">", in, pixels, pixels * sizeof(pixel32rgba), [&] {
+                memory_encoder e;
+                tga::save_to_memory<tga::TGA_RLE_RBG>(in.source, e, mode);
+            }, rle.get_writesize());
+        }
+
+        // the estimation alone, then along with the chosen encoding
+        memory_encoder enc;
+        tga::tga_format format;
+        tga::save_auto_to_memory(in.source, enc, &format);
+        s.run("tga", "choose_format", in, pixels, pixels * sizeof(pixel32rgba), [&] { do_not_optimize(tga::choose_format(in.source)); });
+        s.run("tga", "save_auto_to_memory", in, pixels, pixels * sizeof(pixel32rgba), [&] { memory_encoder e; tga::save_auto_to_memory(in.source, e); }, format.size);
+    }
+
+    // qoi against tga rle, the closest format impp had, for the same pixel depth
+    template<class pixel>
+    void bench_qoi_pixel(suite& s, const input& in, const std::string& suffix, const std::filesystem::path& tmp)
+    {
+        auto img = image<pixel>::create(in.source.width, in.source.height);
+        for (size_t i = 0; i < img.pixels.size(); i++)
+            img.pixels[i] = pixel_cast<pixel>(in.source.pixels[i]);
+        const size_t pixels = img.pixels.size();
+        const size_t bytes = pixels * sizeof(pixel);
+
+        memory_encoder enc;
+        qoi::save_to_memory(img, enc);
+        const std::vector<uint8_t> encoded(enc.get_data(), enc.get_data() + enc.get_writesize());
+        tga::save_to_memory<tga::TGA_RLE_RBG>(img, enc);
+        const std::vector<uint8_t> rle(enc.get_data(), enc.get_data() + enc.get_writesize());
+
+        s.run("qoi", "save_to_memory<" + suffix + ">", in, pixels, bytes, [&] { memory_encoder e; qoi::save_to_memory(img, e); }, encoded.size());
+        s.run("qoi", "load_memory<" + suffix + ">", in, pixels, bytes, [&] { do_not_optimize(qoi::load_memory<pixel>(encoded.data(), encoded.size())); }, encoded.size());
+        s.run("qoi", "tga_rle_save_to_memory<" + suffix + ">", in, pixels, bytes, [&] { memory_encoder e; tga::save_to_memory<tga::TGA_RLE_RBG>(img, e); }, rle.size());
+        s.run("qoi", "tga_rle_load_memory<" + suffix + ">", in, pixels, bytes, [&] { do_not_optimize(tga::load_memory<pixel>(rle.data(), rle.size())); }, rle.size());
+
+        const auto filename = (tmp / ("bench-" + suffix + ".qoi")).string();
+        std::ofstream(filename, std::ios::binary).write(reinterpret_cast<const char*>(encoded.data()), encoded.size());
+        s.run("qoi", "load<" + suffix + ">", in, pixels, bytes, [&] { do_not_optimize(qoi::load<pixel>(filename)); }, encoded.size());
+    }
+
+    void bench_qoi(suite& s, const input& in, const std::filesystem::path& tmp)
+    {
+        bench_qoi_pixel<pixel32rgba>(s, in, "rgba", tmp);
+        bench_qoi_pixel<pixel24bgr>(s, in, "bgr", tmp);
+    }
+
+    // png at every deflate level, the decode cost is dominated by inflate and unfiltering
+    template<class pixel>
+    void bench_png_pixel(suite& s, const input& in, const std::string& suffix, const std::filesystem::path& tmp)
+    {
+        auto img = image<pixel>::create(in.source.width, in.source.height);
+        for (size_t i = 0; i < img.pixels.size(); i++)
+            img.pixels[i] = pixel_cast<pixel>(in.source.pixels[i]);
+        const size_t pixels = img.pixels.size();
+        const size_t bytes = pixels * sizeof(pixel);
+
+        const std::pair<deflate::deflate_level, const char*> levels[] = {
+            { deflate::DEFLATE_STORE, "store" }, { deflate::DEFLATE_RLE, "rle" }, { deflate::DEFLATE_FAST, "fast" }, { deflate::DEFLATE_DEFAULT, "default" },
+        };
+        std::vector<uint8_t> encoded;
+        for (const auto& [level, name] : levels)
+        {
+            memory_encoder enc;
+            png::save_to_memory(img, enc, level);
+            encoded.assign(enc.get_data(), enc.get_data() + enc.get_writesize());
+
+            const auto tag = suffix + "," + name;
+            s.run("png", "save_to_memory<" + tag + ">", in, pixels, bytes, [&] { memory_encoder e; png::save_to_memory(img, e, level); }, encoded.size());
+            s.run("png", "load_memory<" + tag + ">", in, pixels, bytes, [&] { do_not_optimize(png::load_memory<pixel>(encoded.data(), encoded.size())); }, encoded.size());
+        }
+
+        const auto filename = (tmp / ("bench-" + suffix + ".png")).string();
+        std::ofstream(filename, std::ios::binary).write(reinterpret_cast<const char*>(encoded.data()), encoded.size());
+        s.run("png", "load<" + suffix + ">", in, pixels, bytes, [&] { do_not_optimize(png::load<pixel>(filename)); }, encoded.size());
+    }
+
+    void bench_png(suite& s, const input& in, const std::filesystem::path& tmp)
+    {
+        bench_png_pixel<pixel32rgba>(s, in, "rgba", tmp);
+        bench_png_pixel<pixel24rgb>(s, in, "rgb", tmp);
+    }
+
+    // block compression single threaded and on every hardware thread, then the dds decode of the blocks
+    void bench_dds(suite& s, const input& in)
+    {
+        const auto& img = in.source;
+        const size_t pixels = img.pixels.size();
+        const size_t bytes = pixels * sizeof(pixel32rgba);
+
+        const std::pair<dds::dds_format, const char*> formats[] = {
+            { dds::DDS_FORMAT_BC1, "bc1" }, { dds::DDS_FORMAT_BC3, "bc3" }, { dds::DDS_FORMAT_BC7, "bc7" },
+        };
+        for (const auto& [format, name] : formats)
+        {
+            memory_encoder enc;
+            dds::save_to_memory(img, enc, format);
+            const std::vector<uint8_t> encoded(enc.get_data(), enc.get_data() + enc.get_writesize());
+
+            const std::string tag = name;
+            s.run("dds", "save_to_memory<" + tag + ",1>", in, pixels, bytes, [&] { memory_encoder e; dds::save_to_memory(img, e, format, 1); }, encoded.size());
+            s.run("dds", "save_to_memory<" + tag + ",all>", in, pixels, bytes, [&] { memory_encoder e; dds::save_to_memory(img, e, format); }, encoded.size());
+            s.run("dds", "load_memory<" + tag + ">", in, pixels, bytes, [&] { do_not_optimize(dds::load_memory<pixel32rgba>(encoded.data(), encoded.size())); }, encoded.size());
+        }
+    }
+
+    void bench_mipmap(suite& s, const input& in)
+    {
+        const auto& img = in.source;
+        const size_t pixels = img.pixels.size();
+        const size_t bytes = pixels * sizeof(pixel32rgba);
+
+        // the odd source takes the resampling path of the box filter
+        auto odd = image<pixel32rgba>::create(img.width - 1, img.height - 1);
+        for (uint32_t y = 0; y < odd.height; y++)
+            std::copy_n(img.pixels.data() + static_cast<size_t>(y) * img.width, odd.width, odd.pixels.data() + static_cast<size_t>(y) * odd.width);
+        const std::pair<mipmap_filter, const char*> filters[] = {
+            { MIPMAP_BOX, "box" }, { MIPMAP_KAISER, "kaiser" }, { MIPMAP_LANCZOS, "lanczos" },
+        };
+        for (const auto& [filter, name] : filters)
+        {
+            const std::string tag = name;
+            s.run("mipmap", "make_mipmaps<" + tag + ",1>", in, pixels, bytes, [&] { do_not_optimize(make_mipmaps(img, filter, 1)); });
+            s.run("mipmap", "make_mipmaps<" + tag + ",all>", in, pixels, bytes, [&] { do_not_optimize(make_mipmaps(img, filter)); });
+        }
+        s.run("mipmap", "make_mipmaps<box-odd,1>", in, pixels, bytes, [&] { do_not_optimize(make_mipmaps(odd, MIPMAP_BOX, 1)); });
+    }
+
+    void bench_atlas(suite& s, const input& in)
+    {
+        // 10k sprites cut out of the input with transparent borders, some of them repeated
+        const auto& img = in.source;
+        std::mt19937 rng(img.width);
+        std::vector<image<pixel32rgba>> sprites;
+        size_t pixels = 0;
+        for (size_t i = 0; i < 10000; i++)
+        {
+            const uint32_t w = std::min<uint32_t>(8 + rng() % 40, img.width), h = std::min<uint32_t>(8 + rng() % 40, img.height);
+            const uint32_t x = rng() % 64 * (img.width - w) / 63, y = rng() % 64 * (img.height - h) / 63;
+            auto sprite = image<pixel32rgba>::create(w + 6, h + 6);
+            for (uint32_t row = 0; row < h; row++)
+                std::copy_n(img.get_pixel(x, y + row), w, sprite.pixels.data() + static_cast<size_t>(h + 2 - row) * sprite.width + 3);
+            pixels += sprite.pixels.size();
+            sprites.push_back(std::move(sprite));
+        }
+
+        const size_t bytes = pixels * sizeof(pixel32rgba);
+        atlas_options options;
+        for (auto packing : { ATLAS_PACK_SKYLINE, ATLAS_PACK_MAXRECTS })
+        {
+            options.packing = packing;
+            const std::string tag = packing == ATLAS_PACK_SKYLINE ? "skyline" : "maxrects";
+            options.threads = 1;
+            s.run("atlas", "build_atlas<" + tag + ",1>", in, pixels, bytes, [&] { do_not_optimize(build_atlas(sprites, options)); });
+            options.threads = 0;
+            s.run("atlas", "build_atlas<" + tag + ",all>", in, pixels, bytes, [&] { do_not_optimize(build_atlas(sprites, options)); });
+        }
+    }
+
+    void bench_hash(suite& s, const input& in)
+    {
+        const auto& img = in.source;
+        const size_t pixels = img.pixels.size();
+        const size_t bytes = pixels * sizeof(pixel32rgba);
+        const auto bgra = image<pixel32bgra>::create(img.width, img.height, pixel_convert<pixel32bgra>(img.pixels));
+        const auto rgb = image<pixel24rgb>::create(img.width, img.height, pixel_convert<pixel24rgb>(img.pixels));
+
+        s.run("hash", "hash_bytes", in, pixels, bytes, [&] { do_not_optimize(hash_bytes(img.pixels.data(), bytes)); });
+        s.run("hash", "content_hash<rgba>", in, pixels, bytes, [&] { do_not_optimize(content_hash(img)); });
+        s.run("hash", "content_hash<bgra>", in, pixels, bytes, [&] { do_not_optimize(content_hash(bgra)); });
+        s.run("hash", "content_hash<rgb>", in, pixels, pixels * 3, [&] { do_not_optimize(content_hash(rgb)); });
+        s.run("hash", "difference_hash", in, pixels, bytes, [&] { do_not_optimize(difference_hash(img)); });
+        s.run("hash", "perceptual_hash", in, pixels, bytes, [&] { do_not_optimize(perceptual_hash(img)); });
+    }
+
+    void bench_cache(suite& s, const input& in)
+    {
+        const auto& img = in.source;
+        const size_t pixels = img.pixels.size();
+        const size_t bytes = pixels * sizeof(pixel32rgba);
+        const auto encoded = make_bitmap(img, 32);
+
+        // the hit paths, a lookup by key and one hashing the encoded data first
+        image_cache<pixel32rgba> cache(bytes * 4);
+        cache.try_get("source", [&] { return impp::result<image<pixel32rgba>>(img); });
+        cache.get_memory(encoded.data(), encoded.size());
+        s.run("cache", "try_get<hit>", in, pixels, bytes, [&] { do_not_optimize(cache.try_get("source", [&] { return impp::result<image<pixel32rgba>>(img); })); });
+        s.run("cache", "get_memory<hit>", in, pixels, bytes, [&] { do_not_optimize(cache.get_memory(encoded.data(), encoded.size())); }, encoded.size());
+    }
+
+    void bench_lazy(suite& s, const input& in)
+    {
+        const auto& img = in.source;
+        const size_t pixels = img.pixels.size();
+        const size_t bytes = pixels * sizeof(pixel32rgba);
+        memory_encoder encoder;
+        qoi::save_to_memory(img, encoder);
+
+        // opening reads the header alone, the first access pays for the decoding
+        s.run("lazy", "probe_memory", in, pixels, bytes, [&] { do_not_optimize(try_probe_memory(encoder.get_data(), encoder.get_writesize())); }, encoder.get_writesize());
+        s.run("lazy", "open_memory", in, pixels, bytes, [&] { do_not_optimize(lazy_image<pixel32rgba>::open_memory(encoder.get_data(), encoder.get_writesize())); }, encoder.get_writesize());
+        s.run("lazy", "open_memory+get", in, pixels, bytes, [&] { do_not_optimize(lazy_image<pixel32rgba>::open_memory(encoder.get_data(), encoder.get_writesize()).get()); }, encoder.get_writesize());
+    }
+
+    void bench_stats(suite& s, const input& in)
+    {
+        const auto& img = in.source;
+        const size_t pixels = img.pixels.size();
+        const size_t bytes = pixels * sizeof(pixel32rgba);
+        const auto rgb = image<pixel24rgb>::create(img.width, img.height, pixel_convert<pixel24rgb>(img.pixels));
+
+        s.run("stats", "histogram<rgba>", in, pixels, bytes, [&] { do_not_optimize(histogram(img)); });
+        s.run("stats", "histogram<rgb>", in, pixels, pixels * 3, [&] { do_not_optimize(histogram(rgb)); });
+        s.run("stats", "classify_alpha", in, pixels, bytes, [&] { do_not_optimize(classify_alpha(img)); });
+        s.run("stats", "count_colors<256>", in, pixels, bytes, [&] { do_not_optimize(count_colors(img, 256)); });
+        s.run("stats", "count_colors<65536>", in, pixels, bytes, [&] { do_not_optimize(count_colors(img)); });
+    }
+
+    void bench_colorspace(suite& s, const input& in)
+    {
+        const auto& img = in.source;
+        const size_t pixels = img.pixels.size();
+        const size_t bytes = pixels * sizeof(pixel32rgba);
+        const auto wide = srgb_to_linear<pixel64linear>(img);
+        const auto real = srgb_to_linear<pixel128linear>(img);
+
+        s.run("colorspace", "srgb_to_linear<16>", in, pixels, bytes, [&] { do_not_optimize(srgb_to_linear<pixel64linear>(img)); });
+        s.run("colorspace", "srgb_to_linear<float>", in, pixels, bytes, [&] { do_not_optimize(srgb_to_linear<pixel128linear>(img)); });
+        s.run("colorspace", "linear_to_srgb<16>", in, pixels, bytes, [&] { do_not_optimize(linear_to_srgb(wide)); });
+        s.run("colorspace", "linear_to_srgb<float>", in, pixels, bytes, [&] { do_not_optimize(linear_to_srgb(real)); });
+        s.run("colorspace", "linear_to_srgb<float,threads>", in, pixels, bytes, [&] { do_not_optimize(linear_to_srgb(real, 0)); });
+    }
+
+    void bench_filter(suite& s, const input& in)
+    {
+        const auto& img = in.source;
+        const size_t pixels = img.pixels.size();
+        const size_t bytes = pixels * sizeof(pixel32rgba);
+        filter_options threaded;
+        threaded.threads = 0;
+
+        s.run("filter", "box_blur<2>", in, pixels, bytes, [&] { do_not_optimize(box_blur(img, 2)); });
+        s.run("filter", "box_blur<16>", in, pixels, bytes, [&] { do_not_optimize(box_blur(img, 16)); });
+        s.run("filter", "gaussian_blur<1.5>", in, pixels, bytes, [&] { do_not_optimize(gaussian_blur(img, 1.5f)); });
+        s.run("filter", "gaussian_blur<5>", in, pixels, bytes, [&] { do_not_optimize(gaussian_blur(img, 5.0f)); });
+        s.run("filter", "gaussian_blur<5,threads>", in, pixels, bytes, [&] { do_not_optimize(gaussian_blur(img, 5.0f, threaded)); });
+        s.run("filter", "sharpen", in, pixels, bytes, [&] { do_not_optimize(sharpen(img, 0.5f)); });
+    }
+
+    void bench_yuv(suite& s, const input& in)
+    {
+        const size_t pixels = in.source.pixels.size();
+        const size_t bytes = pixels * sizeof(pixel32bgra);
+        const auto bgra = image_convert<pixel32bgra>(in.source);
+        yuv_options threaded;
+        threaded.threads = 0;
+
+        for (auto [layout, name] : { std::pair{ YUV_444, "444" }, std::pair{ YUV_I420, "i420" }, std::pair{ YUV_NV12, "nv12" } })
+        {
+            const auto frame = rgb_to_yuv(bgra, layout);
+            s.run("yuv", std::string("rgb_to_yuv<") + name + ">", in, pixels, bytes, [&] { do_not_optimize(rgb_to_yuv(bgra, layout)); }, frame.get_data().size());
+            s.run("yuv", std::string("yuv_to_rgb<") + name + ">", in, pixels, bytes, [&] { do_not_optimize(yuv_to_rgb(frame)); }, frame.get_data().size());
+        }
+        s.run("yuv", "rgb_to_yuv<nv12,threads>", in, pixels, bytes, [&] { do_not_optimize(rgb_to_yuv(bgra, YUV_NV12, threaded)); });
+    }
+
+    void bench_pipeline(suite& s, const input& in)
+    {
+        const size_t pixels = in.source.pixels.size();
+        const size_t bytes = pixels * sizeof(pixel32rgba);
+        const auto& img = in.source;
+        const pixel24bgr mark{ 0, 0, 255 };
+
+        // convert, mirror, watermark and rle save as separate passes against a single fused pass
+        s.run("pipeline", "steps+save<rle>", in, pixels, bytes, [&] {
+            auto converted = image_convert<pixel24bgr>(img);
+            converted.vertical_mirror();
+            converted.fill_rect(0, 0, img.width / 4, img.height / 8, mark);
+            memory_encoder enc;
+            tga::save_to_memory<tga::TGA_RLE_RBG>(converted, enc);
+            do_not_optimize(enc.get_writesize());
+        });
+        auto pipeline = image_pipeline<pixel24bgr>::from(img);
+        pipeline.vertical_mirror().fill_rect(0, 0, img.width / 4, img.height / 8, mark);
+        s.run("pipeline", "fused+save<rle>", in, pixels, bytes, [&] {
+            memory_encoder enc;
+            tga::save_to_memory<tga::TGA_RLE_RBG>(pipeline, enc);
+            do_not_optimize(enc.get_writesize());
+        });
+        s.run("pipeline", "fused+save<rle,threads>", in, pixels, bytes, [&] {
+            memory_encoder enc;
+            tga::save_to_memory<tga::TGA_RLE_RBG>(pipeline, enc, tga::TGA_RLE_GREEDY, 0);
+            do_not_optimize(enc.get_writesize());
+        });
+        s.run("pipeline", "execute", in, pixels, bytes, [&] { do_not_optimize(pipeline.execute()); });
+    }
+
+    void bench_bmp(suite& s, const input& in, const std::filesystem::path& tmp)
+    {
+        const auto& img = in.source;
+        const size_t pixels = img.pixels.size();
+        const size_t bytes = pixels * sizeof(pixel32rgba);
+
+        for (uint16_t bitcount : { 24, 32 })
+        {
+            const auto encoded = make_bitmap(img, bitcount);
+            const auto suffix = std::to_string(bitcount);
+            const auto filename = (tmp / ("bench-" + suffix + ".bmp")).string();
+            std::ofstream(filename, std::ios::binary).write(reinterpret_cast<const char*>(encoded.data()), encoded.size());
+
+            s.run("bmp", "load_memory<" + suffix + ">", in, pixels, bytes, [&] { do_not_optimize(bmp::load_memory<pixel32rgba>(encoded.data(), encoded.size())); }, encoded.size());
+            s.run("bmp", "load_memory_region<" + suffix + ",quarter>", in, pixels / 4, bytes / 4, [&] {
+                do_not_optimize(bmp::load_memory_region<pixel32rgba>(encoded.data(), encoded.size(), img.width / 4, img.height / 4, img.width / 2, img.height / 2));
+            }, encoded.size());
+            s.run("bmp", "load<" + suffix + ">", in, pixels, bytes, [&] { do_not_optimize(bmp::load<pixel32rgba>(filename)); }, encoded.size());
+            s.run("auto", "load<bmp-" + suffix + ">", in, pixels, bytes, [&] { do_not_optimize(impp::load<pixel32rgba>(filename)); }, encoded.size());
+            s.run("bmp", "load_region<" + suffix + ",quarter>", in, pixels / 4, bytes / 4, [&] {
+                do_not_optimize(bmp::load_region<pixel32rgba>(filename, img.width / 4, img.height / 4, img.width / 2, img.height / 2));
+            }, encoded.size());
+        }
+    }
+
+    template<class pixel> const char* pixel_name();
+    template<> const char* pixel_name<pixel24rgb>() { return "pixel24rgb"; }
+    template<> const char* pixel_name<pixel24bgr>() { return "pixel24bgr"; }
+    template<> const char* pixel_name<pixel32rgba>() { return "pixel32rgba"; }
+    template<> const char* pixel_name<pixel32bgra>() { return "pixel32bgra"; }
+
+    template<class pixelfrom, class pixelto>
+    void bench_convert_pair(suite& s, const input& in)
+    {
+        if constexpr (!std::is_same_v<pixelfrom, pixelto>)
+        {
+            std::vector<pixelfrom> from(in.source.pixels.size());
+            pixel_convert(in.source.pixels.data(), from.data(), from.size());
+            std::vector<pixelto> to(from.size());
+            const auto name = std::string(pixel_name<pixelfrom>()) + "->" + pixel_name<pixelto>();
+            s.run("pixel_convert", name, in, from.size(), from.size() * sizeof(pixelfrom), [&] { pixel_convert(from.data(), to.data(), from.size()); do_not_optimize(to); });
+            s.run("pixel_convert", name + ",threads", in, from.size(), from.size() * sizeof(pixelfrom), [&] { pixel_convert(from.data(), to.data(), from.size(), 0); do_not_optimize(to); });
+        }
+    }
+
+    template<class pixelfrom>
+    void bench_convert_from(suite& s, const input& in)
+    {
+        bench_convert_pair<pixelfrom, pixel24rgb>(s, in);
+        bench_convert_pair<pixelfrom, pixel24bgr>(s, in);
+        bench_convert_pair<pixelfrom, pixel32rgba>(s, in);
+        bench_convert_pair<pixelfrom, pixel32bgra>(s, in);
+    }
+
+    void bench_convert(suite& s, const input& in)
+    {
+        bench_convert_from<pixel24rgb>(s, in);
+        bench_convert_from<pixel24bgr>(s, in);
+        bench_convert_from<pixel32rgba>(s, in);
+        bench_convert_from<pixel32bgra>(s, in);
+    }
+
+    // per pixel rotation through set_pixel/get_pixel as user code would write it
+    template<class pixel>
+    image<pixel> naive_rotate90(const image<pixel>& source)
+    {
+        auto ret = image<pixel>::create(source.height, source.width);
+        for (uint32_t y = 0; y < source.height; y++)
+            for (uint32_t x = 0; x < source.width; x++)
+                ret.set_pixel(source.height - y - 1, x, *source.get_pixel(x, y));
+        return ret;
+    }
+
+    void bench_image(suite& s, const input& in)
+    {
+        const auto& img = in.source;
+        const size_t pixels = img.pixels.size();
+        const size_t bytes = pixels * sizeof(pixel32rgba);
+        auto work = img;
+
+        // copies made inside a benchmark are measured alone so they can be subtracted
+        s.run("image", "copy", in, pixels, bytes, [&] { work = img; });
+        s.run("image", "set_pixel", in, pixels, bytes, [&] {
+            for (uint32_t y = 0; y < work.height; y++)
+                for (uint32_t x = 0; x < work.width; x++)
+                    work.set_pixel(x, y, pixel32rgba{ 1, 2, 3, 4 });
+        });
+        s.run("image", "get_pixel", in, pixels, bytes, [&] {
+            uint32_t sum = 0;
+            for (uint32_t y = 0; y < img.height; y++)
+                for (uint32_t x = 0; x < img.width; x++)
+                    sum += img.get_pixel(x, y)->g;
+            do_not_optimize(sum);
+        });
+        s.run("image", "fill_rect", in, pixels, bytes, [&] { work.fill_rect(0, 0, work.width, work.height, pixel32rgba{ 1, 2, 3, 4 }); });
+        s.run("image", "blank_rect", in, pixels, bytes, [&] { work.blank_rect(0, 0, work.width, work.height); });
+
+        for (auto [mode, name] : { std::pair{ BLEND_NONE, "none" }, { BLEND_SRC_OVER, "src_over" }, { BLEND_SRC_OVER_PREMULTIPLIED, "src_over_premultiplied" },
+            { BLEND_ADDITIVE, "additive" }, { BLEND_MULTIPLY, "multiply" } })
+            s.run("image", std::string("overwrite<") + name + ">", in, pixels, bytes, [&, mode = mode] { work.overwrite(0, 0, img, mode); });
+
+        s.run("image", "vertical_mirror", in, pixels, bytes, [&] { work.vertical_mirror(); });
+        s.run("image", "horizontal_mirror", in, pixels, bytes, [&] { work.horizontal_mirror(); });
+        s.run("image", "flip", in, pixels, bytes, [&] { work.flip(true, true); });
+        s.run("image", "transpose", in, pixels, bytes, [&] { work.transpose(); });
+        s.run("image", "transverse", in, pixels, bytes, [&] { work.transverse(); });
+        s.run("image", "rotate<90>", in, pixels, bytes, [&] { work.rotate(image<pixel32rgba>::ROTATE_90); });
+        s.run("image", "rotate<180>", in, pixels, bytes, [&] { work.rotate(image<pixel32rgba>::ROTATE_180); });
+        s.run("image", "rotate<270>", in, pixels, bytes, [&] { work.rotate(image<pixel32rgba>::ROTATE_270); });
+        s.run("image", "naive_rotate<90>", in, pixels, bytes, [&] { do_not_optimize(naive_rotate90(img)); });
+        s.run("image", "premultiply", in, pixels, bytes, [&] { image_premultiply(work); });
+        s.run("image", "unpremultiply", in, pixels, bytes, [&] { image_unpremultiply(work); });
+        s.run("image", "image_convert<pixel24bgr>", in, pixels, bytes, [&] { do_not_optimize(image_convert<pixel24bgr>(img)); });
+        s.run("image", "image_flatten<pixel24bgr>", in, pixels, bytes, [&] { do_not_optimize(image_flatten(img, pixel24bgr{ 255, 255, 255 })); });
+    }
+
+    bool parse(int argc, char** argv, options* opt)
+    {
+        for (int i = 1; i < argc; i++)
+        {
+            const std::string arg = argv[i];
+            if (i + 1 >= argc)
+                return false;
+
+            if (arg == "--json")
+                opt->json = argv[++i];
+            else if (arg == "--filter")
+                opt->filter = argv[++i];
+            else if (arg == "--min-time")
+                opt->min_time = std::stod(argv[++i]);
+            else if (arg == "--sizes")
+            {
+                opt->sizes.clear();
+                std::stringstream list(argv[++i]);
+                for (std::string size; std::getline(list, size, ',');)
+                    opt->sizes.push_back(static_cast<uint32_t>(std::stoul(size)));
+            }
+            else
+                return false;
+        }
+        return true;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    options opt;
+    if (!parse(argc, argv, &opt))
+    {
+        std::cout << "usage: impp-bench [--json file] [--filter text] [--sizes 256,1024] [--min-time seconds]" << std::endl;
+        return 1;
+    }
+
+    const auto tmp = std::filesystem::temp_directory_path() / "impp-bench";
+    std::filesystem::create_directories(tmp);
+
+    suite s(opt);
+    for (auto size : opt.sizes)
+    {
+        for (auto kind : { "solid", "gradient", "ui", "noise", "photo" })
+        {
+            const auto in = make_input(kind, size);
+            bench_tga(s, in, tmp);
+            bench_bmp(s, in, tmp);
+            bench_qoi(s, in, tmp);
+            bench_png(s, in, tmp);
+            bench_dds(s, in);
+            bench_mipmap(s, in);
+            bench_atlas(s, in);
+            bench_hash(s, in);
+            bench_cache(s, in);
+            bench_lazy(s, in);
+            bench_stats(s, in);
+            bench_colorspace(s, in);
+            bench_filter(s, in);
+            bench_yuv(s, in);
+            bench_pipeline(s, in);
+            bench_convert(s, in);
+            bench_image(s, in);
+        }
+    }
+
+    if (!opt.json.empty())
+        s.write_json(opt.json);
+
+    std::filesystem::remove_all(tmp);
+    return 0;
+}
@@ -20,5 +20,23 @@ int main()
         tga::save_to_file<tga::tga_type::TGA_UNCOMPRESSED_RGB>(test, "final_urgb.tga");
     }
 
+    // TESTING BMP IMAGES AND REGION DECODING
+    auto bitmap = bmp::load<pixel32rgba>("init.bmp");
+    if(bitmap.empty())
+        std::cout << "loading bmp failed!" << std::endl;
+    else
+        tga::save_to_file<tga::tga_type::TGA_RLE_RBG>(bitmap, "final_bmp.tga");
+
+    auto window = tga::load_region<pixel32rgba>("final_rle.tga", 64, 64, 128, 96);
+    if(window.empty())
+        std::cout << "loading tga region failed!" << std::endl;
+
+    // TESTING DECODE-TIME DOWNSCALING
+    auto thumb = tga::load_scaled<pixel32rgba>("final_rle.tga", 4);
+    if(thumb.empty())
+        std::cout << "loading scaled tga failed!" << std::endl;
+    else
+        tga::save_to_file<tga::tga_type::TGA_UNCOMPRESSED_RGB>(thumb, "final_thumb.tga");
+
     return 0;
 }
@@ -0,0 +1,168 @@
+#include <random>
+#include <atlas.hpp>
+#include "unit.hpp"
+
+using namespace impp;
+
+namespace
+{
+    // sprites of random sizes with transparent borders, every sprite has its own colors
+    std::vector<image<pixel32rgba>> random_sprites(size_t count, unsigned seed)
+    {
+        std::mt19937 rng(seed);
+        std::vector<image<pixel32rgba>> sprites;
+        for (size_t i = 0; i < count; i++)
+        {
+            const uint32_t w = 1 + rng() % 40, h = 1 + rng() % 40;
+            auto sprite = image<pixel32rgba>::create(w + 4, h + 2);
+            for (uint32_t y = 0; y < h; y++)
+                for (uint32_t x = 0; x < w; x++)
+                    sprite.set_pixel(x + 2, y + 1, pixel32rgba{ uint8_t(i), uint8_t(i >> 8), uint8_t(x * 7 + y), uint8_t(1 + rng() % 255) });
+            sprites.push_back(std::move(sprite));
+        }
+        return sprites;
+    }
+
+    // every sprite is found at its place with nothing else overlapping it
+    bool check_atlas(const std::vector<image<pixel32rgba>>& sprites, const texture_atlas<pixel32rgba>& atlas, uint32_t padding)
+    {
+        const auto& canvas = atlas.canvas;
+        bool ok = atlas.entries.size() == sprites.size();
+        for (size_t i = 0; ok && i < sprites.size(); i++)
+        {
+            const auto& e = atlas.entries[i];
+            if (e.width == 0)
+                continue;
+            ok &= e.x + e.width <= canvas.width && e.y + e.height <= canvas.height;
+            ok &= e.u0 == float(e.x) / canvas.width && e.v1 == float(e.y + e.height) / canvas.height;
+            for (uint32_t y = 0; ok && y < e.height; y++)
+                for (uint32_t x = 0; ok && x < e.width; x++)
+                    ok &= *canvas.get_pixel(e.x + x, e.y + y) == *sprites[i].get_pixel(e.trim_x + x, e.trim_y + y);
+
+            for (size_t j = 0; ok && j < i; j++)
+            {
+                const auto& o = atlas.entries[j];
+                if (o.width == 0 || o.duplicate_of != j || e.duplicate_of != i)
+                    continue;
+                const bool apart = e.x + e.width + padding <= o.x || o.x + o.width + padding <= e.x
+                    || e.y + e.height + padding <= o.y || o.y + o.height + padding <= e.y;
+                ok &= apart;
+            }
+        }
+        return ok;
+    }
+}
+
+IMPP_TEST(atlas_trim)
+{
+    // the bounds cover the farthest opaque pixels, through the vectorized scans too
+    auto sprite = image<pixel32rgba>::create(23, 9);
+    sprite.set_pixel(13, 1, pixel32rgba{ 1, 2, 3, 4 });
+    sprite.set_pixel(5, 6, pixel32rgba{ 5, 6, 7, 255 });
+    sprite.set_pixel(9, 4, pixel32rgba{ 255, 255, 255, 0 });
+    auto bounds = impp::detail::atlas_alpha_bounds(sprite);
+    IMPP_CHECK(bounds.x == 5 && bounds.y == 1 && bounds.width == 9 && bounds.height == 6);
+
+    sprite.set_orientation(image<pixel32rgba>::LEFT_BOTTOM);
+    bounds = impp::detail::atlas_alpha_bounds(sprite);
+    IMPP_CHECK(bounds.x == 5 && bounds.y == 2 && bounds.width == 9 && bounds.height == 6);
+
+    sprite.set_orientation(image<pixel32rgba>::LEFT_TOP);
+    sprite.set_pixel(22, 8, pixel32rgba{ 0, 0, 0, 1 });
+    bounds = impp::detail::atlas_alpha_bounds(sprite);
+    IMPP_CHECK(bounds.x == 5 && bounds.y == 1 && bounds.width == 18 && bounds.height == 8);
+
+    IMPP_CHECK(impp::detail::atlas_alpha_bounds(image<pixel32rgba>::create(17, 3)).width == 0);
+
+    // fully transparent sprites take no space, 24bit ones are never trimmed
+    auto atlas = build_atlas(std::vector{ image<pixel32rgba>::create(8, 8) });
+    IMPP_CHECK(atlas.entries.size() == 1 && atlas.entries[0].width == 0 && atlas.canvas.width == 0);
+
+    auto rgb = image<pixel24rgb>::create(6, 5);
+    rgb.set_pixel(2, 2, pixel24rgb{ 9, 9, 9 });
+    const auto rgb_atlas = build_atlas(std::vector{ rgb, rgb });
+    IMPP_CHECK(rgb_atlas.entries[0].width == 6 && rgb_atlas.entries[0].height == 5 && rgb_atlas.entries[1].duplicate_of == 0);
+    IMPP_CHECK(rgb_atlas.canvas.width == 6 && rgb_atlas.canvas.height == 5);
+}
+
+IMPP_TEST(atlas_layout)
+{
+    const auto sprites = random_sprites(400, 1);
+    for (auto packing : { ATLAS_PACK_SKYLINE, ATLAS_PACK_MAXRECTS })
+    {
+        atlas_options options;
+        options.packing = packing;
+        options.padding = 2;
+        const auto atlas = build_atlas(sprites, options);
+        IMPP_CHECK(check_atlas(sprites, atlas, 2));
+        IMPP_CHECK(atlas.canvas.width <= 1024 && atlas.canvas.height <= 1024);
+
+        // the packing and the pixels do not depend on the number of workers
+        options.threads = 1;
+        const auto single = build_atlas(sprites, options);
+        IMPP_CHECK(single.canvas.pixels == atlas.canvas.pixels);
+    }
+
+    // the area lost to the packing stays small
+    uint64_t area = 0;
+    const auto atlas = build_atlas(sprites);
+    for (const auto& e : atlas.entries)
+        area += uint64_t(e.width) * e.height;
+    IMPP_CHECK(area * 10 >= uint64_t(atlas.canvas.width) * atlas.canvas.height * 7);
+
+    atlas_options options;
+    options.power_of_two = true;
+    const auto pot = build_atlas(sprites, options);
+    IMPP_CHECK(check_atlas(sprites, pot, 1));
+    IMPP_CHECK((pot.canvas.width & (pot.canvas.width - 1)) == 0 && (pot.canvas.height & (pot.canvas.height - 1)) == 0);
+}
+
+IMPP_TEST(atlas_deduplicate)
+{
+    auto sprites = random_sprites(50, 2);
+    // the same pixels behind different transparent borders
+    auto copy = image<pixel32rgba>::create(sprites[7].width + 5, sprites[7].height);
+    copy.overwrite(5, 0, sprites[7]);
+    sprites.push_back(copy);
+    sprites.push_back(sprites[3]);
+
+    const auto atlas = build_atlas(sprites);
+    IMPP_CHECK(check_atlas(sprites, atlas, 1));
+    const auto& moved = atlas.entries[50];
+    IMPP_CHECK(moved.duplicate_of == 7 && moved.x == atlas.entries[7].x && moved.trim_x == atlas.entries[7].trim_x + 5);
+    IMPP_CHECK(atlas.entries[51].duplicate_of == 3 && atlas.entries[51].u0 == atlas.entries[3].u0);
+
+    atlas_options options;
+    options.deduplicate = false;
+    const auto plain = build_atlas(sprites, options);
+    IMPP_CHECK(check_atlas(sprites, plain, 1) && plain.entries[51].duplicate_of == 51);
+}
+
+IMPP_TEST(atlas_invalid_input)
+{
+    atlas_options options;
+    options.max_width = 32;
+    options.max_height = 32;
+    auto res = try_build_atlas(std::vector{ image<pixel32rgba>::create(40, 2, std::vector<pixel32rgba>(80, pixel32rgba{ 1, 1, 1, 1 })) }, options);
+    IMPP_CHECK(!res && res.get_error().code == error::ERROR_INVALID_ARGUMENT);
+
+    std::vector<image<pixel32rgba>> many(20, image<pixel32rgba>::create(10, 10, std::vector<pixel32rgba>(100, pixel32rgba{ 1, 2, 3, 255 })));
+    for (size_t i = 0; i < many.size(); i++)
+        many[i].set_pixel(0, 0, pixel32rgba{ uint8_t(i), 0, 0, 255 });
+    IMPP_CHECK(!try_build_atlas(many, options));
+    options.max_height = 128;
+    IMPP_CHECK(try_build_atlas(many, options).has_value());
+
+    // power of two sides stay within limits which are not powers of two
+    options.max_width = 100;
+    options.max_height = 40;
+    options.power_of_two = true;
+    const auto fits = try_build_atlas(std::vector(many.begin(), many.begin() + 12), options);
+    IMPP_CHECK(fits && fits->canvas.width <= 64 && fits->canvas.height <= 32);
+    IMPP_CHECK(!try_build_atlas(many, options));
+
+    auto broken = image<pixel32rgba>::create(4, 4);
+    broken.pixels.pop_back();
+    IMPP_CHECK(!try_build_atlas(std::vector{ broken }));
+    IMPP_CHECK(try_build_atlas(std::vector<image<pixel32rgba>>{})->canvas.width == 0);
+}
@@ -0,0 +1,145 @@
+#include <bmp.hpp>
+#include <tga.hpp>
+#include "unit.hpp"
+
+using namespace impp;
+
+namespace
+{
+    template<class tval>
+    void append(std::vector<uint8_t>& bytes, const tval& value)
+    {
+        auto* from = reinterpret_cast<const uint8_t*>(&value);
+        bytes.insert(bytes.end(), from, from + sizeof(tval));
+    }
+
+    // writes an uncompressed bitmap, rows bottom-up unless topdown is set
+    std::vector<uint8_t> make_bitmap(const image<pixel32rgba>& source, uint16_t bitcount, bool topdown)
+    {
+        std::vector<pixel32bgra> palette;
+        if (bitcount <= 8)
+            for (auto& px : source.pixels)
+                if (std::find(palette.begin(), palette.end(), pixel_cast<pixel32bgra>(px)) == palette.end())
+                    palette.push_back(pixel_cast<pixel32bgra>(px));
+
+        const size_t stride = (source.width * bitcount + 31) / 32 * 4;
+        std::vector<uint8_t> raster(stride * source.height);
+        for (uint32_t y = 0; y < source.height; y++)
+        {
+            auto* row = raster.data() + (topdown ? source.height - y - 1 : y) * stride;
+            for (uint32_t x = 0; x < source.width; x++)
+            {
+                const auto px = pixel_cast<pixel32bgra>(source.pixels[y * source.width + x]);
+                if (bitcount == 32)
+                    memcpy(row + x * 4, &px, 4);
+                else if (bitcount == 24)
+                    memcpy(row + x * 3, &px, 3);
+                else
+                {
+                    const auto index = static_cast<uint8_t>(std::find(palette.begin(), palette.end(), px) - palette.begin());
+                    const auto bit = x * bitcount;
+                    row[bit / 8] |= index << (8 - bitcount - bit % 8);
+                }
+            }
+        }
+
+        bmp::bitmap_info_header iheader{};
+        iheader.ihsize = sizeof(iheader);
+        iheader.width = source.width;
+        iheader.height = topdown ? -static_cast<int32_t>(source.height) : source.height;
+        iheader.planes = 1;
+        iheader.bitcount = bitcount;
+        iheader.colorcount = static_cast<uint32_t>(palette.size());
+
+        bmp::bitmap_file_header fheader{};
+        fheader.type = 19778;
+        fheader.offbits = static_cast<uint32_t>(sizeof(fheader) + sizeof(iheader) + palette.size() * 4);
+        fheader.size = static_cast<uint32_t>(fheader.offbits + raster.size());
+
+        std::vector<uint8_t> bytes;
+        append(bytes, fheader);
+        append(bytes, iheader);
+        for (auto& color : palette)
+            append(bytes, color);
+        bytes.insert(bytes.end(), raster.begin(), raster.end());
+        return bytes;
+    }
+}
+
+IMPP_TEST(bmp_sample_matches_tga)
+{
+    auto reference = tga::load<pixel32rgba>(unit::workdir("init.tga"));
+    auto bitmap = bmp::load<pixel32rgba>(unit::workdir("init.bmp"));
+    IMPP_CHECK(bitmap.width == reference.width && bitmap.height == reference.height);
+    IMPP_CHECK(bitmap.pixels == reference.pixels);
+}
+
+IMPP_TEST(bmp_bitcounts_and_row_order)
+{
+    // the sample uses only a few colors so it fits 4bit and 8bit palettes
+    auto reference = tga::load<pixel32rgba>(unit::workdir("init.tga"));
+    for (uint16_t bitcount : { 4, 8, 24, 32 })
+    {
+        for (bool topdown : { false, true })
+        {
+            auto bytes = make_bitmap(reference, bitcount, topdown);
+            IMPP_CHECK(bmp::load_memory<pixel32rgba>(bytes.data(), bytes.size()).pixels == reference.pixels);
+
+            auto region = bmp::load_memory_region<pixel24rgb>(bytes.data(), bytes.size(), 33, 44, 55, 66);
+            bool same = region.width == 55 && region.height == 66;
+            for (uint32_t y = 0; same && y < region.height; y++)
+                for (uint32_t x = 0; x < region.width; x++)
+                    same &= *region.get_pixel(x, y) == pixel_cast<pixel24rgb>(*reference.get_pixel(x + 33, y + 44));
+            IMPP_CHECK(same);
+        }
+    }
+}
+
+IMPP_TEST(bmp_invalid_header)
+{
+    bool failed = false;
+    error::set_error_handler([&](const std::runtime_error&) { failed = true; });
+
+    auto bytes = unit::read_file(unit::workdir("init.bmp"));
+    bytes[0] = 'X';
+    IMPP_CHECK(bmp::load_memory<pixel32rgba>(bytes.data(), bytes.size()).empty());
+    IMPP_CHECK(failed);
+
+    error::set_error_handler(error::detail::error_handling::default_throw_wrapper);
+}
+
+IMPP_TEST(bmp_reserved_alpha)
+{
+    // writers leave the fourth byte of 32bit BI_RGB pixels at 0, the pixels still load opaque
+    auto source = unit::random_image<pixel32rgba>(37, 11);
+    for (auto& px : source.pixels)
+        px.a = 0;
+    const auto bytes = make_bitmap(source, 32, false);
+
+    auto expected = source;
+    for (auto& px : expected.pixels)
+        px.a = UINT8_MAX;
+    IMPP_CHECK(bmp::load_memory<pixel32rgba>(bytes.data(), bytes.size()).pixels == expected.pixels);
+    IMPP_CHECK(bmp::load_memory<pixel32bgra>(bytes.data(), bytes.size()).pixels == image_convert<pixel32bgra>(expected).pixels);
+    IMPP_CHECK(bmp::load_memory<pixel24rgb>(bytes.data(), bytes.size()).pixels == image_convert<pixel24rgb>(source).pixels);
+}
+
+IMPP_TEST(bmp_oversized_header)
+{
+    // tiny files declaring huge sides fail before their pixels are allocated
+    auto bytes = make_bitmap(unit::random_image<pixel32rgba>(2, 2), 24, false);
+    const auto resize = [&](int32_t width, int32_t height) {
+        memcpy(bytes.data() + 18, &width, sizeof(width));
+        memcpy(bytes.data() + 22, &height, sizeof(height));
+        return bmp::try_load_memory<pixel32rgba>(bytes.data(), bytes.size()).get_error().code;
+    };
+    IMPP_CHECK(resize(60000, 60000) == error::ERROR_UNSUPPORTED);
+    IMPP_CHECK(resize(10000, -10000) == error::ERROR_TRUNCATED);
+    IMPP_CHECK(bmp::try_load_memory_region<pixel32rgba>(bytes.data(), bytes.size(), 0, 0, 8, 8).get_error().code == error::ERROR_TRUNCATED);
+
+    // rle rows are not bound to the input size
+    bytes = make_bitmap(unit::random_image<pixel32rgba>(2, 2), 8, false);
+    const uint32_t rle8 = bmp::BMP_COMPRESSION_RLE8;
+    memcpy(bytes.data() + 30, &rle8, sizeof(rle8));
+    IMPP_CHECK(resize(60000, 60000) == error::ERROR_UNSUPPORTED);
+}
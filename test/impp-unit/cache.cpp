@@ -0,0 +1,144 @@
+#include <chrono>
+#include <thread>
+#include <cache.hpp>
+#include <tga.hpp>
+#include "unit.hpp"
+
+using namespace impp;
+
+namespace
+{
+    // images of a known size in bytes, the value tells which load made them
+    image<pixel32rgba> filled(uint32_t size, uint8_t value)
+    {
+        return image<pixel32rgba>::create(size, size, std::vector<pixel32rgba>(size * size, pixel32rgba{ value, value, value, 255 }));
+    }
+
+    constexpr size_t cost(uint32_t size)
+    {
+        return sizeof(image<pixel32rgba>) + size * size * sizeof(pixel32rgba);
+    }
+}
+
+IMPP_TEST(cache_keys)
+{
+    image_cache<pixel32rgba> cache(cost(16) * 4);
+    int loads = 0;
+    const auto load = [&] { loads++; return result<image<pixel32rgba>>(filled(16, uint8_t(loads))); };
+
+    const auto first = cache.try_get("a", load);
+    const auto again = cache.try_get("a", load);
+    IMPP_CHECK(first && again && *first == *again && loads == 1);
+    IMPP_CHECK(cache.try_get("b", load).value()->pixels[0].r == 2);
+
+    auto counters = cache.get_counters();
+    IMPP_CHECK(counters.hits == 1 && counters.misses == 2 && counters.entries == 2 && counters.bytes == cost(16) * 2);
+
+    // a rewritten file is loaded again, the same bytes in memory are found by their content
+    const auto filename = unit::tempfile("cache.tga");
+    IMPP_CHECK(tga::save_to_file<tga::TGA_UNCOMPRESSED_RGB>(filled(8, 1), filename));
+    const auto from_file = cache.get(filename);
+    IMPP_CHECK(from_file && from_file->width == 8 && cache.get(filename) == from_file);
+    IMPP_CHECK(tga::save_to_file<tga::TGA_UNCOMPRESSED_RGB>(filled(9, 2), filename));
+    const auto rewritten = cache.get(filename);
+    IMPP_CHECK(rewritten && rewritten->width == 9 && from_file->width == 8);
+    std::filesystem::remove(filename);
+    IMPP_CHECK(!cache.try_get(filename) && cache.try_get(filename).get_error().code == error::ERROR_FILE_OPEN);
+
+    memory_encoder encoded;
+    IMPP_CHECK(tga::try_save_to_memory<tga::TGA_RLE_RBG>(filled(4, 3), encoded).has_value());
+    const std::vector<uint8_t> copy(encoded.get_data(), encoded.get_data() + encoded.get_writesize());
+    const auto from_memory = cache.get_memory(encoded.get_data(), encoded.get_writesize());
+    IMPP_CHECK(from_memory && from_memory->pixels[0].r == 3 && cache.get_memory(copy.data(), copy.size()) == from_memory);
+
+    // failures are handed out and never kept
+    const auto failing = [&] { loads++; return result<image<pixel32rgba>>(error::error_info{ error::ERROR_INVALID_ARGUMENT, 0, "broken" }); };
+    loads = 0;
+    IMPP_CHECK(!cache.try_get("broken", failing) && !cache.try_get("broken", failing) && loads == 2);
+}
+
+IMPP_TEST(cache_eviction)
+{
+    image_cache<pixel32rgba> cache(cost(16) * 3);
+    const auto load = [](uint8_t value) { return [=] { return result<image<pixel32rgba>>(filled(16, value)); }; };
+
+    const auto kept = cache.try_get("0", load(0)).value();
+    cache.try_get("1", load(1));
+    cache.try_get("2", load(2));
+    // the clock hand clears the reference bits first, then the hits spare the entries used since
+    cache.try_get("3", load(3));
+    cache.try_get("1", load(11));
+    cache.try_get("4", load(4));
+    auto counters = cache.get_counters();
+    IMPP_CHECK(counters.evictions == 2 && counters.entries == 3 && counters.bytes <= cache.get_budget());
+    IMPP_CHECK(cache.try_get("1", load(11)).value()->pixels[0].r == 1);
+    IMPP_CHECK(cache.try_get("0", load(10)).value()->pixels[0].r == 10);
+
+    // handles outlive their entries, larger images than the budget are not kept
+    IMPP_CHECK(kept->pixels[0].r == 0 && kept->pixels.size() == 256);
+    const auto large = cache.try_get("large", [] { return result<image<pixel32rgba>>(filled(32, 7)); });
+    IMPP_CHECK(large && large.value()->width == 32 && cache.get_counters().bytes <= cache.get_budget());
+    IMPP_CHECK(cache.try_get("large", [] { return result<image<pixel32rgba>>(filled(32, 8)); }).value()->pixels[0].r == 8);
+
+    cache.set_budget(0);
+    counters = cache.get_counters();
+    IMPP_CHECK(counters.entries == 0 && counters.bytes == 0);
+    cache.set_budget(cost(16));
+    cache.try_get("5", load(5));
+    cache.clear();
+    IMPP_CHECK(cache.get_counters().entries == 0 && cache.try_get("5", load(6)).value()->pixels[0].r == 6);
+}
+
+IMPP_TEST(cache_coalescing)
+{
+    image_cache<pixel32rgba> cache(cost(64) * 2);
+    std::atomic<int> loads{ 0 };
+    const auto slow = [&] {
+        loads++;
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        return result<image<pixel32rgba>>(filled(64, 9));
+    };
+
+    // concurrent misses on one key share a single load
+    std::vector<image_cache<pixel32rgba>::handle> handles(8);
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < handles.size(); i++)
+        threads.emplace_back([&, i] { handles[i] = cache.try_get("shared", slow).value(); });
+    for (auto& thread : threads)
+        thread.join();
+
+    bool same = true;
+    for (const auto& handle : handles)
+        same &= handle == handles[0];
+    const auto counters = cache.get_counters();
+    IMPP_CHECK(same && handles[0]->pixels[0].r == 9 && loads == 1);
+    IMPP_CHECK(counters.misses == 1 && counters.coalesced + counters.hits == handles.size() - 1);
+}
+
+#if IMPP_EXCEPTIONS
+IMPP_TEST(cache_throwing_loader)
+{
+    image_cache<pixel32rgba> cache(cost(16) * 2);
+    const auto throwing = []() -> result<image<pixel32rgba>> {
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        throw std::runtime_error("loader");
+    };
+
+    // the thread waiting for the load gets its exception
+    bool waiter_threw = false;
+    std::thread waiter([&] {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        try { cache.try_get("thrown", throwing); }
+        catch (const std::runtime_error&) { waiter_threw = true; }
+    });
+    bool loader_threw = false;
+    try { cache.try_get("thrown", throwing); }
+    catch (const std::runtime_error&) { loader_threw = true; }
+    waiter.join();
+    IMPP_CHECK(loader_threw && waiter_threw);
+
+    // nothing is left pending, the next miss loads again
+    const auto loaded = cache.try_get("thrown", [] { return result<image<pixel32rgba>>(filled(16, 4)); });
+    IMPP_CHECK(loaded && loaded.value()->pixels[0].r == 4 && cache.get_counters().entries == 1);
+}
+#endif
@@ -0,0 +1,132 @@
+#include <cstring>
+#include <codec.hpp>
+#include "unit.hpp"
+
+using namespace impp;
+
+namespace
+{
+    // minimal format: "IMPP", 32bit width and height, rgba pixels
+    struct raw_codec
+    {
+        static constexpr const char* name = "raw";
+
+        static codec::sniff_result sniff(const void* memory, size_t size)
+        {
+            return size >= 12 && memcmp(memory, "IMPP", 4) == 0 ? codec::SNIFF_YES : codec::SNIFF_NO;
+        }
+
+        template<pixel_type pixel>
+        static result<image<pixel>> decode(const void* memory, size_t size)
+        {
+            auto dec = decoder::create(memory, size, error::ERROR_POLICY_RECORD);
+            dec.proceed_reading(4);
+            const auto width = dec.read<uint32_t>();
+            const auto height = dec.read<uint32_t>();
+            auto img = image<pixel>::create(width, height);
+            for (auto& px : img.pixels)
+                px = pixel_cast<pixel>(dec.read<pixel32rgba>());
+            if (dec.failed())
+                return dec.get_error();
+            return img;
+        }
+    };
+
+    std::vector<uint8_t> raw_bytes(const image<pixel32rgba>& source)
+    {
+        std::vector<uint8_t> bytes = { 'I', 'M', 'P', 'P' };
+        bytes.resize(12 + source.pixels.size() * sizeof(pixel32rgba));
+        memcpy(bytes.data() + 4, &source.width, 4);
+        memcpy(bytes.data() + 8, &source.height, 4);
+        memcpy(bytes.data() + 12, source.pixels.data(), source.pixels.size() * sizeof(pixel32rgba));
+        return bytes;
+    }
+
+    bool same_format(const char* name, const char* expected)
+    {
+        return name && strcmp(name, expected) == 0;
+    }
+}
+
+IMPP_TEST(codec_detect_builtin)
+{
+    for (auto* name : { "init.tga", "final_rle.tga", "final_umap.tga", "final_urgb.tga" })
+    {
+        const auto bytes = unit::read_file(unit::workdir(name));
+        IMPP_CHECK(same_format(detect_format(bytes.data(), bytes.size()), "tga"));
+    }
+
+    const auto bitmap = unit::read_file(unit::workdir("init.bmp"));
+    IMPP_CHECK(same_format(detect_format(bitmap.data(), bitmap.size()), "bmp"));
+
+    // init.tga carries the tga 2.0 footer
+    const auto footer = unit::read_file(unit::workdir("init.tga"));
+    IMPP_CHECK(tga::has_footer(footer.data(), footer.size()));
+    IMPP_CHECK(codec::tga_codec::sniff(footer.data(), footer.size()) == codec::SNIFF_YES);
+
+    const auto plain = unit::read_file(unit::workdir("final_rle.tga"));
+    IMPP_CHECK(!tga::has_footer(plain.data(), plain.size()));
+    IMPP_CHECK(codec::tga_codec::sniff(plain.data(), plain.size()) == codec::SNIFF_MAYBE);
+}
+
+IMPP_TEST(codec_detect_rejects)
+{
+    const uint8_t text[] = "just some text, not an image at all";
+    IMPP_CHECK(detect_format(text, sizeof(text)) == nullptr);
+    IMPP_CHECK(detect_format(text, 0) == nullptr);
+
+    // a tga header with a broken field is not a tga
+    auto bytes = unit::read_file(unit::workdir("final_urgb.tga"));
+    bytes[2] = 4;
+    IMPP_CHECK(detect_format(bytes.data(), bytes.size()) == nullptr);
+    bytes[2] = tga::TGA_UNCOMPRESSED_RGB;
+    bytes[16] = 7;
+    IMPP_CHECK(detect_format(bytes.data(), bytes.size()) == nullptr);
+
+    auto res = try_load_memory<pixel32rgba>(text, sizeof(text));
+    IMPP_CHECK(!res && res.get_error().code == error::ERROR_UNSUPPORTED);
+    IMPP_CHECK(try_load<pixel32rgba>(unit::workdir("missing.tga")).get_error().code == error::ERROR_FILE_OPEN);
+}
+
+IMPP_TEST(codec_load_dispatch)
+{
+    for (auto* name : { "final_rle.tga", "final_umap.tga", "init.tga" })
+    {
+        auto img = load<pixel32rgba>(unit::workdir(name));
+        auto expected = tga::load<pixel32rgba>(unit::workdir(name));
+        IMPP_CHECK(!img.empty() && img.pixels == expected.pixels);
+    }
+
+    auto bitmap = load<pixel24bgr>(unit::workdir("init.bmp"));
+    IMPP_CHECK(!bitmap.empty() && bitmap.pixels == bmp::load<pixel24bgr>(unit::workdir("init.bmp")).pixels);
+
+    auto bytes = unit::read_file(unit::workdir("final_urgb.tga"));
+    auto img = image<pixel24rgb>::from_buffer(bytes.data(), bytes.size());
+    IMPP_CHECK(img.pixels == image<pixel24rgb>::from_file(unit::workdir("final_urgb.tga")).pixels);
+}
+
+IMPP_TEST(codec_custom_registration)
+{
+    const auto source = unit::random_image<pixel32rgba>(7, 5);
+    const auto bytes = raw_bytes(source);
+    IMPP_CHECK(detect_format(bytes.data(), bytes.size()) == nullptr);
+
+    codec::register_codec<raw_codec>();
+    IMPP_CHECK(codec::registry::get_instance().find("raw").has_value());
+    IMPP_CHECK(same_format(detect_format(bytes.data(), bytes.size()), "raw"));
+
+    auto img = load_memory<pixel32bgra>(bytes.data(), bytes.size());
+    IMPP_CHECK(img.width == 7 && img.height == 5 && img.pixels == pixel_convert<pixel32bgra>(source.pixels));
+
+    auto truncated = try_load_memory<pixel32rgba>(bytes.data(), 20);
+    IMPP_CHECK(truncated.get_error().code == error::ERROR_TRUNCATED);
+
+    // registering again replaces the codec instead of adding it twice
+    const auto count = codec::registry::get_instance().get_names().size();
+    codec::register_codec<raw_codec>();
+    IMPP_CHECK(codec::registry::get_instance().get_names().size() == count);
+
+    IMPP_CHECK(codec::unregister_codec("raw"));
+    IMPP_CHECK(!codec::unregister_codec("raw"));
+    IMPP_CHECK(detect_format(bytes.data(), bytes.size()) == nullptr);
+}
@@ -0,0 +1,82 @@
+#include <cmath>
+#include <colorspace.hpp>
+#include "unit.hpp"
+
+using namespace impp;
+
+namespace
+{
+    double reference_decode(double value)
+    {
+        return value <= 0.04045 ? value / 12.92 : std::pow((value + 0.055) / 1.055, 2.4);
+    }
+
+    double reference_encode(double value)
+    {
+        return value <= 0.0031308 ? value * 12.92 : 1.055 * std::pow(value, 1.0 / 2.4) - 0.055;
+    }
+}
+
+IMPP_TEST(colorspace_tables)
+{
+    // every srgb value comes back from both working formats
+    auto ramp = image<pixel32rgba>::create(256, 1);
+    for (size_t i = 0; i < 256; i++)
+        ramp.pixels[i] = pixel32rgba{ uint8_t(i), uint8_t(255 - i), uint8_t(i * 7), uint8_t(i) };
+    const auto wide = srgb_to_linear<pixel64linear>(ramp);
+    const auto real = srgb_to_linear<pixel128linear>(ramp);
+    IMPP_CHECK(linear_to_srgb(wide).pixels == ramp.pixels);
+    IMPP_CHECK(linear_to_srgb(real).pixels == ramp.pixels);
+
+    bool decoded = true;
+    for (size_t i = 0; i < 256; i++)
+    {
+        decoded &= std::abs(real.pixels[i].r - reference_decode(i / 255.0)) < 1e-6;
+        decoded &= std::abs(wide.pixels[i].r - reference_decode(i / 255.0) * 65535) <= 0.5;
+        // alpha is only rescaled
+        decoded &= wide.pixels[i].a == i * 257 && real.pixels[i].a == i / 255.0f;
+        decoded &= srgb_decode(uint8_t(i)) == real.pixels[i].r;
+    }
+    IMPP_CHECK(decoded);
+
+    // any linear value is encoded within one step of the exact one, and never backwards
+    bool encoded = true;
+    uint8_t previous = 0;
+    for (size_t i = 0; i <= 20000; i++)
+    {
+        const float value = i / 20000.0f;
+        const auto srgb = srgb_encode(value);
+        encoded &= std::abs(srgb - reference_encode(value) * 255) <= 1.0 && srgb >= previous;
+        previous = srgb;
+    }
+    IMPP_CHECK(encoded);
+    IMPP_CHECK(srgb_encode(-1.0f) == 0 && srgb_encode(2.0f) == 255 && srgb_encode(NAN) == 0);
+}
+
+IMPP_TEST(colorspace_images)
+{
+    // the vectorized loops and their scalar tails, on several workers
+    const auto source = unit::random_image<pixel32rgba>(301, 333);
+    for (unsigned threads : { 1u, 3u })
+    {
+        IMPP_CHECK(linear_to_srgb(srgb_to_linear<pixel64linear>(source, threads), threads).pixels == source.pixels);
+        IMPP_CHECK(linear_to_srgb(srgb_to_linear<pixel128linear>(source, threads), threads).pixels == source.pixels);
+    }
+
+    // other pixel types, 24bit ones are opaque
+    auto bgr = image_convert<pixel24bgr>(source);
+    bgr.orientation = image<pixel24bgr>::LEFT_BOTTOM;
+    const auto linear = srgb_to_linear<pixel128linear>(bgr);
+    IMPP_CHECK(linear.orientation == image<pixel128linear>::LEFT_BOTTOM && linear.pixels[5].a == 1.0f);
+    IMPP_CHECK(linear_to_srgb<pixel24bgr>(linear).pixels == bgr.pixels);
+    IMPP_CHECK(linear_to_srgb<pixel32bgra>(srgb_to_linear(image_convert<pixel32bgra>(source))).pixels == image_convert<pixel32bgra>(source).pixels);
+
+    // out of range values are clamped, halfway between black and white in linear light is srgb 188
+    std::vector<pixel128linear> outside = { { -0.5f, 1.5f, 0.5f, 2.0f }, { NAN, 0.0f, 1.0f, -1.0f } };
+    std::vector<pixel32rgba> clamped(2);
+    linear_to_srgb(outside.data(), clamped.data(), clamped.size());
+    IMPP_CHECK(clamped[0] == (pixel32rgba{ 0, 255, 188, 255 }) && clamped[1] == (pixel32rgba{ 0, 0, 255, 0 }));
+    std::vector<pixel64linear> half = { { 32768, 0, 65535, 32896 } };
+    linear_to_srgb(half.data(), clamped.data(), 1);
+    IMPP_CHECK(clamped[0] == (pixel32rgba{ 188, 0, 255, 128 }));
+}
@@ -0,0 +1,257 @@
+#include <cmath>
+#include <cstdio>
+#include <codec.hpp>
+#include <dds.hpp>
+#include "unit.hpp"
+
+using namespace impp;
+
+namespace
+{
+    // smooth color ramps with a few hard edges, the content block compression is made for
+    image<pixel32rgba> gradient_image(uint32_t width, uint32_t height)
+    {
+        auto img = image<pixel32rgba>::create(width, height);
+        for (uint32_t y = 0; y < height; y++)
+            for (uint32_t x = 0; x < width; x++)
+                img.set_pixel(x, y, pixel32rgba{ uint8_t(x * 255 / width), uint8_t(y * 255 / height), uint8_t((x / 16 + y / 16) & 1 ? 200 : 40), uint8_t(255 - (x + y) / 2) });
+        return img;
+    }
+
+    // peak signal to noise ratio over the channels compared, rgb only unless alpha is set
+    double psnr(const image<pixel32rgba>& a, const image<pixel32rgba>& b, bool alpha = false)
+    {
+        double error = 0;
+        for (size_t i = 0; i < a.pixels.size(); i++)
+        {
+            const auto& p = a.pixels[i];
+            const auto& q = b.pixels[i];
+            error += (p.r - q.r) * (p.r - q.r) + (p.g - q.g) * (p.g - q.g) + (p.b - q.b) * (p.b - q.b);
+            if (alpha)
+                error += (p.a - q.a) * (p.a - q.a);
+        }
+        error /= static_cast<double>(a.pixels.size() * (alpha ? 4 : 3));
+        return error == 0 ? 100.0 : 10.0 * std::log10(255.0 * 255.0 / error);
+    }
+
+    image<pixel32rgba> roundtrip(const image<pixel32rgba>& source, bc::bc_format format, unsigned threads = 1)
+    {
+        const auto blocks = bc::compress(source, format, threads);
+        auto res = bc::try_decompress(blocks.data(), blocks.size(), format, source.width, source.height);
+        return res ? std::move(res).value() : image<pixel32rgba>::null();
+    }
+
+    std::vector<uint8_t> encode(const image<pixel32rgba>& source, dds::dds_format format)
+    {
+        memory_encoder enc;
+        dds::save_to_memory(source, enc, format);
+        return { enc.get_data(), enc.get_data() + enc.get_writesize() };
+    }
+}
+
+IMPP_TEST(bc_quality)
+{
+    const auto source = gradient_image(64, 48);
+    const auto bc1 = roundtrip(source, bc::BC_FORMAT_BC1);
+    const auto bc3 = roundtrip(source, bc::BC_FORMAT_BC3);
+    const auto bc7 = roundtrip(source, bc::BC_FORMAT_BC7);
+    IMPP_CHECK(bc1.width == 64 && bc3.width == 64 && bc7.width == 64);
+    // the ramps are planar inside a block so a single line of colors cannot be exact
+    IMPP_CHECK(psnr(source, bc1) > 36);
+    IMPP_CHECK(psnr(source, bc3, true) > 37);
+    IMPP_CHECK(psnr(source, bc7, true) > 39 && psnr(source, bc7, true) > psnr(source, bc3, true));
+
+    // bc1 keeps 1 bit alpha, bc2 4 bits
+    for (const auto& px : bc1.pixels)
+        IMPP_CHECK(px.a == 255);
+    const auto bc2 = roundtrip(source, bc::BC_FORMAT_BC2);
+    for (size_t i = 0; i < source.pixels.size(); i++)
+        IMPP_CHECK(std::abs(bc2.pixels[i].a - source.pixels[i].a) <= 8);
+
+    // noise is the worst case but must stay sane
+    const auto noise = unit::random_image<pixel32rgba>(32, 32, 7);
+    IMPP_CHECK(psnr(noise, roundtrip(noise, bc::BC_FORMAT_BC7), true) > psnr(noise, roundtrip(noise, bc::BC_FORMAT_BC1)) - 1);
+}
+
+IMPP_TEST(bc_blocks)
+{
+    // solid blocks come back exactly or within the 565 rounding
+    auto solid = image<pixel32rgba>::create(4, 4);
+    for (auto color : { pixel32rgba{ 0, 0, 0, 255 }, pixel32rgba{ 255, 255, 255, 255 }, pixel32rgba{ 13, 200, 77, 255 }, pixel32rgba{ 128, 1, 254, 200 } })
+    {
+        solid.fill_rect(0, 0, 4, 4, color);
+        const auto bc1 = roundtrip(solid, bc::BC_FORMAT_BC1);
+        IMPP_CHECK(std::abs(bc1.pixels[0].r - color.r) <= 1 && std::abs(bc1.pixels[0].g - color.g) <= 1 && std::abs(bc1.pixels[0].b - color.b) <= 1);
+        const auto bc7 = roundtrip(solid, bc::BC_FORMAT_BC7);
+        IMPP_CHECK(std::abs(bc7.pixels[0].r - color.r) <= 1 && std::abs(bc7.pixels[0].a - color.a) <= 1);
+        const auto bc3 = roundtrip(solid, bc::BC_FORMAT_BC3);
+        IMPP_CHECK(bc3.pixels[0].a == color.a);
+    }
+
+    // transparent pixels pick the bc1 3 color mode
+    auto cutout = gradient_image(8, 8);
+    for (uint32_t y = 0; y < 8; y++)
+        for (uint32_t x = 0; x < 8; x++)
+        {
+            auto px = *cutout.get_pixel(x, y);
+            px.a = (x + y) % 3 == 0 ? 0 : 255;
+            cutout.set_pixel(x, y, px);
+        }
+    const auto bc1 = roundtrip(cutout, bc::BC_FORMAT_BC1);
+    for (size_t i = 0; i < cutout.pixels.size(); i++)
+        IMPP_CHECK((bc1.pixels[i].a == 0) == (cutout.pixels[i].a == 0));
+
+    // sides that are not multiples of 4 and the worker count do not change the blocks
+    const auto odd = gradient_image(37, 23);
+    IMPP_CHECK(bc::get_compressed_size(bc::BC_FORMAT_BC1, 37, 23) == 10 * 6 * 8);
+    IMPP_CHECK(bc::compress(odd, bc::BC_FORMAT_BC7, 1) == bc::compress(odd, bc::BC_FORMAT_BC7, 4));
+    IMPP_CHECK(psnr(odd, roundtrip(odd, bc::BC_FORMAT_BC3, 3)) > 32);
+
+    // top row first: the first block holds the top left corner
+    auto corner = image<pixel32rgba>::create(4, 8);
+    corner.fill_rect(0, 0, 4, 4, pixel32rgba{ 255, 0, 0, 255 });
+    const auto blocks = bc::compress(corner, bc::BC_FORMAT_BC1);
+    IMPP_CHECK(bc::detail::bc_unpack565(bc::detail::bc_read16(blocks.data())).r == 255);
+
+    // a hand made mode 5 block: rotation 0, red endpoints 127 and 0, alpha 255 and 0, all indices 0
+    bc::detail::bc_bits bits;
+    bits.put(1 << 5, 6);
+    bits.put(0, 2);
+    bits.put(127, 7);
+    bits.put(0, 7 * 5);
+    bits.put(255, 8);
+    bits.put(0, 8);
+    uint8_t mode5[16];
+    bits.store(mode5);
+    auto decoded = bc::try_decompress(mode5, sizeof(mode5), bc::BC_FORMAT_BC7, 4, 4);
+    IMPP_CHECK(decoded && decoded->pixels[0] == (pixel32rgba{ 255, 0, 0, 255 }));
+
+    // partitioned bc7 modes are reported, short input too
+    const uint8_t mode1[16] = { 0x02 };
+    IMPP_CHECK(bc::try_decompress(mode1, sizeof(mode1), bc::BC_FORMAT_BC7, 4, 4).get_error().code == error::ERROR_UNSUPPORTED);
+    IMPP_CHECK(bc::try_decompress(mode1, 8, bc::BC_FORMAT_BC7, 4, 4).get_error().code == error::ERROR_TRUNCATED);
+    IMPP_CHECK(bc::compress(image<pixel32rgba>::null(), bc::BC_FORMAT_BC1).empty());
+}
+
+IMPP_TEST(dds_roundtrip)
+{
+    const auto source = gradient_image(61, 37);
+    for (auto format : { dds::DDS_FORMAT_BC1, dds::DDS_FORMAT_BC2, dds::DDS_FORMAT_BC3, dds::DDS_FORMAT_BC7 })
+    {
+        const auto bytes = encode(source, format);
+        const auto size = bc::get_compressed_size(static_cast<bc::bc_format>(format), 61, 37);
+        IMPP_CHECK(bytes.size() == 128 + (format == dds::DDS_FORMAT_BC7 ? 20 : 0) + size);
+        IMPP_CHECK(dds::has_signature(bytes.data(), bytes.size()));
+
+        // the file holds the same blocks the compressor makes
+        const auto blocks = bc::compress(source, static_cast<bc::bc_format>(format));
+        IMPP_CHECK(std::equal(blocks.begin(), blocks.end(), bytes.end() - size));
+
+        auto loaded = dds::try_load_memory<pixel32rgba>(bytes.data(), bytes.size());
+        IMPP_CHECK(loaded && loaded->pixels == roundtrip(source, static_cast<bc::bc_format>(format)).pixels);
+        auto bgr = dds::load_memory<pixel24bgr>(bytes.data(), bytes.size());
+        IMPP_CHECK(bgr.pixels == pixel_convert<pixel24bgr>(loaded->pixels));
+    }
+
+    // legacy headers carry a fourcc, bc7 the DX10 extension
+    const auto dxt1 = encode(source, dds::DDS_FORMAT_BC1);
+    IMPP_CHECK(memcmp(dxt1.data() + 84, "DXT1", 4) == 0);
+    const auto dx10 = encode(source, dds::DDS_FORMAT_BC7);
+    IMPP_CHECK(memcmp(dx10.data() + 84, "DX10", 4) == 0 && dx10[128] == dds::DXGI_FORMAT_BC7_UNORM);
+
+    // uncompressed data is exact, from any pixel type
+    const auto random = unit::random_image<pixel32bgra>(19, 7, 3);
+    memory_encoder enc;
+    IMPP_CHECK(dds::save_to_memory(random, enc, dds::DDS_FORMAT_RGBA8));
+    IMPP_CHECK(enc.get_writesize() == 128 + 19 * 7 * 4);
+    IMPP_CHECK(dds::load_memory<pixel32bgra>(enc.get_data(), enc.get_writesize()).pixels == random.pixels);
+
+    // a bgrx file written by hand
+    std::vector<uint8_t> bgrx(128 + 8);
+    dds::dds_header header{};
+    header.size = sizeof(header);
+    header.width = 2;
+    header.height = 1;
+    header.pixelformat.size = sizeof(header.pixelformat);
+    header.pixelformat.flags = dds::DDPF_RGB;
+    header.pixelformat.bitcount = 32;
+    header.pixelformat.rmask = 0xFF0000;
+    header.pixelformat.gmask = 0xFF00;
+    header.pixelformat.bmask = 0xFF;
+    memcpy(bgrx.data(), "DDS ", 4);
+    memcpy(bgrx.data() + 4, &header, sizeof(header));
+    const uint8_t texels[] = { 1, 2, 3, 0, 4, 5, 6, 0 };
+    memcpy(bgrx.data() + 128, texels, sizeof(texels));
+    auto rgba = dds::load_memory<pixel32rgba>(bgrx.data(), bgrx.size());
+    IMPP_CHECK(rgba.pixels == (std::vector<pixel32rgba>{ { 3, 2, 1, 255 }, { 6, 5, 4, 255 } }));
+}
+
+IMPP_TEST(dds_invalid_input)
+{
+    const auto bytes = encode(gradient_image(16, 16), dds::DDS_FORMAT_BC7);
+    auto code = [](const std::vector<uint8_t>& data) { return dds::try_load_memory<pixel32rgba>(data.data(), data.size()).get_error().code; };
+
+    IMPP_CHECK(code({ bytes.begin(), bytes.begin() + 100 }) == error::ERROR_TRUNCATED);
+    IMPP_CHECK(code({ bytes.begin(), bytes.begin() + 140 }) == error::ERROR_TRUNCATED);
+    IMPP_CHECK(code({ bytes.begin(), bytes.end() - 1 }) == error::ERROR_TRUNCATED);
+
+    auto magic = bytes;
+    magic[0] = 'X';
+    IMPP_CHECK(code(magic) == error::ERROR_INVALID_HEADER);
+
+    auto size = bytes;
+    size[4] = 100;
+    IMPP_CHECK(code(size) == error::ERROR_INVALID_HEADER);
+
+    auto empty = bytes;
+    memset(empty.data() + 12, 0, 8);
+    IMPP_CHECK(code(empty) == error::ERROR_INVALID_HEADER);
+
+    auto dxgi = bytes;
+    dxgi[128] = 2;
+    IMPP_CHECK(code(dxgi) == error::ERROR_UNSUPPORTED);
+
+    auto fourcc = bytes;
+    memcpy(fourcc.data() + 84, "ATI2", 4);
+    IMPP_CHECK(code(fourcc) == error::ERROR_UNSUPPORTED);
+
+    // sides far larger than the data are rejected before anything large is allocated
+    for (auto format : { dds::DDS_FORMAT_BC7, dds::DDS_FORMAT_RGBA8 })
+    {
+        auto oversized = encode(gradient_image(16, 16), format);
+        const uint32_t side = 16384;
+        memcpy(oversized.data() + 12, &side, 4);
+        memcpy(oversized.data() + 16, &side, 4);
+        unit::largest_allocation = 0;
+        IMPP_CHECK(code(oversized) == error::ERROR_TRUNCATED);
+        IMPP_CHECK(dds::try_load_mipmaps_memory<pixel32rgba>(oversized.data(), oversized.size()).get_error().code == error::ERROR_TRUNCATED);
+        IMPP_CHECK(unit::largest_allocation < 64 * 1024);
+    }
+
+    // a mode 0 block in the middle
+    auto partitioned = bytes;
+    partitioned[148 + 16 * 5] = 0x01;
+    auto res = dds::try_load_memory<pixel32rgba>(partitioned.data(), partitioned.size());
+    IMPP_CHECK(res.get_error().code == error::ERROR_UNSUPPORTED && res.get_error().offset == 148 + 16 * 5);
+
+    memory_encoder enc;
+    IMPP_CHECK(dds::try_save_to_memory(image<pixel32rgba>::null(), enc).get_error().code == error::ERROR_INVALID_ARGUMENT);
+    IMPP_CHECK(dds::try_save_to_memory(gradient_image(4, 4), enc, static_cast<dds::dds_format>(5)).get_error().code == error::ERROR_INVALID_ARGUMENT);
+}
+
+IMPP_TEST(dds_files_and_sniffing)
+{
+    const auto source = tga::load<pixel32rgba>(unit::workdir("final_rle.tga"));
+    const auto filename = unit::tempfile("roundtrip.dds");
+    auto written = dds::try_save_to_file(source, filename, dds::DDS_FORMAT_RGBA8);
+    IMPP_CHECK(written && *written == unit::read_file(filename).size());
+
+    const auto bytes = unit::read_file(filename);
+    const char* format = detect_format(bytes.data(), bytes.size());
+    IMPP_CHECK(format && std::string(format) == "dds");
+    IMPP_CHECK(impp::load<pixel32rgba>(filename).pixels == source.pixels);
+    IMPP_CHECK(dds::load<pixel32rgba>(filename).pixels == source.pixels);
+    std::remove(filename.c_str());
+
+    IMPP_CHECK(codec::dds_codec::sniff(bytes.data(), 64) == codec::SNIFF_NO);
+}
@@ -0,0 +1,130 @@
+#include <cstring>
+#include <random>
+#include <deflate.hpp>
+#include "unit.hpp"
+
+using namespace impp;
+
+namespace
+{
+    constexpr deflate::deflate_level levels[] = { deflate::DEFLATE_STORE, deflate::DEFLATE_RLE, deflate::DEFLATE_FAST, deflate::DEFLATE_DEFAULT };
+
+    // runs, repeated phrases and noise so every block type gets picked
+    std::vector<uint8_t> mixed_data(size_t size, uint32_t seed = 1)
+    {
+        std::mt19937 rng(seed);
+        std::vector<uint8_t> data;
+        const char* phrase = "the quick brown fox jumps over the lazy dog ";
+        while (data.size() < size)
+        {
+            switch (rng() % 3)
+            {
+            case 0: data.insert(data.end(), rng() % 300, static_cast<uint8_t>(rng())); break;
+            case 1: data.insert(data.end(), phrase, phrase + strlen(phrase)); break;
+            default: for (auto n = rng() % 200; n > 0; n--) data.push_back(static_cast<uint8_t>(rng())); break;
+            }
+        }
+        data.resize(size);
+        return data;
+    }
+
+    bool roundtrip(const std::vector<uint8_t>& data, deflate::deflate_level level, size_t* compressed_size = nullptr)
+    {
+        std::vector<uint8_t> compressed;
+        deflate::zlib_compress(data.data(), data.size(), level, &compressed);
+        if (compressed_size)
+            *compressed_size = compressed.size();
+
+        std::vector<uint8_t> out(data.size());
+        auto res = deflate::zlib_decompress(compressed.data(), compressed.size(), out.data(), out.size());
+        return res && *res == data.size() && out == data;
+    }
+}
+
+IMPP_TEST(deflate_roundtrip)
+{
+    const std::vector<std::vector<uint8_t>> inputs = {
+        {},
+        { 42 },
+        std::vector<uint8_t>(100000, 7),
+        mixed_data(1000),
+        mixed_data(300000, 2),
+    };
+
+    for (const auto& data : inputs)
+        for (auto level : levels)
+            IMPP_CHECK(roundtrip(data, level));
+
+    // noise falls back to stored blocks instead of growing
+    std::vector<uint8_t> noise(200000);
+    std::mt19937 rng(5);
+    for (auto& b : noise)
+        b = static_cast<uint8_t>(rng());
+    size_t size = 0;
+    IMPP_CHECK(roundtrip(noise, deflate::DEFLATE_DEFAULT, &size));
+    IMPP_CHECK(size < noise.size() + noise.size() / 1000 + 64);
+}
+
+IMPP_TEST(deflate_levels)
+{
+    const auto data = mixed_data(200000, 4);
+    size_t stored = 0, rle = 0, fast = 0, def = 0;
+    IMPP_CHECK(roundtrip(data, deflate::DEFLATE_STORE, &stored));
+    IMPP_CHECK(roundtrip(data, deflate::DEFLATE_RLE, &rle));
+    IMPP_CHECK(roundtrip(data, deflate::DEFLATE_FAST, &fast));
+    IMPP_CHECK(roundtrip(data, deflate::DEFLATE_DEFAULT, &def));
+    IMPP_CHECK(stored > data.size() && rle < stored && fast < rle && def <= fast);
+}
+
+IMPP_TEST(deflate_reference_streams)
+{
+    // zlib output for "hello hello hello hello": a fixed huffman block with an overlapping match
+    const uint8_t fixed[] = { 0x78, 0x9C, 0xCB, 0x48, 0xCD, 0xC9, 0xC9, 0x57, 0xC8, 0x40, 0x27, 0x01, 0x68, 0x03, 0x08, 0xB1 };
+    const char* expected = "hello hello hello hello";
+    char out[32] = {};
+    auto res = deflate::zlib_decompress(fixed, sizeof(fixed), out, sizeof(out));
+    IMPP_CHECK(res && *res == strlen(expected) && memcmp(out, expected, *res) == 0);
+
+    // the expected size is a hard limit
+    IMPP_CHECK(deflate::zlib_decompress(fixed, sizeof(fixed), out, 10).get_error().code == error::ERROR_CORRUPT_DATA);
+
+    // raw stream: a stored block with "abc"
+    const uint8_t stored[] = { 0x01, 0x03, 0x00, 0xFC, 0xFF, 'a', 'b', 'c' };
+    auto raw = deflate::inflate(stored, sizeof(stored), out, sizeof(out));
+    IMPP_CHECK(raw && *raw == 3 && memcmp(out, "abc", 3) == 0);
+}
+
+IMPP_TEST(deflate_invalid_input)
+{
+    const auto data = mixed_data(5000);
+    std::vector<uint8_t> compressed;
+    deflate::zlib_compress(data.data(), data.size(), deflate::DEFLATE_DEFAULT, &compressed);
+    std::vector<uint8_t> out(data.size());
+
+    auto truncated = deflate::zlib_decompress(compressed.data(), compressed.size() / 2, out.data(), out.size());
+    IMPP_CHECK(!truncated && truncated.get_error().code == error::ERROR_TRUNCATED);
+    IMPP_CHECK(deflate::zlib_decompress(compressed.data(), 3, out.data(), out.size()).get_error().code == error::ERROR_TRUNCATED);
+
+    auto header = compressed;
+    header[0] = 0x79;
+    IMPP_CHECK(deflate::zlib_decompress(header.data(), header.size(), out.data(), out.size()).get_error().code == error::ERROR_CORRUPT_DATA);
+
+    auto checksum = compressed;
+    checksum.pop_back();
+    checksum.push_back(compressed.back() ^ 1);
+    IMPP_CHECK(deflate::zlib_decompress(checksum.data(), checksum.size(), out.data(), out.size()).get_error().code == error::ERROR_CORRUPT_DATA);
+
+    // block type 3 does not exist
+    const uint8_t reserved[] = { 0x07, 0x00 };
+    IMPP_CHECK(deflate::inflate(reserved, sizeof(reserved), out.data(), out.size()).get_error().code == error::ERROR_CORRUPT_DATA);
+
+    // damaged streams fail cleanly whatever the damage
+    std::mt19937 rng(9);
+    for (int i = 0; i < 200; i++)
+    {
+        auto damaged = compressed;
+        damaged[2 + rng() % (damaged.size() - 2)] ^= static_cast<uint8_t>(1 + rng() % 255);
+        auto res = deflate::zlib_decompress(damaged.data(), damaged.size(), out.data(), out.size());
+        IMPP_CHECK(!res || *res <= out.size());
+    }
+}
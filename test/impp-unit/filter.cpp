@@ -0,0 +1,151 @@
+#include <cmath>
+#include <filter.hpp>
+#include "unit.hpp"
+
+using namespace impp;
+
+namespace
+{
+    int64_t reference_edge(int64_t i, int64_t count, filter_edge edge)
+    {
+        while (i < 0 || i >= count)
+        {
+            if (edge == FILTER_EDGE_CLAMP)
+                i = std::clamp<int64_t>(i, 0, count - 1);
+            else if (edge == FILTER_EDGE_WRAP)
+                i = i < 0 ? i + count : i - count;
+            else
+                i = count == 1 ? 0 : (i < 0 ? -i : 2 * (count - 1) - i);
+        }
+        return i;
+    }
+
+    // direct 2d convolution in image coordinates through get_pixel
+    template<class pixel>
+    std::vector<std::array<double, 4>> reference_filter(const image<pixel>& source, const std::vector<double>& weights, int64_t width, filter_edge edge)
+    {
+        const int64_t height = static_cast<int64_t>(weights.size()) / width;
+        std::vector<std::array<double, 4>> ret;
+        for (int64_t y = 0; y < source.height; y++)
+            for (int64_t x = 0; x < source.width; x++)
+            {
+                std::array<double, 4> sum{};
+                for (int64_t ky = 0; ky < height; ky++)
+                    for (int64_t kx = 0; kx < width; kx++)
+                    {
+                        const auto sx = reference_edge(x + kx - width / 2, source.width, edge);
+                        const auto sy = reference_edge(y + ky - height / 2, source.height, edge);
+                        const auto& bytes = pixel_bytes_view(*source.get_pixel(uint32_t(sx), uint32_t(sy)));
+                        for (size_t c = 0; c < bytes.size(); c++)
+                            sum[c] += bytes[c] * weights[ky * width + kx];
+                    }
+                ret.push_back(sum);
+            }
+        return ret;
+    }
+
+    // largest distance from the rounded reference, image coordinates included
+    template<class pixel>
+    double distance(const image<pixel>& filtered, const std::vector<std::array<double, 4>>& reference)
+    {
+        double worst = 0;
+        for (uint32_t y = 0; y < filtered.height; y++)
+            for (uint32_t x = 0; x < filtered.width; x++)
+            {
+                const auto& bytes = pixel_bytes_view(*filtered.get_pixel(x, y));
+                for (size_t c = 0; c < bytes.size(); c++)
+                    worst = std::max(worst, std::abs(bytes[c] - std::clamp(reference[y * filtered.width + x][c], 0.0, 255.0)));
+            }
+        return worst;
+    }
+
+    std::vector<double> outer(const filter_kernel& horizontal, const filter_kernel& vertical)
+    {
+        std::vector<double> ret;
+        for (auto v : vertical.get_weights())
+            for (auto h : horizontal.get_weights())
+                ret.push_back(double(v) * h);
+        return ret;
+    }
+}
+
+IMPP_TEST(filter_separable_kernels)
+{
+    const auto source = unit::random_image<pixel32rgba>(67, 45);
+    const auto gaussian = filter_kernel::gaussian(1.7f);
+    IMPP_CHECK(gaussian.get_radius() == 6);
+    for (auto edge : { FILTER_EDGE_CLAMP, FILTER_EDGE_WRAP, FILTER_EDGE_MIRROR })
+    {
+        filter_options options;
+        options.edge = edge;
+        IMPP_CHECK(distance(gaussian_blur(source, 1.7f, options), reference_filter(source, outer(gaussian, gaussian), 13, edge)) <= 1.0);
+
+        // box sums are exact, whatever the radius against the sides
+        const auto box = filter_kernel::box(3);
+        IMPP_CHECK(distance(box_blur(source, 3, options), reference_filter(source, outer(box, box), 7, edge)) <= 0.5 + 1e-9);
+        const auto tiny = unit::random_image<pixel24bgr>(5, 3);
+        const auto wide = filter_kernel::box(7);
+        IMPP_CHECK(distance(filter_separable(tiny, wide, filter_kernel::box(4), options), reference_filter(tiny, outer(wide, filter_kernel::box(4)), 15, edge)) <= 0.5 + 1e-9);
+    }
+
+    // negative lobes are clamped to the byte range, flat areas stay flat
+    const auto edges = filter_kernel::custom({ -1.0f, 2.5f, -0.5f });
+    IMPP_CHECK(distance(filter_separable(source, edges, filter_kernel::gaussian(0.8f)), reference_filter(source, outer(edges, filter_kernel::gaussian(0.8f)), 3, FILTER_EDGE_CLAMP)) <= 1.0);
+    const auto flat = image<pixel32rgba>::create(40, 30, std::vector<pixel32rgba>(1200, pixel32rgba{ 17, 128, 250, 255 }));
+    IMPP_CHECK(gaussian_blur(flat, 2.3f).pixels == flat.pixels && box_blur(flat, 5).pixels == flat.pixels);
+    IMPP_CHECK(gaussian_blur(source, 0.0f).pixels == source.pixels && filter_separable(source, filter_kernel{}, filter_kernel::custom({})).pixels == source.pixels);
+}
+
+IMPP_TEST(filter_orientation)
+{
+    // the last of three taps reads the pixel below, whichever way the rows are stored
+    auto source = unit::random_image<pixel32rgba>(9, 7);
+    const auto below = filter_kernel::custom({ 0.0f, 0.0f, 1.0f });
+    for (auto orientation : { image<pixel32rgba>::LEFT_TOP, image<pixel32rgba>::LEFT_BOTTOM })
+    {
+        source.orientation = orientation;
+        const auto moved = filter_separable(source, filter_kernel{}, below);
+        const auto convolved = filter_convolve(source, filter_kernel2d::custom(1, 3, { 0.0f, 0.0f, 1.0f }));
+        bool same = moved.orientation == orientation;
+        for (uint32_t y = 0; y + 1 < source.height; y++)
+            for (uint32_t x = 0; x < source.width; x++)
+                same &= *moved.get_pixel(x, y) == *source.get_pixel(x, y + 1) && *convolved.get_pixel(x, y) == *source.get_pixel(x, y + 1);
+        IMPP_CHECK(same);
+    }
+}
+
+IMPP_TEST(filter_convolve_kernels)
+{
+    const auto source = unit::random_image<pixel24rgb>(41, 29);
+    const std::vector<float> laplacian = { 0, 1, 0, 1, -4, 1, 0, 1, 0 };
+    for (auto edge : { FILTER_EDGE_CLAMP, FILTER_EDGE_MIRROR })
+    {
+        filter_options options;
+        options.edge = edge;
+        const auto result = filter_convolve(source, filter_kernel2d::custom(3, 3, laplacian), options);
+        IMPP_CHECK(distance(result, reference_filter(source, std::vector<double>(laplacian.begin(), laplacian.end()), 3, edge)) <= 0.5 + 1e-9);
+    }
+
+    // an even width gets a zero column on the right
+    const auto shifted = filter_convolve(source, filter_kernel2d::custom(2, 1, { 1.0f, 0.0f }));
+    IMPP_CHECK(distance(shifted, reference_filter(source, { 1.0, 0.0, 0.0 }, 3, FILTER_EDGE_CLAMP)) == 0);
+    IMPP_CHECK(sharpen(source, 0.0f).pixels == source.pixels);
+    IMPP_CHECK(distance(sharpen(source, 0.5f), reference_filter(source, { 0, -0.5, 0, -0.5, 3, -0.5, 0, -0.5, 0 }, 3, FILTER_EDGE_CLAMP)) <= 0.5 + 1e-9);
+}
+
+IMPP_TEST(filter_tiles)
+{
+    // wide kernels cut the image in several columns of tiles, workers give the same pixels
+    const auto source = unit::random_image<pixel32rgba>(1500, 150);
+    filter_options threaded;
+    threaded.threads = 3;
+    threaded.edge = FILTER_EDGE_WRAP;
+    filter_options single;
+    single.edge = FILTER_EDGE_WRAP;
+    const auto gaussian = gaussian_blur(source, 12.0f, single);
+    IMPP_CHECK(gaussian.pixels == gaussian_blur(source, 12.0f, threaded).pixels);
+    const auto box = box_blur(source, 40, single);
+    IMPP_CHECK(box.pixels == box_blur(source, 40, threaded).pixels);
+    IMPP_CHECK(sharpen(source, 1.0f, single).pixels == sharpen(source, 1.0f, threaded).pixels);
+    IMPP_CHECK(gaussian_blur(image<pixel32rgba>::null(), 2.0f).empty());
+}
@@ -0,0 +1,136 @@
+#include <random>
+#include <unordered_set>
+#include <hash.hpp>
+#include "unit.hpp"
+
+using namespace impp;
+
+namespace
+{
+    // soft shapes with some texture, what perceptual hashes are made for
+    image<pixel32rgba> scene(uint32_t size, unsigned seed)
+    {
+        std::mt19937 rng(seed);
+        const double cx = rng() % 100 / 100.0, cy = rng() % 100 / 100.0, phase = rng() % 628 / 100.0;
+        auto img = image<pixel32rgba>::create(size, size);
+        for (uint32_t y = 0; y < size; y++)
+            for (uint32_t x = 0; x < size; x++)
+            {
+                const double u = double(x) / size, v = double(y) / size;
+                const double d = std::sqrt((u - cx) * (u - cx) + (v - cy) * (v - cy));
+                const auto l = uint8_t(127 + 120 * std::sin(d * 9 + phase) * std::cos(u * 5 - v * 3));
+                img.set_pixel(x, y, pixel32rgba{ l, uint8_t(255 - l), uint8_t(u * 255), 255 });
+            }
+        return img;
+    }
+}
+
+IMPP_TEST(hash_bytes_stream)
+{
+    std::mt19937 rng(1);
+    std::vector<uint8_t> data(5000);
+    for (auto& byte : data)
+        byte = uint8_t(rng());
+
+    // fixed value, the vectorized and the scalar accumulation agree
+    const auto known = hash_bytes(data.data(), data.size());
+    IMPP_CHECK(known.low == 0xc5e7db3ce0970be6ull && known.high == 0xfdb4cfcfd27c756bull);
+
+    // any split of the input gives the one shot hash
+    bool same = true;
+    for (size_t size : { 0, 1, 63, 64, 65, 1023, 1024, 1025, 5000 })
+    {
+        const auto expected = hash_bytes(data.data(), size);
+        impp::detail::hash_state state;
+        for (size_t at = 0; at < size; )
+        {
+            const size_t take = std::min<size_t>(size - at, rng() % 150);
+            state.update(data.data() + at, take);
+            at += take;
+        }
+        same &= state.finish() == expected;
+    }
+    IMPP_CHECK(same);
+
+    // a flipped bit, a trailing zero or another seed change both halves
+    const auto base = hash_bytes(data.data(), 1000);
+    data[517] ^= 4;
+    const auto flipped = hash_bytes(data.data(), 1000);
+    IMPP_CHECK(flipped.low != base.low && flipped.high != base.high);
+    data[517] ^= 4;
+    data[1000] = 0;
+    IMPP_CHECK(hash_bytes(data.data(), 1001) != base);
+    IMPP_CHECK(hash_bytes(data.data(), 1000, 1) != base);
+    IMPP_CHECK(hash_bytes(data.data(), 1000) == base);
+}
+
+IMPP_TEST(hash_content)
+{
+    const auto rgba = scene(67, 1);
+    const auto expected = content_hash(rgba);
+
+    // pixel types and orientations do not change the hash of the picture
+    IMPP_CHECK(content_hash(image<pixel32bgra>::create(67, 67, pixel_convert<pixel32bgra>(rgba.pixels))) == expected);
+    const auto rgb = image<pixel24rgb>::create(67, 67, pixel_convert<pixel24rgb>(rgba.pixels));
+    IMPP_CHECK(content_hash(rgb) == expected);
+    IMPP_CHECK(content_hash(image<pixel24bgr>::create(67, 67, pixel_convert<pixel24bgr>(rgba.pixels))) == expected);
+
+    auto bottom = rgba;
+    bottom.set_orientation(image<pixel32rgba>::LEFT_BOTTOM);
+    for (uint32_t y = 0; y < 67 / 2; y++)
+        std::swap_ranges(bottom.pixels.begin() + y * 67, bottom.pixels.begin() + (y + 1) * 67, bottom.pixels.end() - (y + 1) * 67);
+    IMPP_CHECK(content_hash(bottom) == expected);
+
+    // any pixel, the sides and the alpha count
+    auto changed = rgba;
+    auto px = *changed.get_pixel(40, 3);
+    px.b ^= 1;
+    changed.set_pixel(40, 3, px);
+    IMPP_CHECK(content_hash(changed) != expected);
+    auto translucent = rgba;
+    translucent.pixels[0].a = 254;
+    IMPP_CHECK(content_hash(translucent) != expected);
+    const auto wide = image<pixel32rgba>::create(8, 2), tall = image<pixel32rgba>::create(2, 8);
+    IMPP_CHECK(content_hash(wide) != content_hash(tall));
+    IMPP_CHECK(content_hash64(rgba) == expected.low);
+
+    std::unordered_set<image<pixel32rgba>, std::hash<image<pixel32rgba>>, bool(*)(const image<pixel32rgba>&, const image<pixel32rgba>&)> set(
+        8, std::hash<image<pixel32rgba>>{}, [](const image<pixel32rgba>& a, const image<pixel32rgba>& b) { return a.pixels == b.pixels; });
+    set.insert(rgba);
+    set.insert(changed);
+    set.insert(rgba);
+    IMPP_CHECK(set.size() == 2);
+}
+
+IMPP_TEST(hash_perceptual)
+{
+    const auto source = scene(256, 2);
+    const auto other = scene(256, 3);
+
+    // a smaller copy and a brighter one stay close, another picture is far away
+    auto smaller = image<pixel32rgba>::create(97, 97);
+    for (uint32_t y = 0; y < 97; y++)
+        for (uint32_t x = 0; x < 97; x++)
+            smaller.set_pixel(x, y, *source.get_pixel(x * 256 / 97, y * 256 / 97));
+    auto brighter = source;
+    for (auto& px : brighter.pixels)
+        px.r = uint8_t(std::min(255, px.r + 12)), px.g = uint8_t(std::min(255, px.g + 12));
+
+    for (auto hash : { &difference_hash<pixel32rgba>, &perceptual_hash<pixel32rgba> })
+    {
+        const auto h = hash(source);
+        IMPP_CHECK(h != 0);
+        IMPP_CHECK(hash_distance(h, hash(smaller)) <= 6);
+        IMPP_CHECK(hash_distance(h, hash(brighter)) <= 6);
+        IMPP_CHECK(hash_distance(h, hash(other)) >= 16);
+    }
+
+    // the pixel type does not matter, tiny and empty images work
+    const auto rgb = image<pixel24bgr>::create(256, 256, pixel_convert<pixel24bgr>(source.pixels));
+    IMPP_CHECK(perceptual_hash(rgb) == perceptual_hash(source) && difference_hash(rgb) == difference_hash(source));
+    IMPP_CHECK(difference_hash(image<pixel32rgba>::null()) == 0 && perceptual_hash(image<pixel32rgba>::null()) == 0);
+    auto tiny = image<pixel32rgba>::create(3, 2);
+    tiny.set_pixel(2, 0, pixel32rgba{ 255, 255, 255, 255 });
+    IMPP_CHECK(difference_hash(tiny) != 0);
+    IMPP_CHECK(hash_distance(0xFF, 0x0F) == 4);
+}
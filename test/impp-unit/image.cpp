@@ -0,0 +1,201 @@
+#include <image.hpp>
+#include <encoder.hpp>
+#include "unit.hpp"
+
+using namespace impp;
+
+namespace
+{
+    enum class operation { transpose, transverse, rotate90, rotate180, rotate270 };
+
+    // per pixel reference working on top-left based coordinates
+    template<class pixel>
+    image<pixel> naive_transform(const image<pixel>& source, operation op)
+    {
+        const bool swapped = op != operation::rotate180;
+        auto ret = image<pixel>::create(swapped ? source.height : source.width, swapped ? source.width : source.height);
+        ret.orientation = source.orientation;
+
+        const auto w = source.width, h = source.height;
+        for (uint32_t y = 0; y < h; y++)
+        {
+            for (uint32_t x = 0; x < w; x++)
+            {
+                const auto& px = *source.get_pixel(x, y);
+                switch (op)
+                {
+                case operation::transpose: ret.set_pixel(y, x, px); break;
+                case operation::transverse: ret.set_pixel(h - y - 1, w - x - 1, px); break;
+                case operation::rotate90: ret.set_pixel(h - y - 1, x, px); break;
+                case operation::rotate180: ret.set_pixel(w - x - 1, h - y - 1, px); break;
+                case operation::rotate270: ret.set_pixel(y, w - x - 1, px); break;
+                }
+            }
+        }
+        return ret;
+    }
+
+    template<class pixel>
+    void check_transforms()
+    {
+        for (auto [w, h] : { std::pair{ 1u, 1u }, { 37u, 37u }, { 64u, 64u }, { 100u, 7u }, { 33u, 70u } })
+        {
+            for (auto orientation : { image<pixel>::LEFT_TOP, image<pixel>::LEFT_BOTTOM })
+            {
+                auto source = unit::random_image<pixel>(w, h, w * h);
+                source.orientation = orientation;
+
+                for (auto op : { operation::transpose, operation::transverse, operation::rotate90, operation::rotate180, operation::rotate270 })
+                {
+                    auto result = source;
+                    switch (op)
+                    {
+                    case operation::transpose: result.transpose(); break;
+                    case operation::transverse: result.transverse(); break;
+                    case operation::rotate90: result.rotate(image<pixel>::ROTATE_90); break;
+                    case operation::rotate180: result.rotate(image<pixel>::ROTATE_180); break;
+                    case operation::rotate270: result.rotate(image<pixel>::ROTATE_270); break;
+                    }
+
+                    auto expected = naive_transform(source, op);
+                    IMPP_CHECK(result.width == expected.width && result.height == expected.height);
+                    IMPP_CHECK(result.pixels == expected.pixels);
+                }
+            }
+        }
+    }
+}
+
+IMPP_TEST(image_div255_exact)
+{
+    bool exact = true;
+    for (uint32_t value = 0; value <= 255 * 255; value++)
+        exact &= detail::div255(value) == (value * 2 + 255) / 510;
+    IMPP_CHECK(exact);
+}
+
+IMPP_TEST(image_blend_simd_matches_scalar)
+{
+    for (auto mode : { BLEND_SRC_OVER, BLEND_SRC_OVER_PREMULTIPLIED, BLEND_ADDITIVE, BLEND_MULTIPLY })
+    {
+        auto src = unit::random_image<pixel32bgra>(103, 3, 7);
+        auto dst = unit::random_image<pixel32bgra>(103, 3, 8);
+        if (mode == BLEND_SRC_OVER_PREMULTIPLIED)
+            image_premultiply(src);
+
+        auto expected = dst;
+        for (size_t i = 0; i < src.pixels.size(); i++)
+            detail::blend_pixel32(reinterpret_cast<const uint8_t*>(&src.pixels[i]), reinterpret_cast<uint8_t*>(&expected.pixels[i]), mode);
+
+        blend_pixels(src.pixels.data(), dst.pixels.data(), dst.pixels.size(), mode);
+        IMPP_CHECK(dst.pixels == expected.pixels);
+    }
+
+    pixel32rgba src{ 200, 100, 50, 128 }, dst{ 0, 0, 0, 255 };
+    blend_pixels(&src, &dst, 1, BLEND_SRC_OVER);
+    IMPP_CHECK(dst.r == 100 && dst.g == 50 && dst.b == 25 && dst.a == 255);
+}
+
+IMPP_TEST(image_premultiply_roundtrip)
+{
+    bool exact = true;
+    for (uint32_t a = 1; a < 256; a++)
+    {
+        for (uint32_t c = 0; c <= a; c++)
+        {
+            pixel32rgba px{ static_cast<uint8_t>(c), 0, 0, static_cast<uint8_t>(a) };
+            unpremultiply_pixels(&px, 1);
+            exact &= px.r == (c * 510 + a) / (2 * a);
+        }
+    }
+    IMPP_CHECK(exact);
+}
+
+IMPP_TEST(image_overwrite_and_flatten)
+{
+    auto canvas = image<pixel32rgba>::create(50, 40);
+    canvas.fill_rect(0, 0, 50, 40, pixel32rgba{ 10, 20, 30, 255 });
+    auto sprite = unit::random_image<pixel32rgba>(20, 30, 5);
+
+    auto expected = canvas;
+    canvas.overwrite(40, 5, sprite);
+    for (uint32_t y = 0; y < 30; y++)
+        for (uint32_t x = 0; x < 10; x++)
+            expected.set_pixel(40 + x, 5 + y, *sprite.get_pixel(x, y));
+    IMPP_CHECK(canvas.pixels == expected.pixels);
+
+    auto flat = image_flatten(sprite, pixel24bgr{ 255, 255, 255 });
+    bool same = true;
+    for (size_t i = 0; i < sprite.pixels.size(); i++)
+    {
+        pixel24bgr px;
+        postprocess_pixel32to24(sprite.pixels[i], px, pixel24bgr{ 255, 255, 255 });
+        same &= px == flat.pixels[i];
+    }
+    IMPP_CHECK(same);
+}
+
+IMPP_TEST(image_transforms)
+{
+    check_transforms<pixel32rgba>();
+    check_transforms<pixel24bgr>();
+}
+
+IMPP_TEST(image_flips)
+{
+    auto source = unit::random_image<pixel24rgb>(13, 9);
+    auto flipped = source;
+    flipped.flip(true, true);
+
+    bool same = true;
+    for (uint32_t y = 0; y < 9; y++)
+        for (uint32_t x = 0; x < 13; x++)
+            same &= *flipped.get_pixel(x, y) == *source.get_pixel(12 - x, 8 - y);
+    IMPP_CHECK(same);
+
+    flipped.vertical_mirror();
+    flipped.horizontal_mirror();
+    IMPP_CHECK(flipped.pixels == source.pixels);
+}
+
+IMPP_TEST(image_convert_parallel)
+{
+    // more pixels than a single range so the workers share them
+    auto source = unit::random_image<pixel32rgba>(700, 300);
+    source.set_orientation(image<pixel32rgba>::LEFT_BOTTOM);
+    const auto expected = pixel_convert<pixel24bgr>(source.pixels);
+    for (unsigned threads : { 0u, 1u, 3u })
+    {
+        const auto converted = image_convert<pixel24bgr>(source, threads);
+        IMPP_CHECK(converted.pixels == expected && converted.orientation == image<pixel24bgr>::LEFT_BOTTOM);
+    }
+    IMPP_CHECK(image_convert<pixel32rgba>(source, 2).pixels == source.pixels);
+
+    // in place, same sized pixels in parallel and smaller ones front to back
+    auto swizzled = source.pixels;
+    pixel_convert_inplace<pixel32rgba, pixel32bgra>(swizzled.data(), swizzled.size(), 4);
+    IMPP_CHECK(memcmp(swizzled.data(), pixel_convert<pixel32bgra>(source.pixels).data(), swizzled.size() * 4) == 0);
+
+    std::vector<uint8_t> bytes(source.pixels.size() * sizeof(pixel32rgba));
+    memcpy(bytes.data(), source.pixels.data(), bytes.size());
+    pixel_convert<pixel32rgba, pixel24bgr>(&bytes, int(source.pixels.size()));
+    IMPP_CHECK(bytes.size() == expected.size() * 3 && memcmp(bytes.data(), expected.data(), bytes.size()) == 0);
+    pixel_convert<pixel24bgr, pixel32bgra>(&bytes, int(expected.size()));
+    IMPP_CHECK(bytes.size() == expected.size() * 4 && memcmp(bytes.data(), pixel_convert<pixel32bgra>(expected).data(), bytes.size()) == 0);
+
+    // streamed into encoders without the whole destination
+    memory_encoder memory;
+    memory.write(uint8_t(7));
+    memory.write_converted<pixel24bgr>(source.pixels.data(), source.pixels.size(), 0);
+    IMPP_CHECK(memory.get_writesize() == 1 + expected.size() * 3 && memcmp(memory.get_data() + 1, expected.data(), expected.size() * 3) == 0);
+
+    const auto filename = unit::tempfile("convert.raw");
+    {
+        file_encoder file(filename);
+        file.write_converted<pixel24bgr>(source.pixels.data(), source.pixels.size());
+        IMPP_CHECK(file.flush() && file.get_writesize() == expected.size() * 3);
+    }
+    const auto written = unit::read_file(filename);
+    IMPP_CHECK(written.size() == expected.size() * 3 && memcmp(written.data(), expected.data(), written.size()) == 0);
+    std::filesystem::remove(filename);
+}
@@ -0,0 +1,155 @@
+#include <atomic>
+#include <sstream>
+#include <thread>
+#include <unordered_set>
+#include <bmp.hpp>
+#include <codec.hpp>
+#include <tga.hpp>
+#include "unit.hpp"
+
+// built into impp-unit without instrumentation and into impp-unit-instrumented with it
+using namespace impp;
+
+namespace
+{
+    struct sink_guard
+    {
+        explicit sink_guard(instrument::sink func) { instrument::set_sink(std::move(func)); }
+        ~sink_guard() { instrument::set_sink({}); }
+    };
+}
+
+#if defined(IMPP_ENABLE_INSTRUMENTATION)
+
+IMPP_TEST(instrument_tga_load)
+{
+    std::vector<instrument::call_report> reports;
+    sink_guard guard([&](const instrument::call_report& report) { reports.push_back(report); });
+
+    const auto filename = unit::workdir("final_rle.tga");
+    auto img = tga::load<pixel32rgba>(filename);
+
+    // the file load going through the memory one is a single report
+    IMPP_CHECK(reports.size() == 1);
+    if (reports.size() != 1)
+        return;
+
+    const auto& report = reports[0];
+    IMPP_CHECK(std::string(report.format) == "tga" && std::string(report.operation) == "load");
+    IMPP_CHECK(report.succeeded);
+    IMPP_CHECK(report.bytes_read > 0 && report.bytes_read <= unit::read_file(filename).size());
+    IMPP_CHECK(report.rle_run_packets + report.rle_raw_packets > 0);
+    IMPP_CHECK(report.rle_run_pixels + report.rle_raw_pixels == img.pixels.size());
+    IMPP_CHECK(report.allocations >= 2);
+
+    uint64_t stages = 0;
+    for (auto ns : report.stage_ns)
+        stages += ns;
+    IMPP_CHECK(stages <= report.total_ns);
+    IMPP_CHECK(report.stage_ns[instrument::STAGE_DECODE] > 0);
+
+    // windowed file reads are accounted as io inside the decode stage
+    reports.clear();
+    tga::load_region<pixel32rgba>(filename, 10, 10, 50, 50);
+    IMPP_CHECK(reports.size() == 1 && reports[0].succeeded);
+    IMPP_CHECK(reports.size() == 1 && reports[0].stage_ns[instrument::STAGE_IO] > 0 && reports[0].stage_ns[instrument::STAGE_HEADER] > 0);
+}
+
+IMPP_TEST(instrument_sniffed_load)
+{
+    std::vector<instrument::call_report> reports;
+    sink_guard guard([&](const instrument::call_report& report) { reports.push_back(report); });
+
+    // the report takes the format of the codec found by sniffing
+    impp::load<pixel32rgba>(unit::workdir("init.bmp"));
+    IMPP_CHECK(reports.size() == 1 && std::string(reports[0].format) == "bmp" && std::string(reports[0].operation) == "load");
+    IMPP_CHECK(reports.size() == 1 && reports[0].succeeded && reports[0].stage_ns[instrument::STAGE_IO] > 0);
+}
+
+IMPP_TEST(instrument_tga_save)
+{
+    std::vector<instrument::call_report> reports;
+    sink_guard guard([&](const instrument::call_report& report) { reports.push_back(report); });
+
+    auto img = tga::load<pixel24bgr>(unit::workdir("final_urgb.tga"));
+    reports.clear();
+
+    memory_encoder enc;
+    tga::save_to_memory<tga::TGA_RLE_RBG>(img, enc);
+    IMPP_CHECK(reports.size() == 1 && reports[0].succeeded);
+    IMPP_CHECK(reports[0].bytes_written == enc.get_writesize());
+    IMPP_CHECK(reports[0].rle_run_pixels + reports[0].rle_raw_pixels == img.pixels.size());
+    IMPP_CHECK(reports[0].stage_ns[instrument::STAGE_ENCODE] > 0);
+
+    tga::save_to_memory<tga::TGA_UNCOMPRESSED_MAPPED>(img, enc);
+    const std::unordered_set<pixel24bgr> colors(img.pixels.begin(), img.pixels.end());
+    IMPP_CHECK(reports.size() == 2 && reports[1].palette_size == colors.size());
+    IMPP_CHECK(reports[1].stage_ns[instrument::STAGE_PALETTE] > 0);
+}
+
+IMPP_TEST(instrument_histogram_sink)
+{
+    instrument::histogram_sink histograms;
+    {
+        sink_guard guard(std::ref(histograms));
+        for (int i = 0; i < 3; i++)
+            tga::load<pixel32rgba>(unit::workdir("final_umap.tga"));
+        bmp::load<pixel32rgba>(unit::workdir("init.bmp"));
+        tga::load<pixel32rgba>(unit::workdir("missing.tga"));
+    }
+
+    const auto entries = histograms.snapshot();
+    IMPP_CHECK(entries.size() == 2);
+    IMPP_CHECK(entries.count("tga/load") && entries.at("tga/load").calls == 4 && entries.at("tga/load").failures == 1);
+    IMPP_CHECK(entries.count("tga/load") && entries.at("tga/load").palette_max > 0);
+    IMPP_CHECK(entries.count("bmp/load") && entries.at("bmp/load").calls == 1 && entries.at("bmp/load").failures == 0);
+    IMPP_CHECK(entries.count("bmp/load") && entries.at("bmp/load").total.percentile(0.5) <= entries.at("bmp/load").total.max);
+
+    std::stringstream out;
+    histograms.print(out);
+    IMPP_CHECK(out.str().find("tga/load: 4 calls, 1 failed") != std::string::npos);
+}
+
+IMPP_TEST(instrument_sink_threads)
+{
+    // sinks swapped while other threads report, every call reaches one of them
+    const auto bytes = unit::read_file(unit::workdir("final_rle.tga"));
+    std::atomic<size_t> first = 0, second = 0;
+    sink_guard guard([&](const instrument::call_report&) { first++; });
+
+    std::atomic<bool> done = false;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; t++)
+        threads.emplace_back([&] {
+            for (int i = 0; i < 20; i++)
+                tga::load_memory<pixel32rgba>(bytes.data(), bytes.size());
+        });
+    std::thread swapper([&] {
+        for (int i = 0; !done; i++)
+        {
+            if (i % 2)
+                instrument::set_sink([&](const instrument::call_report&) { first++; });
+            else
+                instrument::set_sink([&](const instrument::call_report&) { second++; });
+        }
+    });
+    for (auto& thread : threads)
+        thread.join();
+    done = true;
+    swapper.join();
+    IMPP_CHECK(first + second == 80);
+}
+
+#else
+
+IMPP_TEST(instrument_disabled)
+{
+    // without IMPP_ENABLE_INSTRUMENTATION the codecs never reach the sink
+    size_t calls = 0;
+    sink_guard guard([&](const instrument::call_report&) { calls++; });
+    tga::load<pixel32rgba>(unit::workdir("final_rle.tga"));
+    bmp::load<pixel32rgba>(unit::workdir("init.bmp"));
+    IMPP_CHECK(calls == 0);
+}
+
+#endif
@@ -0,0 +1,143 @@
+#include <thread>
+#include <lazy.hpp>
+#include "unit.hpp"
+
+using namespace impp;
+
+namespace
+{
+    image<pixel32rgba> pattern(uint32_t width, uint32_t height)
+    {
+        auto img = image<pixel32rgba>::create(width, height);
+        for (uint32_t y = 0; y < height; y++)
+            for (uint32_t x = 0; x < width; x++)
+                img.set_pixel(x, y, pixel32rgba{ uint8_t(x * 9), uint8_t(y * 5), uint8_t(x ^ y), uint8_t(128 + x) });
+        return img;
+    }
+
+    template<class save_type>
+    std::vector<uint8_t> encode(save_type&& save)
+    {
+        memory_encoder encoder;
+        save(encoder);
+        return std::vector<uint8_t>(encoder.get_data(), encoder.get_data() + encoder.get_writesize());
+    }
+}
+
+IMPP_TEST(lazy_probe)
+{
+    const auto img = pattern(37, 23);
+    const auto check = [](const std::vector<uint8_t>& bytes, const char* format, uint32_t bits, bool alpha) {
+        const auto info = try_probe_memory(bytes.data(), bytes.size());
+        return info && std::string(info->format) == format && info->width == 37 && info->height == 23 && info->bits == bits && info->alpha == alpha;
+    };
+
+    IMPP_CHECK(check(encode([&](memory_encoder& enc) { tga::save_to_memory<tga::TGA_RLE_RBG>(img, enc); }), "tga", 32, true));
+    IMPP_CHECK(check(encode([&](memory_encoder& enc) { tga::save_to_memory(image<pixel24bgr>::create(37, 23), enc); }), "tga", 24, false));
+    IMPP_CHECK(check(encode([&](memory_encoder& enc) { qoi::save_to_memory(img, enc); }), "qoi", 32, true));
+    IMPP_CHECK(check(encode([&](memory_encoder& enc) { png::save_to_memory(img, enc); }), "png", 32, true));
+    IMPP_CHECK(check(encode([&](memory_encoder& enc) { dds::save_to_memory(img, enc, dds::DDS_FORMAT_BC1); }), "dds", 4, false));
+    IMPP_CHECK(check(encode([&](memory_encoder& enc) { dds::save_to_memory(img, enc, dds::DDS_FORMAT_RGBA8); }), "dds", 32, true));
+
+    // files are probed from their start, paletted ones included
+    auto info = try_probe(unit::workdir("init.bmp"));
+    IMPP_CHECK(info && std::string(info->format) == "bmp" && info->width == 367 && info->height == 319);
+    info = try_probe(unit::workdir("png_palette4_adam7.png"));
+    IMPP_CHECK(info && info->bits == 4 && !info->alpha);
+    info = try_probe(unit::workdir("final_umap.tga"));
+    IMPP_CHECK(info && info->width == 367 && info->bits == 16);
+
+    // a colormap past the probed prefix is read up to its end
+    std::vector<uint8_t> mapped(18 + 2000 * 3 + 4);
+    mapped[1] = 1;
+    mapped[2] = tga::TGA_UNCOMPRESSED_MAPPED;
+    mapped[5] = 2000 & 0xFF;
+    mapped[6] = 2000 >> 8;
+    mapped[7] = 24;
+    mapped[12] = 2;
+    mapped[14] = 2;
+    mapped[16] = 8;
+    const auto filename = unit::tempfile("probe_colormap.tga");
+    std::ofstream(filename, std::ios::binary).write(reinterpret_cast<const char*>(mapped.data()), mapped.size());
+    info = try_probe(filename);
+    IMPP_CHECK(info && std::string(info->format) == "tga" && info->width == 2 && info->bits == 8);
+
+    // a large file in no known format fails on its prefix
+    std::vector<uint8_t> junk(64 * 1024, 0xEE);
+    std::ofstream(filename, std::ios::binary).write(reinterpret_cast<const char*>(junk.data()), junk.size());
+    IMPP_CHECK(try_probe(filename).get_error().code == error::ERROR_UNSUPPORTED);
+    std::filesystem::remove(filename);
+
+    const uint8_t garbage[64] = { 1, 2, 3 };
+    IMPP_CHECK(try_probe_memory(garbage, sizeof(garbage)).get_error().code == error::ERROR_UNSUPPORTED);
+    IMPP_CHECK(try_probe(unit::tempfile("missing.png")).get_error().code == error::ERROR_FILE_OPEN);
+}
+
+IMPP_TEST(lazy_decoding)
+{
+    const auto img = pattern(41, 17);
+    const auto filename = unit::tempfile("lazy.qoi");
+    IMPP_CHECK(qoi::save_to_file(img, filename));
+
+    // the sides are known before anything is decoded
+    auto lazy = lazy_image<pixel32rgba>::open(filename);
+    IMPP_CHECK(!lazy.empty() && lazy.get_width() == 41 && lazy.get_height() == 17 && std::string(lazy.get_format()) == "qoi");
+    IMPP_CHECK(!lazy.is_decoded());
+    const auto first = lazy.get();
+    IMPP_CHECK(first && first->pixels == img.pixels && lazy.is_decoded());
+    const auto copy = lazy;
+    IMPP_CHECK(copy.get() == first);
+
+    // released pixels stay alive in the handles and are decoded again on the next access
+    IMPP_CHECK(lazy.release() == img.pixels.size() * sizeof(pixel32rgba) && !copy.is_decoded());
+    const auto again = copy.get();
+    IMPP_CHECK(again && again != first && again->pixels == first->pixels);
+
+    // a file rewritten with other sides is not handed out under the old ones
+    lazy.release();
+    IMPP_CHECK(qoi::save_to_file(pattern(5, 5), filename));
+    const auto changed = lazy.try_get();
+    IMPP_CHECK(!changed && changed.get_error().code == error::ERROR_INVALID_HEADER);
+    std::filesystem::remove(filename);
+    IMPP_CHECK(!lazy_image<pixel32rgba>::try_open(filename));
+
+    // owned and borrowed memory, broken data fails on access only
+    auto bytes = encode([&](memory_encoder& enc) { png::save_to_memory(img, enc); });
+    const auto borrowed = lazy_image<pixel24rgb>::open_memory(bytes.data(), bytes.size());
+    IMPP_CHECK(borrowed.get() && borrowed.get()->pixels == pixel_convert<pixel24rgb>(img.pixels));
+    bytes.resize(bytes.size() / 2);
+    auto owned = lazy_image<pixel32rgba>::try_open_memory(std::move(bytes));
+    IMPP_CHECK(owned && owned->get_width() == 41);
+    IMPP_CHECK(!owned->try_get() && !owned->try_get());
+
+    IMPP_CHECK(lazy_image<pixel32rgba>{}.empty() && !lazy_image<pixel32rgba>{}.try_get());
+}
+
+IMPP_TEST(lazy_threads)
+{
+    const auto img = pattern(300, 200);
+    const auto bytes = encode([&](memory_encoder& enc) { png::save_to_memory(img, enc); });
+
+    // a single decoding serves every thread
+    const auto lazy = lazy_image<pixel32rgba>::open_memory(bytes.data(), bytes.size());
+    std::vector<lazy_image<pixel32rgba>::handle> handles(8);
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < handles.size(); i++)
+        threads.emplace_back([&, i] { handles[i] = lazy.get(); });
+    for (auto& thread : threads)
+        thread.join();
+    bool same = true;
+    for (const auto& handle : handles)
+        same &= handle == handles[0];
+    IMPP_CHECK(same && handles[0] && handles[0]->pixels == img.pixels);
+
+    // prefetching decodes in the background, a dropped image waits for it
+    lazy.release();
+    lazy.prefetch();
+    lazy.prefetch();
+    IMPP_CHECK(lazy.get()->pixels == img.pixels);
+    {
+        auto dropped = lazy_image<pixel32rgba>::open_memory(bytes.data(), bytes.size());
+        dropped.prefetch();
+    }
+}
@@ -0,0 +1,55 @@
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include "unit.hpp"
+
+// every allocation goes through here so tests can tell how large the largest one was
+// all the non aligned forms are replaced so they agree on malloc/free
+static void* unit_allocate(size_t size) noexcept
+{
+    auto largest = unit::largest_allocation.load();
+    while (size > largest && !unit::largest_allocation.compare_exchange_weak(largest, size)) {}
+    return std::malloc(size ? size : 1);
+}
+
+void* operator new(size_t size)
+{
+    if (void* memory = unit_allocate(size))
+        return memory;
+#if defined(__cpp_exceptions) || defined(_CPPUNWIND)
+    throw std::bad_alloc();
+#else
+    std::abort();
+#endif
+}
+
+void* operator new[](size_t size) { return operator new(size); }
+void* operator new(size_t size, const std::nothrow_t&) noexcept { return unit_allocate(size); }
+void* operator new[](size_t size, const std::nothrow_t&) noexcept { return unit_allocate(size); }
+void operator delete(void* memory) noexcept { std::free(memory); }
+void operator delete[](void* memory) noexcept { std::free(memory); }
+void operator delete(void* memory, size_t) noexcept { std::free(memory); }
+void operator delete[](void* memory, size_t) noexcept { std::free(memory); }
+void operator delete(void* memory, const std::nothrow_t&) noexcept { std::free(memory); }
+void operator delete[](void* memory, const std::nothrow_t&) noexcept { std::free(memory); }
+
+// runs every registered test, or only the ones whose name contains argv[1]
+int main(int argc, char** argv)
+{
+    const char* filter = argc > 1 ? argv[1] : nullptr;
+    int run = 0;
+
+    for (const auto& test : unit::registry())
+    {
+        if (filter && !strstr(test.name, filter))
+            continue;
+
+        const auto before = unit::failures();
+        test.func();
+        std::cout << (unit::failures() == before ? "[ OK ] " : "[FAIL] ") << test.name << std::endl;
+        run++;
+    }
+
+    std::cout << run << " tests, " << unit::failures() << " failed checks" << std::endl;
+    return unit::failures() == 0 ? 0 : 1;
+}
@@ -0,0 +1,186 @@
+#include <cstdio>
+#include <random>
+#include <mipmap.hpp>
+#include <dds.hpp>
+#include "unit.hpp"
+
+using namespace impp;
+
+namespace
+{
+    template<class pixel>
+    image<pixel> noise_image(uint32_t width, uint32_t height, unsigned seed)
+    {
+        std::mt19937 rng(seed);
+        auto img = image<pixel>::create(width, height);
+        for (auto& px : img.pixels)
+            px = pixel_cast<pixel>(pixel32rgba{ uint8_t(rng()), uint8_t(rng()), uint8_t(rng()), uint8_t(rng() % 3 == 0 ? 0 : rng()) });
+        return img;
+    }
+
+    bool same_levels(const mipmap_chain<pixel32rgba>& a, const mipmap_chain<pixel32rgba>& b)
+    {
+        if (a.get_level_count() != b.get_level_count())
+            return false;
+        return std::equal(a.get_pixels().begin(), a.get_pixels().end(), b.get_pixels().begin(), [](const pixel32rgba& p, const pixel32rgba& q) {
+            return p.r == q.r && p.g == q.g && p.b == q.b && p.a == q.a;
+        });
+    }
+}
+
+IMPP_TEST(mipmap_levels)
+{
+    const auto chain = mipmap_chain<pixel32rgba>::create(13, 5);
+    IMPP_CHECK(chain.get_level_count() == 4);
+    IMPP_CHECK(mipmap_chain<pixel32rgba>::get_full_count(13, 5) == 4);
+    const uint32_t sides[][2] = { { 13, 5 }, { 6, 2 }, { 3, 1 }, { 1, 1 } };
+    size_t offset = 0;
+    for (size_t i = 0; i < chain.get_level_count(); i++)
+    {
+        IMPP_CHECK(chain.get_level(i).width == sides[i][0] && chain.get_level(i).height == sides[i][1]);
+        IMPP_CHECK(chain.get_level(i).offset == offset);
+        offset += sides[i][0] * sides[i][1];
+    }
+    IMPP_CHECK(chain.get_pixels().size() == offset);
+
+    IMPP_CHECK(mipmap_chain<pixel32rgba>::create(256, 256, 3).get_level_count() == 3);
+    IMPP_CHECK(mipmap_chain<pixel32rgba>::create(0, 4).empty());
+    IMPP_CHECK(make_mipmaps(image<pixel32rgba>::null()).empty());
+
+    const auto made = make_mipmaps(noise_image<pixel32rgba>(64, 16, 1));
+    IMPP_CHECK(made.get_level_count() == 7);
+    IMPP_CHECK(made.get_level(6).width == 1 && made.get_level(6).height == 1);
+    IMPP_CHECK(made.get_image(1).width == 32 && made.get_image(1).height == 8);
+}
+
+IMPP_TEST(mipmap_box_alpha)
+{
+    // opaque red and transparent green average to red, the alpha to the plain mean
+    auto img = image<pixel32rgba>::create(2, 2);
+    img.set_pixel(0, 0, pixel32rgba{ 255, 0, 0, 255 });
+    img.set_pixel(1, 0, pixel32rgba{ 0, 255, 0, 0 });
+    img.set_pixel(0, 1, pixel32rgba{ 255, 0, 0, 255 });
+    img.set_pixel(1, 1, pixel32rgba{ 0, 255, 0, 0 });
+    auto top = make_mipmaps(img).get_level_pixels(1)[0];
+    IMPP_CHECK(top.r == 255 && top.g == 0 && top.b == 0 && top.a == 128);
+
+    // fully transparent blocks keep their plain color
+    img.fill_rect(0, 0, 2, 2, pixel32rgba{ 10, 20, 30, 0 });
+    top = make_mipmaps(img).get_level_pixels(1)[0];
+    IMPP_CHECK(top.r == 10 && top.g == 20 && top.b == 30 && top.a == 0);
+
+    // the fused pass, vectorized or not, matches the reference average of every block
+    const auto source = noise_image<pixel32rgba>(66, 34, 2);
+    const auto chain = make_mipmaps(source, MIPMAP_BOX, 1);
+    bool exact = true;
+    for (uint32_t y = 0; y < 17; y++)
+        for (uint32_t x = 0; x < 33; x++)
+        {
+            const auto* r0 = source.pixels.data() + (y * 2) * 66 + x * 2;
+            const auto* r1 = r0 + 66;
+            const auto ref = impp::detail::mip_average4(r0[0], r0[1], r1[0], r1[1]);
+            const auto got = chain.get_level_pixels(1)[y * 33 + x];
+            exact &= ref.r == got.r && ref.g == got.g && ref.b == got.b && ref.a == got.a;
+        }
+    IMPP_CHECK(exact);
+
+    // bgra swaps the channels only
+    const auto bgra = make_mipmaps(image<pixel32bgra>::create(66, 34, pixel_convert<pixel32bgra>(source.pixels)), MIPMAP_BOX, 1);
+    IMPP_CHECK(pixel_convert<pixel32rgba>(bgra.get_pixels()) == chain.get_pixels());
+
+    // 24bit pixels are a plain rounded mean
+    auto rgb = image<pixel24rgb>::create(2, 2);
+    rgb.fill_rect(0, 0, 2, 2, pixel24rgb{ 0, 0, 0 });
+    rgb.set_pixel(1, 1, pixel24rgb{ 255, 6, 1 });
+    const auto small = make_mipmaps(rgb).get_level_pixels(1)[0];
+    IMPP_CHECK(small.r == 64 && small.g == 2 && small.b == 0);
+}
+
+IMPP_TEST(mipmap_odd_sides)
+{
+    // a 3 pixel row weights its outer pixels 1/3 each into the single output
+    auto img = image<pixel24rgb>::create(3, 1);
+    img.set_pixel(0, 0, pixel24rgb{ 0, 0, 0 });
+    img.set_pixel(1, 0, pixel24rgb{ 90, 90, 90 });
+    img.set_pixel(2, 0, pixel24rgb{ 180, 180, 180 });
+    const auto chain = make_mipmaps(img);
+    IMPP_CHECK(chain.get_level_count() == 2);
+    IMPP_CHECK(chain.get_level_pixels(1)[0].r == 90);
+
+    // 5 to 2: each output covers two and a half pixels
+    auto row = image<pixel24rgb>::create(5, 1);
+    for (uint32_t x = 0; x < 5; x++)
+        row.set_pixel(x, 0, pixel24rgb{ uint8_t(x * 50), 0, 0 });
+    const auto half = make_mipmaps(row);
+    IMPP_CHECK(half.get_level_pixels(1)[0].r == 40 && half.get_level_pixels(1)[1].r == 160);
+
+    // constant images stay constant through every filter, alpha included
+    for (auto filter : { MIPMAP_BOX, MIPMAP_KAISER, MIPMAP_LANCZOS })
+    {
+        auto flat = image<pixel32rgba>::create(37, 22);
+        flat.fill_rect(0, 0, 37, 22, pixel32rgba{ 12, 130, 250, 77 });
+        const auto levels = make_mipmaps(flat, filter);
+        IMPP_CHECK(levels.get_level_count() == 6);
+        bool constant = true;
+        for (const auto& px : levels.get_pixels())
+            constant &= px.r == 12 && px.g == 130 && px.b == 250 && px.a == 77;
+        IMPP_CHECK(constant);
+    }
+}
+
+IMPP_TEST(mipmap_threads)
+{
+    // the large levels are split over workers without changing a single pixel
+    const auto source = noise_image<pixel32rgba>(1100, 600, 3);
+    for (auto filter : { MIPMAP_BOX, MIPMAP_LANCZOS })
+        IMPP_CHECK(same_levels(make_mipmaps(source, filter, 1), make_mipmaps(source, filter, 4)));
+
+    const auto odd = noise_image<pixel32rgba>(1023, 513, 4);
+    IMPP_CHECK(same_levels(make_mipmaps(odd, MIPMAP_KAISER, 1), make_mipmaps(odd, MIPMAP_KAISER, 3)));
+}
+
+IMPP_TEST(mipmap_dds)
+{
+    auto source = noise_image<pixel32rgba>(20, 12, 5);
+    const auto chain = make_mipmaps(source);
+
+    memory_encoder enc;
+    IMPP_CHECK(dds::save_mipmaps_to_memory(chain, enc, dds::DDS_FORMAT_RGBA8));
+    auto res = dds::try_load_mipmaps_memory<pixel32rgba>(enc.get_data(), enc.get_writesize());
+    IMPP_CHECK(res.has_value() && same_levels(*res, chain));
+
+    // the top level is still what the plain loader reads
+    const auto top = dds::load_memory<pixel32rgba>(enc.get_data(), enc.get_writesize());
+    IMPP_CHECK(top.width == 20 && top.height == 12 && top.pixels == source.pixels);
+
+    // block compressed levels keep their sides down to 1x1
+    enc.reset();
+    IMPP_CHECK(dds::save_mipmaps_to_memory(chain, enc, dds::DDS_FORMAT_BC1));
+    const size_t expected = 128 + 15 * 8 + 6 * 8 + 2 * 8 + 8 + 8;
+    IMPP_CHECK(enc.get_writesize() == expected);
+    auto bc = dds::try_load_mipmaps_memory<pixel32rgba>(enc.get_data(), enc.get_writesize());
+    IMPP_CHECK(bc.has_value() && bc->get_level_count() == 5 && bc->get_level(4).width == 1);
+
+    // a single level file loads as a one level chain
+    enc.reset();
+    IMPP_CHECK(dds::save_to_memory(source, enc, dds::DDS_FORMAT_BC3));
+    auto single = dds::try_load_mipmaps_memory<pixel32rgba>(enc.get_data(), enc.get_writesize());
+    IMPP_CHECK(single.has_value() && single->get_level_count() == 1);
+
+    // missing levels are truncated data, impossible counts a broken header
+    std::vector<uint8_t> bytes(enc.get_data(), enc.get_data() + enc.get_writesize());
+    uint32_t count = 5;
+    memcpy(bytes.data() + 4 + 24, &count, sizeof(count));
+    IMPP_CHECK(dds::try_load_mipmaps_memory<pixel32rgba>(bytes.data(), bytes.size()).get_error().code == error::ERROR_TRUNCATED);
+    count = 6;
+    memcpy(bytes.data() + 4 + 24, &count, sizeof(count));
+    IMPP_CHECK(dds::try_load_mipmaps_memory<pixel32rgba>(bytes.data(), bytes.size()).get_error().code == error::ERROR_INVALID_HEADER);
+
+    IMPP_CHECK(!dds::try_save_mipmaps_to_memory(mipmap_chain<pixel32rgba>{}, enc).has_value());
+
+    const auto filename = unit::tempfile("mipmaps.dds");
+    IMPP_CHECK(dds::save_mipmaps_to_file(make_mipmaps(image<pixel24rgb>::create(8, 8)), filename, dds::DDS_FORMAT_BC7));
+    auto loaded = dds::try_load_mipmaps<pixel24rgb>(filename);
+    IMPP_CHECK(loaded.has_value() && loaded->get_level_count() == 4);
+    std::remove(filename.c_str());
+}
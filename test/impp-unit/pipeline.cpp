@@ -0,0 +1,117 @@
+#include <pipeline.hpp>
+#include "unit.hpp"
+
+using namespace impp;
+
+namespace
+{
+    // the same steps run one after the other on whole images
+    template<class pixel>
+    image<pixel24bgr> sequential(const image<pixel>& source, const image<pixel24bgr>& mark)
+    {
+        auto ret = image_convert<pixel24bgr>(source);
+        ret.orientation = static_cast<image<pixel24bgr>::orientation_value>(source.orientation);
+        ret.fill_rect(10, 20, 50, 700, pixel24bgr{ 1, 2, 3 });
+        ret.vertical_mirror();
+        ret.fill_rect(290, 5, 100, 3, pixel24bgr{ 4, 5, 6 });
+        ret.overwrite(250, 400, mark);
+        ret.horizontal_mirror();
+        for (uint32_t y = 0; y < ret.height; y += 7)
+            ret.set_pixel(y % ret.width, y, pixel24bgr{ 7, 8, 9 });
+        return ret;
+    }
+
+    template<class pixel>
+    image_pipeline<pixel24bgr> recorded(image_pipeline<pixel24bgr> pipeline, const image<pixel24bgr>& mark)
+    {
+        pipeline.fill_rect(10, 20, 50, 700, pixel24bgr{ 1, 2, 3 })
+            .vertical_mirror()
+            .fill_rect(290, 5, 100, 3, pixel24bgr{ 4, 5, 6 })
+            .overwrite(250, 400, mark)
+            .horizontal_mirror()
+            .transform_rows([](pixel24bgr* row, uint32_t width, uint32_t y) {
+                if (y % 7 == 0)
+                    row[y % width] = pixel24bgr{ 7, 8, 9 };
+            });
+        return pipeline;
+    }
+}
+
+IMPP_TEST(pipeline_execute)
+{
+    // several bands of rows, the overwritten image crosses the right and bottom edges
+    auto source = unit::random_image<pixel32rgba>(300, 900);
+    const auto mark = unit::random_image<pixel24bgr>(80, 600);
+    for (auto orientation : { image<pixel32rgba>::LEFT_TOP, image<pixel32rgba>::LEFT_BOTTOM })
+    {
+        source.orientation = orientation;
+        const auto expected = sequential(source, mark);
+        const auto pipeline = recorded<pixel32rgba>(image_pipeline<pixel24bgr>::from(source), mark);
+        IMPP_CHECK(pipeline.get_width() == 300 && pipeline.get_height() == 900);
+        for (unsigned threads : { 1u, 3u })
+        {
+            const auto executed = pipeline.execute(threads);
+            IMPP_CHECK(executed.width == 300 && executed.height == 900);
+            IMPP_CHECK(executed.orientation == expected.orientation);
+            IMPP_CHECK(executed.pixels == expected.pixels);
+        }
+    }
+
+    // a moved source is kept by the pipeline
+    auto copy = source;
+    const auto owned = recorded<pixel32rgba>(image_pipeline<pixel24bgr>::from(std::move(copy)), mark);
+    IMPP_CHECK(owned.execute().pixels == sequential(source, mark).pixels);
+
+    // without steps the pipeline converts
+    IMPP_CHECK(image_pipeline<pixel32bgra>::from(source).execute(2).pixels == image_convert<pixel32bgra>(source).pixels);
+    IMPP_CHECK(image_pipeline<pixel32rgba>::from(image<pixel24rgb>::null()).vertical_mirror().execute().empty());
+}
+
+IMPP_TEST(pipeline_tga)
+{
+    auto source = unit::random_image<pixel32rgba>(257, 1500);
+    // runs give the rle packets something to compress
+    for (uint32_t y = 0; y < 1500; y += 3)
+        source.fill_rect(0, y, 200, 1, pixel32rgba{ 9, 9, 9, 255 });
+
+    auto pipeline = image_pipeline<pixel32bgra>::from(source);
+    pipeline.vertical_mirror().fill_rect(100, 100, 50, 1000, pixel32bgra{ 0, 0, 255, 255 });
+    const auto executed = pipeline.execute();
+
+    // uncompressed rows are written as they were saved from the whole image
+    memory_encoder expected;
+    IMPP_CHECK(tga::save_to_memory(executed, expected));
+    for (unsigned threads : { 1u, 4u })
+    {
+        memory_encoder enc;
+        IMPP_CHECK(tga::save_to_memory(pipeline, enc, tga::TGA_RLE_GREEDY, threads));
+        IMPP_CHECK(enc.get_writesize() == expected.get_writesize());
+        IMPP_CHECK(memcmp(enc.get_data(), expected.get_data(), enc.get_writesize()) == 0);
+    }
+
+    // rle packets end with the bands but decode to the same pixels
+    for (auto mode : { tga::TGA_RLE_GREEDY, tga::TGA_RLE_OPTIMAL })
+    {
+        memory_encoder enc;
+        IMPP_CHECK(tga::save_to_memory<tga::TGA_RLE_RBG>(pipeline, enc, mode, 3));
+        IMPP_CHECK(enc.get_writesize() < expected.get_writesize());
+        IMPP_CHECK(tga::load_memory<pixel32bgra>(enc.get_data(), enc.get_writesize()).pixels == executed.pixels);
+    }
+
+    const auto file = unit::tempfile("pipeline.tga");
+    IMPP_CHECK(tga::try_save_to_file<tga::TGA_RLE_RBG>(image_pipeline<pixel24bgr>::from(source).horizontal_mirror(), file).has_value());
+    auto mirrored = image_convert<pixel24bgr>(source);
+    mirrored.horizontal_mirror();
+    IMPP_CHECK(tga::load<pixel24bgr>(file).pixels == mirrored.pixels);
+
+    // mapped images are executed before the palette is built
+    auto flat = image<pixel24bgr>::create(64, 64, std::vector<pixel24bgr>(4096, pixel24bgr{ 1, 2, 3 }));
+    memory_encoder mapped;
+    IMPP_CHECK(tga::save_to_memory<tga::TGA_UNCOMPRESSED_MAPPED>(image_pipeline<pixel24bgr>::from(flat).fill_rect(0, 0, 8, 8, pixel24bgr{}), mapped));
+    flat.fill_rect(0, 0, 8, 8, pixel24bgr{});
+    IMPP_CHECK(tga::load_memory<pixel24bgr>(mapped.get_data(), mapped.get_writesize()).pixels == flat.pixels);
+
+    // header fields are 16 bit wide
+    memory_encoder large(error::ERROR_POLICY_RECORD);
+    IMPP_CHECK(!tga::try_save_to_memory(image_pipeline<pixel24bgr>::from(image<pixel24bgr>::create(70000, 1)), large).has_value());
+}
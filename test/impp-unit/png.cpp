@@ -0,0 +1,206 @@
+#include <cstdio>
+#include <codec.hpp>
+#include <png.hpp>
+#include "unit.hpp"
+
+using namespace impp;
+
+namespace
+{
+    // pattern of the reference files in the workdir, written by an independent zlib based encoder
+    // with every filter type in turn, split or single data chunks and a tEXt chunk to skip
+    pixel32rgba reference_pixel(uint32_t x, uint32_t y)
+    {
+        return { uint8_t(x * 7 + y * 3), uint8_t(x * y), uint8_t(255 - x * 5), uint8_t(x + y * 11) };
+    }
+
+    template<class func>
+    bool matches(const image<pixel32rgba>& img, func expected)
+    {
+        if (img.width != 37 || img.height != 23)
+            return false;
+        for (uint32_t y = 0; y < img.height; y++)
+            for (uint32_t x = 0; x < img.width; x++)
+                if (!(*img.get_pixel(x, y) == expected(x, y)))
+                    return false;
+        return true;
+    }
+
+    template<class pixel>
+    std::vector<uint8_t> encode(const image<pixel>& source, deflate::deflate_level level = deflate::DEFLATE_DEFAULT)
+    {
+        memory_encoder enc;
+        png::save_to_memory(source, enc, level);
+        return { enc.get_data(), enc.get_data() + enc.get_writesize() };
+    }
+
+    template<class pixel>
+    void check_roundtrip(const image<pixel>& source)
+    {
+        for (auto level : { deflate::DEFLATE_STORE, deflate::DEFLATE_RLE, deflate::DEFLATE_FAST, deflate::DEFLATE_DEFAULT })
+        {
+            const auto bytes = encode(source, level);
+            IMPP_CHECK(png::has_signature(bytes.data(), bytes.size()));
+            auto res = png::try_load_memory<pixel>(bytes.data(), bytes.size());
+            IMPP_CHECK(res && res->width == source.width && res->height == source.height && res->pixels == source.pixels);
+        }
+    }
+
+    // rewrites the crc of the chunk starting at offset after it was modified
+    void fix_crc(std::vector<uint8_t>& bytes, size_t offset)
+    {
+        const size_t length = png::detail::png_read32(bytes.data() + offset);
+        png::detail::png_write32(bytes.data() + offset + 8 + length, png::detail::png_crc32(0, bytes.data() + offset + 4, length + 4));
+    }
+}
+
+IMPP_TEST(png_reference_files)
+{
+    auto rgb = png::load<pixel32rgba>(unit::workdir("png_rgb8.png"));
+    IMPP_CHECK(matches(rgb, [](uint32_t x, uint32_t y) { auto px = reference_pixel(x, y); px.a = 255; return px; }));
+
+    auto adam7 = png::load<pixel32rgba>(unit::workdir("png_rgba8_adam7.png"));
+    IMPP_CHECK(matches(adam7, reference_pixel));
+
+    auto deep = png::load<pixel32rgba>(unit::workdir("png_rgba16.png"));
+    IMPP_CHECK(matches(deep, reference_pixel));
+
+    // index (x + y) % 16, the first two entries made transparent by tRNS
+    auto palette = png::load<pixel32rgba>(unit::workdir("png_palette4_adam7.png"));
+    IMPP_CHECK(matches(palette, [](uint32_t x, uint32_t y) {
+        const auto i = (x + y) & 15;
+        return pixel32rgba{ uint8_t(i * 16), uint8_t(255 - i * 16), uint8_t(i * 5), uint8_t(i == 0 ? 0 : i == 1 ? 128 : 255) };
+    }));
+
+    // 2 bit samples scaled to 8 bit, sample 1 is the transparent key
+    auto gray = png::load<pixel32rgba>(unit::workdir("png_gray2_trns.png"));
+    IMPP_CHECK(matches(gray, [](uint32_t x, uint32_t y) {
+        const auto s = (x * y) & 3;
+        return pixel32rgba{ uint8_t(s * 85), uint8_t(s * 85), uint8_t(s * 85), uint8_t(s == 1 ? 0 : 255) };
+    }));
+
+    auto gray_alpha = png::load<pixel32rgba>(unit::workdir("png_graya16.png"));
+    IMPP_CHECK(matches(gray_alpha, [](uint32_t x, uint32_t y) {
+        const auto px = reference_pixel(x, y);
+        return pixel32rgba{ px.r, px.r, px.r, px.a };
+    }));
+
+    // other pixel types decode to the same colors
+    auto bgr = png::load<pixel24bgr>(unit::workdir("png_rgb8.png"));
+    IMPP_CHECK(bgr.pixels == pixel_convert<pixel24bgr>(rgb.pixels));
+    auto bgra = png::load<pixel32bgra>(unit::workdir("png_rgba8_adam7.png"));
+    IMPP_CHECK(bgra.pixels == pixel_convert<pixel32bgra>(adam7.pixels));
+}
+
+IMPP_TEST(png_roundtrip)
+{
+    check_roundtrip(unit::random_image<pixel32rgba>(61, 37));
+    check_roundtrip(unit::random_image<pixel32bgra>(64, 64, 2));
+    check_roundtrip(unit::random_image<pixel24rgb>(17, 3, 3));
+    check_roundtrip(unit::random_image<pixel24bgr>(1, 1, 4));
+
+    // smooth content compresses, more so with the slower levels
+    auto smooth = image<pixel32rgba>::create(300, 200);
+    for (uint32_t y = 0; y < smooth.height; y++)
+        for (uint32_t x = 0; x < smooth.width; x++)
+            smooth.set_pixel(x, y, pixel32rgba{ uint8_t(x / 3), uint8_t(y * 2), uint8_t((x + y) / 7), uint8_t(y < 40 ? 255 : 200) });
+    smooth.fill_rect(10, 10, 90, 30, pixel32rgba{ 1, 2, 3, 4 });
+    check_roundtrip(smooth);
+
+    const auto stored = encode(smooth, deflate::DEFLATE_STORE).size();
+    const auto rle = encode(smooth, deflate::DEFLATE_RLE).size();
+    const auto best = encode(smooth, deflate::DEFLATE_DEFAULT).size();
+    IMPP_CHECK(stored > smooth.pixels.size() * 4 && rle < stored / 4 && best <= rle);
+}
+
+IMPP_TEST(png_orientation)
+{
+    // the first row of the file is the top one
+    auto img = image<pixel24rgb>::create(2, 2);
+    img.set_pixel(0, 0, pixel24rgb{ 200, 0, 0 });
+    img.set_pixel(1, 1, pixel24rgb{ 9, 9, 9 });
+
+    const auto bytes = encode(img, deflate::DEFLATE_STORE);
+    // signature, IHDR, IDAT length and type, zlib header, stored block header, filter byte
+    const size_t first = 8 + 25 + 8 + 2 + 5 + 1;
+    IMPP_CHECK(bytes[first - 1] == png::PNG_FILTER_NONE && bytes[first] == 200 && bytes[first + 1] == 0);
+
+    auto loaded = png::load_memory<pixel24rgb>(bytes.data(), bytes.size());
+    IMPP_CHECK(loaded.get_pixel(0, 0) && *loaded.get_pixel(0, 0) == (pixel24rgb{ 200, 0, 0 }));
+    IMPP_CHECK(loaded.get_pixel(1, 1) && *loaded.get_pixel(1, 1) == (pixel24rgb{ 9, 9, 9 }));
+}
+
+IMPP_TEST(png_invalid_input)
+{
+    const auto bytes = unit::read_file(unit::workdir("png_rgb8.png"));
+    auto code = [](const std::vector<uint8_t>& data) { return png::try_load_memory<pixel32rgba>(data.data(), data.size()).get_error().code; };
+
+    IMPP_CHECK(code({ bytes.begin(), bytes.begin() + 5 }) == error::ERROR_TRUNCATED);
+    IMPP_CHECK(code({ bytes.begin(), bytes.end() - 30 }) == error::ERROR_TRUNCATED);
+
+    // a chunk length past the input fails before the chunk is read
+    std::vector<uint8_t> length(bytes.begin(), bytes.begin() + 20);
+    png::detail::png_write32(length.data() + 8, 0x7F000000);
+    IMPP_CHECK(code(length) == error::ERROR_TRUNCATED);
+
+    auto signature = bytes;
+    signature[1] = 'p';
+    IMPP_CHECK(code(signature) == error::ERROR_INVALID_HEADER);
+
+    // IHDR starts at 8, its data at 16
+    auto crc = bytes;
+    crc[16 + 3] ^= 1;
+    IMPP_CHECK(code(crc) == error::ERROR_CORRUPT_DATA);
+
+    auto depth = bytes;
+    depth[16 + 8] = 4;
+    fix_crc(depth, 8);
+    IMPP_CHECK(code(depth) == error::ERROR_INVALID_HEADER);
+
+    auto huge = bytes;
+    huge[16] = huge[20] = 0x7F;
+    fix_crc(huge, 8);
+    IMPP_CHECK(code(huge) == error::ERROR_UNSUPPORTED);
+
+    // an unknown critical chunk right after IHDR
+    auto critical = bytes;
+    const uint8_t chunk[] = { 0, 0, 0, 0, 'Z', 'Z', 'Z', 'Z', 0, 0, 0, 0 };
+    critical.insert(critical.begin() + 33, chunk, chunk + sizeof(chunk));
+    fix_crc(critical, 33);
+    IMPP_CHECK(code(critical) == error::ERROR_UNSUPPORTED);
+
+    // image data of a 1x1 image holding a filter byte out of range
+    auto source = image<pixel24rgb>::create(1, 1);
+    auto filter = encode(source, deflate::DEFLATE_STORE);
+    const size_t raw = 8 + 25 + 8 + 2 + 5;
+    filter[raw] = 5;
+    const auto adler = deflate::detail::adler32(1, filter.data() + raw, 4);
+    png::detail::png_write32(filter.data() + raw + 4, adler);
+    fix_crc(filter, 33);
+    IMPP_CHECK(code(filter) == error::ERROR_CORRUPT_DATA);
+
+    auto damaged = bytes;
+    damaged[damaged.size() - 40] ^= 0xFF;
+    IMPP_CHECK(code(damaged) != error::ERROR_NONE);
+
+    memory_encoder enc;
+    IMPP_CHECK(png::try_save_to_memory(image<pixel32rgba>::null(), enc).get_error().code == error::ERROR_INVALID_ARGUMENT);
+}
+
+IMPP_TEST(png_files_and_sniffing)
+{
+    const auto source = tga::load<pixel32rgba>(unit::workdir("final_rle.tga"));
+    const auto filename = unit::tempfile("roundtrip.png");
+    auto written = png::try_save_to_file(source, filename, deflate::DEFLATE_FAST);
+    IMPP_CHECK(written && *written == unit::read_file(filename).size());
+
+    const auto bytes = unit::read_file(filename);
+    const char* format = detect_format(bytes.data(), bytes.size());
+    IMPP_CHECK(format && std::string(format) == "png");
+    IMPP_CHECK(impp::load<pixel32rgba>(filename).pixels == source.pixels);
+    IMPP_CHECK(png::load<pixel32rgba>(filename).pixels == source.pixels);
+    std::remove(filename.c_str());
+
+    const auto reference = unit::read_file(unit::workdir("png_palette4_adam7.png"));
+    IMPP_CHECK(codec::png_codec::sniff(reference.data(), reference.size()) == codec::SNIFF_YES);
+}
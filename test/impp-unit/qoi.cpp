@@ -0,0 +1,137 @@
+#include <cstdio>
+#include <codec.hpp>
+#include <qoi.hpp>
+#include "unit.hpp"
+
+using namespace impp;
+
+namespace
+{
+    // every chunk type once, worked out by hand from the specification
+    const std::vector<pixel32rgba> ops_pixels = {
+        { 10, 20, 30, 255 },    // QOI_OP_RGB
+        { 11, 21, 29, 255 },    // QOI_OP_DIFF
+        { 11, 21, 29, 255 },    // QOI_OP_RUN
+        { 10, 20, 30, 255 },    // QOI_OP_INDEX
+        { 20, 35, 40, 255 },    // QOI_OP_LUMA
+        { 20, 35, 40, 128 },    // QOI_OP_RGBA
+    };
+
+    const std::vector<uint8_t> ops_bytes = {
+        'q', 'o', 'i', 'f', 0, 0, 0, 6, 0, 0, 0, 1, 4, 0,
+        0xFE, 10, 20, 30,
+        0x7D,
+        0xC0,
+        0x09,
+        0xAF, 0x33,
+        0xFF, 20, 35, 40, 128,
+        0, 0, 0, 0, 0, 0, 0, 1,
+    };
+
+    template<class pixel>
+    std::vector<uint8_t> encode(const image<pixel>& source)
+    {
+        memory_encoder enc;
+        qoi::save_to_memory(source, enc);
+        return { enc.get_data(), enc.get_data() + enc.get_writesize() };
+    }
+
+    template<class pixel>
+    void check_roundtrip(const image<pixel>& source)
+    {
+        const auto bytes = encode(source);
+        IMPP_CHECK(bytes.size() > qoi::QOI_HEADER_SIZE + sizeof(qoi::QOI_PADDING));
+        IMPP_CHECK(bytes[12] == (pixel_is32bit<pixel> ? 4 : 3));
+
+        auto res = qoi::try_load_memory<pixel>(bytes.data(), bytes.size());
+        IMPP_CHECK(res && res->width == source.width && res->height == source.height && res->pixels == source.pixels);
+    }
+}
+
+IMPP_TEST(qoi_reference_stream)
+{
+    auto source = image<pixel32rgba>::create(6, 1, std::vector<pixel32rgba>(ops_pixels));
+    IMPP_CHECK(encode(source) == ops_bytes);
+
+    auto img = qoi::load_memory<pixel32rgba>(ops_bytes.data(), ops_bytes.size());
+    IMPP_CHECK(img.width == 6 && img.height == 1 && img.pixels == ops_pixels);
+
+    auto bgr = qoi::load_memory<pixel24bgr>(ops_bytes.data(), ops_bytes.size());
+    IMPP_CHECK(bgr.pixels.size() == 6 && bgr.pixels[4] == (pixel24bgr{ 40, 35, 20 }));
+}
+
+IMPP_TEST(qoi_roundtrip)
+{
+    check_roundtrip(unit::random_image<pixel32rgba>(61, 37));
+    check_roundtrip(unit::random_image<pixel32bgra>(64, 64, 2));
+    check_roundtrip(unit::random_image<pixel24rgb>(17, 3, 3));
+    check_roundtrip(unit::random_image<pixel24bgr>(1, 1, 4));
+
+    // smooth content exercises diff, luma, index and runs spanning rows
+    auto smooth = image<pixel32rgba>::create(100, 80);
+    for (uint32_t y = 0; y < smooth.height; y++)
+        for (uint32_t x = 0; x < smooth.width; x++)
+            smooth.set_pixel(x, y, pixel32rgba{ uint8_t(x / 3), uint8_t(y * 2), uint8_t((x + y) / 7), uint8_t(y < 40 ? 255 : 200) });
+    smooth.fill_rect(10, 10, 90, 30, pixel32rgba{ 1, 2, 3, 4 });
+    check_roundtrip(smooth);
+
+    const auto bytes = encode(smooth);
+    IMPP_CHECK(bytes.size() < smooth.pixels.size());
+}
+
+IMPP_TEST(qoi_orientation)
+{
+    // the first pixel of the stream is the top-left one
+    auto img = image<pixel32rgba>::create(2, 2);
+    img.set_pixel(0, 0, pixel32rgba{ 200, 0, 0, 255 });
+    img.set_pixel(1, 0, pixel32rgba{ 0, 255, 0, 255 });
+    img.set_pixel(0, 1, pixel32rgba{ 0, 0, 255, 255 });
+    img.set_pixel(1, 1, pixel32rgba{ 9, 9, 9, 255 });
+
+    const auto bytes = encode(img);
+    IMPP_CHECK(bytes[14] == qoi::QOI_OP_RGB && bytes[15] == 200 && bytes[16] == 0 && bytes[17] == 0);
+
+    auto loaded = qoi::load_memory<pixel32rgba>(bytes.data(), bytes.size());
+    IMPP_CHECK(loaded.get_pixel(0, 0) && *loaded.get_pixel(0, 0) == (pixel32rgba{ 200, 0, 0, 255 }));
+    IMPP_CHECK(loaded.get_pixel(1, 1) && *loaded.get_pixel(1, 1) == (pixel32rgba{ 9, 9, 9, 255 }));
+}
+
+IMPP_TEST(qoi_invalid_input)
+{
+    auto bytes = ops_bytes;
+    auto truncated = qoi::try_load_memory<pixel32rgba>(bytes.data(), bytes.size() - 10);
+    IMPP_CHECK(!truncated && truncated.get_error().code == error::ERROR_TRUNCATED);
+    IMPP_CHECK(qoi::try_load_memory<pixel32rgba>(bytes.data(), 10).get_error().code == error::ERROR_TRUNCATED);
+
+    bytes[12] = 5;
+    IMPP_CHECK(qoi::try_load_memory<pixel32rgba>(bytes.data(), bytes.size()).get_error().code == error::ERROR_INVALID_HEADER);
+    bytes[12] = 4;
+    bytes[0] = 'Q';
+    IMPP_CHECK(qoi::try_load_memory<pixel32rgba>(bytes.data(), bytes.size()).get_error().code == error::ERROR_INVALID_HEADER);
+    bytes[0] = 'q';
+
+    // huge sides are refused before allocating anything
+    bytes[4] = bytes[8] = 0x10;
+    IMPP_CHECK(qoi::try_load_memory<pixel32rgba>(bytes.data(), bytes.size()).get_error().code == error::ERROR_UNSUPPORTED);
+    bytes[4] = bytes[8] = 0;
+    bytes[6] = bytes[10] = 0x10;
+    IMPP_CHECK(qoi::try_load_memory<pixel32rgba>(bytes.data(), bytes.size()).get_error().code == error::ERROR_TRUNCATED);
+
+    memory_encoder enc;
+    IMPP_CHECK(qoi::try_save_to_memory(image<pixel32rgba>::null(), enc).get_error().code == error::ERROR_INVALID_ARGUMENT);
+}
+
+IMPP_TEST(qoi_files_and_sniffing)
+{
+    const auto source = tga::load<pixel32rgba>(unit::workdir("final_rle.tga"));
+    const auto filename = unit::tempfile("roundtrip.qoi");
+    auto written = qoi::try_save_to_file(source, filename);
+    IMPP_CHECK(written && *written == unit::read_file(filename).size());
+
+    const auto bytes = unit::read_file(filename);
+    const char* format = detect_format(bytes.data(), bytes.size());
+    IMPP_CHECK(format && std::string(format) == "qoi");
+    IMPP_CHECK(impp::load<pixel32rgba>(filename).pixels == source.pixels);
+    IMPP_CHECK(qoi::load<pixel32rgba>(filename).pixels == source.pixels);
+    std::remove(filename.c_str());
+}
@@ -0,0 +1,185 @@
+#include <algorithm>
+#include <cstring>
+#include <thread>
+#include <bmp.hpp>
+#include <tga.hpp>
+#include "unit.hpp"
+
+// also built with exceptions disabled into impp-unit-noexcept
+using namespace impp;
+
+namespace
+{
+    // counts error handler calls for the lifetime of the guard
+    struct handler_guard
+    {
+        int calls = 0;
+        handler_guard() { error::set_error_handler([this](const std::runtime_error&) { calls++; }); }
+        ~handler_guard() { error::set_error_handler(error::detail::error_handling::default_throw_wrapper); }
+    };
+
+    std::vector<uint8_t> encode(const image<pixel32rgba>& source, tga::tga_type type)
+    {
+        memory_encoder enc;
+        switch (type)
+        {
+        case tga::TGA_UNCOMPRESSED_MAPPED: tga::try_save_to_memory<tga::TGA_UNCOMPRESSED_MAPPED>(source, enc); break;
+        case tga::TGA_RLE_RBG: tga::try_save_to_memory<tga::TGA_RLE_RBG>(source, enc); break;
+        default: tga::try_save_to_memory<tga::TGA_UNCOMPRESSED_RGB>(source, enc); break;
+        }
+        return { enc.get_data(), enc.get_data() + enc.get_writesize() };
+    }
+}
+
+IMPP_TEST(result_tga_truncated)
+{
+    handler_guard handler;
+    auto bytes = unit::read_file(unit::workdir("final_rle.tga"));
+
+    auto res = tga::try_load_memory<pixel32rgba>(bytes.data(), bytes.size() / 2);
+    IMPP_CHECK(!res && res.get_error().code == error::ERROR_TRUNCATED);
+    IMPP_CHECK(res.get_error().offset <= bytes.size() / 2 && res.get_error().offset > sizeof(tga::tga_header));
+
+    auto scaled = tga::try_load_memory_scaled<pixel32rgba>(bytes.data(), bytes.size() / 2, 2);
+    IMPP_CHECK(!scaled && scaled.get_error().code == error::ERROR_TRUNCATED);
+
+    auto header = tga::try_load_memory<pixel32rgba>(bytes.data(), 5);
+    IMPP_CHECK(!header && header.get_error().code == error::ERROR_TRUNCATED && header.get_error().offset == 0);
+    IMPP_CHECK(handler.calls == 0);
+
+    // the legacy api keeps reporting it
+    IMPP_CHECK(tga::load_memory<pixel32rgba>(bytes.data(), bytes.size() / 2).empty());
+    IMPP_CHECK(handler.calls == 1);
+}
+
+IMPP_TEST(result_missing_files)
+{
+    handler_guard handler;
+    const auto missing = unit::workdir("missing.tga");
+    IMPP_CHECK(tga::try_load<pixel32rgba>(missing).get_error().code == error::ERROR_FILE_OPEN);
+    IMPP_CHECK(tga::try_load_region<pixel32rgba>(missing, 0, 0, 1, 1).get_error().code == error::ERROR_FILE_OPEN);
+    IMPP_CHECK(bmp::try_load<pixel32rgba>(unit::workdir("missing.bmp")).get_error().code == error::ERROR_FILE_OPEN);
+    IMPP_CHECK(tga::try_save_to_file(unit::random_image<pixel32rgba>(2, 2), unit::workdir("missing/out.tga")).get_error().code == error::ERROR_FILE_OPEN);
+
+    // missing files were never reported through the handler
+    IMPP_CHECK(tga::load<pixel32rgba>(missing).empty());
+    IMPP_CHECK(handler.calls == 0);
+}
+
+IMPP_TEST(result_bmp_invalid_header)
+{
+    handler_guard handler;
+    auto bytes = unit::read_file(unit::workdir("init.bmp"));
+    bytes[0] = 'X';
+
+    auto res = bmp::try_load_memory<pixel32rgba>(bytes.data(), bytes.size());
+    IMPP_CHECK(!res && res.get_error().code == error::ERROR_INVALID_HEADER);
+    IMPP_CHECK(std::strcmp(res.get_error().message, "invalid bitmap file header.type: it must be BM") == 0);
+    IMPP_CHECK(res.get_error().offset == sizeof(bmp::bitmap_file_header) + sizeof(bmp::bitmap_info_header));
+    IMPP_CHECK(bmp::try_load_memory_region<pixel32rgba>(bytes.data(), bytes.size(), 0, 0, 4, 4).get_error().code == error::ERROR_INVALID_HEADER);
+    IMPP_CHECK(handler.calls == 0);
+
+    bytes[0] = 'B';
+    IMPP_CHECK(bmp::try_load_memory_region<pixel32rgba>(bytes.data(), bytes.size(), 100000, 0, 4, 4).get_error().code == error::ERROR_INVALID_ARGUMENT);
+    IMPP_CHECK(bmp::try_load_memory<pixel32rgba>(bytes.data(), bytes.size()).has_value());
+}
+
+IMPP_TEST(result_tga_corrupt_data)
+{
+    handler_guard handler;
+    const auto source = unit::random_image<pixel32rgba>(16, 8);
+
+    // an rle packet running past the last pixel
+    auto rle = encode(source, tga::TGA_RLE_RBG);
+    rle.resize(sizeof(tga::tga_header));
+    for (uint8_t packet : { 0xFE, 0x81 })
+    {
+        rle.push_back(packet);
+        rle.insert(rle.end(), { 1, 2, 3, 4 });
+    }
+    auto res = tga::try_load_memory<pixel32rgba>(rle.data(), rle.size());
+    IMPP_CHECK(!res && res.get_error().code == error::ERROR_CORRUPT_DATA);
+
+    // a color index out of the color map
+    auto solid = image<pixel32rgba>::create(16, 8);
+    solid.fill_rect(0, 0, 16, 8, pixel32rgba{ 1, 2, 3, 4 });
+    auto mapped = encode(solid, tga::TGA_UNCOMPRESSED_MAPPED);
+    mapped[mapped.size() - 2] = 7;
+    IMPP_CHECK(tga::try_load_memory<pixel32rgba>(mapped.data(), mapped.size()).get_error().code == error::ERROR_CORRUPT_DATA);
+    IMPP_CHECK(tga::try_load_memory_region<pixel32rgba>(mapped.data(), mapped.size(), 0, 0, 16, 8).get_error().code == error::ERROR_CORRUPT_DATA);
+
+    // corrupt data is reported by the legacy api, unsupported types are not
+    IMPP_CHECK(tga::load_memory<pixel32rgba>(mapped.data(), mapped.size()).empty());
+    IMPP_CHECK(handler.calls == 1);
+    mapped[2] = 9;
+    IMPP_CHECK(tga::try_load_memory<pixel32rgba>(mapped.data(), mapped.size()).get_error().code == error::ERROR_UNSUPPORTED);
+    IMPP_CHECK(tga::load_memory<pixel32rgba>(mapped.data(), mapped.size()).empty());
+    IMPP_CHECK(handler.calls == 1);
+}
+
+IMPP_TEST(result_tga_save)
+{
+    const auto source = unit::random_image<pixel32rgba>(64, 32);
+    memory_encoder enc;
+    auto res = tga::try_save_to_memory<tga::TGA_RLE_RBG>(source, enc);
+    IMPP_CHECK(res && *res == enc.get_writesize());
+
+    auto loaded = tga::try_load_memory<pixel32rgba>(enc.get_data(), enc.get_writesize());
+    IMPP_CHECK(loaded && loaded->pixels == source.pixels);
+
+    // more colors than a 16bit color map can index
+    auto noise = unit::random_image<pixel32rgba>(512, 256);
+    IMPP_CHECK(tga::try_save_to_memory<tga::TGA_UNCOMPRESSED_MAPPED>(noise, enc).get_error().code == error::ERROR_UNSUPPORTED);
+    IMPP_CHECK(!tga::save_to_memory<tga::TGA_UNCOMPRESSED_MAPPED>(noise, enc));
+
+    IMPP_CHECK(tga::try_save_to_memory<tga::TGA_UNCOMPRESSED_RGB>(image<pixel24bgr>::create(70000, 1), enc).get_error().code == error::ERROR_UNSUPPORTED);
+}
+
+IMPP_TEST(result_record_policy)
+{
+    const uint8_t bytes[] = { 1, 2, 3 };
+    auto dec = decoder::create(bytes, sizeof(bytes), error::ERROR_POLICY_RECORD);
+    IMPP_CHECK(dec.read<uint16_t>() == 0x0201);
+    IMPP_CHECK(dec.read<uint32_t>() == 0 && dec.failed());
+    IMPP_CHECK(dec.get_error().code == error::ERROR_TRUNCATED && dec.get_error().offset == 2);
+    IMPP_CHECK(dec.get_readable() == 0 && dec.read<uint8_t>() == 0);
+
+    dec.reset();
+    IMPP_CHECK(!dec.failed() && dec.read<uint8_t>() == 1);
+
+    // failed reads zero the caller buffer and failed peeks never allocate what the input claimed
+    uint8_t buffer[8] = { 9, 9, 9, 9, 9, 9, 9, 9 };
+    dec.read(buffer, sizeof(buffer));
+    IMPP_CHECK(dec.failed() && std::all_of(std::begin(buffer), std::end(buffer), [](uint8_t b) { return b == 0; }));
+    dec.reset();
+    const auto* peeked = dec.peek<uint8_t>(SIZE_MAX / 2);
+    IMPP_CHECK(dec.failed() && dec.get_error().code == error::ERROR_TRUNCATED && peeked && peeked[0] == 0);
+
+    result<int> failed = error::error_info{};
+    IMPP_CHECK(!failed && failed.get_error().code != error::ERROR_NONE && failed.value_or(3) == 3);
+#if !IMPP_EXCEPTIONS
+    IMPP_CHECK(error::default_policy == error::ERROR_POLICY_RECORD);
+#endif
+}
+
+IMPP_TEST(result_concurrent_errors)
+{
+    // every call carries its own error so concurrent failures do not interfere
+    auto bytes = unit::read_file(unit::workdir("final_rle.tga"));
+    auto bitmap = unit::read_file(unit::workdir("init.bmp"));
+    bitmap[0] = 'X';
+
+    error::error_code codes[4] = {};
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; t++)
+        threads.emplace_back([&, t] {
+            for (int i = 0; i < 20; i++)
+                codes[t] = t % 2 ? bmp::try_load_memory<pixel32rgba>(bitmap.data(), bitmap.size()).get_error().code
+                    : tga::try_load_memory<pixel32rgba>(bytes.data(), bytes.size() / 3).get_error().code;
+        });
+    for (auto& thread : threads)
+        thread.join();
+
+    IMPP_CHECK(codes[0] == error::ERROR_TRUNCATED && codes[2] == error::ERROR_TRUNCATED);
+    IMPP_CHECK(codes[1] == error::ERROR_INVALID_HEADER && codes[3] == error::ERROR_INVALID_HEADER);
+}
@@ -0,0 +1,82 @@
+#include <set>
+#include <stats.hpp>
+#include "unit.hpp"
+
+using namespace impp;
+
+IMPP_TEST(stats_histogram)
+{
+    // odd sizes leave tails after the groups of four pixels
+    const auto source = unit::random_image<pixel32rgba>(301, 7);
+    image_histogram expected;
+    for (const auto& px : source.pixels)
+        expected.r[px.r]++, expected.g[px.g]++, expected.b[px.b]++, expected.a[px.a]++;
+
+    for (unsigned threads : { 1u, 3u })
+    {
+        const auto rgba = histogram(source, threads);
+        IMPP_CHECK(rgba.r == expected.r && rgba.g == expected.g && rgba.b == expected.b && rgba.a == expected.a);
+    }
+
+    // channels are named whatever the memory order, 24bit images count opaque alphas
+    const auto bgra = histogram(image_convert<pixel32bgra>(source));
+    IMPP_CHECK(bgra.r == expected.r && bgra.b == expected.b && bgra.a == expected.a);
+    const auto bgr = histogram(image_convert<pixel24bgr>(source));
+    IMPP_CHECK(bgr.r == expected.r && bgr.g == expected.g && bgr.b == expected.b);
+    IMPP_CHECK(bgr.a[255] == source.pixels.size() && bgr.a[0] == 0);
+
+    const auto empty = histogram(image<pixel32rgba>::null());
+    IMPP_CHECK(empty.r[0] == 0 && empty.a[255] == 0);
+}
+
+IMPP_TEST(stats_alpha)
+{
+    // a large image spans several workers and slices
+    auto source = image<pixel32rgba>::create(1000, 700, std::vector<pixel32rgba>(700000, pixel32rgba{ 1, 2, 3, 255 }));
+    IMPP_CHECK(classify_alpha(source) == ALPHA_OPAQUE && classify_alpha(source, 4) == ALPHA_OPAQUE);
+
+    source.pixels[654321].a = 0;
+    IMPP_CHECK(classify_alpha(source) == ALPHA_BINARY && classify_alpha(source, 4) == ALPHA_BINARY);
+    // the last pixel is checked by the scalar tail, the others by the vectorized loop
+    for (size_t at : { size_t(3), size_t(500000), source.pixels.size() - 1 })
+    {
+        auto translucent = source;
+        translucent.pixels[at].a = 128;
+        IMPP_CHECK(classify_alpha(translucent) == ALPHA_TRANSLUCENT && classify_alpha(translucent, 3) == ALPHA_TRANSLUCENT);
+    }
+
+    auto tail = image<pixel32bgra>::create(19, 1, std::vector<pixel32bgra>(19, pixel32bgra{ 0, 0, 0, 255 }));
+    tail.pixels[18].a = 0;
+    IMPP_CHECK(classify_alpha(tail) == ALPHA_BINARY);
+    IMPP_CHECK(classify_alpha(image<pixel24rgb>::create(4, 4)) == ALPHA_OPAQUE);
+    IMPP_CHECK(classify_alpha(image<pixel32rgba>::null()) == ALPHA_OPAQUE);
+}
+
+IMPP_TEST(stats_colors)
+{
+    // a few hundred colors spread over runs and noise
+    std::mt19937 rng(3);
+    auto source = image<pixel32rgba>::create(900, 600);
+    std::set<uint32_t> expected;
+    for (auto& px : source.pixels)
+    {
+        const auto c = rng() % 300;
+        px = pixel32rgba{ uint8_t(c), uint8_t(c >> 8), 7, uint8_t(c % 2 ? 255 : 0) };
+        expected.insert(c);
+    }
+    for (size_t i = 0; i < 20000; i++)
+        source.pixels[i] = pixel32rgba{ 0, 0, 0, 0 };
+    expected.insert(1000);
+
+    IMPP_CHECK(count_colors(source) == expected.size());
+    IMPP_CHECK(count_colors(source, 65536, 4) == expected.size());
+    IMPP_CHECK(count_colors(source, 100) == 100 && count_colors(source, 100, 4) == 100);
+    IMPP_CHECK(count_colors(source, expected.size()) == expected.size());
+
+    const auto noise = unit::random_image<pixel24bgr>(512, 512);
+    std::set<uint32_t> distinct;
+    for (const auto& px : noise.pixels)
+        distinct.insert(uint32_t(px.r) << 16 | px.g << 8 | px.b);
+    IMPP_CHECK(count_colors(noise, SIZE_MAX, 2) == distinct.size());
+    IMPP_CHECK(count_colors(noise, 0) == 0 && count_colors(image<pixel24bgr>::null()) == 0);
+}
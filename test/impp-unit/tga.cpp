@@ -0,0 +1,297 @@
+#include <tga.hpp>
+#include "unit.hpp"
+
+using namespace impp;
+
+namespace
+{
+    template<tga::tga_type type, class pixel>
+    image<pixel> roundtrip(const image<pixel>& source)
+    {
+        memory_encoder enc;
+        if (!tga::save_to_memory<type>(source, enc))
+            return image<pixel>::null();
+        return tga::load_memory<pixel>(enc.get_data(), enc.get_writesize());
+    }
+
+    // same image stored with the top-left origin bit and reversed rows
+    std::vector<uint8_t> make_top_origin(const std::vector<uint8_t>& uncompressed)
+    {
+        tga::tga_header header{};
+        memcpy(&header, uncompressed.data(), sizeof(header));
+        const size_t rowsize = header.width * (header.bits / 8);
+
+        std::vector<uint8_t> ret(uncompressed.begin(), uncompressed.begin() + sizeof(header));
+        ret[17] |= tga::TGA_ORIGIN_TOP;
+        for (size_t y = header.height; y-- > 0;)
+        {
+            auto row = uncompressed.begin() + sizeof(header) + y * rowsize;
+            ret.insert(ret.end(), row, row + rowsize);
+        }
+        return ret;
+    }
+}
+
+IMPP_TEST(tga_roundtrip_all_types)
+{
+    auto noise = unit::random_image<pixel32rgba>(97, 61);
+    IMPP_CHECK(roundtrip<tga::TGA_UNCOMPRESSED_RGB>(noise).pixels == noise.pixels);
+    IMPP_CHECK(roundtrip<tga::TGA_RLE_RBG>(noise).pixels == noise.pixels);
+
+    auto sample = tga::load<pixel24bgr>(unit::workdir("init.tga"));
+    IMPP_CHECK(!sample.empty());
+    IMPP_CHECK(roundtrip<tga::TGA_UNCOMPRESSED_RGB>(sample).pixels == sample.pixels);
+    IMPP_CHECK(roundtrip<tga::TGA_RLE_RBG>(sample).pixels == sample.pixels);
+    IMPP_CHECK(roundtrip<tga::TGA_UNCOMPRESSED_MAPPED>(sample).pixels == sample.pixels);
+}
+
+IMPP_TEST(tga_sample_files_agree)
+{
+    auto reference = tga::load<pixel32rgba>(unit::workdir("init.tga"));
+    for (auto name : { "final_rle.tga", "final_umap.tga", "final_urgb.tga", "final.tga" })
+        IMPP_CHECK(tga::load<pixel32rgba>(unit::workdir(name)).pixels == reference.pixels);
+}
+
+IMPP_TEST(tga_load_scaled)
+{
+    const auto filename = unit::workdir("final_rle.tga");
+    auto full = tga::load<pixel32rgba>(filename);
+    IMPP_CHECK(tga::load_scaled<pixel32rgba>(filename, 1).pixels == full.pixels);
+    IMPP_CHECK(tga::load_scaled<pixel32rgba>(filename, 3).empty());
+
+    const uint32_t factor = 4;
+    auto box = tga::load_scaled<pixel32rgba>(filename, factor);
+    auto nearest = tga::load_scaled<pixel32rgba>(filename, factor, SCALE_NEAREST);
+    IMPP_CHECK(box.width == (full.width + factor - 1) / factor && box.height == (full.height + factor - 1) / factor);
+
+    bool box_ok = true, nearest_ok = true;
+    for (uint32_t y = 0; y < box.height; y++)
+    {
+        for (uint32_t x = 0; x < box.width; x++)
+        {
+            uint32_t sum = 0, count = 0;
+            for (uint32_t sy = y * factor; sy < std::min(full.height, (y + 1) * factor); sy++)
+                for (uint32_t sx = x * factor; sx < std::min(full.width, (x + 1) * factor); sx++, count++)
+                    sum += full.pixels[sy * full.width + sx].g;
+
+            box_ok &= box.pixels[y * box.width + x].g == (sum + count / 2) / count;
+            nearest_ok &= nearest.pixels[y * box.width + x] == full.pixels[y * factor * full.width + x * factor];
+        }
+    }
+    IMPP_CHECK(box_ok);
+    IMPP_CHECK(nearest_ok);
+}
+
+IMPP_TEST(tga_load_region)
+{
+    for (auto name : { "final_rle.tga", "final_umap.tga", "final_urgb.tga" })
+    {
+        const auto filename = unit::workdir(name);
+        auto full = tga::load<pixel32rgba>(filename);
+        auto region = tga::load_region<pixel32rgba>(filename, 40, 25, 100, 300);
+        IMPP_CHECK(region.width == 100 && region.height == full.height - 25);
+
+        bool same = true;
+        for (uint32_t y = 0; y < region.height; y++)
+            for (uint32_t x = 0; x < region.width; x++)
+                same &= *region.get_pixel(x, y) == *full.get_pixel(x + 40, y + 25);
+        IMPP_CHECK(same);
+        IMPP_CHECK(tga::load_region<pixel32rgba>(filename, full.width, 0, 1, 1).empty());
+    }
+}
+
+IMPP_TEST(tga_top_left_origin)
+{
+    auto bytes = unit::read_file(unit::workdir("final_urgb.tga"));
+    auto top = make_top_origin(bytes);
+    auto bottom_image = tga::load_memory<pixel32rgba>(bytes.data(), bytes.size());
+    IMPP_CHECK(tga::load_memory<pixel32rgba>(top.data(), top.size()).pixels == bottom_image.pixels);
+    IMPP_CHECK(tga::load_memory_region<pixel32rgba>(top.data(), top.size(), 10, 20, 30, 40).pixels ==
+        tga::load_memory_region<pixel32rgba>(bytes.data(), bytes.size(), 10, 20, 30, 40).pixels);
+
+    // partial bands would sit on opposite edges, so the scaled comparison needs even dimensions
+    memory_encoder enc;
+    tga::save_to_memory<tga::TGA_UNCOMPRESSED_RGB>(unit::random_image<pixel32rgba>(64, 48), enc);
+    bytes.assign(enc.get_data(), enc.get_data() + enc.get_writesize());
+    top = make_top_origin(bytes);
+    IMPP_CHECK(tga::load_memory_scaled<pixel32rgba>(top.data(), top.size(), 2).pixels ==
+        tga::load_memory_scaled<pixel32rgba>(bytes.data(), bytes.size(), 2).pixels);
+}
+
+IMPP_TEST(tga_truncated_input)
+{
+    std::string message;
+    error::set_error_handler([&](const std::runtime_error& err) { message = err.what(); });
+
+    auto bytes = unit::read_file(unit::workdir("final_rle.tga"));
+    IMPP_CHECK(tga::load_memory<pixel32rgba>(bytes.data(), bytes.size() / 2).empty());
+    IMPP_CHECK(!message.empty());
+
+    error::set_error_handler(error::detail::error_handling::default_throw_wrapper);
+}
+
+IMPP_TEST(tga_oversized_header)
+{
+    // 563 bytes declaring 27759x37695 rle pixels, about 4GB once decoded, are rejected before allocating
+    tga::tga_header header{};
+    header.image_type = tga::TGA_RLE_RBG;
+    header.width = 27759;
+    header.height = 37695;
+    header.bits = 32;
+    std::vector<uint8_t> bytes(563, 0xFF);
+    memcpy(bytes.data(), &header, sizeof(header));
+
+    const auto res = tga::try_load_memory<pixel32rgba>(bytes.data(), bytes.size());
+    IMPP_CHECK(!res && res.get_error().code == error::ERROR_TRUNCATED);
+    IMPP_CHECK(!tga::try_load_memory_scaled<pixel32rgba>(bytes.data(), bytes.size(), 2));
+    IMPP_CHECK(!tga::try_load_memory_region<pixel32rgba>(bytes.data(), bytes.size(), 0, 0, 27759, 37695));
+
+    // raw pixels need every byte
+    header.image_type = tga::TGA_UNCOMPRESSED_RGB;
+    header.width = 16;
+    header.height = 16;
+    memcpy(bytes.data(), &header, sizeof(header));
+    IMPP_CHECK(!tga::try_load_memory<pixel32rgba>(bytes.data(), bytes.size()));
+    bytes.resize(sizeof(header) + 16 * 16 * 4);
+    IMPP_CHECK(tga::try_load_memory<pixel32rgba>(bytes.data(), bytes.size()).has_value());
+
+    // an empty color map has nothing to read
+    header.colormap_type = 1;
+    header.colormap_entrysize = 32;
+    memcpy(bytes.data(), &header, sizeof(header));
+    IMPP_CHECK(tga::try_load_memory_region<pixel32rgba>(bytes.data(), bytes.size(), 0, 0, 16, 16).has_value());
+}
+
+IMPP_TEST(tga_rle_packets)
+{
+    // raw packets run up to the next repeated pixel instead of stopping after two pixels
+    auto source = image<pixel32rgba>::create(300, 1);
+    for (size_t i = 0; i < 300; i++)
+        source.pixels[i] = i < 200 ? pixel32rgba{ uint8_t(i), uint8_t(i * 3), 1, 255 } : pixel32rgba{ 9, 9, 9, 255 };
+    memory_encoder enc;
+    IMPP_CHECK(tga::save_to_memory<tga::TGA_RLE_RBG>(source, enc));
+    // two raw packets of 128 and 72 pixels, a run of 100
+    IMPP_CHECK(enc.get_writesize() == sizeof(tga::tga_header) + 1 + 128 * 4 + 1 + 72 * 4 + 1 + 4);
+    IMPP_CHECK(roundtrip<tga::TGA_RLE_RBG>(source).pixels == source.pixels);
+}
+
+IMPP_TEST(tga_save_auto)
+{
+    const auto check = [](const auto& source, tga::tga_type expected, uint8_t bits, const tga::tga_auto_options& options = {}) {
+        using pixel = typename std::decay_t<decltype(source)>::pixel;
+        memory_encoder enc;
+        tga::tga_format format;
+        if (!tga::save_auto_to_memory(source, enc, &format, options))
+            return false;
+        const auto loaded = tga::load_memory<pixel>(enc.get_data(), enc.get_writesize());
+        return format.type == expected && format.bits == bits && format.size == enc.get_writesize() && loaded.pixels == source.pixels;
+    };
+
+    // noise does not compress, opaque 32bit images lose their alpha
+    auto noise = unit::random_image<pixel32rgba>(120, 80);
+    IMPP_CHECK(check(noise, tga::TGA_UNCOMPRESSED_RGB, 32));
+    for (auto& px : noise.pixels)
+        px.a = 255;
+    IMPP_CHECK(check(noise, tga::TGA_UNCOMPRESSED_RGB, 24));
+
+    // a two colors mask takes a byte per index, a flat image is a handful of runs
+    auto mask = unit::random_image<pixel24bgr>(64, 64);
+    for (auto& px : mask.pixels)
+        px = px.r % 2 ? pixel24bgr{ 0, 0, 0 } : pixel24bgr{ 255, 255, 255 };
+    IMPP_CHECK(check(mask, tga::TGA_UNCOMPRESSED_MAPPED, 8));
+    const auto flat = image<pixel32rgba>::create(256, 256, std::vector<pixel32rgba>(65536, pixel32rgba{ 1, 2, 3, 0 }));
+    IMPP_CHECK(check(flat, tga::TGA_RLE_RBG, 32));
+
+    // a wider tolerance keeps a format faster to decode
+    tga::tga_auto_options tolerant;
+    tolerant.tolerance = 100.0;
+    IMPP_CHECK(check(flat, tga::TGA_UNCOMPRESSED_MAPPED, 8, tolerant));
+    tolerant.tolerance = 1000.0;
+    IMPP_CHECK(check(flat, tga::TGA_UNCOMPRESSED_RGB, 32, tolerant));
+
+    // sampled rows estimate the size of the whole image
+    auto sample = tga::load<pixel24bgr>(unit::workdir("init.tga"));
+    tga::tga_auto_options exact;
+    exact.sample_rows = 0;
+    memory_encoder rle;
+    IMPP_CHECK(tga::save_to_memory<tga::TGA_RLE_RBG>(sample, rle));
+    const auto sampled = tga::detail::rle_estimate_size(sample, 3, 64) + sizeof(tga::tga_header);
+    IMPP_CHECK(tga::detail::rle_estimate_size(sample, 3, 0) + sizeof(tga::tga_header) == rle.get_writesize());
+    IMPP_CHECK(sampled > rle.get_writesize() * 8 / 10 && sampled < rle.get_writesize() * 12 / 10);
+
+    const auto filename = unit::tempfile("auto.tga");
+    const auto saved = tga::try_save_auto_to_file(sample, filename, exact);
+    IMPP_CHECK(saved && saved->size == std::filesystem::file_size(filename) && saved->estimated_size <= saved->size + 256);
+    IMPP_CHECK(tga::load<pixel24bgr>(filename).pixels == sample.pixels);
+    std::filesystem::remove(filename);
+}
+
+IMPP_TEST(tga_rle_optimal)
+{
+    // dithered rows of three colors, where greedy runs of two pixels break the raw packets
+    std::mt19937 rng(5);
+    const pixel24bgr colors[] = { { 0, 0, 0 }, { 255, 0, 0 }, { 0, 0, 255 } };
+    auto dithered = image<pixel24bgr>::create(333, 40);
+    for (auto& px : dithered.pixels)
+        px = colors[rng() % 3];
+    for (size_t i = 2000; i < 2400; i++)
+        dithered.pixels[i] = colors[0];
+
+    // the fewest bytes found by trying every packet at every position
+    const auto fewest = [](const std::vector<pixel24bgr>& pixels, size_t color_bytes) {
+        std::vector<size_t> best(pixels.size() + 1, 0);
+        for (size_t i = pixels.size(); i-- > 0;)
+        {
+            best[i] = SIZE_MAX;
+            bool repeated = true;
+            for (size_t length = 1; length <= 128 && i + length <= pixels.size(); length++)
+            {
+                repeated = repeated && pixels[i + length - 1] == pixels[i];
+                best[i] = std::min(best[i], 1 + (repeated ? 1 : length) * color_bytes + best[i + length]);
+            }
+        }
+        return best[0];
+    };
+
+    memory_encoder greedy, optimal;
+    IMPP_CHECK(tga::save_to_memory<tga::TGA_RLE_RBG>(dithered, greedy));
+    IMPP_CHECK(tga::save_to_memory<tga::TGA_RLE_RBG>(dithered, optimal, tga::TGA_RLE_OPTIMAL));
+    IMPP_CHECK(optimal.get_writesize() == sizeof(tga::tga_header) + fewest(dithered.pixels, 3));
+    IMPP_CHECK(optimal.get_writesize() <= greedy.get_writesize());
+    IMPP_CHECK(tga::load_memory<pixel24bgr>(optimal.get_data(), optimal.get_writesize()).pixels == dithered.pixels);
+
+    // 32bit pixels, long runs and noise
+    auto noise = unit::random_image<pixel32rgba>(200, 50);
+    for (size_t i = 100; i < 3000; i++)
+        noise.pixels[i] = noise.pixels[99];
+    memory_encoder rgba;
+    IMPP_CHECK(tga::save_to_memory<tga::TGA_RLE_RBG>(noise, rgba, tga::TGA_RLE_OPTIMAL));
+    IMPP_CHECK(tga::load_memory<pixel32rgba>(rgba.get_data(), rgba.get_writesize()).pixels == noise.pixels);
+
+    tga::tga_auto_options options;
+    options.rle_mode = tga::TGA_RLE_OPTIMAL;
+    options.sample_rows = 0;
+    const auto chosen = tga::choose_format(dithered, options);
+    IMPP_CHECK(chosen.type != tga::TGA_RLE_RBG || chosen.estimated_size == optimal.get_writesize());
+
+    // greedy runs of two pixels cost the most when pixels take a single byte, like palette indexes
+    const auto row = image<pixel24bgr>::create(dithered.width, 1, std::vector<pixel24bgr>(dithered.pixels.begin(), dithered.pixels.begin() + dithered.width));
+    const auto bytewide = tga::detail::rle_estimate_size(row, 1, 0, tga::TGA_RLE_OPTIMAL);
+    IMPP_CHECK(bytewide == fewest(row.pixels, 1) && bytewide < tga::detail::rle_estimate_size(row, 1, 0));
+
+    // packets are planned by segments, each one is optimal and a run across their boundary is split
+    auto large = image<pixel24bgr>::create(400, 400);
+    for (auto& px : large.pixels)
+        px = colors[rng() % 3];
+    std::fill(large.pixels.begin() + tga::detail::rle_optimal_segment - 50, large.pixels.begin() + tga::detail::rle_optimal_segment + 50, colors[1]);
+    memory_encoder segmented;
+    IMPP_CHECK(tga::save_to_memory<tga::TGA_RLE_RBG>(large, segmented, tga::TGA_RLE_OPTIMAL));
+    size_t planned = sizeof(tga::tga_header);
+    for (size_t base = 0; base < large.pixels.size(); base += tga::detail::rle_optimal_segment)
+    {
+        const auto end = large.pixels.begin() + std::min(large.pixels.size(), base + tga::detail::rle_optimal_segment);
+        planned += fewest(std::vector<pixel24bgr>(large.pixels.begin() + base, end), 3);
+    }
+    IMPP_CHECK(segmented.get_writesize() == planned);
+    IMPP_CHECK(tga::load_memory<pixel24bgr>(segmented.get_data(), segmented.get_writesize()).pixels == large.pixels);
+}
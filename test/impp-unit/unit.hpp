@@ -0,0 +1,89 @@
+#pragma once
+#ifndef IMPP_TEST_UNIT_HPP
+#define IMPP_TEST_UNIT_HPP
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <iterator>
+#include <random>
+#include <string>
+#include <vector>
+#include <image.hpp>
+
+// minimal self registering test runner, every test is a function checking its expectations
+namespace unit
+{
+    struct test_case
+    {
+        const char* name;
+        std::function<void()> func;
+    };
+
+    inline std::vector<test_case>& registry()
+    {
+        static std::vector<test_case> tests;
+        return tests;
+    }
+
+    inline int& failures()
+    {
+        static int count = 0;
+        return count;
+    }
+
+    inline bool add(const char* name, std::function<void()> func)
+    {
+        registry().push_back({ name, std::move(func) });
+        return true;
+    }
+
+    inline void fail(const char* expr, const char* file, int line)
+    {
+        failures()++;
+        std::cout << "  FAILED " << file << ":" << line << ": " << expr << std::endl;
+    }
+
+    // size of the largest allocation since it was last reset, kept by the operator new of main.cpp
+    inline std::atomic<size_t> largest_allocation = 0;
+
+    inline std::string workdir(const std::string& filename)
+    {
+        return std::string(IMPP_TEST_WORKDIR) + "/" + filename;
+    }
+
+    // path for files written by the tests, outside of the source tree
+    inline std::string tempfile(const std::string& filename)
+    {
+        return (std::filesystem::temp_directory_path() / ("impp-unit-" + filename)).string();
+    }
+
+    inline std::vector<uint8_t> read_file(const std::string& filename)
+    {
+        std::ifstream f(filename, std::ios::binary);
+        return { std::istreambuf_iterator<char>(f), std::istreambuf_iterator<char>() };
+    }
+
+    // image filled with reproducible random bytes
+    template<class pixel>
+    impp::image<pixel> random_image(uint32_t width, uint32_t height, uint32_t seed = 1)
+    {
+        std::mt19937 rng(seed);
+        auto ret = impp::image<pixel>::create(width, height);
+        auto* bytes = reinterpret_cast<uint8_t*>(ret.pixels.data());
+        for (size_t i = 0; i < ret.pixels.size() * sizeof(pixel); i++)
+            bytes[i] = static_cast<uint8_t>(rng());
+        return ret;
+    }
+}
+
+#define IMPP_CHECK(expr) do { if (!(expr)) unit::fail(#expr, __FILE__, __LINE__); } while (false)
+
+#define IMPP_TEST(name) \
+    static void name(); \
+    static const bool name##_registered = unit::add(#name, name); \
+    static void name()
+
+#endif //IMPP_TEST_UNIT_HPP
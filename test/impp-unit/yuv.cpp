@@ -0,0 +1,176 @@
+#include <cmath>
+#include <yuv.hpp>
+#include "unit.hpp"
+
+using namespace impp;
+
+namespace
+{
+    struct reference
+    {
+        double kr, kb, ys, cs, offset;
+
+        reference(yuv_matrix matrix, yuv_range range)
+        {
+            kr = matrix == YUV_BT709 ? 0.2126 : 0.299;
+            kb = matrix == YUV_BT709 ? 0.0722 : 0.114;
+            const bool limited = range == YUV_RANGE_LIMITED;
+            ys = limited ? 219.0 / 255 : 1.0;
+            cs = limited ? 224.0 / 255 : 1.0;
+            offset = limited ? 16 : 0;
+        }
+
+        std::array<double, 3> forward(double r, double g, double b) const
+        {
+            const double y = kr * r + (1 - kr - kb) * g + kb * b;
+            return { offset + y * ys, 128 + (b - y) / (2 * (1 - kb)) * cs, 128 + (r - y) / (2 * (1 - kr)) * cs };
+        }
+
+        std::array<double, 3> inverse(double y, double cb, double cr) const
+        {
+            y = (y - offset) / ys;
+            const double u = (cb - 128) / cs * 2 * (1 - kb), v = (cr - 128) / cs * 2 * (1 - kr);
+            const double r = y + v, b = y + u;
+            return { r, (y - kr * r - kb * b) / (1 - kr - kb), b };
+        }
+    };
+
+    bool near(double value, uint8_t actual, double tolerance)
+    {
+        return std::abs(std::clamp(value, 0.0, 255.0) - actual) <= tolerance;
+    }
+
+    // frame row y and image row y both count from the top
+    const pixel32rgba& at(const image<pixel32rgba>& img, uint32_t x, uint32_t y)
+    {
+        return *img.get_pixel(x, y);
+    }
+}
+
+IMPP_TEST(yuv_forward)
+{
+    const auto source = unit::random_image<pixel32rgba>(37, 23);
+    for (auto matrix : { YUV_BT601, YUV_BT709 })
+        for (auto range : { YUV_RANGE_LIMITED, YUV_RANGE_FULL })
+        {
+            yuv_options options;
+            options.matrix = matrix;
+            options.range = range;
+            const reference ref(matrix, range);
+
+            const auto full = rgb_to_yuv(source, YUV_444, options);
+            bool close = true;
+            for (uint32_t y = 0; y < source.height; y++)
+                for (uint32_t x = 0; x < source.width; x++)
+                {
+                    const auto& px = at(source, x, y);
+                    const auto expected = ref.forward(px.r, px.g, px.b);
+                    const size_t i = size_t(y) * source.width + x;
+                    close &= near(expected[0], full.get_plane(0)[i], 0.51) && near(expected[1], full.get_plane(1)[i], 0.51) && near(expected[2], full.get_plane(2)[i], 0.51);
+                }
+            IMPP_CHECK(close);
+
+            // chroma of the blocks, the last column and row of odd sides are repeated
+            const auto i420 = rgb_to_yuv(source, YUV_I420, options);
+            IMPP_CHECK(i420.get_chroma_width() == 19 && i420.get_chroma_height() == 12 && i420.get_data().size() == 37 * 23 + 19 * 12 * 2);
+            IMPP_CHECK(memcmp(i420.get_plane(0), full.get_plane(0), 37 * 23) == 0);
+            for (uint32_t by = 0; by < 12; by++)
+                for (uint32_t bx = 0; bx < 19; bx++)
+                {
+                    double r = 0, g = 0, b = 0;
+                    for (uint32_t dy = 0; dy < 2; dy++)
+                        for (uint32_t dx = 0; dx < 2; dx++)
+                        {
+                            const auto& px = at(source, std::min(bx * 2 + dx, 36u), std::min(by * 2 + dy, 22u));
+                            r += px.r / 4.0, g += px.g / 4.0, b += px.b / 4.0;
+                        }
+                    const auto expected = ref.forward(r, g, b);
+                    close &= near(expected[1], i420.get_plane(1)[by * 19 + bx], 0.51) && near(expected[2], i420.get_plane(2)[by * 19 + bx], 0.51);
+                }
+            IMPP_CHECK(close);
+
+            // nv12 interleaves the same values
+            const auto nv12 = rgb_to_yuv(source, YUV_NV12, options);
+            bool same = nv12.get_plane_count() == 2 && nv12.get_stride(1) == 38 && memcmp(nv12.get_plane(0), i420.get_plane(0), 37 * 23) == 0;
+            for (size_t i = 0; i < 19 * 12; i++)
+                same &= nv12.get_plane(1)[i * 2] == i420.get_plane(1)[i] && nv12.get_plane(1)[i * 2 + 1] == i420.get_plane(2)[i];
+            IMPP_CHECK(same);
+        }
+
+    // white and black land on the ends of the range, grays on neutral chroma
+    const auto gray = image<pixel32bgra>::create(4, 2, { { 255, 255, 255, 255 }, { 0, 0, 0, 255 }, { 128, 128, 128, 255 }, { 1, 1, 1, 0 },
+        { 255, 255, 255, 255 }, { 0, 0, 0, 255 }, { 128, 128, 128, 255 }, { 1, 1, 1, 0 } });
+    const auto limited = rgb_to_yuv(gray, YUV_444);
+    IMPP_CHECK(limited.get_plane(0)[0] == 235 && limited.get_plane(0)[1] == 16 && limited.get_plane(1)[2] == 128 && limited.get_plane(2)[3] == 128);
+    yuv_options full_range;
+    full_range.range = YUV_RANGE_FULL;
+    full_range.matrix = YUV_BT709;
+    const auto full = rgb_to_yuv(gray, YUV_I420, full_range);
+    IMPP_CHECK(full.get_plane(0)[0] == 255 && full.get_plane(0)[1] == 0 && full.get_plane(0)[2] == 128 && full.get_plane(1)[0] == 128 && full.get_plane(2)[1] == 128);
+}
+
+IMPP_TEST(yuv_pixel_types)
+{
+    // the vectorized 32bit kernels compute the same integers as the scalar 24bit ones
+    auto source = unit::random_image<pixel32rgba>(203, 31);
+    const auto bgra = image_convert<pixel32bgra>(source);
+    const auto rgb = image_convert<pixel24rgb>(source);
+    for (auto layout : { YUV_444, YUV_I420, YUV_NV12 })
+    {
+        const auto frame = rgb_to_yuv(source, layout);
+        IMPP_CHECK(frame.get_data() == rgb_to_yuv(bgra, layout).get_data() && frame.get_data() == rgb_to_yuv(rgb, layout).get_data());
+        const auto back = yuv_to_rgb<pixel32rgba>(frame);
+        IMPP_CHECK(back.pixels == image_convert<pixel32rgba>(yuv_to_rgb<pixel24bgr>(frame)).pixels);
+        IMPP_CHECK(back.pixels == image_convert<pixel32rgba>(yuv_to_rgb(frame)).pixels);
+    }
+
+    // rows are read from the top whatever the orientation
+    auto flipped = source;
+    flipped.orientation = image<pixel32rgba>::LEFT_BOTTOM;
+    for (uint32_t y = 0; y < source.height; y++)
+        for (uint32_t x = 0; x < source.width; x++)
+            flipped.set_pixel(x, y, at(source, x, y));
+    IMPP_CHECK(rgb_to_yuv(flipped, YUV_I420).get_data() == rgb_to_yuv(source, YUV_I420).get_data());
+}
+
+IMPP_TEST(yuv_inverse)
+{
+    const auto source = unit::random_image<pixel32rgba>(45, 18);
+    for (auto range : { YUV_RANGE_LIMITED, YUV_RANGE_FULL })
+        for (auto layout : { YUV_444, YUV_I420, YUV_NV12 })
+        {
+            yuv_options options;
+            options.range = range;
+            options.matrix = YUV_BT709;
+            const reference ref(YUV_BT709, range);
+            const auto frame = rgb_to_yuv(source, layout, options);
+            const auto back = yuv_to_rgb<pixel32rgba>(frame, options);
+
+            const bool halved = layout != YUV_444;
+            const uint8_t* cb = frame.get_plane(1);
+            const uint8_t* cr = layout == YUV_NV12 ? cb + 1 : frame.get_plane(2);
+            const size_t step = layout == YUV_NV12 ? 2 : 1;
+            bool close = back.orientation == image<pixel32rgba>::LEFT_TOP;
+            for (uint32_t y = 0; y < source.height; y++)
+                for (uint32_t x = 0; x < source.width; x++)
+                {
+                    const size_t c = (halved ? y / 2 : y) * frame.get_stride(1) + (halved ? x / 2 : x) * step;
+                    const auto expected = ref.inverse(frame.get_plane(0)[y * 45 + x], cb[c], cr[c]);
+                    const auto& px = at(back, x, y);
+                    close &= near(expected[0], px.r, 1.0) && near(expected[1], px.g, 1.0) && near(expected[2], px.b, 1.0) && px.a == 255;
+                    // 4:4:4 frames give the pixels back within the rounding of the planes
+                    if (!halved)
+                        close &= std::abs(px.r - at(source, x, y).r) <= 3 && std::abs(px.g - at(source, x, y).g) <= 3 && std::abs(px.b - at(source, x, y).b) <= 3;
+                }
+            IMPP_CHECK(close);
+        }
+
+    // bands of rows on several workers
+    const auto large = unit::random_image<pixel32bgra>(640, 480);
+    yuv_options threaded;
+    threaded.threads = 3;
+    const auto frame = rgb_to_yuv(large, YUV_NV12);
+    IMPP_CHECK(frame.get_data() == rgb_to_yuv(large, YUV_NV12, threaded).get_data());
+    IMPP_CHECK(yuv_to_rgb(frame).pixels == yuv_to_rgb(frame, threaded).pixels);
+    IMPP_CHECK(rgb_to_yuv(image<pixel32rgba>::null(), YUV_I420).empty() && yuv_to_rgb(yuv_frame{}).empty());
+}
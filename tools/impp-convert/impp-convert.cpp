@@ -0,0 +1,565 @@
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <codec.hpp>
+#include <hash.hpp>
+
+// impp-convert [--format name] [--bits 24|32] [--threads n] [--queue n] [--update mtime|hash|always]
+//              [--rle greedy|optimal] [--quiet] -o outdir inputs...
+// inputs are files or directories walked recursively, the relative paths are kept under outdir
+// files are read, decoded, converted, encoded and written by a bounded pipeline of stages
+
+using namespace impp;
+namespace fs = std::filesystem;
+
+namespace
+{
+    using clock_type = std::chrono::steady_clock;
+
+    enum output_format : uint8_t {
+        FORMAT_TGA = 0,
+        FORMAT_TGA_RLE,
+        FORMAT_TGA_MAPPED,
+        FORMAT_TGA_AUTO,
+        FORMAT_PNG,
+        FORMAT_QOI,
+        FORMAT_DDS
+    };
+
+    enum update_mode : uint8_t {
+        UPDATE_MTIME = 0,   // outputs newer than their input are skipped before reading
+        UPDATE_HASH,        // outputs made from the same input bytes and options are skipped, kept in a manifest
+        UPDATE_ALWAYS
+    };
+
+    struct format_entry
+    {
+        const char* name;
+        const char* extension;
+        output_format format;
+    };
+
+    constexpr format_entry formats[] = {
+        { "tga", ".tga", FORMAT_TGA },
+        { "tga-rle", ".tga", FORMAT_TGA_RLE },
+        { "tga-mapped", ".tga", FORMAT_TGA_MAPPED },
+        { "tga-auto", ".tga", FORMAT_TGA_AUTO },
+        { "png", ".png", FORMAT_PNG },
+        { "qoi", ".qoi", FORMAT_QOI },
+        { "dds", ".dds", FORMAT_DDS },
+    };
+
+    // extensions of the inputs found walking directories, files given by name are always converted
+    constexpr const char* input_extensions[] = { ".tga", ".bmp", ".png", ".qoi", ".dds" };
+
+    // name of the file keeping the input hashes of the outputs in hash mode
+    constexpr const char* manifest_name = ".impp-convert";
+
+    struct options
+    {
+        std::vector<std::string> inputs;
+        std::string outdir;
+        const format_entry* format = &formats[1];
+        uint32_t bits = 0;              // 0 keeps the alpha channel of the sources that have one
+        unsigned threads = 0;
+        size_t queue = 0;               // files held between two stages, 0 is twice the workers
+        update_mode update = UPDATE_MTIME;
+        tga::tga_rle_mode rle = tga::TGA_RLE_GREEDY;
+        bool quiet = false;
+    };
+
+    struct job
+    {
+        fs::path source;
+        fs::path dest;
+        std::string key;                // dest relative to outdir, the manifest entry
+        std::vector<uint8_t> data;      // input bytes, then encoded bytes
+        hash128 hash;
+        uint64_t pixels = 0;
+        std::string error;
+    };
+
+    // stages block on a full queue so a slow stage holds back the ones before it
+    template<class item>
+    class bounded_queue
+    {
+    public:
+        explicit bounded_queue(size_t capacity) : _capacity(std::max<size_t>(capacity, 1)) {}
+
+        void push(item value)
+        {
+            std::unique_lock lock(_mutex);
+            _not_full.wait(lock, [&] { return _items.size() < _capacity; });
+            _items.push_back(std::move(value));
+            _not_empty.notify_one();
+        }
+
+        // false once the queue is closed and drained
+        bool pop(item* value)
+        {
+            std::unique_lock lock(_mutex);
+            _not_empty.wait(lock, [&] { return !_items.empty() || _closed; });
+            if (_items.empty())
+                return false;
+            *value = std::move(_items.front());
+            _items.pop_front();
+            _not_full.notify_one();
+            return true;
+        }
+
+        void close()
+        {
+            std::lock_guard lock(_mutex);
+            _closed = true;
+            _not_empty.notify_all();
+        }
+
+    private:
+        std::mutex _mutex;
+        std::condition_variable _not_full;
+        std::condition_variable _not_empty;
+        std::deque<item> _items;
+        size_t _capacity;
+        bool _closed = false;
+    };
+
+    // busy time of a stage summed over its threads
+    class stage_timer
+    {
+    public:
+        clock_type::time_point start() const { return clock_type::now(); }
+
+        void stop(clock_type::time_point begin)
+        {
+            _nanoseconds += std::chrono::duration_cast<std::chrono::nanoseconds>(clock_type::now() - begin).count();
+        }
+
+        double seconds() const { return _nanoseconds.load() / 1e9; }
+
+    private:
+        std::atomic<int64_t> _nanoseconds{ 0 };
+    };
+
+    struct statistics
+    {
+        std::atomic<size_t> found{ 0 };
+        std::atomic<size_t> converted{ 0 };
+        std::atomic<size_t> skipped{ 0 };
+        std::atomic<size_t> failed{ 0 };
+        std::atomic<uint64_t> bytes_read{ 0 };
+        std::atomic<uint64_t> bytes_written{ 0 };
+        std::atomic<uint64_t> pixels{ 0 };
+        stage_timer read;
+        stage_timer decode;
+        stage_timer encode;
+        stage_timer write;
+    };
+
+    std::string lowercase(std::string text)
+    {
+        std::transform(text.begin(), text.end(), text.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+        return text;
+    }
+
+    bool is_input(const fs::path& path)
+    {
+        const auto extension = lowercase(path.extension().string());
+        return std::any_of(std::begin(input_extensions), std::end(input_extensions), [&](const char* e) { return extension == e; });
+    }
+
+    std::string hex(const hash128& hash)
+    {
+        std::ostringstream out;
+        out << std::hex << std::setfill('0') << std::setw(16) << hash.high << std::setw(16) << hash.low;
+        return out.str();
+    }
+
+    // the options changing the output bytes take part in the input hash
+    uint64_t options_seed(const options& opt)
+    {
+        const std::string text = std::string(opt.format->name) + "/" + std::to_string(opt.bits) + "/" + std::to_string(opt.rle);
+        return hash_bytes(text.data(), text.size()).low;
+    }
+
+    std::map<std::string, std::string> read_manifest(const fs::path& filename)
+    {
+        std::map<std::string, std::string> ret;
+        std::ifstream file(filename);
+        for (std::string hash, key; file >> hash && std::getline(file >> std::ws, key);)
+            ret[key] = hash;
+        return ret;
+    }
+
+    void write_manifest(const fs::path& filename, const std::map<std::string, std::string>& manifest)
+    {
+        std::ofstream file(filename, std::ios::trunc);
+        for (const auto& [key, hash] : manifest)
+            file << hash << ' ' << key << '\n';
+    }
+
+    // files to convert with their destinations, the outputs already up to date by mtime are counted as skipped
+    std::vector<job> collect(const options& opt, statistics& stats)
+    {
+        std::vector<job> ret;
+        std::map<std::string, fs::path> claims;
+        auto add = [&](const fs::path& source, const fs::path& relative) {
+            job added;
+            added.source = source;
+            added.dest = fs::path(opt.outdir) / relative;
+            added.dest.replace_extension(opt.format->extension);
+            added.key = fs::path(relative).replace_extension(opt.format->extension).generic_string();
+            stats.found++;
+
+            // a.tga and a.bmp would both write a.tga
+            const auto [claimed, inserted] = claims.emplace(added.key, source);
+            if (!inserted)
+            {
+                std::cerr << "impp-convert: " << source.string() << ": " << added.dest.string() << " is already written from " << claimed->second.string() << std::endl;
+                stats.failed++;
+                return;
+            }
+
+            std::error_code ec;
+            if (opt.update == UPDATE_MTIME && fs::exists(added.dest, ec) && fs::last_write_time(added.dest, ec) >= fs::last_write_time(source, ec) && !ec)
+            {
+                stats.skipped++;
+                return;
+            }
+            ret.push_back(std::move(added));
+        };
+
+        for (const auto& input : opt.inputs)
+        {
+            std::error_code ec;
+            if (fs::is_directory(input, ec))
+            {
+                // sorted so the same tree always gives the same order and the same conflicts
+                std::vector<fs::path> found;
+                for (const auto& entry : fs::recursive_directory_iterator(input, fs::directory_options::skip_permission_denied, ec))
+                    if (entry.is_regular_file(ec) && is_input(entry.path()))
+                        found.push_back(entry.path());
+                std::sort(found.begin(), found.end());
+                for (const auto& path : found)
+                    add(path, fs::relative(path, input, ec));
+            }
+            else if (fs::is_regular_file(input, ec))
+                add(input, fs::path(input).filename());
+            else
+            {
+                std::cerr << "impp-convert: " << input << ": no such file or directory" << std::endl;
+                stats.failed++;
+            }
+        }
+        return ret;
+    }
+
+    bool read_file(const fs::path& filename, std::vector<uint8_t>* data)
+    {
+        std::ifstream file(filename, std::ios::binary | std::ios::ate);
+        if (!file)
+            return false;
+        data->resize(static_cast<size_t>(file.tellg()));
+        file.seekg(0);
+        return static_cast<bool>(file.read(reinterpret_cast<char*>(data->data()), data->size()));
+    }
+
+    bool write_file(const fs::path& filename, const std::vector<uint8_t>& data)
+    {
+        std::error_code ec;
+        fs::create_directories(filename.parent_path(), ec);
+        std::ofstream file(filename, std::ios::binary | std::ios::trunc);
+        return file && file.write(reinterpret_cast<const char*>(data.data()), data.size());
+    }
+
+    template<pixel_type pixel>
+    result<size_t> encode(const image<pixel>& source, const options& opt, memory_encoder& enc)
+    {
+        switch (opt.format->format)
+        {
+        case FORMAT_TGA:
+            return tga::try_save_to_memory<tga::TGA_UNCOMPRESSED_RGB>(source, enc);
+        case FORMAT_TGA_RLE:
+            return tga::try_save_to_memory<tga::TGA_RLE_RBG>(source, enc, opt.rle);
+        case FORMAT_TGA_MAPPED:
+            return tga::try_save_to_memory<tga::TGA_UNCOMPRESSED_MAPPED>(source, enc);
+        case FORMAT_TGA_AUTO:
+        {
+            tga::tga_auto_options auto_options;
+            auto_options.rle_mode = opt.rle;
+            const auto res = tga::try_save_auto_to_memory(source, enc, auto_options);
+            if (!res)
+                return res.get_error();
+            return enc.get_writesize();
+        }
+        case FORMAT_PNG:
+            return png::try_save_to_memory(source, enc);
+        case FORMAT_QOI:
+            return qoi::try_save_to_memory(source, enc);
+        case FORMAT_DDS:
+            // the files are already spread over the workers
+            return dds::try_save_to_memory(source, enc, dds::DDS_FORMAT_BC3, 1);
+        }
+        return error::error_info{ error::ERROR_INVALID_ARGUMENT, 0, "impp-convert: unknown format." };
+    }
+
+    // decodes straight to the pixel type of the destination format, the input bytes are replaced by the encoded ones
+    template<pixel_type pixel>
+    bool convert(job& item, const options& opt, statistics& stats)
+    {
+        auto begin = stats.decode.start();
+        auto decoded = try_load_memory<pixel>(item.data.data(), item.data.size());
+        stats.decode.stop(begin);
+        if (!decoded)
+        {
+            item.error = decoded.get_error().message;
+            return false;
+        }
+        const auto& source = decoded.value();
+        item.pixels = source.pixels.size();
+
+        begin = stats.encode.start();
+        memory_encoder enc(error::ERROR_POLICY_RECORD);
+        const auto encoded = encode(source, opt, enc);
+        stats.encode.stop(begin);
+        if (!encoded)
+        {
+            item.error = encoded.get_error().message;
+            return false;
+        }
+        item.data.assign(enc.get_data(), enc.get_data() + enc.get_writesize());
+        return true;
+    }
+
+    bool convert(job& item, const options& opt, statistics& stats)
+    {
+        uint32_t bits = opt.bits;
+        if (bits == 0)
+        {
+            const auto info = try_probe_memory(item.data.data(), item.data.size());
+            bits = info && !info.value().alpha ? 24 : 32;
+        }
+
+        // tga stores bgr pixels, the other formats rgb ones
+        const bool bgr = opt.format->format <= FORMAT_TGA_AUTO;
+        if (bits == 24)
+            return bgr ? convert<pixel24bgr>(item, opt, stats) : convert<pixel24rgb>(item, opt, stats);
+        return bgr ? convert<pixel32bgra>(item, opt, stats) : convert<pixel32rgba>(item, opt, stats);
+    }
+
+    void print_statistics(const statistics& stats, double seconds, unsigned workers)
+    {
+        const auto mb = [](uint64_t bytes) { return bytes / 1e6; };
+        std::cout << std::fixed << std::setprecision(2)
+            << "files: " << stats.found << " found, " << stats.converted << " converted, "
+            << stats.skipped << " up to date, " << stats.failed << " failed\n"
+            << "data: " << mb(stats.bytes_read) << " MB read, " << mb(stats.bytes_written) << " MB written, "
+            << stats.pixels / 1e6 << " Mpixels\n"
+            << "time: " << seconds << " s on " << workers << " workers, "
+            << mb(stats.bytes_read) / seconds << " MB/s read, " << stats.pixels / 1e6 / seconds << " Mpixels/s, "
+            << stats.converted / seconds << " files/s\n"
+            << "busy: read " << stats.read.seconds() << " s, decode " << stats.decode.seconds() << " s, encode "
+            << stats.encode.seconds() << " s, write " << stats.write.seconds() << " s" << std::endl;
+    }
+
+    // the whole text must be a number
+    template<class number>
+    bool parse_number(const std::string& text, number* value)
+    {
+        const auto [end, ec] = std::from_chars(text.data(), text.data() + text.size(), *value);
+        return ec == std::errc() && end == text.data() + text.size();
+    }
+
+    bool parse(int argc, char** argv, options* opt)
+    {
+        for (int i = 1; i < argc; i++)
+        {
+            const std::string arg = argv[i];
+            if (arg == "--quiet")
+            {
+                opt->quiet = true;
+                continue;
+            }
+            if (arg.empty() || arg[0] != '-')
+            {
+                opt->inputs.push_back(arg);
+                continue;
+            }
+            if (i + 1 >= argc)
+                return false;
+
+            const std::string value = argv[++i];
+            if (arg == "-o")
+                opt->outdir = value;
+            else if (arg == "--format")
+            {
+                const auto found = std::find_if(std::begin(formats), std::end(formats), [&](const format_entry& f) { return value == f.name; });
+                if (found == std::end(formats))
+                    return false;
+                opt->format = found;
+            }
+            else if (arg == "--bits")
+            {
+                if (!parse_number(value, &opt->bits) || (opt->bits != 24 && opt->bits != 32))
+                    return false;
+            }
+            else if (arg == "--threads")
+            {
+                if (!parse_number(value, &opt->threads))
+                    return false;
+            }
+            else if (arg == "--queue")
+            {
+                if (!parse_number(value, &opt->queue))
+                    return false;
+            }
+            else if (arg == "--update")
+            {
+                if (value == "mtime")
+                    opt->update = UPDATE_MTIME;
+                else if (value == "hash")
+                    opt->update = UPDATE_HASH;
+                else if (value == "always")
+                    opt->update = UPDATE_ALWAYS;
+                else
+                    return false;
+            }
+            else if (arg == "--rle")
+            {
+                if (value == "greedy")
+                    opt->rle = tga::TGA_RLE_GREEDY;
+                else if (value == "optimal")
+                    opt->rle = tga::TGA_RLE_OPTIMAL;
+                else
+                    return false;
+            }
+            else
+                return false;
+        }
+        return !opt->inputs.empty() && !opt->outdir.empty();
+    }
+}
+
+int main(int argc, char** argv)
+{
+    options opt;
+    if (!parse(argc, argv, &opt))
+    {
+        std::cout << "usage: impp-convert [--format tga|tga-rle|tga-mapped|tga-auto|png|qoi|dds] [--bits 24|32] [--threads n]\n"
+            "                    [--queue n] [--update mtime|hash|always] [--rle greedy|optimal] [--quiet] -o outdir inputs..." << std::endl;
+        return 1;
+    }
+
+    const auto begin = clock_type::now();
+    statistics stats;
+    auto jobs = collect(opt, stats);
+
+    const auto manifest_file = fs::path(opt.outdir) / manifest_name;
+    auto manifest = opt.update == UPDATE_HASH ? read_manifest(manifest_file) : std::map<std::string, std::string>{};
+    const uint64_t seed = options_seed(opt);
+
+    // read -> decode, convert and encode on the workers -> write, each queue bounds the files in memory
+    const unsigned workers = detail::parallel_threads(opt.threads);
+    const size_t capacity = opt.queue != 0 ? opt.queue : size_t(workers) * 2;
+    bounded_queue<job> decoding(capacity);
+    bounded_queue<job> writing(capacity);
+
+    std::thread reader([&] {
+        for (auto& item : jobs)
+        {
+            const auto start = stats.read.start();
+            const bool read = read_file(item.source, &item.data);
+            stats.read.stop(start);
+            if (!read)
+                item.error = "unable to read the file";
+            else
+            {
+                stats.bytes_read += item.data.size();
+                // the manifest is only read here, new entries are merged once the threads are joined
+                if (opt.update == UPDATE_HASH)
+                {
+                    item.hash = hash_bytes(item.data.data(), item.data.size(), seed);
+                    const auto found = manifest.find(item.key);
+                    std::error_code ec;
+                    if (found != manifest.end() && found->second == hex(item.hash) && fs::exists(item.dest, ec))
+                    {
+                        stats.skipped++;
+                        continue;
+                    }
+                }
+            }
+            decoding.push(std::move(item));
+        }
+        decoding.close();
+    });
+
+    std::atomic<unsigned> running{ workers };
+    std::vector<std::thread> pool;
+    for (unsigned i = 0; i < workers; i++)
+    {
+        pool.emplace_back([&] {
+            for (job item; decoding.pop(&item);)
+            {
+                if (item.error.empty() && !convert(item, opt, stats))
+                    item.data.clear();
+                writing.push(std::move(item));
+            }
+            if (--running == 0)
+                writing.close();
+        });
+    }
+
+    std::vector<std::pair<std::string, std::string>> written;
+    for (job item; writing.pop(&item);)
+    {
+        if (item.error.empty())
+        {
+            const auto start = stats.write.start();
+            if (!write_file(item.dest, item.data))
+                item.error = "unable to write " + item.dest.string();
+            stats.write.stop(start);
+        }
+        if (!item.error.empty())
+        {
+            std::cerr << "impp-convert: " << item.source.string() << ": " << item.error << std::endl;
+            stats.failed++;
+            continue;
+        }
+
+        stats.converted++;
+        stats.bytes_written += item.data.size();
+        stats.pixels += item.pixels;
+        if (opt.update == UPDATE_HASH)
+            written.emplace_back(item.key, hex(item.hash));
+        if (!opt.quiet)
+            std::cout << item.source.string() << " -> " << item.dest.string() << std::endl;
+    }
+
+    reader.join();
+    for (auto& thread : pool)
+        thread.join();
+
+    if (opt.update == UPDATE_HASH)
+    {
+        for (auto& [key, hash] : written)
+            manifest[key] = hash;
+        std::error_code ec;
+        fs::create_directories(opt.outdir, ec);
+        write_manifest(manifest_file, manifest);
+    }
+
+    print_statistics(stats, std::chrono::duration<double>(clock_type::now() - begin).count(), workers);
+    return stats.failed != 0 ? 1 : 0;
+}